@@ -0,0 +1,174 @@
+﻿#include "ChessPerft.h"
+#include "ChessThreadPool.h"
+
+ChessPerftSuitePosition const g_perftSuite[] =
+{
+    { "start",     CHESS_STARTING_FEN,                                                            5, 4865609ull, 7, 3195901860ull },
+    { "kiwipete",  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",       4, 4085603ull, 5, 193690690ull },
+    { "position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",                                   5, 674624ull,  7, 178633661ull },
+    { "position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",           4, 422333ull,  5, 15833292ull },
+    { "position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",                  4, 2103487ull, 5, 89941194ull },
+    { "position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",   4, 3894594ull, 5, 164075551ull },
+};
+int const g_numPerftSuitePositions = (int)(sizeof(g_perftSuite) / sizeof(g_perftSuite[0]));
+
+//----------------------------------------------------------------------------------------------------------
+ChessPerftHash::ChessPerftHash(int sizeInMB)
+{
+    uint64_t numEntries = 1;
+    while (numEntries * 2 * sizeof(Entry) <= (uint64_t)sizeInMB * 1024 * 1024)
+    {
+        numEntries *= 2;
+    }
+    m_entries = std::make_unique<Entry[]>((size_t)numEntries);
+    m_indexMask = numEntries - 1;
+}
+
+bool ChessPerftHash::Probe(uint64_t key, int depth, uint64_t& out_numNodes) const
+{
+    Entry const& entry = m_entries[key & m_indexMask];
+    uint64_t data = entry.m_data.load(std::memory_order_relaxed);
+    uint64_t check = entry.m_check.load(std::memory_order_relaxed);
+    if ((check ^ data) != key || (int)(data & 0xFF) != depth)
+    {
+        return false;
+    }
+    out_numNodes = data >> 8;
+    return true;
+}
+
+void ChessPerftHash::Store(uint64_t key, int depth, uint64_t numNodes)
+{
+    Entry& entry = m_entries[key & m_indexMask];
+    uint64_t data = (numNodes << 8) | (uint64_t)depth;
+    entry.m_check.store(key ^ data, std::memory_order_relaxed);
+    entry.m_data.store(data, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------------------------------------
+static uint64_t PerftInPlace(ChessPosition& position, int depth, ChessPerftHash* hash)
+{
+    ChessMoveList moves;
+    GenerateLegalMoves(position, moves);
+    if (depth == 1)
+    {
+        return (uint64_t)moves.Size();
+    }
+
+    uint64_t key = 0;
+    if (hash != nullptr)
+    {
+        key = position.GetKey();
+        uint64_t numCachedNodes = 0;
+        if (hash->Probe(key, depth, numCachedNodes))
+        {
+            return numCachedNodes;
+        }
+    }
+
+    uint64_t numNodes = 0;
+    ChessUndoRecord undo;
+    for (ChessMove const& move : moves)
+    {
+        position.MakeMove(move, undo);
+        numNodes += PerftInPlace(position, depth - 1, hash);
+        position.UnmakeMove(undo);
+    }
+
+    if (hash != nullptr)
+    {
+        hash->Store(key, depth, numNodes);
+    }
+    return numNodes;
+}
+
+uint64_t Perft(ChessPosition const& position, int depth, ChessPerftHash* hash)
+{
+    if (depth <= 0)
+    {
+        return 1;
+    }
+    ChessPosition scratch = position;
+    return PerftInPlace(scratch, depth, hash);
+}
+
+uint64_t PerftDivide(ChessPosition const& position, int depth, std::vector<ChessPerftDivideEntry>& out_entries, ChessPerftHash* hash)
+{
+    out_entries.clear();
+
+    ChessMoveList moves;
+    GenerateLegalMoves(position, moves);
+
+    uint64_t numNodes = 0;
+    for (ChessMove const& move : moves)
+    {
+        ChessPosition child = position;
+        child.ApplyMove(move);
+
+        ChessPerftDivideEntry entry;
+        entry.m_move = move;
+        entry.m_numNodes = Perft(child, depth - 1, hash);
+        numNodes += entry.m_numNodes;
+        out_entries.push_back(entry);
+    }
+    return numNodes;
+}
+
+//----------------------------------------------------------------------------------------------------------
+static void SubmitPerftSubtree(ChessThreadPool& pool, ChessTaskGroup& group, ChessPosition const& position, int depth,
+    int numSplitPlies, ChessPerftHash* hash, std::atomic<uint64_t>& out_numNodes)
+{
+    //Small subtrees are not worth a task of their own
+    if (numSplitPlies <= 0 || depth <= 3)
+    {
+        pool.Submit(group, [position, depth, hash, &out_numNodes]()
+        {
+            out_numNodes.fetch_add(Perft(position, depth, hash), std::memory_order_relaxed);
+        });
+        return;
+    }
+
+    ChessMoveList moves;
+    GenerateLegalMoves(position, moves);
+    for (ChessMove const& move : moves)
+    {
+        ChessPosition child = position;
+        child.ApplyMove(move);
+        SubmitPerftSubtree(pool, group, child, depth - 1, numSplitPlies - 1, hash, out_numNodes);
+    }
+}
+
+uint64_t PerftDivideParallel(ChessThreadPool& pool, ChessPosition const& position, int depth, int numSplitPlies,
+    std::vector<ChessPerftDivideEntry>& out_entries, ChessPerftHash* hash)
+{
+    out_entries.clear();
+    if (depth <= 0)
+    {
+        return 1;
+    }
+
+    ChessMoveList moves;
+    GenerateLegalMoves(position, moves);
+    std::unique_ptr<std::atomic<uint64_t>[]> rootCounts = std::make_unique<std::atomic<uint64_t>[]>((size_t)moves.Size());
+
+    ChessTaskGroup group;
+    for (int moveIndex = 0; moveIndex < moves.Size(); ++moveIndex)
+    {
+        rootCounts[moveIndex] = 0;
+        ChessPosition child = position;
+        child.ApplyMove(moves[moveIndex]);
+        SubmitPerftSubtree(pool, group, child, depth - 1, numSplitPlies - 1, hash, rootCounts[moveIndex]);
+    }
+    pool.Wait(group);
+
+    uint64_t numNodes = 0;
+    for (int moveIndex = 0; moveIndex < moves.Size(); ++moveIndex)
+    {
+        ChessPerftDivideEntry entry;
+        entry.m_move = moves[moveIndex];
+        entry.m_numNodes = rootCounts[moveIndex].load();
+        numNodes += entry.m_numNodes;
+        out_entries.push_back(entry);
+    }
+    return numNodes;
+}
@@ -0,0 +1,60 @@
+﻿#pragma once
+#include "ChessMoveGen.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ChessThreadPool;
+
+struct ChessPerftDivideEntry
+{
+    ChessMove m_move;
+    uint64_t m_numNodes = 0;
+};
+
+struct ChessPerftSuitePosition
+{
+    char const* m_name;
+    char const* m_fen;
+    int m_depth;
+    uint64_t m_expectedNodes;
+    int m_deepDepth; //the multi-threaded stress run
+    uint64_t m_expectedDeepNodes;
+};
+
+//----------------------------------------------------------------------------------------------------------
+//Subtree counts keyed by Zobrist key and depth, shared lock-free between threads.
+//Each slot stores (key ^ data, data) so a torn write from two racing threads fails the check instead of returning a wrong count
+class ChessPerftHash
+{
+public:
+    explicit ChessPerftHash(int sizeInMB);
+
+    bool Probe(uint64_t key, int depth, uint64_t& out_numNodes) const;
+    void Store(uint64_t key, int depth, uint64_t numNodes);
+
+private:
+    struct Entry
+    {
+        std::atomic<uint64_t> m_check{ 0 };
+        std::atomic<uint64_t> m_data{ 0 };
+    };
+
+    std::unique_ptr<Entry[]> m_entries;
+    uint64_t m_indexMask = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------
+//Leaf count of the legal move tree, the last ply is bulk-counted from the move list size
+uint64_t Perft(ChessPosition const& position, int depth, ChessPerftHash* hash = nullptr);
+uint64_t PerftDivide(ChessPosition const& position, int depth, std::vector<ChessPerftDivideEntry>& out_entries, ChessPerftHash* hash = nullptr);
+
+//Splits the root and the next numSplitPlies - 1 plies into pool tasks, counts match Perft/PerftDivide exactly
+uint64_t PerftDivideParallel(ChessThreadPool& pool, ChessPosition const& position, int depth, int numSplitPlies,
+    std::vector<ChessPerftDivideEntry>& out_entries, ChessPerftHash* hash = nullptr);
+
+//Published reference counts (chessprogramming.org "Perft Results"), used as the correctness oracle
+extern ChessPerftSuitePosition const g_perftSuite[];
+extern int const g_numPerftSuitePositions;
@@ -0,0 +1,901 @@
+﻿#include "ChessTablebaseGen.h"
+#include "ChessMoveGen.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <set>
+
+static char const s_pieceLetters[] = "QRBNP"; //strongest first, how Syzygy orders the sides
+static char const s_materialLetters[NUM_CHESS_PIECE_TYPES] = { 'B', 'N', 'R', 'Q', 'K', 'P' };
+static unsigned char const s_syzygyPieceTypes[NUM_CHESS_PIECE_TYPES] = { 3, 2, 4, 5, 6, 1 }; //Syzygy numbers PNBRQK 1-6
+
+constexpr int MAX_GEN_DTZ = 0xFFF;        //what a working entry and a leaf of the symbol tree hold
+constexpr int GEN_BLOCK_SIZE_LOG = 6;     //64-byte blocks: a probe decodes at most 512 bits
+constexpr int GEN_SPAN_LOG = 14;          //one sparse index entry per 16384 values
+constexpr int MAX_GEN_BLOCK_VALUES = 32768; //so a sparse entry's 16-bit offset reaches past the last block too
+constexpr int MAX_GEN_CODE_LENGTH = 32;   //the prober refills 32 bits at a time
+constexpr uint16_t UNSET_VALUE = 0xFFFF;
+
+//----------------------------------------------------------------------------------------------------------
+//Letters of one side in KQRBNP order, empty if there is anything but exactly one king and known letters
+static std::string GetSortedSideLetters(std::string const& letters)
+{
+    std::string sorted = "K";
+    for (char const* letter = s_pieceLetters; *letter != '\0'; ++letter)
+    {
+        sorted.append(std::count(letters.begin(), letters.end(), *letter), *letter);
+    }
+    bool hasOneKing = std::count(letters.begin(), letters.end(), 'K') == 1;
+    return (sorted.size() == letters.size() && hasOneKing) ? sorted : "";
+}
+
+static bool IsStrongerSide(std::string const& letters, std::string const& otherLetters)
+{
+    if (letters.size() != otherLetters.size())
+        return letters.size() > otherLetters.size();
+
+    for (size_t letterIndex = 1; letterIndex < letters.size(); ++letterIndex)
+    {
+        if (letters[letterIndex] != otherLetters[letterIndex])
+            return strchr(s_pieceLetters, letters[letterIndex]) < strchr(s_pieceLetters, otherLetters[letterIndex]);
+    }
+    return false;
+}
+
+std::string GetSyzygyMaterialName(std::string const& name)
+{
+    size_t separatorPos = name.find('v');
+    if (separatorPos == std::string::npos)
+        return "";
+
+    std::string firstLetters = GetSortedSideLetters(name.substr(0, separatorPos));
+    std::string secondLetters = GetSortedSideLetters(name.substr(separatorPos + 1));
+    if (firstLetters.empty() || secondLetters.empty() || (int)(firstLetters.size() + secondLetters.size()) > MAX_CHESS_TABLEBASE_PIECES)
+        return "";
+    return IsStrongerSide(secondLetters, firstLetters) ? (secondLetters + "v" + firstLetters) : (firstLetters + "v" + secondLetters);
+}
+
+static void AddMaterialNames(int numPiecesLeft, int firstLetterIndex, std::string const& pieces, std::set<std::string>& out_names)
+{
+    if (numPiecesLeft == 0)
+    {
+        //Every split of the pieces between the two sides
+        int numSplits = 1 << (int)pieces.size();
+        for (int split = 0; split < numSplits; ++split)
+        {
+            std::string firstSide = "K";
+            std::string secondSide = "K";
+            for (int pieceIndex = 0; pieceIndex < (int)pieces.size(); ++pieceIndex)
+            {
+                ((split >> pieceIndex) & 1 ? secondSide : firstSide) += pieces[pieceIndex];
+            }
+            out_names.insert(GetSyzygyMaterialName(firstSide + "v" + secondSide));
+        }
+        return;
+    }
+    for (int letterIndex = firstLetterIndex; letterIndex < 5; ++letterIndex)
+    {
+        AddMaterialNames(numPiecesLeft - 1, letterIndex, pieces + s_pieceLetters[letterIndex], out_names);
+    }
+}
+
+std::vector<std::string> GetChessMaterialNames(int numPieces)
+{
+    std::set<std::string> names;
+    if (numPieces >= 3)
+    {
+        AddMaterialNames(numPieces - 2, 0, "", names);
+    }
+    std::vector<std::string> sortedNames(names.begin(), names.end());
+    std::stable_sort(sortedNames.begin(), sortedNames.end(), [](std::string const& a, std::string const& b) {
+        return std::count(a.begin(), a.end(), 'P') < std::count(b.begin(), b.end(), 'P');
+    });
+    return sortedNames;
+}
+
+std::vector<std::string> GetChessTablebaseDependencies(std::string const& materialName)
+{
+    std::set<std::string> dependencies;
+    size_t separatorPos = materialName.find('v');
+    for (size_t pieceIndex = 0; pieceIndex < materialName.size(); ++pieceIndex)
+    {
+        char letter = materialName[pieceIndex];
+        if (letter == 'K' || letter == 'v')
+            continue;
+
+        //This piece captured, or this pawn promoted, or promoted while capturing one of the other side's pieces
+        std::string captured = materialName;
+        captured.erase(pieceIndex, 1);
+        dependencies.insert(GetSyzygyMaterialName(captured));
+        if (letter != 'P')
+            continue;
+
+        for (char promotion : { 'Q', 'R', 'B', 'N' })
+        {
+            std::string promoted = materialName;
+            promoted[pieceIndex] = promotion;
+            dependencies.insert(GetSyzygyMaterialName(promoted));
+            for (size_t victimIndex = 0; victimIndex < promoted.size(); ++victimIndex)
+            {
+                bool isOtherSide = (victimIndex < separatorPos) != (pieceIndex < separatorPos);
+                if (isOtherSide && promoted[victimIndex] != 'K' && promoted[victimIndex] != 'v')
+                {
+                    std::string promotedCapture = promoted;
+                    promotedCapture.erase(victimIndex, 1);
+                    dependencies.insert(GetSyzygyMaterialName(promotedCapture));
+                }
+            }
+        }
+    }
+    dependencies.erase("KvK");
+    return std::vector<std::string>(dependencies.begin(), dependencies.end());
+}
+
+//----------------------------------------------------------------------------------------------------------
+//The generator's working layout: pawns first so every pawn configuration is one contiguous slice, then the other
+//pieces, white (the side named first) before black and in KQRBNP order within a side. An index is their squares,
+//6 bits each, and the side to move; it keeps every order of equal pieces, so decoding one needs no symmetry
+struct ChessTablebaseGenLayout
+{
+    int m_numPieces = 0;
+    int m_numPawns = 0;
+    unsigned char m_pieceCodes[MAX_CHESS_TABLEBASE_PIECES] = {};
+
+    uint64_t GetNumEntries() const { return ((uint64_t)1 << (6 * m_numPieces)) * 2; }
+    uint64_t GetIndex(ChessPosition const& position) const; //position must have exactly this material
+};
+
+static bool GetTablebaseGenLayout(std::string const& materialName, ChessTablebaseGenLayout& out_layout)
+{
+    if (GetSyzygyMaterialName(materialName) != materialName)
+        return false;
+
+    size_t separatorPos = materialName.find('v');
+    std::string sideLetters[NUM_KISHI];
+    sideLetters[KISHI_WHITE] = materialName.substr(0, separatorPos);
+    sideLetters[KISHI_BLACK] = materialName.substr(separatorPos + 1);
+
+    ChessTablebaseGenLayout layout;
+    for (int isPawnPass = 1; isPawnPass >= 0; --isPawnPass)
+    {
+        for (int kishiID : { KISHI_WHITE, KISHI_BLACK })
+        {
+            for (char letter : sideLetters[kishiID])
+            {
+                ChessPieceType type = (ChessPieceType)((char const*)memchr(s_materialLetters, letter, NUM_CHESS_PIECE_TYPES) - s_materialLetters);
+                if ((type == ChessPieceType::Pawn) == (isPawnPass == 1))
+                {
+                    layout.m_pieceCodes[layout.m_numPieces++] = GetPieceCode(kishiID, type);
+                    layout.m_numPawns += isPawnPass;
+                }
+            }
+        }
+    }
+    out_layout = layout;
+    return true;
+}
+
+uint64_t ChessTablebaseGenLayout::GetIndex(ChessPosition const& position) const
+{
+    //Pieces of the same kind take their squares lowest first; the entries hold every order, so any one would do
+    Bitboard remaining[NUM_KISHI][NUM_CHESS_PIECE_TYPES];
+    memcpy(remaining, position.m_pieces, sizeof(remaining));
+    uint64_t index = 0;
+    for (int pieceIndex = 0; pieceIndex < m_numPieces; ++pieceIndex)
+    {
+        unsigned char code = m_pieceCodes[pieceIndex];
+        index = (index << 6) | (uint64_t)PopLowestSquare(remaining[GetPieceCodeKishi(code)][(int)GetPieceCodeType(code)]);
+    }
+    return (index << 1) | (uint64_t)position.m_sideToMove;
+}
+
+//Sets position to entry index of the table, false if that entry is not a legal position
+static bool DecodeTablebaseIndex(ChessTablebaseGenLayout const& layout, uint64_t index, ChessPosition& out_position)
+{
+    out_position.Clear();
+    out_position.m_sideToMove = (int)(index & 1);
+    uint64_t squares = index >> 1;
+    for (int pieceIndex = layout.m_numPieces - 1; pieceIndex >= 0; --pieceIndex, squares >>= 6)
+    {
+        int square = (int)(squares & 63);
+        unsigned char code = layout.m_pieceCodes[pieceIndex];
+        bool isPawnOnBackRank = GetPieceCodeType(code) == ChessPieceType::Pawn && (GetSquareY(square) == 0 || GetSquareY(square) == BOARD_SIZE - 1);
+        if (!out_position.IsEmpty(square) || isPawnOnBackRank)
+            return false;
+        out_position.PutPiece(square, GetPieceCodeKishi(code), GetPieceCodeType(code));
+    }
+    return !out_position.IsInCheck(1 - out_position.m_sideToMove); //the side that just moved cannot be left in check
+}
+
+//How far the pawns have come, every pawn move raises it
+static int GetPawnProgress(ChessTablebaseGenLayout const& layout, uint64_t slice)
+{
+    int progress = 0;
+    for (int pawnIndex = layout.m_numPawns - 1; pawnIndex >= 0; --pawnIndex, slice >>= 6)
+    {
+        int y = GetSquareY((int)(slice & 63));
+        progress += (GetPieceCodeKishi(layout.m_pieceCodes[pawnIndex]) == KISHI_WHITE) ? y : (BOARD_SIZE - 1 - y);
+    }
+    return progress;
+}
+
+//Working entry: 0 where no legal position is, else the WDL (+3) above the DTZ in plies, 0 for a checkmate
+static uint16_t EncodeEntry(ChessTablebaseWDL wdl, int dtz) { return (uint16_t)((((int)wdl + 3) << 12) | dtz); }
+static ChessTablebaseWDL GetEntryWDL(uint16_t entry) { return (ChessTablebaseWDL)((entry >> 12) - 3); }
+static int GetEntryDTZ(uint16_t entry) { return entry & MAX_GEN_DTZ; }
+
+static ChessTablebaseWDL Negate(ChessTablebaseWDL wdl) { return (ChessTablebaseWDL)(-(int)wdl); }
+
+static bool IsZeroingMove(ChessPosition const& position, ChessMove const& move)
+{
+    return move.IsCapture() || !position.IsEmpty(move.m_to) || position.GetPieceTypeAt(move.m_from) == ChessPieceType::Pawn;
+}
+
+//----------------------------------------------------------------------------------------------------------
+//Result of a capture or pawn move for the side making it, from the position after it with a fresh fifty-move count.
+//Pawn moves that neither capture nor promote stay in this table, in a slice that is already solved; a double push
+//also gives the other side every en passant capture the stored entry leaves out
+static bool GetZeroingMoveWDL(ChessPosition const& position, ChessMove const& move, ChessTablebaseGenLayout const& layout,
+    std::vector<uint16_t> const& entries, ChessTablebase const& subTables, ChessTablebaseWDL& out_wdl)
+{
+    ChessPosition child = position;
+    child.ApplyMove(move);
+    ChessTablebaseWDL childWDL = ChessTablebaseWDL::Draw;
+    if (move.IsCapture() || !position.IsEmpty(move.m_to) || IsPromotionChoice(move.m_promoteTo))
+    {
+        if (!subTables.ProbeWDL(child, childWDL))
+            return false;
+    }
+    else
+    {
+        int enPassantSquare = child.m_enPassantSquare;
+        child.m_enPassantSquare = NO_SQUARE;
+        childWDL = GetEntryWDL(entries[layout.GetIndex(child)]);
+        child.m_enPassantSquare = enPassantSquare;
+        if (move.m_result == ChessMoveResult::VALID_MOVE_PAWN_2SQUARE)
+        {
+            ChessMoveList replies;
+            GenerateLegalMoves(child, replies);
+            for (ChessMove const& reply : replies)
+            {
+                if (reply.m_result != ChessMoveResult::VALID_CAPTURE_ENPASSANT)
+                    continue;
+
+                ChessPosition grandchild = child;
+                grandchild.ApplyMove(reply);
+                ChessTablebaseWDL grandchildWDL = ChessTablebaseWDL::Draw;
+                if (!subTables.ProbeWDL(grandchild, grandchildWDL))
+                    return false;
+                childWDL = std::max(childWDL, Negate(grandchildWDL));
+            }
+        }
+    }
+    out_wdl = Negate(childWDL);
+    return true;
+}
+
+//One retrograde solve of a slice where a zeroing move counts as won when its result is at least threshold (and as
+//lost when at most -threshold), anything else as a draw. out_results has, per slice entry, the plies to that win
+//(positive) or minus one more than the plies to that loss, 0 when neither; checkmates are losses in 0
+static bool SolveSlice(ChessTablebaseGenLayout const& layout, uint64_t sliceStart, std::vector<uint64_t> openIndices,
+    std::vector<signed char> const& bestExits, std::vector<uint16_t> const& entries, ChessTablebaseWDL threshold,
+    std::vector<int16_t>& out_results, int& inout_numPasses)
+{
+    uint16_t const matedEntry = EncodeEntry(ChessTablebaseWDL::Loss, 0);
+    for (uint64_t localIndex = 0; localIndex < out_results.size(); ++localIndex)
+    {
+        out_results[localIndex] = (entries[sliceStart + localIndex] == matedEntry) ? -1 : 0;
+    }
+
+    //Pass d finds the wins in d plies; a loss can resolve one pass early, so stop after two quiet passes in a row
+    ChessPosition position;
+    ChessMoveList moves;
+    int numQuietPasses = 0;
+    for (int pass = 1; numQuietPasses < 2 && !openIndices.empty(); ++pass)
+    {
+        if (pass > MAX_GEN_DTZ)
+            return false;
+
+        ++inout_numPasses;
+        size_t numStillOpen = 0;
+        for (uint64_t index : openIndices)
+        {
+            uint64_t localIndex = index - sliceStart;
+            DecodeTablebaseIndex(layout, index, position);
+            GenerateLegalMoves(position, moves);
+            int bestWinDTZ = (bestExits[localIndex] >= (int)threshold) ? 1 : INT_MAX;
+            int longestLossDTZ = 1;
+            bool isEveryMoveLost = bestExits[localIndex] <= -(int)threshold;
+            for (ChessMove const& move : moves)
+            {
+                if (IsZeroingMove(position, move))
+                    continue;
+
+                ChessPosition child = position;
+                child.ApplyMove(move);
+                int childResult = out_results[layout.GetIndex(child) - sliceStart];
+                if (childResult < 0)
+                {
+                    bestWinDTZ = std::min(bestWinDTZ, -childResult);
+                    isEveryMoveLost = false;
+                }
+                else if (childResult > 0)
+                {
+                    longestLossDTZ = std::max(longestLossDTZ, childResult + 1);
+                }
+                else
+                {
+                    isEveryMoveLost = false;
+                }
+            }
+
+            if (bestWinDTZ <= pass)
+            {
+                out_results[localIndex] = (int16_t)bestWinDTZ;
+            }
+            else if (isEveryMoveLost)
+            {
+                out_results[localIndex] = (int16_t)-(longestLossDTZ + 1);
+            }
+            else
+            {
+                openIndices[numStillOpen++] = index;
+            }
+        }
+        numQuietPasses = (numStillOpen == openIndices.size()) ? numQuietPasses + 1 : 0;
+        openIndices.resize(numStillOpen);
+    }
+    return true;
+}
+
+bool GenerateChessTablebase(std::string const& materialName, ChessTablebase const& subTables, std::vector<uint16_t>& out_entries,
+    ChessTablebaseGenStats& out_stats, std::string& out_error)
+{
+    ChessTablebaseGenLayout layout;
+    if (!GetTablebaseGenLayout(materialName, layout))
+    {
+        out_error = materialName + " is not a table name, the Syzygy name is " + GetSyzygyMaterialName(materialName);
+        return false;
+    }
+    for (std::string const& dependency : GetChessTablebaseDependencies(materialName))
+    {
+        if (!subTables.HasTable(dependency))
+        {
+            out_error = materialName + " needs " + dependency + " first";
+            return false;
+        }
+    }
+
+    out_stats = ChessTablebaseGenStats();
+    out_entries.assign((size_t)layout.GetNumEntries(), 0);
+    uint64_t sliceSize = (uint64_t)1 << (6 * (layout.m_numPieces - layout.m_numPawns) + 1);
+    uint64_t numSlices = (uint64_t)1 << (6 * layout.m_numPawns);
+    std::vector<std::pair<int, uint64_t>> slices;
+    for (uint64_t slice = 0; slice < numSlices; ++slice)
+    {
+        slices.push_back({ GetPawnProgress(layout, slice), slice });
+    }
+    std::sort(slices.begin(), slices.end(), [](std::pair<int, uint64_t> const& a, std::pair<int, uint64_t> const& b) { return a.first > b.first; });
+
+    constexpr signed char NO_EXIT = -3; //below any result, a position without captures or pawn moves
+    std::vector<signed char> bestExits(sliceSize);
+    std::vector<int16_t> results(sliceSize);
+    std::vector<int16_t> fiftyMoveFreeResults(sliceSize);
+    std::vector<uint64_t> openIndices; //legal positions with moves
+    ChessPosition position;
+    ChessMoveList moves;
+    for (std::pair<int, uint64_t> const& slice : slices)
+    {
+        //Pass 0: legality, mates and stalemates, and the best result of each position's zeroing moves
+        openIndices.clear();
+        bool hasFiftyMoveExits = false;
+        uint64_t sliceStart = slice.second * sliceSize;
+        for (uint64_t index = sliceStart; index < sliceStart + sliceSize; ++index)
+        {
+            if (!DecodeTablebaseIndex(layout, index, position))
+                continue;
+
+            ++out_stats.m_numLegal;
+            GenerateLegalMoves(position, moves);
+            if (moves.Size() == 0)
+            {
+                bool isMated = position.IsInCheck(position.m_sideToMove);
+                out_entries[index] = EncodeEntry(isMated ? ChessTablebaseWDL::Loss : ChessTablebaseWDL::Draw, 0);
+                continue;
+            }
+
+            signed char bestExit = NO_EXIT;
+            for (ChessMove const& move : moves)
+            {
+                ChessTablebaseWDL exitWDL = ChessTablebaseWDL::Draw;
+                if (!IsZeroingMove(position, move))
+                    continue;
+                if (!GetZeroingMoveWDL(position, move, layout, out_entries, subTables, exitWDL))
+                {
+                    out_error = materialName + ": a capture or promotion from " + position.GetFEN() + " is not in the tables";
+                    return false;
+                }
+                bestExit = std::max(bestExit, (signed char)exitWDL);
+            }
+            bestExits[index - sliceStart] = bestExit;
+            hasFiftyMoveExits |= (bestExit == (signed char)ChessTablebaseWDL::CursedWin || bestExit == (signed char)ChessTablebaseWDL::BlessedLoss);
+            openIndices.push_back(index);
+        }
+
+        //Wins and losses within the fifty-move rule first. Only if some do not make it, or a zeroing move reaches a
+        //cursed win or blessed loss, is the slice solved again with those counted as wins and losses, which is the
+        //result without the rule
+        if (!SolveSlice(layout, sliceStart, openIndices, bestExits, out_entries, ChessTablebaseWDL::Win, results, out_stats.m_numPasses))
+        {
+            out_error = materialName + " has a DTZ above " + std::to_string(MAX_GEN_DTZ);
+            return false;
+        }
+        bool hasLongResults = std::any_of(openIndices.begin(), openIndices.end(), [&results, sliceStart](uint64_t index) {
+            return results[index - sliceStart] > 100 || results[index - sliceStart] < -101; });
+        std::vector<int16_t> const* fiftyMoveFreeSource = &results;
+        if (hasFiftyMoveExits || hasLongResults)
+        {
+            if (!SolveSlice(layout, sliceStart, openIndices, bestExits, out_entries, ChessTablebaseWDL::CursedWin, fiftyMoveFreeResults,
+                out_stats.m_numPasses))
+            {
+                out_error = materialName + " has a DTZ above " + std::to_string(MAX_GEN_DTZ);
+                return false;
+            }
+            fiftyMoveFreeSource = &fiftyMoveFreeResults;
+        }
+
+        for (uint64_t index : openIndices)
+        {
+            int result = results[index - sliceStart];
+            int fiftyMoveFreeResult = (*fiftyMoveFreeSource)[index - sliceStart];
+            if (result > 0 && result <= 100)
+            {
+                out_entries[index] = EncodeEntry(ChessTablebaseWDL::Win, result);
+            }
+            else if (result < 0 && -result - 1 <= 100)
+            {
+                out_entries[index] = EncodeEntry(ChessTablebaseWDL::Loss, -result - 1);
+            }
+            else if (fiftyMoveFreeResult > 0)
+            {
+                out_entries[index] = EncodeEntry(ChessTablebaseWDL::CursedWin, fiftyMoveFreeResult);
+            }
+            else if (fiftyMoveFreeResult < 0)
+            {
+                out_entries[index] = EncodeEntry(ChessTablebaseWDL::BlessedLoss, -fiftyMoveFreeResult - 1);
+            }
+            else
+            {
+                out_entries[index] = EncodeEntry(ChessTablebaseWDL::Draw, 0);
+            }
+        }
+    }
+
+    for (uint16_t entry : out_entries)
+    {
+        if (entry == 0)
+            continue;
+
+        switch (GetEntryWDL(entry))
+        {
+        case ChessTablebaseWDL::Win:
+            ++out_stats.m_numWins;
+            out_stats.m_maxWinDTZ = std::max(out_stats.m_maxWinDTZ, GetEntryDTZ(entry));
+            break;
+        case ChessTablebaseWDL::Loss:
+            ++out_stats.m_numLosses;
+            out_stats.m_maxLossDTZ = std::max(out_stats.m_maxLossDTZ, GetEntryDTZ(entry));
+            break;
+        case ChessTablebaseWDL::CursedWin:   ++out_stats.m_numCursedWins; break;
+        case ChessTablebaseWDL::BlessedLoss: ++out_stats.m_numBlessedLosses; break;
+        default:                             ++out_stats.m_numDraws; break;
+        }
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------
+//One compressed sub-table, in the sections a Syzygy file keeps apart
+struct SyzygyGenPairs
+{
+    std::vector<unsigned char> m_header; //flags through the symbol tree
+    std::vector<unsigned char> m_sparseIndex;
+    std::vector<unsigned char> m_blockLengths;
+    std::vector<unsigned char> m_data;
+};
+
+static void AppendLittleEndian(std::vector<unsigned char>& inout_bytes, uint64_t value, int numBytes)
+{
+    for (int byteIndex = 0; byteIndex < numBytes; ++byteIndex)
+    {
+        inout_bytes.push_back((unsigned char)(value >> (8 * byteIndex)));
+    }
+}
+
+//Huffman code lengths of symbols with these frequencies, at least two of them
+static std::vector<int> GetHuffmanLengths(std::vector<uint64_t> const& frequencies)
+{
+    using Node = std::pair<uint64_t, int>;
+    std::priority_queue<Node, std::vector<Node>, std::greater<Node>> queue;
+    std::vector<int> parents(2 * frequencies.size() - 1, -1);
+    for (int symbol = 0; symbol < (int)frequencies.size(); ++symbol)
+    {
+        queue.push({ frequencies[symbol], symbol });
+    }
+    int nextNode = (int)frequencies.size();
+    while (queue.size() > 1)
+    {
+        Node first = queue.top();
+        queue.pop();
+        Node second = queue.top();
+        queue.pop();
+        parents[first.second] = nextNode;
+        parents[second.second] = nextNode;
+        queue.push({ first.first + second.first, nextNode++ });
+    }
+
+    std::vector<int> lengths(frequencies.size(), 0);
+    for (int symbol = 0; symbol < (int)frequencies.size(); ++symbol)
+    {
+        for (int node = symbol; parents[node] != -1; node = parents[node])
+        {
+            ++lengths[symbol];
+        }
+    }
+    return lengths;
+}
+
+//Fills the positions no probe can reach with the most common value and codes the rest: a single value if that is
+//all there is, else one canonical Huffman symbol per value packed into fixed-size blocks
+static void CompressValues(std::vector<uint16_t>& inout_values, unsigned char flags, SyzygyGenPairs& out_pairs)
+{
+    std::vector<uint64_t> valueCounts(MAX_GEN_DTZ + 1, 0);
+    for (uint16_t value : inout_values)
+    {
+        if (value != UNSET_VALUE)
+        {
+            ++valueCounts[value];
+        }
+    }
+    uint16_t commonValue = (uint16_t)(std::max_element(valueCounts.begin(), valueCounts.end()) - valueCounts.begin());
+    for (uint16_t& value : inout_values)
+    {
+        if (value == UNSET_VALUE)
+        {
+            value = commonValue;
+            ++valueCounts[commonValue];
+        }
+    }
+
+    std::vector<int> symbolValues;
+    std::vector<uint64_t> frequencies;
+    for (int value = 0; value <= MAX_GEN_DTZ; ++value)
+    {
+        if (valueCounts[value] > 0)
+        {
+            symbolValues.push_back(value);
+            frequencies.push_back(valueCounts[value]);
+        }
+    }
+    out_pairs = SyzygyGenPairs();
+    if (symbolValues.size() == 1 && symbolValues[0] <= 0xFF)
+    {
+        out_pairs.m_header = { (unsigned char)(flags | SYZYGY_FLAG_SINGLE_VALUE), (unsigned char)symbolValues[0] };
+        return;
+    }
+    if (symbolValues.size() == 1)
+    {
+        symbolValues.push_back(0); //a value the byte cannot hold still needs a code of at least one bit
+        frequencies.push_back(0);
+    }
+
+    //Halving the frequencies evens the tree out until the longest code fits the prober's refill
+    std::vector<int> lengths = GetHuffmanLengths(frequencies);
+    while (*std::max_element(lengths.begin(), lengths.end()) > MAX_GEN_CODE_LENGTH)
+    {
+        for (uint64_t& frequency : frequencies)
+        {
+            frequency = (frequency >> 1) + 1;
+        }
+        lengths = GetHuffmanLengths(frequencies);
+    }
+
+    //Canonical codes: the longest ones are the lowest symbols and count up from 0, each shorter length starting
+    //where the longer codes end
+    int const maxLength = *std::max_element(lengths.begin(), lengths.end());
+    int const minLength = *std::min_element(lengths.begin(), lengths.end());
+    std::vector<int> numCodes(maxLength + 2, 0);
+    for (int length : lengths)
+    {
+        ++numCodes[length];
+    }
+    std::vector<int> lowestSymbols(maxLength + 2, 0);
+    std::vector<uint64_t> bases(maxLength + 2, 0);
+    for (int length = maxLength - 1; length >= minLength; --length)
+    {
+        lowestSymbols[length] = lowestSymbols[length + 1] + numCodes[length + 1];
+        bases[length] = (bases[length + 1] + numCodes[length + 1]) / 2;
+    }
+    std::vector<int> symbolOfValue(MAX_GEN_DTZ + 1, 0);
+    std::vector<int> valueOfSymbol(symbolValues.size(), 0);
+    std::vector<int> nextSymbols = lowestSymbols;
+    std::vector<uint32_t> codeOfValue(MAX_GEN_DTZ + 1, 0);
+    std::vector<int> lengthOfValue(MAX_GEN_DTZ + 1, 0);
+    for (int valueIndex = 0; valueIndex < (int)symbolValues.size(); ++valueIndex)
+    {
+        int length = lengths[valueIndex];
+        int symbol = nextSymbols[length]++;
+        int value = symbolValues[valueIndex];
+        valueOfSymbol[symbol] = value;
+        codeOfValue[value] = (uint32_t)(bases[length] + (symbol - lowestSymbols[length]));
+        lengthOfValue[value] = length;
+    }
+
+    //Blocks of 2^GEN_BLOCK_SIZE_LOG bytes, each holding as many whole codes as fit
+    uint64_t const blockSize = (uint64_t)1 << GEN_BLOCK_SIZE_LOG;
+    std::vector<uint64_t> blockFirstValues;
+    uint64_t bitPosition = blockSize * 8;
+    int numBlockValues = MAX_GEN_BLOCK_VALUES;
+    for (uint64_t valueIndex = 0; valueIndex < inout_values.size(); ++valueIndex)
+    {
+        int value = inout_values[valueIndex];
+        if (bitPosition + lengthOfValue[value] > blockSize * 8 || numBlockValues == MAX_GEN_BLOCK_VALUES)
+        {
+            if (!blockFirstValues.empty())
+            {
+                AppendLittleEndian(out_pairs.m_blockLengths, numBlockValues - 1, 2);
+            }
+            blockFirstValues.push_back(valueIndex);
+            out_pairs.m_data.resize(out_pairs.m_data.size() + blockSize, 0);
+            bitPosition = 0;
+            numBlockValues = 0;
+        }
+        unsigned char* block = out_pairs.m_data.data() + (blockFirstValues.size() - 1) * blockSize;
+        for (int bitIndex = lengthOfValue[value] - 1; bitIndex >= 0; --bitIndex, ++bitPosition)
+        {
+            block[bitPosition / 8] |= (unsigned char)(((codeOfValue[value] >> bitIndex) & 1) << (7 - bitPosition % 8));
+        }
+        ++numBlockValues;
+    }
+    AppendLittleEndian(out_pairs.m_blockLengths, numBlockValues - 1, 2);
+
+    //Each sparse entry locates the value in the middle of its span; past the last value it counts on from the last
+    //block, which the prober only ever walks back from
+    uint64_t const span = (uint64_t)1 << GEN_SPAN_LOG;
+    for (uint64_t spanStart = 0; spanStart < inout_values.size(); spanStart += span)
+    {
+        uint64_t middle = spanStart + span / 2;
+        size_t block = std::upper_bound(blockFirstValues.begin(), blockFirstValues.end(), middle) - blockFirstValues.begin() - 1;
+        AppendLittleEndian(out_pairs.m_sparseIndex, block, 4);
+        AppendLittleEndian(out_pairs.m_sparseIndex, middle - blockFirstValues[block], 2);
+    }
+
+    std::vector<unsigned char>& header = out_pairs.m_header;
+    header = { flags, (unsigned char)GEN_BLOCK_SIZE_LOG, (unsigned char)GEN_SPAN_LOG, 0 };
+    AppendLittleEndian(header, blockFirstValues.size(), 4);
+    header.push_back((unsigned char)maxLength);
+    header.push_back((unsigned char)minLength);
+    for (int length = minLength; length <= maxLength; ++length)
+    {
+        AppendLittleEndian(header, lowestSymbols[length], 2);
+    }
+    AppendLittleEndian(header, valueOfSymbol.size(), 2);
+    for (int value : valueOfSymbol)
+    {
+        //A leaf: the value on the left, 0xFFF on the right
+        header.push_back((unsigned char)value);
+        header.push_back((unsigned char)(((value >> 8) & 0xF) | 0xF0));
+        header.push_back(0xFF);
+    }
+    if (valueOfSymbol.size() & 1)
+    {
+        header.push_back(0);
+    }
+}
+
+//Piece order of every sub-table: the leading group first (the leading side's pawns, or the kings and with unique
+//pieces the first of those), then the other side's pawns, then the rest with equal pieces next to each other
+static void SetTablebaseGenEncodings(ChessTablebaseMaterial const& material, ChessTablebaseGenLayout const& layout,
+    int const order[2], ChessTablebaseEncoding out_encodings[4])
+{
+    std::vector<unsigned char> pieces;
+    for (int pieceIndex = 0; pieceIndex < layout.m_numPieces; ++pieceIndex)
+    {
+        unsigned char code = layout.m_pieceCodes[pieceIndex];
+        pieces.push_back((unsigned char)(s_syzygyPieceTypes[(int)GetPieceCodeType(code)] | (GetPieceCodeKishi(code) == KISHI_BLACK ? 8 : 0)));
+    }
+    unsigned char const leadPawn = material.m_isLeadPawnWhite ? 1 : 9;
+    unsigned char const whiteKing = 6;
+    unsigned char const blackKing = 14;
+    auto getRank = [&](unsigned char piece) {
+        bool isUnique = std::count(pieces.begin(), pieces.end(), piece) == 1 && (piece & 7) != 6;
+        return (piece == leadPawn) ? 0 : (piece == (leadPawn ^ 8)) ? 1 : material.m_hasPawns ? 2
+            : (piece == whiteKing) ? 0 : (piece == blackKing) ? 1 : (isUnique && material.m_hasUniquePieces) ? 2 : 3; };
+    std::stable_sort(pieces.begin(), pieces.end(), [&](unsigned char a, unsigned char b) {
+        return (getRank(a) != getRank(b)) ? getRank(a) < getRank(b) : a < b; });
+    //Only the first unique piece joins the kings
+    if (!material.m_hasPawns && material.m_hasUniquePieces)
+    {
+        std::stable_sort(pieces.begin() + 3, pieces.end());
+    }
+
+    for (int fileIndex = 0; fileIndex < 4; ++fileIndex)
+    {
+        out_encodings[fileIndex] = ChessTablebaseEncoding();
+        out_encodings[fileIndex].m_numPieces = layout.m_numPieces;
+        std::copy(pieces.begin(), pieces.end(), out_encodings[fileIndex].m_pieces);
+        SetChessTablebaseGroups(material, order, fileIndex, out_encodings[fileIndex]);
+    }
+}
+
+//Stored DTZ values: wins and losses in plies less one (SYZYGY_FLAG_WIN_PLIES and LOSS_PLIES), cursed wins and
+//blessed losses in moves beyond the first 100 plies, which the prober rounds up by at most a ply
+static int GetStoredDTZ(ChessTablebaseWDL wdl, int dtz)
+{
+    switch (wdl)
+    {
+    case ChessTablebaseWDL::Win:  return dtz - 1;
+    case ChessTablebaseWDL::Loss: return std::max(dtz, 1) - 1;
+    default:                      return (std::max(dtz, 101) - 100) / 2;
+    }
+}
+
+bool WriteChessTablebase(std::string const& directory, std::string const& materialName, std::vector<uint16_t> const& entries,
+    std::string& out_error)
+{
+    ChessTablebaseGenLayout layout;
+    ChessTablebaseMaterial material;
+    if (!GetTablebaseGenLayout(materialName, layout) || !GetChessTablebaseMaterial(materialName, material) || entries.size() != layout.GetNumEntries())
+    {
+        out_error = "no entries for " + materialName;
+        return false;
+    }
+
+    bool const hasOtherPawns = material.m_hasPawns && material.m_pawnCounts[1] > 0;
+    int const order[2] = { 0, hasOtherPawns ? 1 : 0xF };
+    ChessTablebaseEncoding encodings[4];
+    SetTablebaseGenEncodings(material, layout, order, encodings);
+    int const numFiles = material.m_hasPawns ? 4 : 1;
+    int const numWDLSides = material.m_isSymmetric ? 1 : 2;
+
+    //Every legal position into the sub-table of its side to move (white only for DTZ) and leading pawn file. Mirror
+    //images share an index, and have to agree on the value
+    std::vector<uint16_t> wdlValues[2][4];
+    std::vector<uint16_t> dtzValues[4];
+    for (int fileIndex = 0; fileIndex < numFiles; ++fileIndex)
+    {
+        uint64_t size = encodings[fileIndex].GetSize();
+        wdlValues[0][fileIndex].assign(size, UNSET_VALUE);
+        wdlValues[1][fileIndex].assign(material.m_isSymmetric ? 0 : size, UNSET_VALUE);
+        dtzValues[fileIndex].assign(size, UNSET_VALUE);
+    }
+    ChessPosition position;
+    for (uint64_t index = 0; index < entries.size(); ++index)
+    {
+        if (entries[index] == 0 || !DecodeTablebaseIndex(layout, index, position))
+            continue;
+
+        int side = (position.m_sideToMove == KISHI_WHITE) ? 0 : 1;
+        if (side >= numWDLSides)
+            continue;
+
+        int file = 0;
+        uint64_t tableIndex = GetChessTablebaseIndex(material, encodings, position, false, file);
+        ChessTablebaseWDL wdl = GetEntryWDL(entries[index]);
+        uint16_t wdlValue = (uint16_t)((int)wdl + 2);
+        uint16_t dtzValue = (uint16_t)GetStoredDTZ(wdl, GetEntryDTZ(entries[index]));
+        std::vector<uint16_t>& wdlTable = wdlValues[side][file];
+        std::vector<uint16_t>& dtzTable = dtzValues[file];
+        bool hasDTZ = (side == 0 && wdl != ChessTablebaseWDL::Draw); //draws have no DTZ, the prober never reads one
+        bool isClash = tableIndex >= wdlTable.size() || (wdlTable[tableIndex] != UNSET_VALUE && wdlTable[tableIndex] != wdlValue)
+            || (hasDTZ && dtzTable[tableIndex] != UNSET_VALUE && dtzTable[tableIndex] != dtzValue);
+        if (isClash)
+        {
+            out_error = materialName + ": " + position.GetFEN() + " does not fit its Syzygy index " + std::to_string(tableIndex);
+            return false;
+        }
+        wdlTable[tableIndex] = wdlValue;
+        if (hasDTZ)
+        {
+            dtzTable[tableIndex] = dtzValue;
+        }
+    }
+
+    for (bool isDTZ : { false, true })
+    {
+        std::vector<SyzygyGenPairs> pairs;
+        for (int fileIndex = 0; fileIndex < numFiles; ++fileIndex)
+        {
+            for (int side = 0; side < (isDTZ ? 1 : numWDLSides); ++side)
+            {
+                pairs.emplace_back();
+                unsigned char flags = isDTZ ? (SYZYGY_FLAG_WIN_PLIES | SYZYGY_FLAG_LOSS_PLIES) : 0; //DTZ stores white to move
+                CompressValues(isDTZ ? dtzValues[fileIndex] : wdlValues[side][fileIndex], flags, pairs.back());
+            }
+        }
+
+        std::vector<unsigned char> bytes(isDTZ ? SYZYGY_DTZ_MAGIC : SYZYGY_WDL_MAGIC, (isDTZ ? SYZYGY_DTZ_MAGIC : SYZYGY_WDL_MAGIC) + 4);
+        bytes.push_back((unsigned char)((material.m_isSymmetric ? 0 : SYZYGY_FILE_SPLIT) | (material.m_hasPawns ? SYZYGY_FILE_HAS_PAWNS : 0)));
+        for (int fileIndex = 0; fileIndex < numFiles; ++fileIndex)
+        {
+            //Both sides to move share the order and pieces, in the low and high nibbles
+            bytes.push_back((unsigned char)(order[0] | (order[0] << 4)));
+            if (hasOtherPawns)
+            {
+                bytes.push_back((unsigned char)(order[1] | (order[1] << 4)));
+            }
+            for (int pieceIndex = 0; pieceIndex < layout.m_numPieces; ++pieceIndex)
+            {
+                bytes.push_back((unsigned char)(encodings[fileIndex].m_pieces[pieceIndex] | (encodings[fileIndex].m_pieces[pieceIndex] << 4)));
+            }
+        }
+        bytes.resize(bytes.size() + (bytes.size() & 1), 0);
+        for (SyzygyGenPairs const& subTable : pairs)
+        {
+            bytes.insert(bytes.end(), subTable.m_header.begin(), subTable.m_header.end());
+        }
+        for (SyzygyGenPairs const& subTable : pairs)
+        {
+            bytes.insert(bytes.end(), subTable.m_sparseIndex.begin(), subTable.m_sparseIndex.end());
+        }
+        for (SyzygyGenPairs const& subTable : pairs)
+        {
+            bytes.insert(bytes.end(), subTable.m_blockLengths.begin(), subTable.m_blockLengths.end());
+        }
+        for (SyzygyGenPairs const& subTable : pairs)
+        {
+            bytes.resize((bytes.size() + 63) & ~(size_t)63, 0);
+            bytes.insert(bytes.end(), subTable.m_data.begin(), subTable.m_data.end());
+        }
+        //Published files end 16 bytes past a 64-byte boundary, which other probers check; it also covers the prober
+        //reading a few bytes beyond the last block
+        bytes.resize(((bytes.size() + 63) & ~(size_t)63) + 16, 0);
+
+        std::string path = directory + "/" + materialName + (isDTZ ? SYZYGY_DTZ_EXTENSION : SYZYGY_WDL_EXTENSION);
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write((char const*)bytes.data(), (std::streamsize)bytes.size());
+        if (!file)
+        {
+            out_error = "cannot write " + path;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool VerifyChessTablebase(std::string const& materialName, ChessTablebase const& tablebase, std::vector<uint16_t> const& entries,
+    std::string& out_error)
+{
+    ChessTablebaseGenLayout layout;
+    if (!GetTablebaseGenLayout(materialName, layout) || entries.size() != layout.GetNumEntries())
+    {
+        out_error = "no entries for " + materialName;
+        return false;
+    }
+
+    ChessPosition position;
+    for (uint64_t index = 0; index < entries.size(); ++index)
+    {
+        if (entries[index] == 0 || !DecodeTablebaseIndex(layout, index, position))
+            continue;
+
+        //A checkmate probes as a loss in 1, cursed wins and blessed losses only as beyond 100
+        ChessTablebaseWDL wdl = GetEntryWDL(entries[index]);
+        int dtz = GetEntryDTZ(entries[index]);
+        ChessTablebaseResult result;
+        bool isFound = tablebase.Probe(position, result);
+        bool isDTZRight = (wdl == ChessTablebaseWDL::Win || wdl == ChessTablebaseWDL::Loss) ? result.m_dtz == std::max(dtz, 1)
+            : (wdl == ChessTablebaseWDL::Draw) ? result.m_dtz == 0 : result.m_dtz > 100;
+        if (!isFound || result.m_wdl != wdl || !isDTZRight)
+        {
+            out_error = materialName + ": " + position.GetFEN() + " probes as " + (isFound ? std::to_string((int)result.m_wdl) + " DTZ "
+                + std::to_string(result.m_dtz) : "missing") + ", generated " + std::to_string((int)wdl) + " DTZ " + std::to_string(dtz);
+            return false;
+        }
+    }
+    return true;
+}
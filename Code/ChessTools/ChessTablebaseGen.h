@@ -0,0 +1,43 @@
+﻿#pragma once
+#include "ChessTablebase.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ChessTablebaseGenStats
+{
+    uint64_t m_numLegal = 0;
+    uint64_t m_numWins = 0;
+    uint64_t m_numCursedWins = 0;
+    uint64_t m_numDraws = 0;
+    uint64_t m_numBlessedLosses = 0;
+    uint64_t m_numLosses = 0;
+    int m_maxWinDTZ = 0;
+    int m_maxLossDTZ = 0;
+    int m_numPasses = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------
+//The name Syzygy files the material under: the side with more pieces first, on a tie the one with the stronger
+//pieces (QRBNP, compared strongest first). Empty if name is not a valid signature with one king per side
+std::string GetSyzygyMaterialName(std::string const& name);
+//Every Syzygy material signature with exactly numPieces pieces, kings included, in an order where each table comes
+//after the ones it depends on (fewer pawns first, since a promotion keeps the piece count)
+std::vector<std::string> GetChessMaterialNames(int numPieces);
+//Tables a capture or promotion can lead to from materialName, bare kings excluded
+std::vector<std::string> GetChessTablebaseDependencies(std::string const& materialName);
+
+//Solves one table by retrograde passes over its positions, pawn configurations from the most advanced back, so a
+//pawn move always lands in a part that is already solved. Captures and promotions are looked up in subTables,
+//which must already hold every dependency. out_entries is the generator's own working layout, one entry per piece
+//placement and side to move, only meant for WriteChessTablebase and VerifyChessTablebase
+bool GenerateChessTablebase(std::string const& materialName, ChessTablebase const& subTables, std::vector<uint16_t>& out_entries,
+    ChessTablebaseGenStats& out_stats, std::string& out_error);
+//Writes materialName.rtbw and .rtbz into directory: Huffman-coded values without the reference generator's symbol
+//pairing, so the files are larger than the published ones but probe the same
+bool WriteChessTablebase(std::string const& directory, std::string const& materialName, std::vector<uint16_t> const& entries,
+    std::string& out_error);
+//Probes every legal position through tablebase, which must have the written files open, against entries
+bool VerifyChessTablebase(std::string const& materialName, ChessTablebase const& tablebase, std::vector<uint16_t> const& entries,
+    std::string& out_error);
@@ -0,0 +1,358 @@
+﻿#include "ChessTexelTuner.h"
+#include "ChessThreadPool.h"
+#include "ChessTrainingData.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+constexpr int TUNER_LOAD_CHUNK_RECORDS = 1 << 16;
+constexpr int TUNER_PASS_CHUNK_POSITIONS = 1 << 13;
+constexpr int TUNER_BLOCK_POSITIONS = 256; //evaluated together, then run through the sigmoid as one contiguous array
+constexpr uint16_t TUNER_FEATURE_INDEX_MASK = 0x01FF;
+constexpr double TUNER_ADAM_BETA1 = 0.9;
+constexpr double TUNER_ADAM_BETA2 = 0.999;
+constexpr double TUNER_ADAM_EPSILON = 1e-8;
+
+static_assert(NUM_CHESS_TUNER_FEATURES <= TUNER_FEATURE_INDEX_MASK + 1, "a feature index must fit below the black flag");
+
+//----------------------------------------------------------------------------------------------------------
+uint64_t ChessTuningSet::GetMemorySize() const
+{
+    return m_featureStarts.size() * sizeof(uint32_t) + m_features.size() * sizeof(uint16_t)
+        + (m_midgameFactors.size() + m_results.size() + m_searchScores.size()) * sizeof(float);
+}
+
+static void AddTuningPosition(ChessTrainingRecord const& record, ChessPosition const& position, ChessEvaluationWeights const& weights,
+    ChessTuningSet& out_set)
+{
+    int gamePhase = 0;
+    for (int kishiIndex = 0; kishiIndex < NUM_KISHI; ++kishiIndex)
+    {
+        for (int typeIndex = 0; typeIndex < NUM_CHESS_PIECE_TYPES; ++typeIndex)
+        {
+            Bitboard pieces = position.m_pieces[kishiIndex][typeIndex];
+            while (pieces)
+            {
+                //Bonuses are laid out rank 8 first: a white piece on square s reads index s ^ 56, a black piece index s
+                int square = PopLowestSquare(pieces);
+                int bonusIndex = (kishiIndex == KISHI_WHITE) ? (square ^ 56) : square;
+                uint16_t feature = (uint16_t)(typeIndex * NUM_BOARD_SQUARES + bonusIndex);
+                out_set.m_features.push_back((kishiIndex == KISHI_WHITE) ? feature : (uint16_t)(feature | CHESS_TUNER_BLACK_FEATURE));
+                gamePhase += weights.m_phaseWeights[typeIndex];
+            }
+        }
+    }
+    out_set.m_featureStarts.push_back((uint32_t)out_set.m_features.size());
+    out_set.m_midgameFactors.push_back((float)std::min(gamePhase, CHESS_MAX_GAME_PHASE) / (float)CHESS_MAX_GAME_PHASE);
+    out_set.m_results.push_back(GetChessResultScore(record.m_result));
+    out_set.m_searchScores.push_back((float)((position.m_sideToMove == KISHI_WHITE) ? record.m_score : -record.m_score));
+}
+
+bool LoadChessTuningSet(ChessThreadPool& pool, std::vector<std::string> const& paths, ChessEvaluationWeights const& weights,
+    ChessTuningSet& out_set, std::string& out_error)
+{
+    std::vector<std::unique_ptr<ChessTrainingDataFile>> files;
+    for (std::string const& path : paths)
+    {
+        files.push_back(std::make_unique<ChessTrainingDataFile>());
+        if (!files.back()->Open(path, out_error))
+            return false;
+    }
+
+    //Each task fills its own partial set from one run of records, the parts are joined in file order afterwards
+    struct LoadChunk
+    {
+        ChessTrainingDataFile const* m_file = nullptr;
+        uint64_t m_firstRecord = 0;
+        uint64_t m_endRecord = 0;
+        ChessTuningSet m_set;
+    };
+    std::vector<LoadChunk> chunks;
+    for (std::unique_ptr<ChessTrainingDataFile> const& file : files)
+    {
+        for (uint64_t firstRecord = 0; firstRecord < file->GetNumRecords(); firstRecord += TUNER_LOAD_CHUNK_RECORDS)
+        {
+            LoadChunk chunk;
+            chunk.m_file = file.get();
+            chunk.m_firstRecord = firstRecord;
+            chunk.m_endRecord = std::min(firstRecord + TUNER_LOAD_CHUNK_RECORDS, file->GetNumRecords());
+            chunks.push_back(std::move(chunk));
+        }
+    }
+
+    ChessTaskGroup group;
+    for (LoadChunk& chunk : chunks)
+    {
+        pool.Submit(group, [&chunk, &weights]()
+            {
+                chunk.m_set.m_featureStarts.push_back(0);
+                ChessPosition position;
+                for (uint64_t recordIndex = chunk.m_firstRecord; recordIndex < chunk.m_endRecord; ++recordIndex)
+                {
+                    ChessTrainingRecord record = chunk.m_file->GetRecord(recordIndex);
+                    if (UnpackChessPosition(record.m_position, position))
+                    {
+                        AddTuningPosition(record, position, weights, chunk.m_set);
+                    }
+                }
+            });
+    }
+    pool.Wait(group);
+
+    ChessTuningSet set;
+    set.m_featureStarts.push_back(0);
+    for (LoadChunk const& chunk : chunks)
+    {
+        uint32_t featureOffset = (uint32_t)set.m_features.size();
+        for (size_t startIndex = 1; startIndex < chunk.m_set.m_featureStarts.size(); ++startIndex)
+        {
+            set.m_featureStarts.push_back(featureOffset + chunk.m_set.m_featureStarts[startIndex]);
+        }
+        set.m_features.insert(set.m_features.end(), chunk.m_set.m_features.begin(), chunk.m_set.m_features.end());
+        set.m_midgameFactors.insert(set.m_midgameFactors.end(), chunk.m_set.m_midgameFactors.begin(), chunk.m_set.m_midgameFactors.end());
+        set.m_results.insert(set.m_results.end(), chunk.m_set.m_results.begin(), chunk.m_set.m_results.end());
+        set.m_searchScores.insert(set.m_searchScores.end(), chunk.m_set.m_searchScores.begin(), chunk.m_set.m_searchScores.end());
+    }
+    if (set.GetNumPositions() == 0)
+    {
+        out_error = "no usable positions in the training files";
+        return false;
+    }
+    out_set = std::move(set);
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------
+ChessTexelTuner::ChessTexelTuner(ChessThreadPool& pool, ChessTuningSet const& set, ChessEvaluationWeights const& startWeights)
+    : m_pool(pool)
+    , m_set(set)
+    , m_startWeights(startWeights)
+{
+    m_parameters.resize(NUM_CHESS_TUNER_PARAMETERS);
+    for (int typeIndex = 0; typeIndex < NUM_CHESS_PIECE_TYPES; ++typeIndex)
+    {
+        for (int bonusIndex = 0; bonusIndex < NUM_BOARD_SQUARES; ++bonusIndex)
+        {
+            int feature = typeIndex * NUM_BOARD_SQUARES + bonusIndex;
+            m_parameters[feature] = (float)(startWeights.m_midgameValues[typeIndex] + startWeights.m_midgameBonuses[typeIndex][bonusIndex]);
+            m_parameters[NUM_CHESS_TUNER_FEATURES + feature] = (float)(startWeights.m_endgameValues[typeIndex] + startWeights.m_endgameBonuses[typeIndex][bonusIndex]);
+        }
+    }
+    m_firstMoments.assign(NUM_CHESS_TUNER_PARAMETERS, 0.0);
+    m_secondMoments.assign(NUM_CHESS_TUNER_PARAMETERS, 0.0);
+    m_gradient.assign(NUM_CHESS_TUNER_PARAMETERS, 0.0);
+}
+
+double ChessTexelTuner::FitScalingK()
+{
+    //The loss is unimodal in K; a golden-section search narrows it down in a few dozen passes
+    double savedLambda = m_lambda;
+    m_lambda = 0.0;
+    double const ratio = (std::sqrt(5.0) - 1.0) / 2.0;
+    double low = 0.05;
+    double high = 5.0;
+    for (int stepIndex = 0; stepIndex < 30; ++stepIndex)
+    {
+        double lowProbe = high - ratio * (high - low);
+        double highProbe = low + ratio * (high - low);
+        m_scalingK = lowProbe;
+        double lowLoss = ComputeLoss();
+        m_scalingK = highProbe;
+        double highLoss = ComputeLoss();
+        if (lowLoss < highLoss)
+        {
+            high = highProbe;
+        }
+        else
+        {
+            low = lowProbe;
+        }
+    }
+    m_lambda = savedLambda;
+    m_scalingK = (low + high) / 2.0;
+    return m_scalingK;
+}
+
+double ChessTexelTuner::ComputeLoss() const
+{
+    return ComputeLossAndGradient(false);
+}
+
+double ChessTexelTuner::RunIteration(double learningRate)
+{
+    double loss = ComputeLossAndGradient(true);
+    ++m_numSteps;
+    double const firstCorrection = 1.0 - std::pow(TUNER_ADAM_BETA1, m_numSteps);
+    double const secondCorrection = 1.0 - std::pow(TUNER_ADAM_BETA2, m_numSteps);
+    for (int parameterIndex = 0; parameterIndex < NUM_CHESS_TUNER_PARAMETERS; ++parameterIndex)
+    {
+        double gradient = m_gradient[parameterIndex];
+        double& firstMoment = m_firstMoments[parameterIndex];
+        double& secondMoment = m_secondMoments[parameterIndex];
+        firstMoment = TUNER_ADAM_BETA1 * firstMoment + (1.0 - TUNER_ADAM_BETA1) * gradient;
+        secondMoment = TUNER_ADAM_BETA2 * secondMoment + (1.0 - TUNER_ADAM_BETA2) * gradient * gradient;
+        double step = (firstMoment / firstCorrection) / (std::sqrt(secondMoment / secondCorrection) + TUNER_ADAM_EPSILON);
+        m_parameters[parameterIndex] -= (float)(learningRate * step);
+    }
+    return loss;
+}
+
+ChessEvaluationWeights ChessTexelTuner::GetWeights() const
+{
+    ChessEvaluationWeights weights = m_startWeights;
+    for (int typeIndex = 0; typeIndex < NUM_CHESS_PIECE_TYPES; ++typeIndex)
+    {
+        //Pawns never stand on the first or last rank, those squares keep their bonuses and stay out of the average
+        bool const isPawn = (typeIndex == (int)ChessPieceType::Pawn);
+        auto isReachable = [isPawn](int bonusIndex) { return !isPawn || (bonusIndex >= BOARD_SIZE && bonusIndex < NUM_BOARD_SQUARES - BOARD_SIZE); };
+
+        for (int phaseIndex = 0; phaseIndex < 2; ++phaseIndex)
+        {
+            float const* parameters = &m_parameters[phaseIndex * NUM_CHESS_TUNER_FEATURES + typeIndex * NUM_BOARD_SQUARES];
+            int& value = (phaseIndex == 0) ? weights.m_midgameValues[typeIndex] : weights.m_endgameValues[typeIndex];
+            int* bonuses = (phaseIndex == 0) ? weights.m_midgameBonuses[typeIndex] : weights.m_endgameBonuses[typeIndex];
+
+            double totalChange = 0.0;
+            int numReachable = 0;
+            for (int bonusIndex = 0; bonusIndex < NUM_BOARD_SQUARES; ++bonusIndex)
+            {
+                if (isReachable(bonusIndex))
+                {
+                    totalChange += parameters[bonusIndex] - (value + bonuses[bonusIndex]);
+                    ++numReachable;
+                }
+            }
+            int const startValue = value;
+            if (typeIndex != (int)ChessPieceType::King) //both sides always have one, its value cancels out
+            {
+                value = startValue + (int)std::lround(totalChange / numReachable);
+            }
+            for (int bonusIndex = 0; bonusIndex < NUM_BOARD_SQUARES; ++bonusIndex)
+            {
+                if (isReachable(bonusIndex))
+                {
+                    bonuses[bonusIndex] = (int)std::lround(parameters[bonusIndex]) - value;
+                }
+            }
+        }
+    }
+    return weights;
+}
+
+//----------------------------------------------------------------------------------------------------------
+double ChessTexelTuner::ComputeLossAndGradient(bool isComputingGradient) const
+{
+    int const numPositions = m_set.GetNumPositions();
+    int const numChunks = (numPositions + TUNER_PASS_CHUNK_POSITIONS - 1) / TUNER_PASS_CHUNK_POSITIONS;
+    m_chunkSums.resize(numChunks);
+
+    ChessTaskGroup group;
+    for (int chunkIndex = 0; chunkIndex < numChunks; ++chunkIndex)
+    {
+        ChunkSums& sums = m_chunkSums[chunkIndex];
+        if (isComputingGradient)
+        {
+            sums.m_gradient.assign(NUM_CHESS_TUNER_PARAMETERS, 0.0f);
+        }
+        else
+        {
+            sums.m_gradient.clear();
+        }
+        int firstPosition = chunkIndex * TUNER_PASS_CHUNK_POSITIONS;
+        int endPosition = std::min(firstPosition + TUNER_PASS_CHUNK_POSITIONS, numPositions);
+        m_pool.Submit(group, [this, firstPosition, endPosition, &sums]() { SumChunk(firstPosition, endPosition, sums); });
+    }
+    m_pool.Wait(group);
+
+    //Summed in chunk order, so the result does not depend on which thread finished first
+    double loss = 0.0;
+    for (ChunkSums const& sums : m_chunkSums)
+    {
+        loss += sums.m_loss;
+    }
+    if (isComputingGradient)
+    {
+        std::fill(m_gradient.begin(), m_gradient.end(), 0.0);
+        for (ChunkSums const& sums : m_chunkSums)
+        {
+            for (int parameterIndex = 0; parameterIndex < NUM_CHESS_TUNER_PARAMETERS; ++parameterIndex)
+            {
+                m_gradient[parameterIndex] += sums.m_gradient[parameterIndex];
+            }
+        }
+        for (double& gradient : m_gradient)
+        {
+            gradient /= numPositions;
+        }
+    }
+    return loss / numPositions;
+}
+
+void ChessTexelTuner::SumChunk(int firstPosition, int endPosition, ChunkSums& out_sums) const
+{
+    float const sigmoidScale = (float)(m_scalingK * std::log(10.0) / 400.0);
+    float const lambda = (float)m_lambda;
+    float const* midgameParameters = m_parameters.data();
+    float const* endgameParameters = m_parameters.data() + NUM_CHESS_TUNER_FEATURES;
+    float* midgameGradient = out_sums.m_gradient.empty() ? nullptr : out_sums.m_gradient.data();
+    float* endgameGradient = out_sums.m_gradient.empty() ? nullptr : out_sums.m_gradient.data() + NUM_CHESS_TUNER_FEATURES;
+    uint32_t const* featureStarts = m_set.m_featureStarts.data();
+    uint16_t const* features = m_set.m_features.data();
+
+    float evaluations[TUNER_BLOCK_POSITIONS];
+    float errorSlopes[TUNER_BLOCK_POSITIONS];
+    double loss = 0.0;
+    for (int blockStart = firstPosition; blockStart < endPosition; blockStart += TUNER_BLOCK_POSITIONS)
+    {
+        int const blockSize = std::min(TUNER_BLOCK_POSITIONS, endPosition - blockStart);
+        float const* midgameFactors = m_set.m_midgameFactors.data() + blockStart;
+        float const* results = m_set.m_results.data() + blockStart;
+        float const* searchScores = m_set.m_searchScores.data() + blockStart;
+
+        //Gather: the only scattered reads, into the parameters, which stay in L1
+        for (int blockIndex = 0; blockIndex < blockSize; ++blockIndex)
+        {
+            float midgameScore = 0.0f;
+            float endgameScore = 0.0f;
+            for (uint32_t featureIndex = featureStarts[blockStart + blockIndex]; featureIndex < featureStarts[blockStart + blockIndex + 1]; ++featureIndex)
+            {
+                uint16_t feature = features[featureIndex];
+                float sign = (feature & CHESS_TUNER_BLACK_FEATURE) ? -1.0f : 1.0f;
+                midgameScore += sign * midgameParameters[feature & TUNER_FEATURE_INDEX_MASK];
+                endgameScore += sign * endgameParameters[feature & TUNER_FEATURE_INDEX_MASK];
+            }
+            evaluations[blockIndex] = midgameScore * midgameFactors[blockIndex] + endgameScore * (1.0f - midgameFactors[blockIndex]);
+        }
+
+        //Straight-line float math over contiguous arrays, left for the compiler to vectorize
+        float blockLoss = 0.0f;
+        for (int blockIndex = 0; blockIndex < blockSize; ++blockIndex)
+        {
+            float prediction = 1.0f / (1.0f + std::exp(-sigmoidScale * evaluations[blockIndex]));
+            float searchPrediction = 1.0f / (1.0f + std::exp(-sigmoidScale * searchScores[blockIndex]));
+            float label = lambda * searchPrediction + (1.0f - lambda) * results[blockIndex];
+            float error = prediction - label;
+            blockLoss += error * error;
+            errorSlopes[blockIndex] = 2.0f * error * prediction * (1.0f - prediction) * sigmoidScale;
+        }
+        loss += blockLoss;
+        if (midgameGradient == nullptr)
+            continue;
+
+        //Scatter: d(eval) / d(parameter) is the piece's sign times its phase factor
+        for (int blockIndex = 0; blockIndex < blockSize; ++blockIndex)
+        {
+            float midgameSlope = errorSlopes[blockIndex] * midgameFactors[blockIndex];
+            float endgameSlope = errorSlopes[blockIndex] - midgameSlope;
+            for (uint32_t featureIndex = featureStarts[blockStart + blockIndex]; featureIndex < featureStarts[blockStart + blockIndex + 1]; ++featureIndex)
+            {
+                uint16_t feature = features[featureIndex];
+                float sign = (feature & CHESS_TUNER_BLACK_FEATURE) ? -1.0f : 1.0f;
+                midgameGradient[feature & TUNER_FEATURE_INDEX_MASK] += sign * midgameSlope;
+                endgameGradient[feature & TUNER_FEATURE_INDEX_MASK] += sign * endgameSlope;
+            }
+        }
+    }
+    out_sums.m_loss = loss;
+}
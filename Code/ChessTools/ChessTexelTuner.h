@@ -0,0 +1,77 @@
+﻿#pragma once
+#include "ChessEvaluation.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ChessThreadPool;
+
+//Tuned parameters: per piece type and bonus square the midgame piece-square score (value plus bonus), then the endgame one
+constexpr int NUM_CHESS_TUNER_FEATURES = NUM_CHESS_PIECE_TYPES * NUM_BOARD_SQUARES;
+constexpr int NUM_CHESS_TUNER_PARAMETERS = 2 * NUM_CHESS_TUNER_FEATURES;
+constexpr uint16_t CHESS_TUNER_BLACK_FEATURE = 0x8000; //the piece counts against white
+
+//----------------------------------------------------------------------------------------------------------
+//Labelled positions reduced to what the tapered evaluation reads, as parallel arrays so a pass over them streams
+//through memory: two bytes per piece and three floats per position
+struct ChessTuningSet
+{
+    std::vector<uint32_t> m_featureStarts; //position i's features are [m_featureStarts[i], m_featureStarts[i + 1])
+    std::vector<uint16_t> m_features; //piece type * 64 + bonus index, CHESS_TUNER_BLACK_FEATURE set for a black piece
+    std::vector<float> m_midgameFactors; //game phase / CHESS_MAX_GAME_PHASE, at most 1
+    std::vector<float> m_results; //what white scored, 0, 0.5 or 1
+    std::vector<float> m_searchScores; //centipawns from white's point of view
+
+    int GetNumPositions() const { return (int)m_results.size(); }
+    uint64_t GetMemorySize() const;
+};
+
+//Reads every record of the training files (ChessTrainingData.h), split over the pool. Phases are counted with the
+//phase weights of weights, which the tuner leaves alone
+bool LoadChessTuningSet(ChessThreadPool& pool, std::vector<std::string> const& paths, ChessEvaluationWeights const& weights,
+    ChessTuningSet& out_set, std::string& out_error);
+
+//----------------------------------------------------------------------------------------------------------
+//Texel tuning: minimizes the mean squared difference between each position's label and 1 / (1 + 10^(-K * eval / 400))
+//by Adam steps on the full-batch gradient. The label is the game result, blended towards the search score's own
+//sigmoid by lambda. Every pass is split into chunks over the pool, each chunk summing its own gradient
+class ChessTexelTuner
+{
+public:
+    ChessTexelTuner(ChessThreadPool& pool, ChessTuningSet const& set, ChessEvaluationWeights const& startWeights);
+
+    void SetLambda(double lambda) { m_lambda = lambda; }
+    void SetScalingK(double scalingK) { m_scalingK = scalingK; }
+    double GetScalingK() const { return m_scalingK; }
+    double FitScalingK(); //the K the start weights predict the labels best with, set and returned
+
+    double ComputeLoss() const;
+    double RunIteration(double learningRate); //one Adam step, returns the loss before it
+    //Rounded back into the weights file layout: the average change of each piece's squares moves its value, the rest
+    //stays in the bonuses. The king's value and every phase weight are kept from the start weights
+    ChessEvaluationWeights GetWeights() const;
+
+private:
+    struct ChunkSums
+    {
+        double m_loss = 0.0;
+        std::vector<float> m_gradient; //empty when only the loss is wanted
+    };
+
+    double ComputeLossAndGradient(bool isComputingGradient) const; //gradient into m_gradient, averaged over the positions
+    void SumChunk(int firstPosition, int endPosition, ChunkSums& out_sums) const;
+
+private:
+    ChessThreadPool& m_pool;
+    ChessTuningSet const& m_set;
+    ChessEvaluationWeights m_startWeights;
+    double m_scalingK = 1.0;
+    double m_lambda = 0.0;
+    std::vector<float> m_parameters;
+    std::vector<double> m_firstMoments; //Adam state
+    std::vector<double> m_secondMoments;
+    int m_numSteps = 0;
+    mutable std::vector<double> m_gradient;
+    mutable std::vector<ChunkSums> m_chunkSums;
+};
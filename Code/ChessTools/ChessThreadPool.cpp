@@ -0,0 +1,134 @@
+﻿#include "ChessThreadPool.h"
+
+static thread_local ChessThreadPool const* t_workerPool = nullptr;
+static thread_local int t_workerIndex = -1;
+
+//----------------------------------------------------------------------------------------------------------
+ChessThreadPool::ChessThreadPool(int numThreads)
+{
+    if (numThreads < 1)
+    {
+        numThreads = 1;
+    }
+    for (int queueIndex = 0; queueIndex <= numThreads; ++queueIndex)
+    {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (int workerIndex = 0; workerIndex < numThreads; ++workerIndex)
+    {
+        m_threads.emplace_back(&ChessThreadPool::WorkerMain, this, workerIndex);
+    }
+}
+
+ChessThreadPool::~ChessThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_isQuitting = true;
+    }
+    m_wakeCondition.notify_all();
+    for (std::thread& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void ChessThreadPool::Submit(ChessTaskGroup& group, std::function<void()> task)
+{
+    group.m_numUnfinished.fetch_add(1, std::memory_order_relaxed);
+
+    WorkerQueue& queue = *m_queues[GetMyQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.m_mutex);
+        queue.m_tasks.push_back(Task{ std::move(task), &group });
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_numQueuedTasks.fetch_add(1, std::memory_order_release);
+    }
+    m_wakeCondition.notify_one();
+}
+
+void ChessThreadPool::Wait(ChessTaskGroup& group)
+{
+    while (group.m_numUnfinished.load(std::memory_order_acquire) > 0)
+    {
+        if (!TryRunOneTask())
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------
+void ChessThreadPool::WorkerMain(int workerIndex)
+{
+    t_workerPool = this;
+    t_workerIndex = workerIndex;
+
+    for (;;)
+    {
+        if (TryRunOneTask())
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wakeCondition.wait(lock, [this]() { return m_isQuitting || m_numQueuedTasks.load(std::memory_order_acquire) > 0; });
+        if (m_isQuitting)
+        {
+            return;
+        }
+    }
+}
+
+int ChessThreadPool::GetMyQueueIndex() const
+{
+    return (t_workerPool == this) ? t_workerIndex : (int)m_threads.size();
+}
+
+bool ChessThreadPool::TryPopOrSteal(int queueIndex, Task& out_task)
+{
+    {
+        WorkerQueue& myQueue = *m_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(myQueue.m_mutex);
+        if (!myQueue.m_tasks.empty())
+        {
+            out_task = std::move(myQueue.m_tasks.back());
+            myQueue.m_tasks.pop_back();
+            return true;
+        }
+    }
+
+    int numQueues = (int)m_queues.size();
+    for (int offset = 1; offset < numQueues; ++offset)
+    {
+        WorkerQueue& victim = *m_queues[(queueIndex + offset) % numQueues];
+        std::lock_guard<std::mutex> lock(victim.m_mutex);
+        if (!victim.m_tasks.empty())
+        {
+            out_task = std::move(victim.m_tasks.front());
+            victim.m_tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ChessThreadPool::TryRunOneTask()
+{
+    if (m_numQueuedTasks.load(std::memory_order_acquire) == 0)
+    {
+        return false;
+    }
+
+    Task task;
+    if (!TryPopOrSteal(GetMyQueueIndex(), task))
+    {
+        return false;
+    }
+    m_numQueuedTasks.fetch_sub(1, std::memory_order_acq_rel);
+
+    task.m_function();
+    task.m_group->m_numUnfinished.fetch_sub(1, std::memory_order_release);
+    return true;
+}
@@ -0,0 +1,55 @@
+﻿#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Counts the unfinished tasks submitted under it, Wait() on the pool returns once it reaches zero
+struct ChessTaskGroup
+{
+    std::atomic<int> m_numUnfinished{ 0 };
+};
+
+//----------------------------------------------------------------------------------------------------------
+//Work-stealing pool: every worker owns a deque, pushes and pops its own back (depth-first, cache warm)
+//and steals from the front of the others (oldest, biggest tasks) once its own deque runs dry
+class ChessThreadPool
+{
+public:
+    explicit ChessThreadPool(int numThreads);
+    ~ChessThreadPool();
+
+    void Submit(ChessTaskGroup& group, std::function<void()> task);
+    void Wait(ChessTaskGroup& group); //the waiting thread runs tasks too, so tasks may submit and wait on nested groups
+    int GetNumThreads() const { return (int)m_threads.size(); }
+
+private:
+    struct Task
+    {
+        std::function<void()> m_function;
+        ChessTaskGroup* m_group = nullptr;
+    };
+
+    struct WorkerQueue
+    {
+        std::mutex m_mutex;
+        std::deque<Task> m_tasks;
+    };
+
+    void WorkerMain(int workerIndex);
+    int GetMyQueueIndex() const;
+    bool TryPopOrSteal(int queueIndex, Task& out_task);
+    bool TryRunOneTask();
+
+private:
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues; //one per worker, the last is shared by outside threads
+    std::vector<std::thread> m_threads;
+    std::atomic<bool> m_isQuitting{ false };
+    std::atomic<int> m_numQueuedTasks{ 0 };
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeCondition;
+};
@@ -0,0 +1,252 @@
+﻿#include "ChessPieceAnimations.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+constexpr int PIECES_PER_BOARD = 32;
+
+struct ChessAnimBenchOptions
+{
+    int m_numBoards = 0; //0 sweeps 1 to 10000 boards
+    int m_numFrames = 1000;
+    int m_numMovingPerBoard = 1;
+};
+
+//----------------------------------------------------------------------------------------------------------
+//Stand-in for the old path: every piece a separate heap object, all of them updated through a virtual call each frame,
+//re-running the tint and lerp logic and snapping to the square center even while at rest
+class LegacyAnimatedObject
+{
+public:
+    virtual ~LegacyAnimatedObject() = default;
+    virtual void Update(float deltaSeconds) = 0;
+};
+
+class LegacyAnimatedPiece : public LegacyAnimatedObject
+{
+public:
+    void Update(float deltaSeconds) override
+    {
+        m_varyTime += deltaSeconds;
+        if (m_varyTime > 360.f)
+        {
+            m_varyTime = 0.f;
+        }
+        if (m_isGrabbed)
+        {
+            float pulse = 0.5f + 0.5f * sinf(m_varyTime * 3.f);
+            m_tint[3] = (unsigned char)(150.f + 105.f * pulse);
+        }
+        else
+        {
+            m_tint[3] = m_originalAlpha;
+        }
+
+        if (m_lerpT >= 1.f)
+        {
+            m_position[0] = (float)m_currentCoord[0] + 0.5f;
+            m_position[1] = (float)m_currentCoord[1] + 0.5f;
+            return;
+        }
+        m_lerpT = std::min(m_lerpT + m_lerpSpeed * deltaSeconds, 1.f);
+        float inverse = 1.f - m_lerpT;
+        float t = 1.f - inverse * inverse * inverse;
+        m_position[0] = ((float)m_lastCoord[0] + 0.5f) + (float)(m_currentCoord[0] - m_lastCoord[0]) * t;
+        m_position[1] = ((float)m_lastCoord[1] + 0.5f) + (float)(m_currentCoord[1] - m_lastCoord[1]) * t;
+        m_position[2] = m_isKnight ? 1.f - t : 0.f;
+    }
+
+public:
+    float m_position[3] = {};
+    float m_orientation[3] = {};
+    int m_lastCoord[2] = {};
+    int m_currentCoord[2] = {};
+    float m_lerpT = 1.f;
+    float m_lerpSpeed = 1.f;
+    float m_varyTime = 0.f;
+    unsigned char m_tint[4] = { 255, 255, 255, 255 };
+    unsigned char m_originalAlpha = 255;
+    bool m_isGrabbed = false;
+    bool m_isKnight = false;
+    unsigned char m_otherState[64] = {}; //rest of a ChessPiece: definition pointer, owner, flags, start square, debug verts
+};
+
+//----------------------------------------------------------------------------------------------------------
+static double GetSecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void PrintUsage()
+{
+    printf("Usage: ChessAnimBench [options]\n");
+    printf("  --boards N           boards to animate at once, 0 sweeps 1 to 10000 (default 0)\n");
+    printf("  --frames N           frames to simulate per run (default 1000)\n");
+    printf("  --moving N           pieces sliding on every board at any time (default 1)\n");
+}
+
+static double RunLegacy(int numBoards, ChessAnimBenchOptions const& options, float& out_checksum)
+{
+    //Allocate in a shuffled order so the objects end up scattered like long-lived game objects
+    int numPieces = numBoards * PIECES_PER_BOARD;
+    std::vector<std::unique_ptr<LegacyAnimatedPiece>> storage(numPieces);
+    std::vector<int> allocationOrder(numPieces);
+    for (int pieceIndex = 0; pieceIndex < numPieces; ++pieceIndex)
+    {
+        allocationOrder[pieceIndex] = pieceIndex;
+    }
+    std::shuffle(allocationOrder.begin(), allocationOrder.end(), std::mt19937(1234));
+    std::vector<std::unique_ptr<unsigned char[]>> spacers;
+    for (int pieceIndex : allocationOrder)
+    {
+        storage[pieceIndex] = std::make_unique<LegacyAnimatedPiece>();
+        storage[pieceIndex]->m_isKnight = (pieceIndex % PIECES_PER_BOARD) == 1;
+        spacers.push_back(std::make_unique<unsigned char[]>(96 + (pieceIndex % 7) * 16));
+    }
+    std::vector<LegacyAnimatedObject*> objects;
+    for (std::unique_ptr<LegacyAnimatedPiece> const& piece : storage)
+    {
+        objects.push_back(piece.get());
+    }
+
+    float const deltaSeconds = 1.f / 60.f;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < options.m_numFrames; ++frame)
+    {
+        //Same workload as the SoA run: the first pieces of every board restart their slide when they land
+        for (int boardIndex = 0; boardIndex < numBoards; ++boardIndex)
+        {
+            for (int movingIndex = 0; movingIndex < options.m_numMovingPerBoard; ++movingIndex)
+            {
+                LegacyAnimatedPiece* piece = storage[boardIndex * PIECES_PER_BOARD + movingIndex].get();
+                if (piece->m_lerpT >= 1.f)
+                {
+                    piece->m_lastCoord[0] = piece->m_currentCoord[0];
+                    piece->m_lastCoord[1] = piece->m_currentCoord[1];
+                    piece->m_currentCoord[0] = (piece->m_currentCoord[0] + 3) & 7;
+                    piece->m_currentCoord[1] = (piece->m_currentCoord[1] + 5) & 7;
+                    piece->m_lerpT = 0.f;
+                }
+            }
+        }
+        for (LegacyAnimatedObject* object : objects)
+        {
+            object->Update(deltaSeconds);
+        }
+    }
+    double seconds = GetSecondsSince(start);
+
+    out_checksum = 0.f;
+    for (int boardIndex = 0; boardIndex < numBoards; ++boardIndex)
+    {
+        for (int movingIndex = 0; movingIndex < options.m_numMovingPerBoard; ++movingIndex)
+        {
+            LegacyAnimatedPiece const* piece = storage[boardIndex * PIECES_PER_BOARD + movingIndex].get();
+            out_checksum += piece->m_position[0] + piece->m_position[1];
+        }
+    }
+    return seconds;
+}
+
+static double RunSoA(int numBoards, ChessAnimBenchOptions const& options, float& out_checksum)
+{
+    int numPieces = numBoards * PIECES_PER_BOARD;
+    ChessPieceAnimations animations;
+    animations.Initialize(numPieces);
+    std::vector<int> coords(numPieces * 2, 0);
+
+    float const deltaSeconds = 1.f / 60.f;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < options.m_numFrames; ++frame)
+    {
+        for (int boardIndex = 0; boardIndex < numBoards; ++boardIndex)
+        {
+            for (int movingIndex = 0; movingIndex < options.m_numMovingPerBoard; ++movingIndex)
+            {
+                int slot = boardIndex * PIECES_PER_BOARD + movingIndex;
+                if (!animations.IsMoving(slot))
+                {
+                    int lastX = coords[slot * 2];
+                    int lastY = coords[slot * 2 + 1];
+                    coords[slot * 2] = (lastX + 3) & 7;
+                    coords[slot * 2 + 1] = (lastY + 5) & 7;
+                    animations.StartMove(slot, (float)lastX + 0.5f, (float)lastY + 0.5f,
+                        (float)coords[slot * 2] + 0.5f, (float)coords[slot * 2 + 1] + 0.5f, movingIndex == 1);
+                }
+            }
+        }
+        animations.Update(deltaSeconds);
+    }
+    double seconds = GetSecondsSince(start);
+
+    out_checksum = 0.f;
+    for (int boardIndex = 0; boardIndex < numBoards; ++boardIndex)
+    {
+        for (int movingIndex = 0; movingIndex < options.m_numMovingPerBoard; ++movingIndex)
+        {
+            int slot = boardIndex * PIECES_PER_BOARD + movingIndex;
+            out_checksum += animations.m_x[slot] + animations.m_y[slot];
+        }
+    }
+    return seconds;
+}
+
+static void RunBoards(int numBoards, ChessAnimBenchOptions const& options)
+{
+    float legacyChecksum = 0.f;
+    float soaChecksum = 0.f;
+    double legacySeconds = RunLegacy(numBoards, options, legacyChecksum);
+    double soaSeconds = RunSoA(numBoards, options, soaChecksum);
+    double legacyMicroseconds = legacySeconds * 1e6 / options.m_numFrames;
+    double soaMicroseconds = soaSeconds * 1e6 / options.m_numFrames;
+    printf("%8d %10d %14.2f %14.2f %9.1fx   (%g / %g)\n", numBoards, numBoards * PIECES_PER_BOARD, legacyMicroseconds, soaMicroseconds,
+        (soaMicroseconds > 0.0) ? legacyMicroseconds / soaMicroseconds : 0.0, legacyChecksum, soaChecksum);
+}
+
+//----------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    ChessAnimBenchOptions options;
+    for (int argIndex = 1; argIndex < argc; ++argIndex)
+    {
+        std::string arg = argv[argIndex];
+        bool hasValue = argIndex + 1 < argc;
+        if (arg == "--boards" && hasValue)
+        {
+            options.m_numBoards = atoi(argv[++argIndex]);
+        }
+        else if (arg == "--frames" && hasValue)
+        {
+            options.m_numFrames = std::max(1, atoi(argv[++argIndex]));
+        }
+        else if (arg == "--moving" && hasValue)
+        {
+            options.m_numMovingPerBoard = std::min(std::max(0, atoi(argv[++argIndex])), PIECES_PER_BOARD);
+        }
+        else
+        {
+            PrintUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 2;
+        }
+    }
+
+    printf("%d frames, %d sliding piece(s) per board\n", options.m_numFrames, options.m_numMovingPerBoard);
+    printf("  boards     pieces  per-object us  SoA active us   speedup   (checksums)\n");
+    if (options.m_numBoards > 0)
+    {
+        RunBoards(options.m_numBoards, options);
+        return 0;
+    }
+    for (int numBoards = 1; numBoards <= 10000; numBoards *= 10)
+    {
+        RunBoards(numBoards, options);
+    }
+    return 0;
+}
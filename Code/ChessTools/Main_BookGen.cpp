@@ -0,0 +1,299 @@
+﻿#include "ChessOpeningBook.h"
+#include "ChessMoveGen.h"
+#include "ChessZobrist.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+//Every allocation of the process is counted so the benchmark can show that lookups make none
+static std::atomic<int64_t> s_numAllocations{ 0 };
+
+void* operator new(size_t size)
+{
+    ++s_numAllocations;
+    void* memory = malloc(size > 0 ? size : 1);
+    if (memory == nullptr)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    free(memory);
+}
+
+struct ChessBookGenOptions
+{
+    std::string m_linesPath = "Data/Books/ChessOpenings.txt";
+    std::string m_bookPath = "Data/Books/ChessBook.bin";
+    std::string m_probeFEN;
+    int m_benchLookups = 0;
+    bool m_isCheckingKeys = false;
+};
+
+//Positions and keys given in the Polyglot book format description
+struct ChessBookReferenceKey
+{
+    char const* m_fen;
+    uint64_t m_key;
+};
+
+static constexpr ChessBookReferenceKey s_bookReferenceKeys[] =
+{
+    { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 0x463B96181691FC9Cull },
+    { "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", 0x823C9B50FD114196ull },
+    { "rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2", 0x0756B94461C50FB0ull },
+    { "rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2", 0x662FAFB965DB29D4ull },
+    { "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", 0x22A48B5A8E47FF78ull },
+    { "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3", 0x652A607CA3F242C1ull },
+    { "rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4", 0x00FDD303C946BDD9ull },
+    { "rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3", 0x3C8123EA7B067637ull },
+    { "rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4", 0x5C3F9B829B279560ull },
+};
+
+//----------------------------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf("Usage: ChessBookGen [options]\n");
+    printf("  --lines PATH         opening lines to build from (default Data/Books/ChessOpenings.txt)\n");
+    printf("  --book PATH          book file written, or read by --probe and --bench (default Data/Books/ChessBook.bin)\n");
+    printf("  --probe \"<fen>\"      list the book moves of a position and exit\n");
+    printf("  --bench N            time N lookups on the book and exit\n");
+    printf("  --check-keys         compare the book keys against Polyglot's reference keys and exit\n");
+}
+
+static double GetSecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int RunProbe(ChessBookGenOptions const& options)
+{
+    ChessPosition position;
+    if (!position.SetFromFEN(options.m_probeFEN))
+    {
+        printf("Invalid FEN: %s\n", options.m_probeFEN.c_str());
+        return 2;
+    }
+    ChessOpeningBook book;
+    std::string error;
+    if (!book.Open(options.m_bookPath, error) || !book.LoadOpeningNames(options.m_linesPath, error))
+    {
+        printf("%s\n", error.c_str());
+        return 1;
+    }
+
+    char const* name = book.GetOpeningName(position);
+    printf("%s\n", (name != nullptr) ? name : "(no opening name)");
+    ChessBookMove moves[MAX_CHESS_BOOK_MOVES];
+    int numMoves = book.Probe(position, moves, MAX_CHESS_BOOK_MOVES);
+    if (numMoves == 0)
+    {
+        printf("Not in the book\n");
+        return 1;
+    }
+    for (int moveIndex = 0; moveIndex < numMoves; ++moveIndex)
+    {
+        printf("  %-6s weight %d\n", GetMoveNotation(moves[moveIndex].m_move).c_str(), moves[moveIndex].m_weight);
+    }
+    return 0;
+}
+
+static int RunKeyCheck()
+{
+    int numFailed = 0;
+    for (ChessBookReferenceKey const& reference : s_bookReferenceKeys)
+    {
+        ChessPosition position;
+        if (!position.SetFromFEN(reference.m_fen))
+        {
+            printf("FAIL  invalid FEN %s\n", reference.m_fen);
+            ++numFailed;
+            continue;
+        }
+        uint64_t key = GetChessBookKey(position);
+        bool isMatching = (key == reference.m_key);
+        numFailed += isMatching ? 0 : 1;
+        printf("%s  %016llx  %s\n", isMatching ? "ok  " : "FAIL", (unsigned long long)key, reference.m_fen);
+        if (!isMatching)
+        {
+            printf("      expected %016llx\n", (unsigned long long)reference.m_key);
+        }
+    }
+    int numKeys = (int)(sizeof(s_bookReferenceKeys) / sizeof(s_bookReferenceKeys[0]));
+    printf("%d/%d reference keys match\n", numKeys - numFailed, numKeys);
+    return (numFailed == 0) ? 0 : 1;
+}
+
+//Half the positions come from the book lines, half are random playouts that mostly miss, so both outcomes are timed
+static int RunBench(ChessBookGenOptions const& options, std::vector<ChessOpeningLine> const& lines)
+{
+    ChessOpeningBook book;
+    std::string error;
+    if (!book.Open(options.m_bookPath, error))
+    {
+        printf("%s\n", error.c_str());
+        return 1;
+    }
+    ChessOpeningBook secondBook; //shares the first one's mapping
+    secondBook.Open(options.m_bookPath, error);
+
+    std::vector<ChessPosition> positions;
+    for (ChessOpeningLine const& line : lines)
+    {
+        ChessPosition position;
+        position.SetToStartingPosition();
+        for (ChessMove const& move : line.m_moves)
+        {
+            positions.push_back(position);
+            position.ApplyMove(move);
+        }
+    }
+    size_t numBookPositions = positions.size();
+    uint64_t randomState = 1;
+    while (positions.size() < numBookPositions * 2)
+    {
+        ChessPosition position;
+        position.SetToStartingPosition();
+        for (int ply = 0; ply < 12; ++ply)
+        {
+            ChessMoveList moves;
+            GenerateLegalMoves(position, moves);
+            if (moves.Size() == 0)
+                break;
+            position.ApplyMove(moves[(int)(GetNextZobristRandom(randomState) % (uint64_t)moves.Size())]);
+        }
+        positions.push_back(position);
+    }
+
+    ChessBookMove moves[MAX_CHESS_BOOK_MOVES];
+    int64_t numHits = 0;
+    int64_t numMovesFound = 0;
+    int64_t allocationsBefore = s_numAllocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int lookupIndex = 0; lookupIndex < options.m_benchLookups; ++lookupIndex)
+    {
+        ChessOpeningBook const& probedBook = (lookupIndex & 1) ? secondBook : book;
+        int numMoves = probedBook.Probe(positions[lookupIndex % positions.size()], moves, MAX_CHESS_BOOK_MOVES);
+        numHits += (numMoves > 0) ? 1 : 0;
+        numMovesFound += numMoves;
+    }
+    double seconds = GetSecondsSince(start);
+    int64_t numAllocations = s_numAllocations.load() - allocationsBefore;
+
+    printf("%llu entries, %d lookups over %d positions: %lld hits, %lld moves\n", (unsigned long long)book.GetNumEntries(),
+        options.m_benchLookups, (int)positions.size(), (long long)numHits, (long long)numMovesFound);
+    printf("%.0f ns per lookup, %lld heap allocations\n", seconds * 1e9 / std::max(options.m_benchLookups, 1), (long long)numAllocations);
+    return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    ChessBookGenOptions options;
+    for (int argIndex = 1; argIndex < argc; ++argIndex)
+    {
+        std::string arg = argv[argIndex];
+        bool hasValue = argIndex + 1 < argc;
+        if (arg == "--lines" && hasValue)
+        {
+            options.m_linesPath = argv[++argIndex];
+        }
+        else if (arg == "--book" && hasValue)
+        {
+            options.m_bookPath = argv[++argIndex];
+        }
+        else if (arg == "--probe" && hasValue)
+        {
+            options.m_probeFEN = argv[++argIndex];
+        }
+        else if (arg == "--bench" && hasValue)
+        {
+            options.m_benchLookups = atoi(argv[++argIndex]);
+        }
+        else if (arg == "--check-keys")
+        {
+            options.m_isCheckingKeys = true;
+        }
+        else
+        {
+            PrintUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 2;
+        }
+    }
+
+    InitializeChessAttackTables();
+    if (options.m_isCheckingKeys)
+    {
+        return RunKeyCheck();
+    }
+    if (!options.m_probeFEN.empty())
+    {
+        return RunProbe(options);
+    }
+
+    std::vector<ChessOpeningLine> lines;
+    std::string error;
+    if (!ReadChessOpeningLines(options.m_linesPath, lines, error))
+    {
+        printf("%s\n", error.c_str());
+        return 1;
+    }
+    if (options.m_benchLookups > 0)
+    {
+        return RunBench(options, lines);
+    }
+
+    //A book move weighs as many lines as play it from that position
+    std::map<std::pair<uint64_t, uint16_t>, int> moveCounts;
+    for (ChessOpeningLine const& line : lines)
+    {
+        ChessPosition position;
+        position.SetToStartingPosition();
+        for (ChessMove const& move : line.m_moves)
+        {
+            ++moveCounts[{ GetChessBookKey(position), EncodeChessBookMove(move) }];
+            position.ApplyMove(move);
+        }
+    }
+
+    std::vector<ChessBookEntry> entries;
+    for (auto const& moveCount : moveCounts)
+    {
+        ChessBookEntry entry;
+        entry.m_key = moveCount.first.first;
+        entry.m_move = moveCount.first.second;
+        entry.m_weight = (uint16_t)std::min(moveCount.second, 0xFFFF);
+        entries.push_back(entry);
+    }
+    std::sort(entries.begin(), entries.end(), [](ChessBookEntry const& a, ChessBookEntry const& b)
+        { return (a.m_key != b.m_key) ? a.m_key < b.m_key : a.m_weight > b.m_weight; });
+
+    std::vector<unsigned char> bytes(entries.size() * CHESS_BOOK_ENTRY_SIZE);
+    for (size_t entryIndex = 0; entryIndex < entries.size(); ++entryIndex)
+    {
+        WriteChessBookEntry(entries[entryIndex], &bytes[entryIndex * CHESS_BOOK_ENTRY_SIZE]);
+    }
+    std::ofstream file(options.m_bookPath, std::ios::binary);
+    if (!file.write((char const*)bytes.data(), (std::streamsize)bytes.size()))
+    {
+        printf("Cannot write %s\n", options.m_bookPath.c_str());
+        return 1;
+    }
+    printf("%d lines, %d book entries written to %s\n", (int)lines.size(), (int)entries.size(), options.m_bookPath.c_str());
+    return 0;
+}
@@ -0,0 +1,219 @@
+﻿#include "ChessEvaluation.h"
+#include "ChessMoveGen.h"
+#include "ChessNNUE.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+struct ChessNNUEBenchOptions
+{
+    int m_numGames = 2000;
+    int m_maxPlies = 120;
+    int m_numRepeats = 5;
+    std::string m_networkPath; //empty benchmarks the piece-square bootstrap network
+    std::string m_writePath;
+};
+
+//One ply of a recorded game: the position before the move and the move
+struct ChessNNUEBenchPly
+{
+    ChessPosition m_position;
+    ChessMove m_move;
+    bool m_isGameStart = false;
+};
+
+//----------------------------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf("Usage: ChessNNUEBench [options]\n");
+    printf("  --games N            random games to replay (default 2000)\n");
+    printf("  --plies N            longest game in plies (default 120)\n");
+    printf("  --repeats N          timed passes over the games, best one counts (default 5)\n");
+    printf("  --network PATH       weights file to benchmark, the piece-square bootstrap network if omitted\n");
+    printf("  --write-bootstrap PATH   write the piece-square bootstrap network to PATH and exit\n");
+}
+
+static double GetSecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void RecordRandomGames(ChessNNUEBenchOptions const& options, std::vector<ChessNNUEBenchPly>& out_plies)
+{
+    std::mt19937 random(5678);
+    for (int gameIndex = 0; gameIndex < options.m_numGames; ++gameIndex)
+    {
+        ChessPosition position;
+        position.SetToStartingPosition();
+        for (int ply = 0; ply < options.m_maxPlies; ++ply)
+        {
+            ChessMoveList moves;
+            GenerateLegalMoves(position, moves);
+            if (moves.Size() == 0)
+                break;
+
+            ChessNNUEBenchPly benchPly;
+            benchPly.m_position = position;
+            benchPly.m_move = moves[(int)(random() % (unsigned)moves.Size())];
+            benchPly.m_isGameStart = (ply == 0);
+            out_plies.push_back(benchPly);
+            position.ApplyMove(benchPly.m_move);
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    ChessNNUEBenchOptions options;
+    for (int argIndex = 1; argIndex < argc; ++argIndex)
+    {
+        std::string arg = argv[argIndex];
+        bool hasValue = argIndex + 1 < argc;
+        if (arg == "--games" && hasValue)
+        {
+            options.m_numGames = std::max(1, atoi(argv[++argIndex]));
+        }
+        else if (arg == "--plies" && hasValue)
+        {
+            options.m_maxPlies = std::max(1, atoi(argv[++argIndex]));
+        }
+        else if (arg == "--repeats" && hasValue)
+        {
+            options.m_numRepeats = std::max(1, atoi(argv[++argIndex]));
+        }
+        else if (arg == "--network" && hasValue)
+        {
+            options.m_networkPath = argv[++argIndex];
+        }
+        else if (arg == "--write-bootstrap" && hasValue)
+        {
+            options.m_writePath = argv[++argIndex];
+        }
+        else
+        {
+            PrintUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 2;
+        }
+    }
+
+    InitializeChessAttackTables();
+
+    std::unique_ptr<ChessNNUENetwork> network = std::make_unique<ChessNNUENetwork>();
+    if (options.m_networkPath.empty())
+    {
+        network->InitializeFromPieceSquareTables();
+    }
+    else
+    {
+        std::string error;
+        if (!network->LoadFromFile(options.m_networkPath, error))
+        {
+            printf("%s\n", error.c_str());
+            return 2;
+        }
+    }
+    if (!options.m_writePath.empty())
+    {
+        if (!network->SaveToFile(options.m_writePath))
+        {
+            printf("Cannot write %s\n", options.m_writePath.c_str());
+            return 2;
+        }
+        printf("Wrote %s\n", options.m_writePath.c_str());
+        return 0;
+    }
+
+    std::vector<ChessNNUEBenchPly> plies;
+    RecordRandomGames(options, plies);
+    int numPlies = (int)plies.size();
+    printf("%s kernels, %d hidden neurons, %d random games, %d moves\n", GetChessNNUESimdName(), CHESS_NNUE_HIDDEN_SIZE, options.m_numGames, numPlies);
+
+    //Correctness first: the incremental accumulator must match a refresh bit for bit after every move
+    int numMismatches = 0;
+    int maxEvalDifference = 0;
+    ChessNNUEAccumulator incremental;
+    ChessNNUEAccumulator refreshed;
+    for (int plyIndex = 0; plyIndex < numPlies; ++plyIndex)
+    {
+        ChessNNUEBenchPly const& benchPly = plies[plyIndex];
+        if (benchPly.m_isGameStart)
+        {
+            network->RefreshAccumulator(benchPly.m_position, incremental);
+        }
+        ChessNNUEAccumulator next;
+        network->UpdateAccumulator(incremental, benchPly.m_position, benchPly.m_move, next);
+        incremental = next;
+
+        ChessPosition after = benchPly.m_position;
+        after.ApplyMove(benchPly.m_move);
+        network->RefreshAccumulator(after, refreshed);
+        if (memcmp(&incremental, &refreshed, sizeof(incremental)) != 0)
+        {
+            ++numMismatches;
+        }
+        if (options.m_networkPath.empty())
+        {
+            int midgameScore = (after.m_sideToMove == KISHI_WHITE) ? after.m_midgameScore : -after.m_midgameScore;
+            maxEvalDifference = std::max(maxEvalDifference, abs(network->Evaluate(refreshed, after.m_sideToMove) - midgameScore));
+        }
+    }
+    printf("Incremental vs refresh: %d mismatches\n", numMismatches);
+    if (options.m_networkPath.empty())
+    {
+        printf("Bootstrap network vs midgame piece-square score: at most %d cp apart\n", maxEvalDifference);
+    }
+
+    //Timed passes: update + evaluate after every move, against refresh + evaluate
+    double bestIncrementalSeconds = 1e30;
+    double bestRefreshSeconds = 1e30;
+    int64_t checksum = 0;
+    for (int repeat = 0; repeat < options.m_numRepeats; ++repeat)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int plyIndex = 0; plyIndex < numPlies; ++plyIndex)
+        {
+            ChessNNUEBenchPly const& benchPly = plies[plyIndex];
+            if (benchPly.m_isGameStart)
+            {
+                network->RefreshAccumulator(benchPly.m_position, incremental);
+            }
+            ChessNNUEAccumulator next;
+            network->UpdateAccumulator(incremental, benchPly.m_position, benchPly.m_move, next);
+            incremental = next;
+            checksum += network->Evaluate(incremental, 1 - benchPly.m_position.m_sideToMove);
+        }
+        bestIncrementalSeconds = std::min(bestIncrementalSeconds, GetSecondsSince(start));
+
+        start = std::chrono::steady_clock::now();
+        for (int plyIndex = 0; plyIndex < numPlies; ++plyIndex)
+        {
+            //The position after the move is the next ply's position, except at the end of a game
+            ChessNNUEBenchPly const& benchPly = plies[plyIndex];
+            bool hasNext = plyIndex + 1 < numPlies && !plies[plyIndex + 1].m_isGameStart;
+            ChessPosition after;
+            if (!hasNext)
+            {
+                after = benchPly.m_position;
+                after.ApplyMove(benchPly.m_move);
+            }
+            network->RefreshAccumulator(hasNext ? plies[plyIndex + 1].m_position : after, refreshed);
+            checksum -= network->Evaluate(refreshed, 1 - benchPly.m_position.m_sideToMove);
+        }
+        bestRefreshSeconds = std::min(bestRefreshSeconds, GetSecondsSince(start));
+    }
+
+    double incrementalNanoseconds = bestIncrementalSeconds * 1e9 / numPlies;
+    double refreshNanoseconds = bestRefreshSeconds * 1e9 / numPlies;
+    printf("  incremental update + eval %8.1f ns, %6.2f M evals/s\n", incrementalNanoseconds, 1000.0 / incrementalNanoseconds);
+    printf("  full refresh + eval       %8.1f ns, %6.2f M evals/s\n", refreshNanoseconds, 1000.0 / refreshNanoseconds);
+    printf("  incremental is %.1fx faster (checksum %lld, 0 when both agree)\n", refreshNanoseconds / incrementalNanoseconds, (long long)checksum);
+    return numMismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+﻿#include "ChessPerft.h"
+#include "ChessThreadPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+struct ChessPerftOptions
+{
+    int m_depth = 5;
+    bool m_isDivide = false;
+    bool m_isDeep = false;
+    int m_numThreads = 1;
+    int m_numSplitPlies = 2;
+    int m_hashSizeInMB = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf("Usage: ChessPerft [options]\n");
+    printf("  --suite              run the reference positions and compare against published counts (default)\n");
+    printf("  --deep               run the suite at its deeper stress depths (depth 5-7)\n");
+    printf("  --depth N            count a single position to depth N (default 5)\n");
+    printf("  --fen \"<fen>\"        position to count, the starting position if omitted\n");
+    printf("  --divide             print the node count below every root move\n");
+    printf("  --threads N          worker threads, 0 for every hardware thread (default 1, single-threaded)\n");
+    printf("  --split N            plies split into pool tasks (default 2)\n");
+    printf("  --hash MB            shared subtree hash size, 0 to disable (default 0)\n");
+}
+
+static double GetSecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void PrintNodeRate(uint64_t numNodes, double seconds)
+{
+    double nodesPerSecond = (seconds > 0.0) ? (double)numNodes / seconds : 0.0;
+    printf("  %llu nodes in %.3f s, %.2f Mnps\n", (unsigned long long)numNodes, seconds, nodesPerSecond / 1000000.0);
+}
+
+static uint64_t RunPosition(ChessPosition const& position, int depth, ChessPerftOptions const& options, ChessThreadPool* pool)
+{
+    //A fresh table per position keeps every count independent of the previous run
+    std::unique_ptr<ChessPerftHash> hash;
+    if (options.m_hashSizeInMB > 0)
+    {
+        hash = std::make_unique<ChessPerftHash>(options.m_hashSizeInMB);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ChessPerftDivideEntry> entries;
+    uint64_t numNodes = 0;
+    if (pool != nullptr)
+    {
+        numNodes = PerftDivideParallel(*pool, position, depth, options.m_numSplitPlies, entries, hash.get());
+    }
+    else if (options.m_isDivide)
+    {
+        numNodes = PerftDivide(position, depth, entries, hash.get());
+    }
+    else
+    {
+        numNodes = Perft(position, depth, hash.get());
+    }
+    double seconds = GetSecondsSince(start);
+
+    if (options.m_isDivide)
+    {
+        for (ChessPerftDivideEntry const& entry : entries)
+        {
+            printf("  %s: %llu\n", GetMoveNotation(entry.m_move).c_str(), (unsigned long long)entry.m_numNodes);
+        }
+        printf("  %d root moves\n", (int)entries.size());
+    }
+    PrintNodeRate(numNodes, seconds);
+    return numNodes;
+}
+
+static int RunSuite(ChessPerftOptions const& options, ChessThreadPool* pool)
+{
+    int numFailed = 0;
+    uint64_t totalNodes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int suiteIndex = 0; suiteIndex < g_numPerftSuitePositions; ++suiteIndex)
+    {
+        ChessPerftSuitePosition const& suitePosition = g_perftSuite[suiteIndex];
+        int depth = options.m_isDeep ? suitePosition.m_deepDepth : suitePosition.m_depth;
+        uint64_t expectedNodes = options.m_isDeep ? suitePosition.m_expectedDeepNodes : suitePosition.m_expectedNodes;
+
+        ChessPosition position;
+        position.SetFromFEN(suitePosition.m_fen);
+
+        printf("%s depth %d\n", suitePosition.m_name, depth);
+        uint64_t numNodes = RunPosition(position, depth, options, pool);
+        totalNodes += numNodes;
+        if (numNodes != expectedNodes)
+        {
+            printf("  FAILED, expected %llu\n", (unsigned long long)expectedNodes);
+            ++numFailed;
+        }
+    }
+    printf("Suite: %d/%d passed\n", g_numPerftSuitePositions - numFailed, g_numPerftSuitePositions);
+    PrintNodeRate(totalNodes, GetSecondsSince(start));
+    return numFailed == 0 ? 0 : 1;
+}
+
+//----------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    ChessPerftOptions options;
+    std::string fen;
+    bool isSuite = true;
+
+    for (int argIndex = 1; argIndex < argc; ++argIndex)
+    {
+        std::string arg = argv[argIndex];
+        bool hasValue = argIndex + 1 < argc;
+        if (arg == "--suite")
+        {
+            isSuite = true;
+        }
+        else if (arg == "--deep")
+        {
+            isSuite = true;
+            options.m_isDeep = true;
+        }
+        else if (arg == "--divide")
+        {
+            options.m_isDivide = true;
+        }
+        else if (arg == "--depth" && hasValue)
+        {
+            options.m_depth = atoi(argv[++argIndex]);
+            isSuite = false;
+        }
+        else if (arg == "--fen" && hasValue)
+        {
+            fen = argv[++argIndex];
+            isSuite = false;
+        }
+        else if (arg == "--threads" && hasValue)
+        {
+            options.m_numThreads = atoi(argv[++argIndex]);
+        }
+        else if (arg == "--split" && hasValue)
+        {
+            options.m_numSplitPlies = atoi(argv[++argIndex]);
+        }
+        else if (arg == "--hash" && hasValue)
+        {
+            options.m_hashSizeInMB = atoi(argv[++argIndex]);
+        }
+        else
+        {
+            PrintUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 2;
+        }
+    }
+
+    InitializeChessAttackTables();
+
+    if (options.m_numThreads <= 0)
+    {
+        options.m_numThreads = (int)std::thread::hardware_concurrency();
+    }
+    std::unique_ptr<ChessThreadPool> pool;
+    if (options.m_numThreads > 1)
+    {
+        pool = std::make_unique<ChessThreadPool>(options.m_numThreads);
+        printf("%d threads, %d split plies, %d MB hash\n", options.m_numThreads, options.m_numSplitPlies, options.m_hashSizeInMB);
+    }
+
+    if (isSuite)
+    {
+        return RunSuite(options, pool.get());
+    }
+
+    ChessPosition position;
+    if (!position.SetFromFEN(fen.empty() ? std::string(CHESS_STARTING_FEN) : fen))
+    {
+        printf("Invalid FEN: %s\n", fen.c_str());
+        return 2;
+    }
+    printf("%s depth %d\n", position.GetFEN().c_str(), options.m_depth);
+    RunPosition(position, options.m_depth, options, pool.get());
+    return 0;
+}
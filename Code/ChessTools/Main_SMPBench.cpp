@@ -0,0 +1,118 @@
+﻿#include "ChessAnalysis.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ChessSMPBenchOptions
+{
+    int m_depth = 10;
+    int m_maxThreads = 16;
+    int m_hashSizeInMB = 64;
+};
+
+//Middlegame positions with plenty to search, a mate or a bare endgame finishes too early to measure anything
+static char const* const s_benchFENs[] =
+{
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r1bq1rk1/pp2bppp/2n1pn2/2pp4/2PP4/2NBPN2/PP3PPP/R1BQ1RK1 w - - 0 8",
+    "r2q1rk1/1p1nbppp/p2pbn2/4p3/4P3/1NN1BP2/PPPQ2PP/2KR1B1R w - - 2 11",
+};
+constexpr int NUM_BENCH_FENS = (int)(sizeof(s_benchFENs) / sizeof(s_benchFENs[0]));
+
+//----------------------------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf("Usage: ChessSMPBench [options]\n");
+    printf("  --depth N            depth every thread count searches each position to (default 10)\n");
+    printf("  --threads N          largest thread count, doubling from 1 (default 16)\n");
+    printf("  --hash MB            shared transposition table size (default 64)\n");
+}
+
+static double GetSecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void RunThreadCount(int numThreads, ChessSMPBenchOptions const& options, double& out_seconds, int64_t& out_nodes)
+{
+    out_seconds = 0.0;
+    out_nodes = 0;
+    ChessSearchLimits limits;
+    limits.m_maxDepth = options.m_depth;
+    for (int fenIndex = 0; fenIndex < NUM_BENCH_FENS; ++fenIndex)
+    {
+        //A fresh analysis per position so no run starts from another's table
+        ChessAnalysis analysis(numThreads, options.m_hashSizeInMB);
+        ChessPosition position;
+        position.SetFromFEN(s_benchFENs[fenIndex]);
+
+        auto start = std::chrono::steady_clock::now();
+        analysis.Start(position, std::vector<uint64_t>(), limits);
+        ChessAnalysisInfo info = analysis.GetInfo();
+        while (!info.m_hasLine || analysis.IsRunning())
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            info = analysis.GetInfo();
+        }
+        out_seconds += GetSecondsSince(start);
+        out_nodes += info.m_nodes;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    ChessSMPBenchOptions options;
+    for (int argIndex = 1; argIndex < argc; ++argIndex)
+    {
+        std::string arg = argv[argIndex];
+        bool hasValue = argIndex + 1 < argc;
+        if (arg == "--depth" && hasValue)
+        {
+            options.m_depth = std::max(1, atoi(argv[++argIndex]));
+        }
+        else if (arg == "--threads" && hasValue)
+        {
+            options.m_maxThreads = std::max(1, atoi(argv[++argIndex]));
+        }
+        else if (arg == "--hash" && hasValue)
+        {
+            options.m_hashSizeInMB = std::max(1, atoi(argv[++argIndex]));
+        }
+        else
+        {
+            PrintUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 2;
+        }
+    }
+
+    InitializeChessAttackTables();
+
+    //Time to depth is what the spectator sees; nodes per second shows whether the threads get in each other's way
+    printf("%d positions to depth %d, %d MB hash, %u hardware threads\n", NUM_BENCH_FENS, options.m_depth, options.m_hashSizeInMB,
+        std::thread::hardware_concurrency());
+    printf(" threads   seconds        nodes       Mnps   time-to-depth speedup   nps speedup\n");
+    double baseSeconds = 0.0;
+    double baseNodesPerSecond = 0.0;
+    for (int numThreads = 1; numThreads <= options.m_maxThreads; numThreads *= 2)
+    {
+        double seconds = 0.0;
+        int64_t numNodes = 0;
+        RunThreadCount(numThreads, options, seconds, numNodes);
+        double nodesPerSecond = (seconds > 0.0) ? (double)numNodes / seconds : 0.0;
+        if (numThreads == 1)
+        {
+            baseSeconds = seconds;
+            baseNodesPerSecond = nodesPerSecond;
+        }
+        printf("%8d %9.3f %12lld %10.2f %22.2fx %12.2fx\n", numThreads, seconds, (long long)numNodes, nodesPerSecond / 1000000.0,
+            (seconds > 0.0) ? baseSeconds / seconds : 0.0, (baseNodesPerSecond > 0.0) ? nodesPerSecond / baseNodesPerSecond : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,360 @@
+﻿#include "ChessEvaluation.h"
+#include "ChessOpeningBook.h"
+#include "ChessSearch.h"
+#include "ChessTrainingData.h"
+#include "ChessZobrist.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ChessSelfPlayOptions
+{
+    int m_numGames = 1000;
+    int m_numThreads = 0; //0 for every hardware thread
+    int64_t m_nodesPerMove = 5000;
+    int m_depthPerMove = 0;
+    int m_hashSizeInMB = 8; //per game being played
+    int m_randomPlies = 8;
+    int m_maxPlies = 400;
+    int m_resignScore = 1000;
+    int m_resignPlies = 6;
+    uint64_t m_seed = 1;
+    bool m_isAppending = false;
+    std::string m_outputPath = "Training/ChessSelfPlay.bin";
+    std::string m_bookPath = "Data/Books/ChessBook.bin";
+    std::string m_weightsPath;
+};
+
+//Shared by the playing threads; each game is played start to end by one thread on its own position, searcher and table
+struct ChessSelfPlayState
+{
+    ChessSelfPlayOptions const* m_options = nullptr;
+    ChessOpeningBook const* m_book = nullptr;
+    ChessTrainingDataWriter* m_writer = nullptr;
+    std::atomic<int> m_nextGameIndex{ 0 };
+    std::atomic<int> m_numGamesPlayed{ 0 };
+    std::atomic<int> m_numResults[3] = {}; //indexed by CHESS_RESULT_*
+    std::atomic<int64_t> m_numNodes{ 0 };
+    std::atomic<bool> m_hasWriteFailed{ false };
+};
+
+//----------------------------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf("Usage: ChessSelfPlay [options]\n");
+    printf("  --games N            games to play (default 1000)\n");
+    printf("  --threads N          games played at once (default: all hardware threads)\n");
+    printf("  --nodes N            search nodes per move (default 5000)\n");
+    printf("  --depth N            search depth per move instead of nodes\n");
+    printf("  --hash MB            transposition table of each game (default 8)\n");
+    printf("  --random-plies N     random moves after the book line, so games differ (default 8)\n");
+    printf("  --max-plies N        games still going after N plies are drawn (default 400)\n");
+    printf("  --seed N             games are reproducible from the seed and their index (default 1)\n");
+    printf("  --book PATH          opening book the games start from, skipped if missing (default Data/Books/ChessBook.bin)\n");
+    printf("  --weights PATH       evaluation weights the searches use (default: built-in)\n");
+    printf("  --out PATH           training records written (default Training/ChessSelfPlay.bin)\n");
+    printf("  --append             add to the output file instead of replacing it\n");
+}
+
+static double GetSecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//Neither side can mate: bare kings, or a single knight or bishop left
+static bool IsInsufficientMaterial(ChessPosition const& position)
+{
+    Bitboard const heavyPieces = position.GetPiecesOfType(ChessPieceType::Pawn) | position.GetPiecesOfType(ChessPieceType::Rook)
+        | position.GetPiecesOfType(ChessPieceType::Queen);
+    if (heavyPieces != 0)
+        return false;
+    return CountBits(position.GetPiecesOfType(ChessPieceType::Knight) | position.GetPiecesOfType(ChessPieceType::Bishop)) <= 1;
+}
+
+static bool IsThreefoldRepetition(std::vector<uint64_t> const& gameKeys)
+{
+    uint64_t const key = gameKeys.back();
+    return std::count(gameKeys.begin(), gameKeys.end(), key) >= 3;
+}
+
+static void PlayChessMove(ChessPosition& position, std::vector<uint64_t>& gameKeys, ChessMove const& move)
+{
+    position.ApplyMove(move);
+    if (position.m_halfmoveClock == 0)
+    {
+        gameKeys.clear();
+    }
+    gameKeys.push_back(position.GetKey());
+}
+
+//Book moves, then random ones; false if the random moves ended the game before it started
+static bool PlaySelfPlayOpening(ChessSelfPlayState const& state, uint64_t& randomState, ChessPosition& position, std::vector<uint64_t>& gameKeys)
+{
+    ChessMove move;
+    while (state.m_book->IsOpen() && state.m_book->PickMove(position, GetNextZobristRandom(randomState), move))
+    {
+        PlayChessMove(position, gameKeys, move);
+    }
+    for (int ply = 0; ply < state.m_options->m_randomPlies; ++ply)
+    {
+        ChessMoveList moves;
+        GenerateLegalMoves(position, moves);
+        if (moves.Size() == 0)
+            return false;
+        PlayChessMove(position, gameKeys, moves[(int)(GetNextZobristRandom(randomState) % (uint64_t)moves.Size())]);
+    }
+    ChessMoveList moves;
+    GenerateLegalMoves(position, moves);
+    return moves.Size() > 0;
+}
+
+//Plays one game to its end or adjudication. Only quiet positions are recorded (not in check, a quiet best move, no
+//mate found), their static evaluation is what the search score measures and what a tuner can learn from
+static void PlaySelfPlayGame(ChessSelfPlayState& state, int gameIndex, ChessSearcher& searcher, ChessTranspositionTable& table,
+    std::vector<ChessTrainingRecord>& out_records)
+{
+    ChessSelfPlayOptions const& options = *state.m_options;
+    out_records.clear();
+    table.Clear(); //with a fresh table and searcher and a node limit, a game depends only on the seed and its index
+
+    uint64_t randomState = options.m_seed ^ ((uint64_t)(gameIndex + 1) * 0x9E3779B97F4A7C15ULL);
+    ChessPosition position;
+    std::vector<uint64_t> gameKeys;
+    do
+    {
+        position.SetToStartingPosition();
+        gameKeys.assign(1, position.GetKey());
+    } while (!PlaySelfPlayOpening(state, randomState, position, gameKeys));
+
+    ChessSearchLimits limits;
+    limits.m_maxDepth = options.m_depthPerMove;
+    limits.m_maxNodes = (options.m_depthPerMove > 0) ? 0 : options.m_nodesPerMove;
+
+    unsigned char result = CHESS_RESULT_DRAW;
+    int numDecisivePlies = 0;
+    int lastDecisiveSign = 0;
+    for (int ply = 0; ply < options.m_maxPlies; ++ply)
+    {
+        int const us = position.m_sideToMove;
+        bool const isInCheck = position.IsInCheck(us);
+        ChessMoveList moves;
+        GenerateLegalMoves(position, moves);
+        if (moves.Size() == 0)
+        {
+            result = !isInCheck ? CHESS_RESULT_DRAW : (us == KISHI_WHITE) ? CHESS_RESULT_BLACK_WIN : CHESS_RESULT_WHITE_WIN;
+            break;
+        }
+        if (position.m_halfmoveClock >= 100 || IsThreefoldRepetition(gameKeys) || IsInsufficientMaterial(position))
+            break;
+
+        ChessSearchResult searchResult = searcher.Search(position, gameKeys, limits, table);
+        state.m_numNodes += searchResult.m_nodes;
+        int const whiteScore = (us == KISHI_WHITE) ? searchResult.m_score : -searchResult.m_score;
+
+        //A found mate is played out only as far as the search is sure of it, a lopsided score long enough is a resignation
+        int const decisiveSign = (whiteScore >= options.m_resignScore) ? 1 : (whiteScore <= -options.m_resignScore) ? -1 : 0;
+        numDecisivePlies = (decisiveSign != 0 && decisiveSign == lastDecisiveSign) ? numDecisivePlies + 1 : (decisiveSign != 0) ? 1 : 0;
+        lastDecisiveSign = decisiveSign;
+        if (IsChessMateScore(searchResult.m_score) || numDecisivePlies >= options.m_resignPlies)
+        {
+            result = (whiteScore > 0) ? CHESS_RESULT_WHITE_WIN : CHESS_RESULT_BLACK_WIN;
+            break;
+        }
+
+        ChessMove const& bestMove = searchResult.m_bestMove;
+        if (!isInCheck && !bestMove.IsCapture() && bestMove.m_result != ChessMoveResult::VALID_MOVE_PROMOTION)
+        {
+            ChessTrainingRecord record;
+            if (PackChessPosition(position, record.m_position))
+            {
+                record.m_score = (short)searchResult.m_score;
+                out_records.push_back(record);
+            }
+        }
+        PlayChessMove(position, gameKeys, bestMove);
+    }
+
+    for (ChessTrainingRecord& record : out_records)
+    {
+        record.m_result = result;
+    }
+    ++state.m_numResults[result];
+}
+
+static void RunSelfPlayThread(ChessSelfPlayState& state)
+{
+    ChessTranspositionTable table;
+    table.Resize(state.m_options->m_hashSizeInMB);
+    std::vector<ChessTrainingRecord> records;
+    for (;;)
+    {
+        int gameIndex = state.m_nextGameIndex++;
+        if (gameIndex >= state.m_options->m_numGames || state.m_hasWriteFailed)
+            return;
+
+        std::unique_ptr<ChessSearcher> searcher = std::make_unique<ChessSearcher>(); //no history carried over from the last game
+        PlaySelfPlayGame(state, gameIndex, *searcher, table, records);
+        if (!state.m_writer->Append(records))
+        {
+            state.m_hasWriteFailed = true;
+            return;
+        }
+        ++state.m_numGamesPlayed;
+    }
+}
+
+static void PrintProgress(ChessSelfPlayState const& state, double seconds)
+{
+    uint64_t numPositions = state.m_writer->GetNumWritten();
+    printf("%d/%d games (+%d =%d -%d), %llu positions, %.0f positions/hour, %.0f knps\n", state.m_numGamesPlayed.load(),
+        state.m_options->m_numGames, state.m_numResults[CHESS_RESULT_WHITE_WIN].load(), state.m_numResults[CHESS_RESULT_DRAW].load(),
+        state.m_numResults[CHESS_RESULT_BLACK_WIN].load(), (unsigned long long)numPositions, numPositions * 3600.0 / std::max(seconds, 1e-3),
+        state.m_numNodes.load() / std::max(seconds, 1e-3) / 1000.0);
+    fflush(stdout);
+}
+
+//----------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    ChessSelfPlayOptions options;
+    for (int argIndex = 1; argIndex < argc; ++argIndex)
+    {
+        std::string arg = argv[argIndex];
+        bool hasValue = argIndex + 1 < argc;
+        if (arg == "--games" && hasValue)
+        {
+            options.m_numGames = std::max(1, atoi(argv[++argIndex]));
+        }
+        else if (arg == "--threads" && hasValue)
+        {
+            options.m_numThreads = std::max(0, atoi(argv[++argIndex]));
+        }
+        else if (arg == "--nodes" && hasValue)
+        {
+            options.m_nodesPerMove = std::max(1LL, atoll(argv[++argIndex]));
+        }
+        else if (arg == "--depth" && hasValue)
+        {
+            options.m_depthPerMove = std::max(0, atoi(argv[++argIndex]));
+        }
+        else if (arg == "--hash" && hasValue)
+        {
+            options.m_hashSizeInMB = std::max(1, atoi(argv[++argIndex]));
+        }
+        else if (arg == "--random-plies" && hasValue)
+        {
+            options.m_randomPlies = std::max(0, atoi(argv[++argIndex]));
+        }
+        else if (arg == "--max-plies" && hasValue)
+        {
+            options.m_maxPlies = std::max(1, atoi(argv[++argIndex]));
+        }
+        else if (arg == "--seed" && hasValue)
+        {
+            options.m_seed = strtoull(argv[++argIndex], nullptr, 10);
+        }
+        else if (arg == "--book" && hasValue)
+        {
+            options.m_bookPath = argv[++argIndex];
+        }
+        else if (arg == "--weights" && hasValue)
+        {
+            options.m_weightsPath = argv[++argIndex];
+        }
+        else if (arg == "--out" && hasValue)
+        {
+            options.m_outputPath = argv[++argIndex];
+        }
+        else if (arg == "--append")
+        {
+            options.m_isAppending = true;
+        }
+        else
+        {
+            PrintUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 2;
+        }
+    }
+    if (options.m_numThreads == 0)
+    {
+        options.m_numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+
+    InitializeChessAttackTables();
+    std::string error;
+    if (!options.m_weightsPath.empty())
+    {
+        ChessEvaluationWeights weights = ChessEvaluationWeights::GetDefaults();
+        if (!weights.LoadFromFile(options.m_weightsPath, error))
+        {
+            printf("%s\n", error.c_str());
+            return 1;
+        }
+        SetChessEvaluationWeights(weights); //before any position is set up, positions keep the tables they were built with
+    }
+
+    ChessOpeningBook book;
+    if (!book.Open(options.m_bookPath, error))
+    {
+        printf("%s, games start from the starting position\n", error.c_str());
+    }
+
+    std::filesystem::path outputDirectory = std::filesystem::path(options.m_outputPath).parent_path();
+    if (!outputDirectory.empty())
+    {
+        std::error_code errorCode;
+        std::filesystem::create_directories(outputDirectory, errorCode);
+    }
+    ChessTrainingDataWriter writer;
+    if (!writer.Open(options.m_outputPath, options.m_isAppending, error))
+    {
+        printf("%s\n", error.c_str());
+        return 1;
+    }
+
+    ChessSelfPlayState state;
+    state.m_options = &options;
+    state.m_book = &book;
+    state.m_writer = &writer;
+    std::string budget = (options.m_depthPerMove > 0) ? "depth " + std::to_string(options.m_depthPerMove) : std::to_string(options.m_nodesPerMove) + " nodes";
+    printf("%d games on %d threads, %s per move\n", options.m_numGames, options.m_numThreads, budget.c_str());
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int threadIndex = 0; threadIndex < options.m_numThreads; ++threadIndex)
+    {
+        threads.emplace_back(RunSelfPlayThread, std::ref(state));
+    }
+    auto lastReport = start;
+    while (state.m_numGamesPlayed < options.m_numGames && !state.m_hasWriteFailed)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (GetSecondsSince(lastReport) >= 5.0)
+        {
+            lastReport = std::chrono::steady_clock::now();
+            PrintProgress(state, GetSecondsSince(start));
+        }
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    writer.Close();
+
+    PrintProgress(state, GetSecondsSince(start));
+    if (state.m_hasWriteFailed)
+    {
+        printf("Cannot write %s\n", options.m_outputPath.c_str());
+        return 1;
+    }
+    printf("Written to %s\n", options.m_outputPath.c_str());
+    return 0;
+}
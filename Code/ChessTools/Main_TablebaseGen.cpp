@@ -0,0 +1,179 @@
+﻿#include "ChessTablebaseGen.h"
+#include "ChessMoveGen.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+struct ChessTablebaseGenOptions
+{
+    std::string m_directory = "Tablebases";
+    std::vector<std::string> m_tableNames; //empty generates every table up to m_maxPieces
+    int m_maxPieces = 3;
+    bool m_isForced = false;
+    std::string m_probeFEN;
+};
+
+//----------------------------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf("Usage: ChessTablebaseGen [options]\n");
+    printf("  --dir PATH           directory the tables are read from and written to (default Tablebases)\n");
+    printf("  --pieces N           generate every table with up to N pieces, kings included (default 3)\n");
+    printf("  --table NAME         generate only this table, by its Syzygy name, e.g. KQvKR; may be repeated\n");
+    printf("  --force              regenerate tables that already exist\n");
+    printf("  --probe \"<fen>\"      probe a position with the tables in --dir and exit\n");
+    printf("Writes Syzygy .rtbw/.rtbz files. Working memory grows 64x per piece: 1 MB for 3 pieces, 64 MB for 4, 4 GB for 5;\n");
+    printf("the published 5-piece and larger sets are better downloaded than generated\n");
+}
+
+static double GetSecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static char const* GetWDLName(ChessTablebaseWDL wdl)
+{
+    static char const* const s_wdlNames[5] = { "loss", "blessed loss", "draw", "cursed win", "win" };
+    return s_wdlNames[(int)wdl + 2];
+}
+
+static int RunProbe(ChessTablebaseGenOptions const& options)
+{
+    ChessPosition position;
+    if (!position.SetFromFEN(options.m_probeFEN))
+    {
+        printf("Invalid FEN: %s\n", options.m_probeFEN.c_str());
+        return 2;
+    }
+    ChessTablebase tablebase;
+    std::string error;
+    int numTables = tablebase.Open(options.m_directory, error);
+    printf("%d tables in %s, %d with DTZ\n", numTables, options.m_directory.c_str(), tablebase.GetNumDTZTables());
+    if (!error.empty())
+    {
+        printf("%s\n", error.c_str());
+    }
+
+    ChessTablebaseResult result;
+    auto start = std::chrono::steady_clock::now();
+    if (!tablebase.Probe(position, result))
+    {
+        printf("Not covered by the tables\n");
+        return 1;
+    }
+    double seconds = GetSecondsSince(start);
+    printf("%s for the side to move, DTZ %d (%.1f us, first touch of the page included)\n", GetWDLName(result.m_wdl), result.m_dtz, seconds * 1e6);
+
+    //Every move with the result it leads to, as a way to follow the winning line by hand
+    ChessMoveList moves;
+    GenerateLegalMoves(position, moves);
+    for (int moveIndex = 0; moveIndex < moves.Size(); ++moveIndex)
+    {
+        ChessPosition child = position;
+        child.ApplyMove(moves[moveIndex]);
+        ChessTablebaseResult childResult;
+        if (tablebase.Probe(child, childResult))
+        {
+            printf("  %-6s %s, DTZ %d\n", GetMoveNotation(moves[moveIndex]).c_str(), GetWDLName(childResult.m_wdl), childResult.m_dtz);
+        }
+    }
+    return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    ChessTablebaseGenOptions options;
+    for (int argIndex = 1; argIndex < argc; ++argIndex)
+    {
+        std::string arg = argv[argIndex];
+        bool hasValue = argIndex + 1 < argc;
+        if (arg == "--dir" && hasValue)
+        {
+            options.m_directory = argv[++argIndex];
+        }
+        else if (arg == "--pieces" && hasValue)
+        {
+            options.m_maxPieces = atoi(argv[++argIndex]);
+        }
+        else if (arg == "--table" && hasValue)
+        {
+            options.m_tableNames.push_back(argv[++argIndex]);
+        }
+        else if (arg == "--force")
+        {
+            options.m_isForced = true;
+        }
+        else if (arg == "--probe" && hasValue)
+        {
+            options.m_probeFEN = argv[++argIndex];
+        }
+        else
+        {
+            PrintUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 2;
+        }
+    }
+
+    InitializeChessAttackTables();
+    if (!options.m_probeFEN.empty())
+    {
+        return RunProbe(options);
+    }
+
+    if (options.m_tableNames.empty())
+    {
+        for (int numPieces = 3; numPieces <= options.m_maxPieces; ++numPieces)
+        {
+            std::vector<std::string> names = GetChessMaterialNames(numPieces);
+            options.m_tableNames.insert(options.m_tableNames.end(), names.begin(), names.end());
+        }
+    }
+
+    std::error_code errorCode;
+    std::filesystem::create_directories(options.m_directory, errorCode);
+    ChessTablebase tablebase;
+    std::string error;
+    tablebase.Open(options.m_directory, error);
+
+    std::vector<uint16_t> entries;
+    for (std::string const& tableName : options.m_tableNames)
+    {
+        if (tablebase.HasTable(tableName) && !options.m_isForced)
+        {
+            printf("%s exists, skipped\n", tableName.c_str());
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        ChessTablebaseGenStats stats;
+        if (!GenerateChessTablebase(tableName, tablebase, entries, stats, error))
+        {
+            printf("%s\n", error.c_str());
+            return 1;
+        }
+        tablebase.Close(); //unmaps a table being regenerated before it is overwritten
+        if (!WriteChessTablebase(options.m_directory, tableName, entries, error))
+        {
+            printf("%s\n", error.c_str());
+            return 1;
+        }
+        printf("%-8s %10llu legal: %llu wins, %llu cursed, %llu draws, %llu blessed, %llu losses, longest DTZ %d/%d, %d passes, %.1f s\n",
+            tableName.c_str(), (unsigned long long)stats.m_numLegal, (unsigned long long)stats.m_numWins, (unsigned long long)stats.m_numCursedWins,
+            (unsigned long long)stats.m_numDraws, (unsigned long long)stats.m_numBlessedLosses, (unsigned long long)stats.m_numLosses,
+            stats.m_maxWinDTZ, stats.m_maxLossDTZ, stats.m_numPasses, GetSecondsSince(start));
+
+        //The next tables may capture or promote into this one; reading every position back checks the files too
+        tablebase.Open(options.m_directory, error);
+        if (!VerifyChessTablebase(tableName, tablebase, entries, error))
+        {
+            printf("%s\n", error.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
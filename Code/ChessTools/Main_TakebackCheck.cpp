@@ -0,0 +1,170 @@
+﻿#include "ChessPerft.h"
+#include "ChessZobrist.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct ChessTakebackCheckOptions
+{
+    int m_depth = 3;
+    int m_numGames = 200;
+    int m_maxPlies = 300;
+    uint64_t m_seed = 1;
+};
+
+//----------------------------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf("Usage: ChessTakebackCheck [options]\n");
+    printf("  --depth N            plies of every perft suite tree made and taken back move by move (default 3)\n");
+    printf("  --games N            random games played out, then taken back to the start (default 200)\n");
+    printf("  --plies N            longest game played (default 300)\n");
+    printf("  --seed N             random seed of the games (default 1)\n");
+}
+
+//Every field UnmakeMove has to restore, the incremental keys and evaluation terms included
+static bool IsSamePosition(ChessPosition const& a, ChessPosition const& b)
+{
+    return memcmp(a.m_pieces, b.m_pieces, sizeof(a.m_pieces)) == 0 && memcmp(a.m_kishiPieces, b.m_kishiPieces, sizeof(a.m_kishiPieces)) == 0
+        && a.m_occupied == b.m_occupied && memcmp(a.m_board, b.m_board, sizeof(a.m_board)) == 0 && a.m_sideToMove == b.m_sideToMove
+        && a.m_castlingRights == b.m_castlingRights && a.m_enPassantSquare == b.m_enPassantSquare && a.m_halfmoveClock == b.m_halfmoveClock
+        && a.m_fullmoveNumber == b.m_fullmoveNumber && a.m_pieceKey == b.m_pieceKey && a.m_midgameScore == b.m_midgameScore
+        && a.m_endgameScore == b.m_endgameScore && a.m_gamePhase == b.m_gamePhase;
+}
+
+//Makes and takes back every move of the tree, returns the number of moves that did not restore the position
+static int CheckTree(ChessPosition& position, int depth, uint64_t& out_numMoves)
+{
+    if (depth == 0)
+        return 0;
+
+    ChessMoveList legalMoves;
+    GenerateLegalMoves(position, legalMoves);
+    int numFailed = 0;
+    for (ChessMove const& move : legalMoves)
+    {
+        ChessPosition before = position;
+        ChessUndoRecord undo;
+        position.MakeMove(move, undo);
+        if (position.GetKey() != ComputeChessPositionKey(position))
+        {
+            printf("  key drift after %s in %s\n", GetMoveNotation(move).c_str(), before.GetFEN().c_str());
+            ++numFailed;
+        }
+        numFailed += CheckTree(position, depth - 1, out_numMoves);
+        position.UnmakeMove(undo);
+        ++out_numMoves;
+        if (!IsSamePosition(position, before))
+        {
+            printf("  %s not taken back in %s, got %s\n", GetMoveNotation(move).c_str(), before.GetFEN().c_str(), position.GetFEN().c_str());
+            position = before;
+            ++numFailed;
+        }
+    }
+    return numFailed;
+}
+
+//The game's history: one undo record per ply played, taken back one at a time down to the start. A record count that
+//differs from the plies played is the double recording a takeback would then replay wrongly
+static int CheckGame(uint64_t& randomState, int maxPlies, int& out_numPlies)
+{
+    ChessPosition position;
+    position.SetToStartingPosition();
+    ChessUndoStack<ChessUndoRecord, MAX_CHESS_GAME_PLIES> undoStack;
+    std::vector<ChessPosition> history;
+    for (int ply = 0; ply < maxPlies; ++ply)
+    {
+        ChessMoveList legalMoves;
+        GenerateLegalMoves(position, legalMoves);
+        if (legalMoves.Size() == 0)
+            break;
+
+        history.push_back(position);
+        position.MakeMove(legalMoves[(int)(GetNextZobristRandom(randomState) % (uint64_t)legalMoves.Size())], undoStack.Push());
+    }
+    out_numPlies = (int)history.size();
+    if (undoStack.Size() != out_numPlies)
+    {
+        printf("  %d records for %d plies\n", undoStack.Size(), out_numPlies);
+        return 1;
+    }
+
+    while (!undoStack.IsEmpty())
+    {
+        position.UnmakeMove(undoStack.Top());
+        undoStack.Pop();
+        if (!IsSamePosition(position, history.back()))
+        {
+            printf("  takeback %d of %d gave %s, expected %s\n", out_numPlies - (int)history.size() + 1, out_numPlies,
+                position.GetFEN().c_str(), history.back().GetFEN().c_str());
+            return 1;
+        }
+        history.pop_back();
+    }
+    return (position.GetFEN() == CHESS_STARTING_FEN) ? 0 : 1;
+}
+
+//----------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    ChessTakebackCheckOptions options;
+    for (int argIndex = 1; argIndex < argc; ++argIndex)
+    {
+        std::string arg = argv[argIndex];
+        bool hasValue = argIndex + 1 < argc;
+        if (arg == "--depth" && hasValue)
+        {
+            options.m_depth = atoi(argv[++argIndex]);
+        }
+        else if (arg == "--games" && hasValue)
+        {
+            options.m_numGames = atoi(argv[++argIndex]);
+        }
+        else if (arg == "--plies" && hasValue)
+        {
+            options.m_maxPlies = atoi(argv[++argIndex]);
+        }
+        else if (arg == "--seed" && hasValue)
+        {
+            options.m_seed = strtoull(argv[++argIndex], nullptr, 10);
+        }
+        else
+        {
+            PrintUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 2;
+        }
+    }
+
+    InitializeChessAttackTables();
+
+    int numFailed = 0;
+    for (int suiteIndex = 0; suiteIndex < g_numPerftSuitePositions; ++suiteIndex)
+    {
+        ChessPerftSuitePosition const& suitePosition = g_perftSuite[suiteIndex];
+        ChessPosition position;
+        position.SetFromFEN(suitePosition.m_fen);
+        uint64_t numMoves = 0;
+        int numTreeFailed = CheckTree(position, options.m_depth, numMoves);
+        printf("%s depth %d: %llu moves made and taken back, %d failed\n", suitePosition.m_name, options.m_depth,
+            (unsigned long long)numMoves, numTreeFailed);
+        numFailed += numTreeFailed;
+    }
+
+    uint64_t randomState = options.m_seed;
+    int numGamesFailed = 0;
+    int64_t totalPlies = 0;
+    for (int gameIndex = 0; gameIndex < options.m_numGames; ++gameIndex)
+    {
+        int numPlies = 0;
+        numGamesFailed += CheckGame(randomState, options.m_maxPlies, numPlies);
+        totalPlies += numPlies;
+    }
+    printf("%d games, %lld plies played and taken back, %d failed\n", options.m_numGames, (long long)totalPlies, numGamesFailed);
+    numFailed += numGamesFailed;
+
+    printf("Takeback check %s\n", (numFailed == 0) ? "passed" : "FAILED");
+    return (numFailed == 0) ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+﻿#include "ChessTexelTuner.h"
+#include "ChessThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ChessTunerOptions
+{
+    std::vector<std::string> m_dataPaths;
+    int m_numThreads = 0; //0 for every hardware thread
+    int m_numIterations = 300;
+    double m_learningRate = 1.0;
+    double m_lambda = 0.0;
+    double m_scalingK = 0.0; //0 to fit it to the data first
+    int m_saveEvery = 50;
+    std::string m_weightsPath;
+    std::string m_outputPath = "Data/Definitions/ChessEvaluation.xml";
+};
+
+//----------------------------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+    printf("Usage: ChessTuner [options]\n");
+    printf("  --data PATH          training records from ChessSelfPlay, repeat for more files (default Training/ChessSelfPlay.bin)\n");
+    printf("  --threads N          threads sharing every pass (default: all hardware threads)\n");
+    printf("  --iterations N       Adam steps over the whole set (default 300)\n");
+    printf("  --rate R             learning rate in centipawns per step (default 1.0)\n");
+    printf("  --lambda L           weight of the search score against the game result in the labels (default 0)\n");
+    printf("  --k K                sigmoid scaling, fitted to the data when left out\n");
+    printf("  --save-every N       also write the weights every N iterations (default 50)\n");
+    printf("  --weights PATH       weights to start from (default: built-in)\n");
+    printf("  --out PATH           weights file written (default Data/Definitions/ChessEvaluation.xml)\n");
+}
+
+static double GetSecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool SaveTunedWeights(ChessTexelTuner const& tuner, std::string const& path)
+{
+    if (!tuner.GetWeights().SaveToFile(path))
+    {
+        printf("Cannot write %s\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    ChessTunerOptions options;
+    for (int argIndex = 1; argIndex < argc; ++argIndex)
+    {
+        std::string arg = argv[argIndex];
+        bool hasValue = argIndex + 1 < argc;
+        if (arg == "--data" && hasValue)
+        {
+            options.m_dataPaths.push_back(argv[++argIndex]);
+        }
+        else if (arg == "--threads" && hasValue)
+        {
+            options.m_numThreads = std::max(0, atoi(argv[++argIndex]));
+        }
+        else if (arg == "--iterations" && hasValue)
+        {
+            options.m_numIterations = std::max(0, atoi(argv[++argIndex]));
+        }
+        else if (arg == "--rate" && hasValue)
+        {
+            options.m_learningRate = atof(argv[++argIndex]);
+        }
+        else if (arg == "--lambda" && hasValue)
+        {
+            options.m_lambda = std::min(std::max(atof(argv[++argIndex]), 0.0), 1.0);
+        }
+        else if (arg == "--k" && hasValue)
+        {
+            options.m_scalingK = std::max(0.0, atof(argv[++argIndex]));
+        }
+        else if (arg == "--save-every" && hasValue)
+        {
+            options.m_saveEvery = std::max(0, atoi(argv[++argIndex]));
+        }
+        else if (arg == "--weights" && hasValue)
+        {
+            options.m_weightsPath = argv[++argIndex];
+        }
+        else if (arg == "--out" && hasValue)
+        {
+            options.m_outputPath = argv[++argIndex];
+        }
+        else
+        {
+            PrintUsage();
+            return (arg == "--help" || arg == "-h") ? 0 : 2;
+        }
+    }
+    if (options.m_dataPaths.empty())
+    {
+        options.m_dataPaths.push_back("Training/ChessSelfPlay.bin");
+    }
+    if (options.m_numThreads == 0)
+    {
+        options.m_numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+
+    InitializeChessAttackTables();
+    std::string error;
+    ChessEvaluationWeights startWeights = ChessEvaluationWeights::GetDefaults();
+    if (!options.m_weightsPath.empty() && !startWeights.LoadFromFile(options.m_weightsPath, error))
+    {
+        printf("%s\n", error.c_str());
+        return 1;
+    }
+
+    ChessThreadPool pool(options.m_numThreads);
+    ChessTuningSet set;
+    auto loadStart = std::chrono::steady_clock::now();
+    if (!LoadChessTuningSet(pool, options.m_dataPaths, startWeights, set, error))
+    {
+        printf("%s\n", error.c_str());
+        return 1;
+    }
+    printf("%d positions loaded in %.2f s, %.1f MB in memory, %d threads\n", set.GetNumPositions(), GetSecondsSince(loadStart),
+        set.GetMemorySize() / (1024.0 * 1024.0), options.m_numThreads);
+
+    ChessTexelTuner tuner(pool, set, startWeights);
+    tuner.SetLambda(options.m_lambda);
+    if (options.m_scalingK > 0.0)
+    {
+        tuner.SetScalingK(options.m_scalingK);
+    }
+    else
+    {
+        printf("Fitted K = %.4f\n", tuner.FitScalingK());
+    }
+    printf("Start loss %.6f\n", tuner.ComputeLoss());
+
+    for (int iteration = 1; iteration <= options.m_numIterations; ++iteration)
+    {
+        auto start = std::chrono::steady_clock::now();
+        double loss = tuner.RunIteration(options.m_learningRate);
+        double seconds = GetSecondsSince(start);
+        printf("iteration %4d  loss %.6f  %7.1f ms  %.2f M positions/s\n", iteration, loss, seconds * 1000.0,
+            set.GetNumPositions() / std::max(seconds, 1e-9) / 1e6);
+        fflush(stdout);
+        if (options.m_saveEvery > 0 && iteration % options.m_saveEvery == 0 && !SaveTunedWeights(tuner, options.m_outputPath))
+            return 1;
+    }
+
+    printf("Final loss %.6f\n", tuner.ComputeLoss());
+    if (!SaveTunedWeights(tuner, options.m_outputPath))
+        return 1;
+    printf("Weights written to %s\n", options.m_outputPath.c_str());
+    return 0;
+}
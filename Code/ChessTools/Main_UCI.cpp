@@ -0,0 +1,386 @@
+﻿#include "ChessAnalysis.h"
+#include "ChessMoveGen.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------
+//Headless UCI engine over the same rules and Lazy SMP search the game uses, for cutechess-cli, fastchess or scripts.
+//stdin is read on the main thread; a search runs on the ChessAnalysis threads and a reporter thread prints its info
+//lines and the bestmove, so "stop" and "isready" are answered while it thinks
+constexpr int DEFAULT_UCI_HASH_MB = 16;
+constexpr int MAX_UCI_HASH_MB = 4096;
+constexpr int MAX_UCI_THREADS = 256;
+
+struct ChessUCISession
+{
+    int m_numThreads = 1;
+    int m_hashMB = DEFAULT_UCI_HASH_MB;
+    std::unique_ptr<ChessNNUENetwork> m_network; //null for the piece-square evaluation
+    std::unique_ptr<ChessAnalysis> m_analysis; //rebuilt when Threads, Hash or EvalFile change
+
+    ChessPosition m_position;
+    std::vector<uint64_t> m_gameKeys; //since the last capture or pawn move, as ChessSearcher::Search wants them
+    bool m_isPositionValid = true; //false after a position command that could not be applied, go refuses to search
+
+    std::thread m_reporterThread;
+    std::mutex m_stopMutex;
+    bool m_isStopRequested = false; //an infinite search only reports its bestmove once told to stop
+};
+
+static std::mutex s_outputMutex;
+
+static void PrintLine(char const* format, ...)
+{
+    std::lock_guard<std::mutex> lock(s_outputMutex);
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+    fflush(stdout);
+}
+
+static std::string GetUCIScore(int score)
+{
+    if (!IsChessMateScore(score))
+        return "cp " + std::to_string(score);
+
+    //Mate in plies to mate in moves, negative when the side to move is the one mated
+    int matePlies = CHESS_MATE_SCORE - abs(score);
+    return "mate " + std::to_string((score > 0) ? (matePlies + 1) / 2 : -(matePlies / 2));
+}
+
+static void PrintSearchInfo(ChessAnalysisInfo const& info)
+{
+    std::string principalVariation;
+    for (ChessMove const& move : info.m_principalVariation)
+    {
+        principalVariation += " " + GetMoveNotation(move);
+    }
+    int64_t nodesPerSecond = (info.m_milliseconds > 0) ? info.m_nodes * 1000 / info.m_milliseconds : 0;
+    PrintLine("info depth %d score %s nodes %lld nps %lld time %d pv%s", info.m_depth, GetUCIScore(info.m_score).c_str(),
+        (long long)info.m_nodes, (long long)nodesPerSecond, info.m_milliseconds, principalVariation.c_str());
+}
+
+//----------------------------------------------------------------------------------------------------------
+static void WaitForSearch(ChessUCISession& session)
+{
+    if (session.m_reporterThread.joinable())
+    {
+        session.m_reporterThread.join();
+    }
+}
+
+static void StopSearch(ChessUCISession& session)
+{
+    {
+        std::lock_guard<std::mutex> lock(session.m_stopMutex);
+        session.m_isStopRequested = true;
+    }
+    if (session.m_analysis)
+    {
+        session.m_analysis->Stop();
+    }
+    WaitForSearch(session);
+}
+
+static void RebuildAnalysis(ChessUCISession& session)
+{
+    StopSearch(session);
+    session.m_analysis.reset(); //joins the old threads and frees the old table before the new one is allocated
+    session.m_analysis = std::make_unique<ChessAnalysis>(session.m_numThreads, session.m_hashMB, session.m_network.get());
+}
+
+static void ReportSearch(ChessUCISession* session, bool isInfinite)
+{
+    ChessAnalysis& analysis = *session->m_analysis;
+    int reportedDepth = 0;
+    ChessAnalysisInfo info = analysis.GetInfo();
+    for (;;)
+    {
+        if (info.m_hasLine && info.m_depth > reportedDepth)
+        {
+            PrintSearchInfo(info);
+            reportedDepth = info.m_depth;
+        }
+        bool isDone = info.m_hasLine && !analysis.IsRunning();
+        if (isDone && isInfinite)
+        {
+            std::lock_guard<std::mutex> lock(session->m_stopMutex);
+            isDone = session->m_isStopRequested;
+        }
+        if (isDone)
+            break;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        info = analysis.GetInfo();
+    }
+
+    PrintSearchInfo(info); //with the final node count and time
+    //No ponder move: "go ponder" and "ponderhit" are not supported, a GUI told one would start pondering on it
+    PrintLine("bestmove %s", GetMoveNotation(info.m_principalVariation[0]).c_str());
+}
+
+//----------------------------------------------------------------------------------------------------------
+//position [startpos | fen <fen>] [moves <move>...]
+//A command that cannot be applied in full leaves no position rather than the previous one, so go cannot search a stale board
+static void OnPosition(ChessUCISession& session, std::istringstream& tokens)
+{
+    session.m_isPositionValid = false;
+    std::string token;
+    tokens >> token;
+    ChessPosition position;
+    if (token == "startpos")
+    {
+        position.SetToStartingPosition();
+        tokens >> token;
+    }
+    else if (token == "fen")
+    {
+        std::string fen;
+        while (tokens >> token && token != "moves")
+        {
+            fen += (fen.empty() ? "" : " ") + token;
+        }
+        if (!position.SetFromFEN(fen))
+        {
+            PrintLine("info string invalid fen %s", fen.c_str());
+            return;
+        }
+    }
+    else
+    {
+        PrintLine("info string position needs startpos or fen");
+        return;
+    }
+
+    std::vector<uint64_t> gameKeys(1, position.GetKey());
+    if (token == "moves")
+    {
+        while (tokens >> token)
+        {
+            ChessMoveList legalMoves;
+            GenerateLegalMoves(position, legalMoves);
+            ChessMove const* move = std::find_if(legalMoves.begin(), legalMoves.end(),
+                [&token](ChessMove const& legalMove) { return GetMoveNotation(legalMove) == token; });
+            if (move == legalMoves.end())
+            {
+                PrintLine("info string illegal move %s", token.c_str());
+                return;
+            }
+            if (move->IsCapture() || position.GetPieceTypeAt(move->m_from) == ChessPieceType::Pawn)
+            {
+                gameKeys.clear();
+            }
+            position.ApplyMove(*move);
+            gameKeys.push_back(position.GetKey());
+        }
+    }
+    session.m_position = position;
+    session.m_gameKeys.swap(gameKeys);
+    session.m_isPositionValid = true;
+}
+
+//go [depth N] [nodes N] [movetime MS] [wtime MS btime MS [winc MS] [binc MS] [movestogo N]] [infinite]
+static void OnGo(ChessUCISession& session, std::istringstream& tokens)
+{
+    StopSearch(session);
+    if (!session.m_isPositionValid)
+    {
+        PrintLine("info string no valid position to search, send position first");
+        PrintLine("bestmove 0000");
+        return;
+    }
+
+    ChessSearchLimits limits;
+    int timeLeft[NUM_KISHI] = {};
+    int increment[NUM_KISHI] = {};
+    int movesToGo = 0;
+    bool isInfinite = false;
+    std::string token;
+    while (tokens >> token)
+    {
+        int64_t value = 0;
+        if (token == "infinite")
+        {
+            isInfinite = true;
+        }
+        else if (tokens >> value)
+        {
+            if (token == "depth")
+                limits.m_maxDepth = (int)value;
+            else if (token == "nodes")
+                limits.m_maxNodes = value;
+            else if (token == "movetime")
+                limits.m_maxMilliseconds = (int)value;
+            else if (token == "wtime")
+                timeLeft[KISHI_WHITE] = (int)value;
+            else if (token == "btime")
+                timeLeft[KISHI_BLACK] = (int)value;
+            else if (token == "winc")
+                increment[KISHI_WHITE] = (int)value;
+            else if (token == "binc")
+                increment[KISHI_BLACK] = (int)value;
+            else if (token == "movestogo")
+                movesToGo = (int)value;
+        }
+    }
+
+    //Clock games: an even share of the time left plus most of the increment, never close to flagging
+    int sideToMove = session.m_position.m_sideToMove;
+    if (timeLeft[sideToMove] > 0 && limits.m_maxMilliseconds == 0)
+    {
+        int share = timeLeft[sideToMove] / ((movesToGo > 0) ? movesToGo + 1 : 30) + increment[sideToMove] * 3 / 4;
+        limits.m_maxMilliseconds = std::max(1, std::min(share, timeLeft[sideToMove] / 2));
+    }
+    if (isInfinite)
+    {
+        limits = ChessSearchLimits();
+    }
+    //Every Lazy SMP thread counts its own nodes, so the budget is split for the total to come out right
+    if (limits.m_maxNodes > 0)
+    {
+        limits.m_maxNodes = std::max<int64_t>(1, limits.m_maxNodes / session.m_numThreads);
+    }
+
+    ChessMoveList legalMoves;
+    GenerateLegalMoves(session.m_position, legalMoves);
+    if (legalMoves.Size() == 0)
+    {
+        PrintLine("info depth 0 score %s", session.m_position.IsInCheck(sideToMove) ? "mate 0" : "cp 0");
+        PrintLine("bestmove 0000");
+        return;
+    }
+
+    session.m_isStopRequested = false;
+    session.m_analysis->Start(session.m_position, session.m_gameKeys, limits);
+    session.m_reporterThread = std::thread(ReportSearch, &session, isInfinite);
+}
+
+//setoption name <Threads|Hash|EvalFile> value <value>
+static void OnSetOption(ChessUCISession& session, std::istringstream& tokens)
+{
+    std::string token;
+    std::string name;
+    std::string value;
+    tokens >> token; //"name"
+    while (tokens >> token && token != "value")
+    {
+        name += (name.empty() ? "" : " ") + token;
+    }
+    while (tokens >> token)
+    {
+        value += (value.empty() ? "" : " ") + token;
+    }
+
+    if (name == "Threads")
+    {
+        session.m_numThreads = std::max(1, std::min(atoi(value.c_str()), MAX_UCI_THREADS));
+    }
+    else if (name == "Hash")
+    {
+        session.m_hashMB = std::max(1, std::min(atoi(value.c_str()), MAX_UCI_HASH_MB));
+    }
+    else if (name == "EvalFile")
+    {
+        std::unique_ptr<ChessNNUENetwork> network;
+        if (!value.empty() && value != "<empty>")
+        {
+            std::string error;
+            network = std::make_unique<ChessNNUENetwork>();
+            if (!network->LoadFromFile(value, error))
+            {
+                PrintLine("info string cannot load %s: %s", value.c_str(), error.c_str());
+                return;
+            }
+        }
+        StopSearch(session);
+        session.m_analysis.reset(); //its searchers point at the old network
+        session.m_network = std::move(network);
+    }
+    else
+    {
+        PrintLine("info string unknown option %s", name.c_str());
+        return;
+    }
+    RebuildAnalysis(session);
+}
+
+//----------------------------------------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    if (argc > 1)
+    {
+        printf("Usage: ChessUCI\n");
+        printf("  Speaks UCI on stdin/stdout: uci, isready, ucinewgame, setoption (Threads, Hash, EvalFile),\n");
+        printf("  position startpos|fen ... [moves ...], go depth|nodes|movetime|wtime/btime|infinite, stop, quit\n");
+        return (std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h") ? 0 : 2;
+    }
+
+    InitializeChessAttackTables();
+    ChessUCISession session;
+    session.m_position.SetToStartingPosition();
+    session.m_gameKeys.push_back(session.m_position.GetKey());
+    session.m_analysis = std::make_unique<ChessAnalysis>(session.m_numThreads, session.m_hashMB);
+
+    std::string line;
+    while (std::getline(std::cin, line))
+    {
+        std::istringstream tokens(line);
+        std::string command;
+        tokens >> command;
+        if (command == "uci")
+        {
+            PrintLine("id name ChessSoul");
+            PrintLine("id author ChessSoul team");
+            PrintLine("option name Threads type spin default 1 min 1 max %d", MAX_UCI_THREADS);
+            PrintLine("option name Hash type spin default %d min 1 max %d", DEFAULT_UCI_HASH_MB, MAX_UCI_HASH_MB);
+            PrintLine("option name EvalFile type string default <empty>");
+            PrintLine("uciok");
+        }
+        else if (command == "isready")
+        {
+            PrintLine("readyok");
+        }
+        else if (command == "ucinewgame")
+        {
+            RebuildAnalysis(session); //a fresh table, nothing carried over from the last game
+        }
+        else if (command == "setoption")
+        {
+            OnSetOption(session, tokens);
+        }
+        else if (command == "position")
+        {
+            StopSearch(session);
+            OnPosition(session, tokens);
+        }
+        else if (command == "go")
+        {
+            OnGo(session, tokens);
+        }
+        else if (command == "stop")
+        {
+            StopSearch(session);
+        }
+        else if (command == "quit")
+        {
+            break;
+        }
+        else if (!command.empty())
+        {
+            PrintLine("info string unknown command %s", command.c_str());
+        }
+    }
+    StopSearch(session);
+    return 0;
+}
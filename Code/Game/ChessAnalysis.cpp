@@ -0,0 +1,150 @@
+﻿#include "ChessAnalysis.h"
+
+#include <algorithm>
+
+ChessAnalysis::ChessAnalysis(int numThreads, int hashMB, ChessNNUENetwork const* network)
+{
+    m_table.Resize(hashMB);
+    for (int threadIndex = 0; threadIndex < std::max(numThreads, 1); ++threadIndex)
+    {
+        m_threads.push_back(std::make_unique<AnalysisThread>());
+        m_threads.back()->m_searcher.SetHelperIndex(threadIndex);
+        m_threads.back()->m_searcher.SetNetwork(network);
+    }
+    //Only start the threads once every AnalysisThread exists, ThreadMain stops the others through m_threads
+    for (int threadIndex = 0; threadIndex < (int)m_threads.size(); ++threadIndex)
+    {
+        m_threads[threadIndex]->m_thread = std::thread(&ChessAnalysis::ThreadMain, this, threadIndex);
+    }
+}
+
+ChessAnalysis::~ChessAnalysis()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isQuitting = true;
+        StopAllThreads();
+    }
+    m_wakeCondition.notify_all();
+    for (std::unique_ptr<AnalysisThread>& analysisThread : m_threads)
+    {
+        analysisThread->m_thread.join();
+    }
+}
+
+void ChessAnalysis::Start(ChessPosition const& position, std::vector<uint64_t> const& gameKeys, ChessSearchLimits const& limits)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        StopAllThreads(); //the running generation, before the new one is made current
+        m_requestPosition = position;
+        m_requestKeys = gameKeys;
+        m_requestLimits = limits;
+        ++m_generation;
+        //Counted as running from here, not from when each thread wakes, so IsRunning cannot report a finished
+        //analysis in between. Threads that never picked up the previous generation were still counted for it
+        m_numRunningThreads += (int)m_threads.size() - m_numUnclaimedThreads;
+        m_numUnclaimedThreads = (int)m_threads.size();
+        m_startTime = std::chrono::steady_clock::now();
+        m_info = ChessAnalysisInfo();
+        m_info.m_positionKey = position.GetKey();
+        m_info.m_sideToMove = position.m_sideToMove;
+    }
+    m_wakeCondition.notify_all();
+}
+
+void ChessAnalysis::Stop()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    StopAllThreads();
+}
+
+ChessAnalysisInfo ChessAnalysis::GetInfo() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ChessAnalysisInfo info = m_info;
+    info.m_nodes = 0;
+    for (std::unique_ptr<AnalysisThread> const& analysisThread : m_threads)
+    {
+        info.m_nodes += analysisThread->m_searcher.GetPublishedNodes();
+    }
+    if (IsRunning())
+    {
+        info.m_milliseconds = (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+    }
+    return info;
+}
+
+void ChessAnalysis::StopAllThreads()
+{
+    m_stoppedGeneration = m_generation;
+    for (std::unique_ptr<AnalysisThread>& analysisThread : m_threads)
+    {
+        analysisThread->m_stopFlag = true;
+    }
+}
+
+void ChessAnalysis::ThreadMain(int threadIndex)
+{
+    AnalysisThread& analysisThread = *m_threads[threadIndex];
+    int runGeneration = 0;
+    ChessPosition position;
+    std::vector<uint64_t> gameKeys;
+    ChessSearchLimits limits;
+    analysisThread.m_searcher.m_onIterationDone = [this, threadIndex, &runGeneration](ChessSearchResult const& result)
+    {
+        PublishResult(threadIndex, runGeneration, result);
+    };
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeCondition.wait(lock, [this, runGeneration]() { return m_generation != runGeneration || m_isQuitting; });
+            if (m_isQuitting)
+                return;
+
+            runGeneration = m_generation;
+            --m_numUnclaimedThreads;
+            //Stopped before this thread picked it up: helpers skip it, the main thread keeps its flag set and only
+            //completes depth 1, so even an analysis stopped at once delivers a line
+            bool const isStopped = (runGeneration == m_stoppedGeneration);
+            if (isStopped && threadIndex != 0)
+            {
+                --m_numRunningThreads;
+                continue;
+            }
+
+            position = m_requestPosition;
+            gameKeys = m_requestKeys;
+            limits = m_requestLimits;
+            analysisThread.m_stopFlag = isStopped;
+        }
+
+        analysisThread.m_searcher.Search(position, gameKeys, limits, m_table, &analysisThread.m_stopFlag);
+
+        //The first thread to finish its depth limit ends the analysis for all of them, the rest would only repeat it
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (runGeneration == m_generation && !analysisThread.m_stopFlag)
+        {
+            StopAllThreads();
+        }
+        --m_numRunningThreads;
+    }
+}
+
+void ChessAnalysis::PublishResult(int threadIndex, int generation, ChessSearchResult const& result)
+{
+    //Deepest completed line wins; at equal depth the main thread's, whose depths are never skipped
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (generation != m_generation || !result.m_hasMove)
+        return;
+    if (m_info.m_hasLine && (result.m_depth < m_info.m_depth || (result.m_depth == m_info.m_depth && threadIndex != 0)))
+        return;
+
+    m_info.m_hasLine = true;
+    m_info.m_depth = result.m_depth;
+    m_info.m_score = result.m_score;
+    m_info.m_principalVariation = result.m_principalVariation;
+    m_info.m_milliseconds = result.m_milliseconds;
+}
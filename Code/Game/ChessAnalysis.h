@@ -0,0 +1,68 @@
+﻿#pragma once
+#include "ChessSearch.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+//Best line found so far by a ChessAnalysis, for display
+struct ChessAnalysisInfo
+{
+    bool m_hasLine = false;
+    uint64_t m_positionKey = 0; //position analysed
+    int m_sideToMove = KISHI_WHITE;
+    int m_depth = 0;
+    int m_score = 0; //centipawns from the side to move's point of view
+    std::vector<ChessMove> m_principalVariation;
+    int64_t m_nodes = 0; //all threads together
+    int m_milliseconds = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------
+//Lazy SMP: every thread runs its own ChessSearcher over the same position and they share one lock-free transposition
+//table, so each thread mostly finds the others' work already done. Nothing else is shared between the searchers; how
+//far that scales is for ChessSMPBench to measure on the target machine. The threads are created once and sleep between
+//analyses; Start on a new position abandons the running one without waiting for it
+class ChessAnalysis
+{
+public:
+    ChessAnalysis(int numThreads, int hashMB, ChessNNUENetwork const* network = nullptr); //network as for ChessSearcher::SetNetwork
+    ~ChessAnalysis(); //stops and joins every thread
+
+    //Restarts the analysis on position; gameKeys as for ChessSearcher::Search. The table is kept, the new position
+    //is usually one move on from the old one. With no limits it runs until Stop or the next Start
+    void Start(ChessPosition const& position, std::vector<uint64_t> const& gameKeys, ChessSearchLimits const& limits = ChessSearchLimits());
+    void Stop();
+    bool IsRunning() const { return m_numRunningThreads.load() > 0; }
+    ChessAnalysisInfo GetInfo() const; //safe to call every frame, copies the latest line under a lock
+    int GetNumThreads() const { return (int)m_threads.size(); }
+
+private:
+    struct AnalysisThread
+    {
+        ChessSearcher m_searcher;
+        std::atomic<bool> m_stopFlag{ false }; //per thread, so a thread still leaving the last analysis cannot miss its stop
+        std::thread m_thread;
+    };
+
+    void ThreadMain(int threadIndex);
+    void StopAllThreads(); //stops the current generation, under m_mutex
+    void PublishResult(int threadIndex, int generation, ChessSearchResult const& result);
+
+private:
+    std::vector<std::unique_ptr<AnalysisThread>> m_threads;
+    ChessTranspositionTable m_table;
+    std::atomic<int> m_numRunningThreads{ 0 }; //searching, or started and not yet woken up
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeCondition;
+    bool m_isQuitting = false;
+    int m_generation = 0; //bumped by every Start, threads compare it against the analysis they are running
+    int m_stoppedGeneration = 0; //last generation stopped, a thread waking up late for it must not clear its stop flag
+    int m_numUnclaimedThreads = 0; //threads yet to pick up the current generation
+    ChessPosition m_requestPosition;
+    std::vector<uint64_t> m_requestKeys;
+    ChessSearchLimits m_requestLimits;
+    std::chrono::steady_clock::time_point m_startTime;
+    ChessAnalysisInfo m_info;
+};
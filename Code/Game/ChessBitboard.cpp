@@ -0,0 +1,137 @@
+﻿#include "ChessBitboard.h"
+
+ChessMagic g_rookMagics[NUM_BOARD_SQUARES];
+ChessMagic g_bishopMagics[NUM_BOARD_SQUARES];
+
+static Bitboard s_rookAttackTable[0x19000];  //sum over squares of 2^(relevant rook bits)
+static Bitboard s_bishopAttackTable[0x1480]; //sum over squares of 2^(relevant bishop bits)
+static bool s_areAttackTablesInitialized = false;
+
+static int const s_rookDirections[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+static int const s_bishopDirections[4][2] = { {1, 1}, {1, -1}, {-1, 1}, {-1, -1} };
+
+//----------------------------------------------------------------------------------------------------------
+static Bitboard GetSlidingAttacksSlow(int square, Bitboard occupied, int const directions[4][2])
+{
+    Bitboard attacks = 0;
+    for (int dirIndex = 0; dirIndex < 4; ++dirIndex)
+    {
+        int x = GetSquareX(square) + directions[dirIndex][0];
+        int y = GetSquareY(square) + directions[dirIndex][1];
+        while (x >= 0 && x < BOARD_SIZE && y >= 0 && y < BOARD_SIZE)
+        {
+            Bitboard bit = GetSquareBit(GetSquareAt(x, y));
+            attacks |= bit;
+            if (occupied & bit)
+            {
+                break;
+            }
+            x += directions[dirIndex][0];
+            y += directions[dirIndex][1];
+        }
+    }
+    return attacks;
+}
+
+Bitboard GetRookAttacksSlow(int square, Bitboard occupied)
+{
+    return GetSlidingAttacksSlow(square, occupied, s_rookDirections);
+}
+
+Bitboard GetBishopAttacksSlow(int square, Bitboard occupied)
+{
+    return GetSlidingAttacksSlow(square, occupied, s_bishopDirections);
+}
+
+//----------------------------------------------------------------------------------------------------------
+static uint64_t GetNextRandom(uint64_t& state)
+{
+    //xorshift64*
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ull;
+}
+
+static void InitializeMagics(ChessMagic magics[NUM_BOARD_SQUARES], Bitboard* table, int const directions[4][2])
+{
+    Bitboard occupancies[4096];
+    Bitboard references[4096];
+    int epochs[4096] = {};
+    int currentEpoch = 0;
+
+    //Per-rank seeds known to find every magic after few candidates
+    static uint64_t const seeds[BOARD_SIZE] = { 728, 10316, 55013, 32803, 12281, 15100, 16645, 255 };
+
+    Bitboard* nextAttacks = table;
+    for (int square = 0; square < NUM_BOARD_SQUARES; ++square)
+    {
+        //Edge squares never change what a slider can reach, unless the slider stands on that edge
+        Bitboard edges = ((RANK_1_BITS | RANK_8_BITS) & ~(RANK_1_BITS << (8 * GetSquareY(square))))
+                       | ((FILE_A_BITS | FILE_H_BITS) & ~(FILE_A_BITS << GetSquareX(square)));
+
+        ChessMagic& magic = magics[square];
+        magic.m_mask = GetSlidingAttacksSlow(square, 0, directions) & ~edges;
+        magic.m_shift = 64 - CountBits(magic.m_mask);
+        magic.m_attacks = nextAttacks;
+
+        //Carry-Rippler enumeration of every subset of the mask
+        int numSubsets = 0;
+        Bitboard subset = 0;
+        do
+        {
+            occupancies[numSubsets] = subset;
+            references[numSubsets] = GetSlidingAttacksSlow(square, subset, directions);
+            ++numSubsets;
+            subset = (subset - magic.m_mask) & magic.m_mask;
+        } while (subset != 0);
+
+        uint64_t randomState = seeds[GetSquareY(square)];
+        for (;;)
+        {
+            do
+            {
+                magic.m_magic = GetNextRandom(randomState) & GetNextRandom(randomState) & GetNextRandom(randomState);
+            } while (CountBits((magic.m_mask * magic.m_magic) >> 56) < 6);
+
+            ++currentEpoch;
+            bool isCollisionFree = true;
+            for (int subsetIndex = 0; subsetIndex < numSubsets; ++subsetIndex)
+            {
+                unsigned int index = magic.GetIndex(occupancies[subsetIndex]);
+                if (epochs[index] < currentEpoch)
+                {
+                    epochs[index] = currentEpoch;
+                    magic.m_attacks[index] = references[subsetIndex];
+                }
+                else if (magic.m_attacks[index] != references[subsetIndex])
+                {
+                    isCollisionFree = false;
+                    break;
+                }
+            }
+            if (isCollisionFree)
+            {
+                break;
+            }
+        }
+        nextAttacks += numSubsets;
+    }
+}
+
+void InitializeChessAttackTables()
+{
+    if (s_areAttackTablesInitialized)
+    {
+        return;
+    }
+    InitializeMagics(g_rookMagics, s_rookAttackTable, s_rookDirections);
+    InitializeMagics(g_bishopMagics, s_bishopAttackTable, s_bishopDirections);
+
+    s_areAttackTablesInitialized = true;
+}
+
+bool AreChessAttackTablesInitialized()
+{
+    return s_areAttackTablesInitialized;
+}
@@ -0,0 +1,193 @@
+﻿#pragma once
+#include "ChessCommon.h"
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//Engine-free 64-bit board sets, bit index = y * 8 + x (a1 = 0, h8 = 63)
+typedef uint64_t Bitboard;
+
+constexpr int NO_SQUARE = -1;
+
+constexpr Bitboard FILE_A_BITS = 0x0101010101010101ull;
+constexpr Bitboard FILE_H_BITS = FILE_A_BITS << 7;
+constexpr Bitboard RANK_1_BITS = 0xFFull;
+constexpr Bitboard RANK_8_BITS = RANK_1_BITS << 56;
+
+constexpr Bitboard GetSquareBit(int square) { return 1ull << square; }
+constexpr int GetSquareAt(int x, int y) { return y * BOARD_SIZE + x; }
+constexpr int GetSquareX(int square) { return square & 7; }
+constexpr int GetSquareY(int square) { return square >> 3; }
+
+inline int GetLowestSquare(Bitboard bits)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return (int)index;
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+inline int PopLowestSquare(Bitboard& bits)
+{
+    int square = GetLowestSquare(bits);
+    bits &= bits - 1;
+    return square;
+}
+
+inline int CountBits(Bitboard bits)
+{
+#if defined(_MSC_VER)
+    return (int)__popcnt64(bits);
+#else
+    return __builtin_popcountll(bits);
+#endif
+}
+
+//Sliding attacks are magic-indexed: ((occupied & mask) * magic) >> shift picks the precomputed attack set
+struct ChessMagic
+{
+    Bitboard m_mask = 0;
+    Bitboard m_magic = 0;
+    Bitboard* m_attacks = nullptr;
+    int m_shift = 0;
+
+    unsigned int GetIndex(Bitboard occupied) const { return (unsigned int)(((occupied & m_mask) * m_magic) >> m_shift); }
+};
+
+extern ChessMagic g_rookMagics[NUM_BOARD_SQUARES];
+extern ChessMagic g_bishopMagics[NUM_BOARD_SQUARES];
+
+//Fixed-pattern attacks and ray geometry are built by the compiler into read-only data, only the magics need runtime setup
+struct ChessLeaperTables
+{
+    Bitboard m_pawnAttacks[NUM_KISHI][NUM_BOARD_SQUARES] = {};
+    Bitboard m_knightAttacks[NUM_BOARD_SQUARES] = {};
+    Bitboard m_kingAttacks[NUM_BOARD_SQUARES] = {};
+};
+
+struct ChessLineTables
+{
+    Bitboard m_rookRays[NUM_BOARD_SQUARES] = {};   //rook attacks on an empty board
+    Bitboard m_bishopRays[NUM_BOARD_SQUARES] = {}; //bishop attacks on an empty board
+    Bitboard m_between[NUM_BOARD_SQUARES][NUM_BOARD_SQUARES] = {}; //squares strictly between two aligned squares, 0 if not aligned
+    Bitboard m_line[NUM_BOARD_SQUARES][NUM_BOARD_SQUARES] = {};    //the whole board line through two aligned squares, 0 if not aligned
+};
+
+constexpr Bitboard GetOffsetSquareBit(int square, int dx, int dy)
+{
+    int x = GetSquareX(square) + dx;
+    int y = GetSquareY(square) + dy;
+    return (x >= 0 && x < BOARD_SIZE && y >= 0 && y < BOARD_SIZE) ? GetSquareBit(GetSquareAt(x, y)) : 0;
+}
+
+//Opposite directions sit next to each other (dir ^ 1), the first four are the rook's
+constexpr int CHESS_RAY_DIRECTIONS[8][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {-1, -1}, {1, -1}, {-1, 1} };
+constexpr int CHESS_KNIGHT_OFFSETS[8][2] = { {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2} };
+
+constexpr ChessLeaperTables MakeChessLeaperTables()
+{
+    ChessLeaperTables tables;
+    for (int square = 0; square < NUM_BOARD_SQUARES; ++square)
+    {
+        for (int offsetIndex = 0; offsetIndex < 8; ++offsetIndex)
+        {
+            tables.m_knightAttacks[square] |= GetOffsetSquareBit(square, CHESS_KNIGHT_OFFSETS[offsetIndex][0], CHESS_KNIGHT_OFFSETS[offsetIndex][1]);
+            tables.m_kingAttacks[square] |= GetOffsetSquareBit(square, CHESS_RAY_DIRECTIONS[offsetIndex][0], CHESS_RAY_DIRECTIONS[offsetIndex][1]);
+        }
+        //White pawns move toward y = 7, black pawns toward y = 0
+        tables.m_pawnAttacks[KISHI_WHITE][square] = GetOffsetSquareBit(square, -1, 1) | GetOffsetSquareBit(square, 1, 1);
+        tables.m_pawnAttacks[KISHI_BLACK][square] = GetOffsetSquareBit(square, -1, -1) | GetOffsetSquareBit(square, 1, -1);
+    }
+    return tables;
+}
+
+constexpr ChessLineTables MakeChessLineTables()
+{
+    ChessLineTables tables;
+    for (int from = 0; from < NUM_BOARD_SQUARES; ++from)
+    {
+        Bitboard rays[8] = {};
+        for (int dirIndex = 0; dirIndex < 8; ++dirIndex)
+        {
+            //Walking outward, everything passed so far is what lies between 'from' and the square reached
+            int x = GetSquareX(from) + CHESS_RAY_DIRECTIONS[dirIndex][0];
+            int y = GetSquareY(from) + CHESS_RAY_DIRECTIONS[dirIndex][1];
+            for (; x >= 0 && x < BOARD_SIZE && y >= 0 && y < BOARD_SIZE; x += CHESS_RAY_DIRECTIONS[dirIndex][0], y += CHESS_RAY_DIRECTIONS[dirIndex][1])
+            {
+                tables.m_between[from][GetSquareAt(x, y)] = rays[dirIndex];
+                rays[dirIndex] |= GetSquareBit(GetSquareAt(x, y));
+            }
+            if (dirIndex < 4)
+            {
+                tables.m_rookRays[from] |= rays[dirIndex];
+            }
+            else
+            {
+                tables.m_bishopRays[from] |= rays[dirIndex];
+            }
+        }
+        for (int to = 0; to < NUM_BOARD_SQUARES; ++to)
+        {
+            for (int dirIndex = 0; dirIndex < 8; ++dirIndex)
+            {
+                if (rays[dirIndex] & GetSquareBit(to))
+                {
+                    tables.m_line[from][to] = rays[dirIndex] | rays[dirIndex ^ 1] | GetSquareBit(from);
+                }
+            }
+        }
+    }
+    return tables;
+}
+
+inline constexpr ChessLeaperTables g_leaperAttacks = MakeChessLeaperTables();
+inline constexpr ChessLineTables g_lineTables = MakeChessLineTables();
+
+static_assert(g_leaperAttacks.m_knightAttacks[GetSquareAt(0, 0)] == (GetSquareBit(GetSquareAt(1, 2)) | GetSquareBit(GetSquareAt(2, 1))), "knight on a1 reaches b3 and c2");
+static_assert(g_leaperAttacks.m_kingAttacks[GetSquareAt(7, 7)] == (GetSquareBit(GetSquareAt(6, 7)) | GetSquareBit(GetSquareAt(6, 6)) | GetSquareBit(GetSquareAt(7, 6))), "king on h8 reaches g8, g7 and h7");
+static_assert(g_leaperAttacks.m_pawnAttacks[KISHI_WHITE][GetSquareAt(4, 1)] == (GetSquareBit(GetSquareAt(3, 2)) | GetSquareBit(GetSquareAt(5, 2))), "white pawn on e2 attacks d3 and f3");
+static_assert(g_leaperAttacks.m_pawnAttacks[KISHI_BLACK][GetSquareAt(0, 6)] == GetSquareBit(GetSquareAt(1, 5)), "black pawn on a7 attacks b6 only");
+static_assert(g_lineTables.m_rookRays[GetSquareAt(0, 0)] == ((FILE_A_BITS | RANK_1_BITS) & ~GetSquareBit(GetSquareAt(0, 0))), "rook rays from a1 cover the a-file and first rank");
+static_assert(g_lineTables.m_between[GetSquareAt(0, 0)][GetSquareAt(7, 7)] == 0x0040201008040200ull, "b2 through g7 lie between a1 and h8");
+static_assert(g_lineTables.m_between[GetSquareAt(0, 0)][GetSquareAt(1, 2)] == 0, "a1 and b3 are not aligned");
+static_assert(g_lineTables.m_between[GetSquareAt(4, 0)][GetSquareAt(4, 1)] == 0, "adjacent squares have nothing between them");
+static_assert(g_lineTables.m_line[GetSquareAt(1, 1)][GetSquareAt(2, 2)] == 0x8040201008040201ull, "b2 and c3 share the long diagonal");
+static_assert(g_lineTables.m_line[GetSquareAt(3, 4)][GetSquareAt(6, 4)] == (RANK_1_BITS << 32), "d5 and g5 share the fifth rank");
+
+constexpr Bitboard GetPawnAttacks(int kishiID, int square) { return g_leaperAttacks.m_pawnAttacks[kishiID][square]; }
+constexpr Bitboard GetKnightAttacks(int square) { return g_leaperAttacks.m_knightAttacks[square]; }
+constexpr Bitboard GetKingAttacks(int square) { return g_leaperAttacks.m_kingAttacks[square]; }
+constexpr Bitboard GetRookRays(int square) { return g_lineTables.m_rookRays[square]; }
+constexpr Bitboard GetBishopRays(int square) { return g_lineTables.m_bishopRays[square]; }
+constexpr Bitboard GetBetweenBits(int from, int to) { return g_lineTables.m_between[from][to]; }
+constexpr Bitboard GetLineBits(int from, int to) { return g_lineTables.m_line[from][to]; }
+
+//Must run once before any sliding attack lookup; the magics are searched with a fixed seed so the tables are identical every run
+void InitializeChessAttackTables();
+bool AreChessAttackTablesInitialized();
+
+Bitboard GetRookAttacksSlow(int square, Bitboard occupied);
+Bitboard GetBishopAttacksSlow(int square, Bitboard occupied);
+
+inline Bitboard GetRookAttacks(int square, Bitboard occupied)
+{
+    ChessMagic const& magic = g_rookMagics[square];
+    return magic.m_attacks[magic.GetIndex(occupied)];
+}
+
+inline Bitboard GetBishopAttacks(int square, Bitboard occupied)
+{
+    ChessMagic const& magic = g_bishopMagics[square];
+    return magic.m_attacks[magic.GetIndex(occupied)];
+}
+
+inline Bitboard GetQueenAttacks(int square, Bitboard occupied)
+{
+    return GetRookAttacks(square, occupied) | GetBishopAttacks(square, occupied);
+}
@@ -1,7 +1,9 @@
 ﻿#include "ChessBoard.h"
 #include "ChessPiece.h"
+#include "ChessReferee.h"
 #include "Game.hpp"
 
+#include "Engine/Core/Time.hpp"
 #include "Engine/Core/VertexUtils.hpp"
 #include "Engine/Math/AABB3.hpp"
 #include "Engine/Renderer/IndexBuffer.hpp"
@@ -61,22 +63,19 @@ ChessBoard::ChessBoard(ChessReferee* owner)
     m_boardTexture = g_theRenderer->CreateOrGetTextureFromFile("Data/Images/woodfloor_d.png");
     m_boardNormalTexture = g_theRenderer->CreateOrGetTextureFromFile("Data/Images/woodfloor_n.png");
     m_sgeTexture = g_theRenderer->CreateOrGetTextureFromFile("Data/Images/Bricks_sge.png");
+
+    InitializeChessAttackTables();
     
     InitializeBoardSquaresAndBuffers();
+    m_pieceAnimations.Initialize(MAX_CHESS_PIECES);
     InitializeChessPieces();
 }
 
 ChessBoard::~ChessBoard()
 {
-	for (ChessPiece* piece : m_chessPieces)
-	{
-		if (piece != nullptr)
-		{
-            delete piece;
-            piece = nullptr;
-		}
-	}
     m_chessPieces.clear();
+    m_parkedPieces.clear();
+    m_piecePool.DestroyAllPieces(); //also the referee's ghost piece
 
     delete m_indexBuffer;
     m_indexBuffer = nullptr;
@@ -127,6 +126,13 @@ void ChessBoard::InitializeChessPieces()
     int whiteID = 1;
     int blackID = 0;
 
+    m_position.Clear();
+    m_position.m_castlingRights = CASTLE_ALL;
+
+    //Pieces live in m_piecePool and only move between these two vectors afterwards, so neither needs to grow again
+    m_chessPieces.reserve(NUM_KISHI * 2 * BOARD_SIZE);
+    m_parkedPieces.reserve(NUM_KISHI * 2 * BOARD_SIZE);
+
     std::vector<ChessPieceType> whiteBackRow =
     {
         ChessPieceType::Rook, ChessPieceType::Knight, ChessPieceType::Bishop, ChessPieceType::Queen,
@@ -138,14 +144,16 @@ void ChessBoard::InitializeChessPieces()
         Vec3 backPos((float)file + 0.5f, + 0.5f, 0.f);
         IntVec2 backCoord(file, 0);
         //m_chessPieces[backCoord] = new ChessPiece(whiteID, whiteBackRow[file], backPos, EulerAngles(90.f, 0.f, 0.f));
-        ChessPiece* p1 = new ChessPiece(whiteID, whiteBackRow[file], backPos, EulerAngles(90.f, 0.f, 0.f));
+        ChessPiece* p1 = m_piecePool.CreatePiece(whiteID, whiteBackRow[file], backPos, EulerAngles(90.f, 0.f, 0.f));
         m_chessPieces.push_back(p1);
+        PlacePieceOnBoard(p1, backCoord);
         
         Vec3 pawnPos((float)file+ 0.5f, 1.f+ 0.5f, 0.f);
         IntVec2 pawnCoord(file, 1);
         //m_chessPieces[pawnCoord] = new ChessPiece(whiteID, ChessPieceType::Pawn, pawnPos, EulerAngles(90.f, 0.f, 0.f));
-        ChessPiece* p2 = new ChessPiece(whiteID, ChessPieceType::Pawn, pawnPos, EulerAngles(90.f, 0.f, 0.f));
+        ChessPiece* p2 = m_piecePool.CreatePiece(whiteID, ChessPieceType::Pawn, pawnPos, EulerAngles(90.f, 0.f, 0.f));
         m_chessPieces.push_back(p2);
+        PlacePieceOnBoard(p2, pawnCoord);
     }
 
     std::vector<ChessPieceType> blackBackRow =
@@ -159,25 +167,33 @@ void ChessBoard::InitializeChessPieces()
         Vec3 pawnPos((float)file+ 0.5f, 6.f+ 0.5f, 0.f);
         IntVec2 pawnCoord(file, 6);
         //m_chessPieces[pawnCoord] = new ChessPiece(blackID, ChessPieceType::Pawn, pawnPos, EulerAngles(-90.f, 0.f, 0.f)); 
-        ChessPiece* p1 = new ChessPiece(blackID, ChessPieceType::Pawn, pawnPos, EulerAngles(-90.f, 0.f, 0.f)); 
+        ChessPiece* p1 = m_piecePool.CreatePiece(blackID, ChessPieceType::Pawn, pawnPos, EulerAngles(-90.f, 0.f, 0.f));
         m_chessPieces.push_back(p1);
+        PlacePieceOnBoard(p1, pawnCoord);
         
         Vec3 backPos((float)file+ 0.5f, 7.f+ 0.5f, 0.f);
         IntVec2 backCoord(file, 7);
         //m_chessPieces[backCoord] = new ChessPiece(blackID, blackBackRow[file], backPos, EulerAngles(-90.f, 0.f, 0.f));
-        ChessPiece* p2 = new ChessPiece(blackID, blackBackRow[file], backPos, EulerAngles(-90.f, 0.f, 0.f));
+        ChessPiece* p2 = m_piecePool.CreatePiece(blackID, blackBackRow[file], backPos, EulerAngles(-90.f, 0.f, 0.f));
         m_chessPieces.push_back(p2);
+        PlacePieceOnBoard(p2, backCoord);
     }
+    m_keyHistory.Push() = m_position.GetKey();
 }
 
 void ChessBoard::Update(float deltaSeconds)
 {
-    //std::vector<ChessPiece*> pieces = m_chessPieces;
-    for (ChessPiece* piece : m_chessPieces)
+    //Only sliding or pulsing pieces are visited, pieces at rest already sit on their square with their own tint
+    m_pieceAnimations.Update(deltaSeconds);
+    for (int updatedIndex = 0; updatedIndex < m_pieceAnimations.GetNumUpdated(); ++updatedIndex)
     {
-        if (piece != nullptr)
+        int slot = m_pieceAnimations.GetUpdatedSlot(updatedIndex);
+        ChessPiece* piece = m_piecePool.GetPiece(slot);
+        piece->m_position = Vec3(m_pieceAnimations.m_x[slot], m_pieceAnimations.m_y[slot], m_pieceAnimations.m_z[slot]);
+        if (m_pieceAnimations.IsPulsing(slot))
         {
-            piece->Update(deltaSeconds);
+            piece->m_tint = piece->m_originalTint;
+            piece->m_tint.a = m_pieceAnimations.m_alpha[slot];
         }
     }
 }
@@ -208,7 +224,29 @@ Vec3 ChessBoard::GetCenterPosition(IntVec2 tileCoord) const
     return Vec3((float)tileCoord.x+0.5f, (float)tileCoord.y+0.5f, 0.0f);
 }
 
+bool ChessBoard::IsOnBoard(IntVec2 coordinate) const
+{
+    return coordinate.x >= 0 && coordinate.x < BOARD_SIZE && coordinate.y >= 0 && coordinate.y < BOARD_SIZE;
+}
+
+int ChessBoard::GetSquareIndex(IntVec2 coordinate) const
+{
+    return coordinate.y * BOARD_SIZE + coordinate.x;
+}
+
 bool ChessBoard::IsTherePiece(IntVec2 coordinate) const
+{
+    return GetPiece(coordinate) != nullptr;
+}
+
+ChessPiece* ChessBoard::GetPiece(IntVec2 coordinate) const
+{
+    if (!IsOnBoard(coordinate))
+        return nullptr;
+    return m_squares[GetSquareIndex(coordinate)];
+}
+
+ChessPiece* ChessBoard::GetPieceByScan(IntVec2 coordinate) const //the old O(n) lookup, only used to benchmark against the mailbox
 {
     for (ChessPiece* piece : m_chessPieces)
     {
@@ -216,33 +254,330 @@ bool ChessBoard::IsTherePiece(IntVec2 coordinate) const
         {
             if (piece->m_currentCoord == coordinate)
             {
-                return true;
+                return piece;
             }
         }
     }
-    return false;
-    //auto iter = m_chessPieces.find(coordinate);
-    //return (iter != m_chessPieces.end() && iter->second != nullptr);
+    return nullptr;
 }
 
-ChessPiece* ChessBoard::GetPiece(IntVec2 coordinate) const
+void ChessBoard::PlacePieceOnBoard(ChessPiece* piece, IntVec2 coordinate)
+{
+    piece->m_currentCoord = coordinate;
+    //A sliding piece keeps sliding toward the new square, a resting one is put straight on it
+    Vec3 center = GetCenterPosition(coordinate);
+    m_pieceAnimations.RetargetMove(piece->m_poolIndex, center.x, center.y);
+    if (!m_pieceAnimations.IsMoving(piece->m_poolIndex))
+    {
+        m_pieceAnimations.StopMove(piece->m_poolIndex);
+        piece->m_position = center;
+    }
+    if (IsOnBoard(coordinate))
+    {
+        m_squares[GetSquareIndex(coordinate)] = piece;
+        m_position.PutPiece(GetSquareIndex(coordinate), piece->m_ownerKishiID, piece->m_type);
+    }
+}
+
+void ChessBoard::MovePieceOnBoard(ChessPiece* piece, IntVec2 to)
+{
+    IntVec2 from = piece->m_currentCoord;
+    bool wasOnBoard = IsOnBoard(from) && m_squares[GetSquareIndex(from)] == piece;
+    if (wasOnBoard)
+    {
+        m_squares[GetSquareIndex(from)] = nullptr;
+        m_position.RemovePiece(GetSquareIndex(from));
+        m_position.ClearCastlingRightsOn(GetSquareIndex(from));
+    }
+    PlacePieceOnBoard(piece, to);
+
+    if (wasOnBoard && piece->m_type == ChessPieceType::Pawn)
+    {
+        m_isIrreversiblePly = true;
+    }
+
+    //A double pawn push leaves the skipped square open to en passant for exactly one move
+    m_position.m_enPassantSquare = NO_SQUARE;
+    if (wasOnBoard && IsOnBoard(to) && piece->m_type == ChessPieceType::Pawn && abs(to.y - from.y) == 2 && to.x == from.x)
+    {
+        m_position.m_enPassantSquare = GetSquareIndex(IntVec2(from.x, (from.y + to.y) / 2));
+    }
+}
+
+void ChessBoard::OnPiecePromoted(ChessPiece* piece)
 {
+    IntVec2 coord = piece->m_currentCoord;
+    if (IsOnBoard(coord) && m_squares[GetSquareIndex(coord)] == piece)
+    {
+        m_position.PutPiece(GetSquareIndex(coord), piece->m_ownerKishiID, piece->m_type);
+    }
+}
+
+void ChessBoard::AnimatePieceMove(ChessPiece* piece)
+{
+    Vec3 from = GetCenterPosition(piece->m_lastCoord);
+    Vec3 to = GetCenterPosition(piece->m_currentCoord);
+    m_pieceAnimations.StartMove(piece->m_poolIndex, from.x, from.y, to.x, to.y, piece->m_type == ChessPieceType::Knight);
+}
+
+void ChessBoard::SnapPieceToSquare(ChessPiece* piece)
+{
+    Vec3 center = GetCenterPosition(piece->m_currentCoord);
+    m_pieceAnimations.RetargetMove(piece->m_poolIndex, center.x, center.y);
+    m_pieceAnimations.StopMove(piece->m_poolIndex);
+    m_pieceAnimations.StopPulse(piece->m_poolIndex);
+    piece->m_position = center;
+    piece->m_tint = piece->m_originalTint;
+}
+
+void ChessBoard::SetPiecePulsing(ChessPiece* piece, bool isPulsing)
+{
+    if (piece->m_poolIndex < 0)
+        return;
+
+    if (isPulsing)
+    {
+        m_pieceAnimations.StartPulse(piece->m_poolIndex);
+    }
+    else
+    {
+        m_pieceAnimations.StopPulse(piece->m_poolIndex);
+        piece->m_tint = piece->m_originalTint;
+    }
+}
+
+void ChessBoard::ParkPiece(ChessPiece* piece)
+{
+    m_isIrreversiblePly = true;
+    RemovePieceFromBoard(piece);
+    piece->m_isGrabbed = false;
+    piece->m_isImpacted = false;
+    SnapPieceToSquare(piece); //parked pieces must not stay on the active list
+    m_parkedPieces.push_back(piece);
+}
+
+void ChessBoard::UnparkPiece(ChessPiece* piece, IntVec2 coordinate)
+{
+    m_parkedPieces.erase(std::remove(m_parkedPieces.begin(), m_parkedPieces.end(), piece), m_parkedPieces.end());
+    m_chessPieces.push_back(piece);
+    PlacePieceOnBoard(piece, coordinate);
+    piece->m_lastCoord = coordinate;
+    SnapPieceToSquare(piece);
+}
+
+void ChessBoard::ResetPieces()
+{
+    for (ChessPiece* piece : m_parkedPieces)
+    {
+        m_chessPieces.push_back(piece);
+    }
+    m_parkedPieces.clear();
+
+    for (int squareIndex = 0; squareIndex < NUM_BOARD_SQUARES; ++squareIndex)
+    {
+        m_squares[squareIndex] = nullptr;
+    }
+    m_position.Clear();
+    m_position.m_castlingRights = CASTLE_ALL;
+
     for (ChessPiece* piece : m_chessPieces)
     {
-        if (piece != nullptr)
+        if (piece->m_type != piece->m_startType)
         {
-            if (piece->m_currentCoord == coordinate)
+            piece->PromoteTo(piece->m_startType);
+        }
+        piece->m_hasMoved = false;
+        piece->m_hasMoved2Squares = false;
+        piece->m_isGrabbed = false;
+        piece->m_isImpacted = false;
+        piece->m_lastCoord = piece->m_startCoord;
+        PlacePieceOnBoard(piece, piece->m_startCoord);
+        SnapPieceToSquare(piece);
+    }
+    for (int kishiIndex = 0; kishiIndex < NUM_KISHI; ++kishiIndex)
+    {
+        m_owner->m_chessKishi[kishiIndex]->m_lastMovedPiece = nullptr;
+    }
+    m_undoStack.Clear();
+    m_keyHistory.Clear();
+    m_keyHistory.Push() = m_position.GetKey();
+    m_isIrreversiblePly = false;
+}
+
+bool ChessBoard::LoadFEN(std::string const& fen)
+{
+    ChessPosition loaded;
+    if (!loaded.SetFromFEN(fen))
+        return false;
+
+    //Each side owns exactly 16 piece objects, a position needing more of them cannot be shown
+    int const numPiecesPerKishi = 2 * BOARD_SIZE;
+    for (int kishiIndex = 0; kishiIndex < NUM_KISHI; ++kishiIndex)
+    {
+        if (CountBits(loaded.GetKishiPieces(kishiIndex)) > numPiecesPerKishi)
+            return false;
+    }
+
+    //Gather every piece, on the board or parked, and hand them out square by square; nothing is allocated or reloaded
+    ChessPiece* freePieces[NUM_KISHI][2 * BOARD_SIZE] = {};
+    int numFreePieces[NUM_KISHI] = {};
+    for (ChessPiece* piece : m_parkedPieces)
+    {
+        m_chessPieces.push_back(piece);
+    }
+    m_parkedPieces.clear();
+    for (ChessPiece* piece : m_chessPieces)
+    {
+        freePieces[piece->m_ownerKishiID][numFreePieces[piece->m_ownerKishiID]++] = piece;
+    }
+    m_chessPieces.clear();
+    for (int squareIndex = 0; squareIndex < NUM_BOARD_SQUARES; ++squareIndex)
+    {
+        m_squares[squareIndex] = nullptr;
+    }
+    m_position.Clear();
+
+    //Prefer a piece that started as the wanted type, so a later reset has less to un-promote
+    ChessPiece* assigned[NUM_BOARD_SQUARES] = {};
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        Bitboard occupied = loaded.GetOccupied();
+        while (occupied)
+        {
+            int square = PopLowestSquare(occupied);
+            if (assigned[square] != nullptr)
+                continue;
+
+            int kishiID = loaded.GetKishiAt(square);
+            ChessPieceType type = loaded.GetPieceTypeAt(square);
+            for (int freeIndex = 0; freeIndex < numFreePieces[kishiID]; ++freeIndex)
             {
-                return piece;
+                ChessPiece* piece = freePieces[kishiID][freeIndex];
+                if (pass == 0 && piece->m_startType != type)
+                    continue;
+
+                assigned[square] = piece;
+                freePieces[kishiID][freeIndex] = freePieces[kishiID][--numFreePieces[kishiID]];
+                break;
             }
         }
     }
-    // auto iter = m_chessPieces.find(coordinate);
-    // if (iter != m_chessPieces.end())
-    // {
-    //     return iter->second;
-    // }
-    return nullptr;
+
+    for (int kishiIndex = 0; kishiIndex < NUM_KISHI; ++kishiIndex)
+    {
+        m_owner->m_chessKishi[kishiIndex]->m_lastMovedPiece = nullptr;
+        for (int freeIndex = 0; freeIndex < numFreePieces[kishiIndex]; ++freeIndex)
+        {
+            ChessPiece* piece = freePieces[kishiIndex][freeIndex];
+            piece->m_isGrabbed = false;
+            piece->m_isImpacted = false;
+            SnapPieceToSquare(piece);
+            m_parkedPieces.push_back(piece);
+        }
+    }
+
+    //The flags below are only bookkeeping now, castling and en passant legality come from the loaded position itself
+    int const pawnStartY[NUM_KISHI] = { BOARD_SIZE - 2, 1 };
+    for (int square = 0; square < NUM_BOARD_SQUARES; ++square)
+    {
+        ChessPiece* piece = assigned[square];
+        if (piece == nullptr)
+            continue;
+
+        ChessPieceType type = loaded.GetPieceTypeAt(square);
+        if (piece->m_type != type)
+        {
+            piece->PromoteTo(type); //before placing, so the position only ever sees the final type
+        }
+        IntVec2 coord(GetSquareX(square), GetSquareY(square));
+        piece->m_hasMoved = (type == ChessPieceType::Pawn) && coord.y != pawnStartY[piece->m_ownerKishiID];
+        piece->m_hasMoved2Squares = false;
+        piece->m_isGrabbed = false;
+        piece->m_isImpacted = false;
+        piece->m_lastCoord = coord;
+        m_chessPieces.push_back(piece);
+        PlacePieceOnBoard(piece, coord);
+        SnapPieceToSquare(piece);
+    }
+
+    if (loaded.m_enPassantSquare != NO_SQUARE)
+    {
+        int pawnSquare = loaded.m_enPassantSquare + ((loaded.m_sideToMove == KISHI_WHITE) ? -BOARD_SIZE : BOARD_SIZE);
+        ChessPiece* pawn = (pawnSquare >= 0 && pawnSquare < NUM_BOARD_SQUARES) ? m_squares[pawnSquare] : nullptr;
+        if (pawn != nullptr && pawn->m_type == ChessPieceType::Pawn)
+        {
+            pawn->m_hasMoved2Squares = true;
+            m_owner->m_chessKishi[pawn->m_ownerKishiID]->m_lastMovedPiece = pawn;
+        }
+    }
+
+    //Same pieces on the same squares, so this only brings over side to move, castling, en passant and the clocks
+    m_position = loaded;
+    m_undoStack.Clear();
+    m_keyHistory.Clear();
+    m_keyHistory.Push() = m_position.GetKey();
+    m_isIrreversiblePly = false;
+    return true;
+}
+
+void ChessBoard::SetSideToMove(int kishiID)
+{
+    m_position.m_sideToMove = kishiID;
+}
+
+void ChessBoard::EndTurn(int nextKishiID)
+{
+    //Called once per ply after the pieces have landed: advances the clocks and records the key for repetition checks
+    m_position.m_halfmoveClock = m_isIrreversiblePly ? 0 : m_position.m_halfmoveClock + 1;
+    if (nextKishiID == KISHI_WHITE)
+    {
+        ++m_position.m_fullmoveNumber;
+    }
+    m_isIrreversiblePly = false;
+    SetSideToMove(nextKishiID);
+    m_keyHistory.Push() = m_position.GetKey();
+}
+
+int ChessBoard::GetRepetitionCount() const
+{
+    //Only positions since the last capture or pawn move can recur, with the same side to move, so at most 50 compares
+    int lastPly = m_keyHistory.Size() - 1;
+    if (lastPly < 0)
+        return 0;
+
+    uint64_t key = m_keyHistory[lastPly];
+    int oldestPly = lastPly - m_position.m_halfmoveClock;
+    int count = 1;
+    for (int ply = lastPly - 2; ply >= 0 && ply >= oldestPly; ply -= 2)
+    {
+        if (m_keyHistory[ply] == key)
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void ChessBoard::GetRepeatableKeys(std::vector<uint64_t>& out_keys) const
+{
+    out_keys.clear();
+    int lastPly = m_keyHistory.Size() - 1;
+    for (int ply = std::max(0, lastPly - m_position.m_halfmoveClock); ply <= lastPly; ++ply)
+    {
+        out_keys.push_back(m_keyHistory[ply]);
+    }
+}
+
+void ChessBoard::RemovePieceFromBoard(ChessPiece* piece)
+{
+    IntVec2 coord = piece->m_currentCoord;
+    if (IsOnBoard(coord) && m_squares[GetSquareIndex(coord)] == piece)
+    {
+        m_squares[GetSquareIndex(coord)] = nullptr;
+        m_position.RemovePiece(GetSquareIndex(coord));
+        m_position.ClearCastlingRightsOn(GetSquareIndex(coord));
+    }
+    m_chessPieces.erase(std::remove(m_chessPieces.begin(), m_chessPieces.end(), piece), m_chessPieces.end());
 }
 
 IntVec2 ChessBoard::ParseCoordinate(std::string const& text)
@@ -274,12 +609,11 @@ bool ChessBoard::CaptureAnotherPiece(IntVec2 from, IntVec2 to) //只有吃子的
 
     if (toPiece != nullptr)
     {
-        if (toPiece->m_definition.m_type == ChessPieceType::King)
+        if (toPiece->m_definition->m_type == ChessPieceType::King)
         {
             g_theGame->m_hasWon = true;
         }
-        delete toPiece;
-        m_chessPieces.erase(std::remove(m_chessPieces.begin(), m_chessPieces.end(), toPiece), m_chessPieces.end());
+        ParkPiece(toPiece);
         //didCapture = true;
     }
 
@@ -294,12 +628,11 @@ bool ChessBoard::CaptureAnotherPiece(IntVec2 to)
     ChessPiece* toPiece = GetPiece(to);
     if (toPiece != nullptr)
     {
-        if (toPiece->m_definition.m_type == ChessPieceType::King)
+        if (toPiece->m_definition->m_type == ChessPieceType::King)
         {
             g_theGame->m_hasWon = true;
         }
-        delete toPiece;
-        m_chessPieces.erase(std::remove(m_chessPieces.begin(), m_chessPieces.end(), toPiece), m_chessPieces.end());
+        ParkPiece(toPiece);
         return true;
     }
     return false;
@@ -307,69 +640,158 @@ bool ChessBoard::CaptureAnotherPiece(IntVec2 to)
 
 bool ChessBoard::IsAxial(IntVec2 from, IntVec2 to) const
 {
-    return from.x == to.x || from.y == to.y;
+    if (!IsOnBoard(from) || !IsOnBoard(to))
+        return false;
+    return from == to || (GetRookRays(GetSquareIndex(from)) & GetSquareBit(GetSquareIndex(to))) != 0;
 }
 
 bool ChessBoard::IsDiagonal(IntVec2 from, IntVec2 to) const
 {
-    return abs(from.x - to.x) == abs(from.y - to.y);
+    if (!IsOnBoard(from) || !IsOnBoard(to))
+        return false;
+    return from == to || (GetBishopRays(GetSquareIndex(from)) & GetSquareBit(GetSquareIndex(to))) != 0;
 }
 
 bool ChessBoard::IsMovingKnight(IntVec2 from, IntVec2 to) const
 {
-    int dx = abs(to.x - from.x);
-    int dy = abs(to.y - from.y);
-    return (dx == 2 && dy == 1) || (dx == 1 && dy == 2);
+    if (!IsOnBoard(from) || !IsOnBoard(to))
+        return false;
+    return (GetKnightAttacks(GetSquareIndex(from)) & GetSquareBit(GetSquareIndex(to))) != 0;
 }
 
 bool ChessBoard::HasBlockedOnAxial(IntVec2 from, IntVec2 to) const
 {
-    if (from.x != to.x && from.y != to.y)
+    if (from == to)
+        return false;
+    if (!IsOnBoard(from) || !IsOnBoard(to))
+        return true;
+    if (!IsAxial(from, to))
         return false; // Not axial //only called when its axial plz
 
-    int dx = (to.x > from.x) ? 1 : (to.x < from.x ? -1 : 0);
-    int dy = (to.y > from.y) ? 1 : (to.y < from.y ? -1 : 0);
+    //Anything occupied strictly between the two squares blocks the slide
+    return (GetBetweenBits(GetSquareIndex(from), GetSquareIndex(to)) & m_position.GetOccupied()) != 0;
+}
 
-    IntVec2 check = from;
-    check.x += dx;
-    check.y += dy;
+bool ChessBoard::HasBlockedOnDiagonal(IntVec2 from, IntVec2 to) const
+{
+    if (from == to)
+        return false;
+    if (!IsOnBoard(from) || !IsOnBoard(to))
+        return true;
+    if (!IsDiagonal(from, to))
+        return false; // Not diagonal //Only call when its diagonal plz
+
+    return (GetBetweenBits(GetSquareIndex(from), GetSquareIndex(to)) & m_position.GetOccupied()) != 0;
+}
 
-    while (check != to)
+void ChessBoard::BeginMoveRecord(ChessMove const& move)
+{
+    //Snapshot taken before ChessPiece::OnMove runs, it is only kept if the move actually happens
+    IntVec2 from(GetSquareX(move.m_from), GetSquareY(move.m_from));
+    IntVec2 to(GetSquareX(move.m_to), GetSquareY(move.m_to));
+    ChessBoardUndoRecord& record = m_pendingRecord;
+    record = ChessBoardUndoRecord();
+    m_hasPendingRecord = true;
+
+    record.m_positionUndo.m_move = move;
+    record.m_positionUndo.m_castlingRights = m_position.m_castlingRights;
+    record.m_positionUndo.m_enPassantSquare = (signed char)m_position.m_enPassantSquare;
+    record.m_positionUndo.m_halfmoveClock = m_position.m_halfmoveClock;
+    record.m_fullmoveNumber = m_position.m_fullmoveNumber;
+
+    record.m_movedPiece = GetPiece(from);
+    record.m_movedType = record.m_movedPiece->m_type;
+    record.m_movedLastCoord = record.m_movedPiece->m_lastCoord;
+    record.m_movedHadMoved = record.m_movedPiece->m_hasMoved;
+    record.m_movedHadMoved2Squares = record.m_movedPiece->m_hasMoved2Squares;
+
+    record.m_capturedCoord = (move.m_result == ChessMoveResult::VALID_CAPTURE_ENPASSANT) ? IntVec2(to.x, from.y) : to;
+    record.m_capturedPiece = GetPiece(record.m_capturedCoord);
+    record.m_positionUndo.m_capturedCode = m_position.GetPieceCodeAt(GetSquareIndex(record.m_capturedCoord));
+
+    if (move.m_result == ChessMoveResult::VALID_CASTLE_KINGSIDE || move.m_result == ChessMoveResult::VALID_CASTLE_QUEENSIDE)
     {
-        if (IsTherePiece(check))
-            return true; // Blocked
+        IntVec2 rookCoord((move.m_result == ChessMoveResult::VALID_CASTLE_KINGSIDE) ? BOARD_SIZE - 1 : 0, from.y);
+        record.m_castledRook = GetPiece(rookCoord);
+        record.m_rookLastCoord = record.m_castledRook->m_lastCoord;
+        record.m_rookHadMoved = record.m_castledRook->m_hasMoved;
+    }
 
-        check.x += dx;
-        check.y += dy;
+    for (int kishiIndex = 0; kishiIndex < NUM_KISHI; ++kishiIndex)
+    {
+        record.m_lastMovedPieces[kishiIndex] = m_owner->m_chessKishi[kishiIndex]->m_lastMovedPiece;
     }
-    return false; 
 }
 
-bool ChessBoard::HasBlockedOnDiagonal(IntVec2 from, IntVec2 to) const
+void ChessBoard::CommitMoveRecord()
 {
-    int dx = to.x - from.x;
-    int dy = to.y - from.y;
+    if (!m_hasPendingRecord)
+        return;
 
-    if (abs(dx) != abs(dy))
-        return false; // Not diagonal //Only call when its diagonal plz
+    m_undoStack.Push() = m_pendingRecord;
+    m_hasPendingRecord = false;
+}
 
-    dx = (dx > 0) ? 1 : -1;
-    dy = (dy > 0) ? 1 : -1;
+bool ChessBoard::TakeBackMove()
+{
+    if (m_undoStack.IsEmpty())
+        return false;
 
-    IntVec2 check = from;
-    check.x += dx;
-    check.y += dy;
+    ChessBoardUndoRecord const& record = m_undoStack.Top();
+    ChessMove const& move = record.m_positionUndo.m_move;
+    IntVec2 from(GetSquareX(move.m_from), GetSquareY(move.m_from));
 
-    while (check != to)
+    //Pieces snap back instead of animating, m_lastCoord feeds the en passant checks in ChessPiece::OnMove
+    ChessPiece* movedPiece = record.m_movedPiece;
+    if (movedPiece->m_type != record.m_movedType)
     {
-        if (IsTherePiece(check))
-            return true; // Blocked!
+        movedPiece->PromoteTo(record.m_movedType);
+    }
+    MovePieceOnBoard(movedPiece, from);
+    movedPiece->m_lastCoord = record.m_movedLastCoord;
+    SnapPieceToSquare(movedPiece);
+    movedPiece->m_hasMoved = record.m_movedHadMoved;
+    movedPiece->m_hasMoved2Squares = record.m_movedHadMoved2Squares;
 
-        check.x += dx;
-        check.y += dy;
+    if (record.m_castledRook != nullptr)
+    {
+        IntVec2 rookCoord((move.m_result == ChessMoveResult::VALID_CASTLE_KINGSIDE) ? BOARD_SIZE - 1 : 0, from.y);
+        MovePieceOnBoard(record.m_castledRook, rookCoord);
+        record.m_castledRook->m_lastCoord = record.m_rookLastCoord;
+        SnapPieceToSquare(record.m_castledRook);
+        record.m_castledRook->m_hasMoved = record.m_rookHadMoved;
     }
 
-    return false;
+    if (record.m_capturedPiece != nullptr)
+    {
+        UnparkPiece(record.m_capturedPiece, record.m_capturedCoord);
+    }
+
+    for (int kishiIndex = 0; kishiIndex < NUM_KISHI; ++kishiIndex)
+    {
+        m_owner->m_chessKishi[kishiIndex]->m_lastMovedPiece = record.m_lastMovedPieces[kishiIndex];
+    }
+
+    //MovePieceOnBoard above touched castling and en passant, the record holds the real values
+    m_position.m_castlingRights = record.m_positionUndo.m_castlingRights;
+    m_position.m_enPassantSquare = record.m_positionUndo.m_enPassantSquare;
+    m_position.m_halfmoveClock = record.m_positionUndo.m_halfmoveClock;
+    m_position.m_fullmoveNumber = record.m_fullmoveNumber;
+    m_position.m_sideToMove = movedPiece->m_ownerKishiID;
+    m_isIrreversiblePly = false;
+
+    m_undoStack.Pop();
+    if (m_keyHistory.Size() > 1)
+    {
+        m_keyHistory.Pop();
+    }
+    return true;
+}
+
+void ChessBoard::ClearMoveHistory()
+{
+    m_undoStack.Clear();
+    m_isIrreversiblePly = true; //nothing before a teleport can be repeated
 }
 
 AABB3 ChessBoard::GetAABB() const
@@ -377,4 +799,53 @@ AABB3 ChessBoard::GetAABB() const
     return AABB3(Vec3(0.f,0.f,-1.f), Vec3(8.f,8.f,0.f));
 }
 
+void ChessBoard::RunSquareLookupBenchmark(int numIterations) const
+{
+    //Full-board scans (all 64 squares), the same access pattern as GetBoardStateAsString / raycast updates
+    int foundByScan = 0;
+    double scanStart = GetCurrentTimeSeconds();
+    for (int iteration = 0; iteration < numIterations; ++iteration)
+    {
+        for (int squareIndex = 0; squareIndex < NUM_BOARD_SQUARES; ++squareIndex)
+        {
+            if (GetPieceByScan(IntVec2(squareIndex % BOARD_SIZE, squareIndex / BOARD_SIZE)) != nullptr)
+            {
+                foundByScan++;
+            }
+        }
+    }
+    double scanSeconds = GetCurrentTimeSeconds() - scanStart;
+
+    int foundByMailbox = 0;
+    double mailboxStart = GetCurrentTimeSeconds();
+    for (int iteration = 0; iteration < numIterations; ++iteration)
+    {
+        for (int squareIndex = 0; squareIndex < NUM_BOARD_SQUARES; ++squareIndex)
+        {
+            if (GetPiece(IntVec2(squareIndex % BOARD_SIZE, squareIndex / BOARD_SIZE)) != nullptr)
+            {
+                foundByMailbox++;
+            }
+        }
+    }
+    double mailboxSeconds = GetCurrentTimeSeconds() - mailboxStart;
+
+    double numLookups = (double)numIterations * (double)NUM_BOARD_SQUARES;
+    g_theDevConsole->AddLine(Rgba8::CYAN, Stringf("Square lookup benchmark: %d full-board scans, %d pieces on board",
+        numIterations, (int)m_chessPieces.size()));
+    g_theDevConsole->AddLine(Rgba8::YELLOW, Stringf("  Linear scan: %.3f ms (%.2f ns/square)",
+        scanSeconds * 1000.0, scanSeconds * 1e9 / numLookups));
+    g_theDevConsole->AddLine(Rgba8::YELLOW, Stringf("  Mailbox:     %.3f ms (%.2f ns/square)",
+        mailboxSeconds * 1000.0, mailboxSeconds * 1e9 / numLookups));
+    if (mailboxSeconds > 0.0)
+    {
+        g_theDevConsole->AddLine(Rgba8::MINTGREEN, Stringf("  Speedup: %.1fx", scanSeconds / mailboxSeconds));
+    }
+    if (foundByScan != foundByMailbox)
+    {
+        g_theDevConsole->AddLine(Rgba8::RED, Stringf("  Mailbox out of sync! scan found %d, mailbox found %d",
+            foundByScan, foundByMailbox));
+    }
+}
+
 
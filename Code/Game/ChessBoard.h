@@ -1,6 +1,8 @@
 ﻿#pragma once
 #include "ChessObject.h"
 #include "ChessPiece.h"
+#include "ChessPieceAnimations.h"
+#include "ChessPosition.h"
 
 class ChessBoard;
 class ChessReferee;
@@ -59,6 +61,29 @@ public:
 //     }
 // };
 
+//----------------------------------------------------------------------------------------------------------
+//One ply of game history: the core position's undo data plus the visual pieces the move touched
+struct ChessBoardUndoRecord
+{
+    ChessUndoRecord m_positionUndo;
+    int m_fullmoveNumber = 1;
+
+    ChessPiece* m_movedPiece = nullptr;
+    ChessPieceType m_movedType = ChessPieceType::Pawn; //before promotion
+    IntVec2 m_movedLastCoord;
+    bool m_movedHadMoved = false;
+    bool m_movedHadMoved2Squares = false;
+
+    ChessPiece* m_capturedPiece = nullptr; //parked in ChessBoard::m_parkedPieces until taken back or reset
+    IntVec2 m_capturedCoord;
+
+    ChessPiece* m_castledRook = nullptr;
+    IntVec2 m_rookLastCoord;
+    bool m_rookHadMoved = false;
+
+    ChessPiece* m_lastMovedPieces[NUM_KISHI] = {};
+};
+
 class ChessBoard : public ChessObject
 {
     friend class ChessReferee;
@@ -79,8 +104,30 @@ public:
     //Utils
     //bool IsOutOfBoard() const;
     Vec3 GetCenterPosition(IntVec2 tileCoord) const;
+    bool IsOnBoard(IntVec2 coordinate) const;
+    int GetSquareIndex(IntVec2 coordinate) const;
     bool IsTherePiece(IntVec2 coordinate) const;
     ChessPiece* GetPiece(IntVec2 coordinate) const;
+    ChessPiece* GetPieceByScan(IntVec2 coordinate) const;
+    void PlacePieceOnBoard(ChessPiece* piece, IntVec2 coordinate);
+    void MovePieceOnBoard(ChessPiece* piece, IntVec2 to);
+    void RemovePieceFromBoard(ChessPiece* piece);
+    void OnPiecePromoted(ChessPiece* piece);
+    void AnimatePieceMove(ChessPiece* piece); //slide from m_lastCoord to m_currentCoord
+    void SnapPieceToSquare(ChessPiece* piece); //stop every animation and rest on m_currentCoord
+    void SetPiecePulsing(ChessPiece* piece, bool isPulsing);
+    void ParkPiece(ChessPiece* piece);
+    void UnparkPiece(ChessPiece* piece, IntVec2 coordinate);
+    void ResetPieces();
+    bool LoadFEN(std::string const& fen); //leaves the board untouched and returns false if the text is malformed
+    std::string GetFEN() const { return m_position.GetFEN(); }
+    void SetSideToMove(int kishiID);
+    void EndTurn(int nextKishiID);
+    uint64_t GetPositionKey() const { return m_position.GetKey(); } //the shared identity of the current position
+    int GetRepetitionCount() const;
+    void GetRepeatableKeys(std::vector<uint64_t>& out_keys) const; //keys since the last capture or pawn move, oldest first, current last
+    bool IsFiftyMoveRuleReached() const { return m_position.m_halfmoveClock >= 100; }
+    ChessPosition const& GetPosition() const { return m_position; }
     IntVec2 ParseCoordinate(std::string const& text);
     bool CaptureAnotherPiece(IntVec2 from, IntVec2 to);
     bool CaptureAnotherPiece(IntVec2 to);
@@ -92,6 +139,16 @@ public:
 
     AABB3 GetAABB() const;
 
+    //History
+    void BeginMoveRecord(ChessMove const& move);
+    void CommitMoveRecord();
+    bool TakeBackMove();
+    void ClearMoveHistory();
+    int GetNumRecordedMoves() const { return m_undoStack.Size(); }
+
+    //Benchmark
+    void RunSquareLookupBenchmark(int numIterations) const;
+
 protected:
     ChessReferee* m_owner = nullptr;
     Shader* m_boardShader = nullptr;
@@ -105,8 +162,18 @@ protected:
     IndexBuffer* m_indexBuffer = nullptr;
     VertexBuffer* m_vertexBuffer = nullptr;
 
+    ChessPiecePool m_piecePool; //owns every piece below, on the board or parked, and the referee's ghost piece
+    ChessPieceAnimations m_pieceAnimations; //indexed by ChessPiece::m_poolIndex
     std::vector<ChessPiece*> m_chessPieces;
-    //std::map<IntVec2, ChessPiece*> m_chessPieces;
+    ChessPiece* m_squares[NUM_BOARD_SQUARES] = {}; //mailbox, index = y * 8 + x, kept in sync by MovePieceOnBoard
+    ChessPosition m_position; //bitboard rules state, the ChessPiece objects above are only its visual layer
+
+    std::vector<ChessPiece*> m_parkedPieces; //captured pieces, kept alive so takeback and reset never allocate
+    ChessBoardUndoRecord m_pendingRecord;
+    bool m_hasPendingRecord = false; //a record is committed at most once, whoever ends it
+    ChessUndoStack<ChessBoardUndoRecord, MAX_CHESS_GAME_PLIES> m_undoStack;
+    ChessUndoStack<uint64_t, MAX_CHESS_GAME_PLIES> m_keyHistory; //one key per ply, the current position on top
+    bool m_isIrreversiblePly = false; //a capture or pawn move happened this ply, resets the fifty-move clock
 };
 
 
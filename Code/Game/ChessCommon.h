@@ -0,0 +1,63 @@
+﻿#pragma once
+//Engine-free chess definitions shared by the game, the board model and the headless tools
+
+constexpr int NUM_KISHI =2;
+constexpr int KISHI_BLACK = 0; //lowercase glyphs, pawns move toward y = 0
+constexpr int KISHI_WHITE = 1; //moves first
+
+constexpr int BOARD_SIZE = 8;
+constexpr int NUM_BOARD_SQUARES = BOARD_SIZE * BOARD_SIZE;
+
+enum class ChessPieceType : unsigned char
+{
+    Bishop,
+    Knight,
+    Rook,
+    Queen,
+    King,
+    Pawn,
+    Count
+};
+
+enum class ChessMoveResult : unsigned char
+{
+    UNKNOWN,
+    VALID_MOVE_NORMAL,
+    VALID_MOVE_PAWN_2SQUARE,
+    VALID_MOVE_PROMOTION,
+    VALID_CASTLE_KINGSIDE,
+    VALID_CASTLE_QUEENSIDE,
+    VALID_CAPTURE_NORMAL,
+    VALID_CAPTURE_ENPASSANT,
+
+    INVALID_MOVE_BAD_LOCATION,
+    INVALID_MOVE_NO_PIECE,
+    INVALID_MOVE_NOT_YOUR_PIECE,
+    INVALID_MOVE_WRONG_MOVE_SHAPE,
+    INVALID_MOVE_ZERO_DISTANCE,
+    INVALID_MOVE_PAWN_BLOCKED,
+    INVALID_MOVE_DESTINATION_BLOCKED,
+    INVALID_MOVE_PATH_BLOCKED,
+    INVALID_MOVE_ENDS_IN_CHECK,
+    INVALID_MOVE_KING_TOGETHER,
+    INVALID_MOVE_NO_PROMOTION,
+    INVALID_ENPASSANT_STALE,
+    INVALID_CASTLE_KING_HAS_MOVED,
+    INVALID_CASTLE_ROOK_HAS_MOVED,
+    INVALID_CASTLE_PATH_BLOCKED,
+    INVALID_CASTLE_THROUGH_CHECK,
+    INVALID_CASTLE_OUT_OF_CHECK,
+    COUNT
+};
+
+constexpr int NUM_CHESS_PIECE_TYPES = (int)ChessPieceType::Count;
+
+constexpr bool IsValidChessMoveResult(ChessMoveResult result)
+{
+    return result >= ChessMoveResult::VALID_MOVE_NORMAL && result <= ChessMoveResult::VALID_CAPTURE_ENPASSANT;
+}
+
+constexpr bool IsPromotionChoice(ChessPieceType type)
+{
+    return type == ChessPieceType::Queen || type == ChessPieceType::Rook || type == ChessPieceType::Bishop || type == ChessPieceType::Knight;
+}
@@ -0,0 +1,418 @@
+﻿#include "ChessEvaluation.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+//----------------------------------------------------------------------------------------------------------
+//Built-in weights, laid out like ChessEvaluationWeights: seen from white, rank 8 first, a-file on the left
+static constexpr int s_defaultPhaseWeights[NUM_CHESS_PIECE_TYPES] = { 1, 1, 2, 4, 0, 0 };
+static constexpr int s_defaultMidgameValues[NUM_CHESS_PIECE_TYPES] = { 330, 320, 500, 900, 0, 100 };
+static constexpr int s_defaultEndgameValues[NUM_CHESS_PIECE_TYPES] = { 340, 300, 530, 930, 0, 120 };
+
+static constexpr signed char s_defaultMidgameBonuses[NUM_CHESS_PIECE_TYPES][NUM_BOARD_SQUARES] =
+{
+    //Bishop
+    {
+        -20,-10,-10,-10,-10,-10,-10,-20,
+        -10,  0,  0,  0,  0,  0,  0,-10,
+        -10,  0,  5, 10, 10,  5,  0,-10,
+        -10,  5,  5, 10, 10,  5,  5,-10,
+        -10,  0, 10, 10, 10, 10,  0,-10,
+        -10, 10, 10, 10, 10, 10, 10,-10,
+        -10,  5,  0,  0,  0,  0,  5,-10,
+        -20,-10,-10,-10,-10,-10,-10,-20,
+    },
+    //Knight
+    {
+        -50,-40,-30,-30,-30,-30,-40,-50,
+        -40,-20,  0,  0,  0,  0,-20,-40,
+        -30,  0, 10, 15, 15, 10,  0,-30,
+        -30,  5, 15, 20, 20, 15,  5,-30,
+        -30,  0, 15, 20, 20, 15,  0,-30,
+        -30,  5, 10, 15, 15, 10,  5,-30,
+        -40,-20,  0,  5,  5,  0,-20,-40,
+        -50,-40,-30,-30,-30,-30,-40,-50,
+    },
+    //Rook
+    {
+          0,  0,  0,  0,  0,  0,  0,  0,
+          5, 10, 10, 10, 10, 10, 10,  5,
+         -5,  0,  0,  0,  0,  0,  0, -5,
+         -5,  0,  0,  0,  0,  0,  0, -5,
+         -5,  0,  0,  0,  0,  0,  0, -5,
+         -5,  0,  0,  0,  0,  0,  0, -5,
+         -5,  0,  0,  0,  0,  0,  0, -5,
+          0,  0,  0,  5,  5,  0,  0,  0,
+    },
+    //Queen
+    {
+        -20,-10,-10, -5, -5,-10,-10,-20,
+        -10,  0,  0,  0,  0,  0,  0,-10,
+        -10,  0,  5,  5,  5,  5,  0,-10,
+         -5,  0,  5,  5,  5,  5,  0, -5,
+          0,  0,  5,  5,  5,  5,  0, -5,
+        -10,  5,  5,  5,  5,  5,  0,-10,
+        -10,  0,  5,  0,  0,  0,  0,-10,
+        -20,-10,-10, -5, -5,-10,-10,-20,
+    },
+    //King, tucked behind its pawns
+    {
+        -30,-40,-40,-50,-50,-40,-40,-30,
+        -30,-40,-40,-50,-50,-40,-40,-30,
+        -30,-40,-40,-50,-50,-40,-40,-30,
+        -30,-40,-40,-50,-50,-40,-40,-30,
+        -20,-30,-30,-40,-40,-30,-30,-20,
+        -10,-20,-20,-20,-20,-20,-20,-10,
+         20, 20,  0,  0,  0,  0, 20, 20,
+         20, 30, 10,  0,  0, 10, 30, 20,
+    },
+    //Pawn
+    {
+          0,  0,  0,  0,  0,  0,  0,  0,
+         50, 50, 50, 50, 50, 50, 50, 50,
+         10, 10, 20, 30, 30, 20, 10, 10,
+          5,  5, 10, 25, 25, 10,  5,  5,
+          0,  0,  0, 20, 20,  0,  0,  0,
+          5, -5,-10,  0,  0,-10, -5,  5,
+          5, 10, 10,-20,-20, 10, 10,  5,
+          0,  0,  0,  0,  0,  0,  0,  0,
+    },
+};
+
+
+static constexpr signed char s_defaultEndgameBonuses[NUM_CHESS_PIECE_TYPES][NUM_BOARD_SQUARES] =
+{
+    //Bishop
+    {
+        -20,-10,-10,-10,-10,-10,-10,-20,
+        -10,  0,  0,  0,  0,  0,  0,-10,
+        -10,  0,  5, 10, 10,  5,  0,-10,
+        -10,  5,  5, 10, 10,  5,  5,-10,
+        -10,  0, 10, 10, 10, 10,  0,-10,
+        -10, 10, 10, 10, 10, 10, 10,-10,
+        -10,  5,  0,  0,  0,  0,  5,-10,
+        -20,-10,-10,-10,-10,-10,-10,-20,
+    },
+    //Knight
+    {
+        -50,-40,-30,-30,-30,-30,-40,-50,
+        -40,-20,  0,  0,  0,  0,-20,-40,
+        -30,  0, 10, 15, 15, 10,  0,-30,
+        -30,  5, 15, 20, 20, 15,  5,-30,
+        -30,  0, 15, 20, 20, 15,  0,-30,
+        -30,  5, 10, 15, 15, 10,  5,-30,
+        -40,-20,  0,  5,  5,  0,-20,-40,
+        -50,-40,-30,-30,-30,-30,-40,-50,
+    },
+    //Rook
+    {
+          0,  0,  0,  0,  0,  0,  0,  0,
+          5, 10, 10, 10, 10, 10, 10,  5,
+         -5,  0,  0,  0,  0,  0,  0, -5,
+         -5,  0,  0,  0,  0,  0,  0, -5,
+         -5,  0,  0,  0,  0,  0,  0, -5,
+         -5,  0,  0,  0,  0,  0,  0, -5,
+         -5,  0,  0,  0,  0,  0,  0, -5,
+          0,  0,  0,  5,  5,  0,  0,  0,
+    },
+    //Queen
+    {
+        -20,-10,-10, -5, -5,-10,-10,-20,
+        -10,  0,  0,  0,  0,  0,  0,-10,
+        -10,  0,  5,  5,  5,  5,  0,-10,
+         -5,  0,  5,  5,  5,  5,  0, -5,
+          0,  0,  5,  5,  5,  5,  0, -5,
+        -10,  5,  5,  5,  5,  5,  0,-10,
+        -10,  0,  5,  0,  0,  0,  0,-10,
+        -20,-10,-10, -5, -5,-10,-10,-20,
+    },
+    //King, walks to the centre once the heavy pieces are gone
+    {
+        -50,-40,-30,-20,-20,-30,-40,-50,
+        -30,-20,-10,  0,  0,-10,-20,-30,
+        -30,-10, 20, 30, 30, 20,-10,-30,
+        -30,-10, 30, 40, 40, 30,-10,-30,
+        -30,-10, 30, 40, 40, 30,-10,-30,
+        -30,-10, 20, 30, 30, 20,-10,-30,
+        -30,-30,  0,  0,  0,  0,-30,-30,
+        -50,-30,-30,-30,-30,-30,-30,-50,
+    },
+    //Pawn, worth more the closer it gets to promoting
+    {
+          0,  0,  0,  0,  0,  0,  0,  0,
+         80, 80, 80, 80, 80, 80, 80, 80,
+         50, 50, 50, 50, 50, 50, 50, 50,
+         30, 30, 30, 30, 30, 30, 30, 30,
+         15, 15, 15, 15, 15, 15, 15, 15,
+          5,  5,  5,  5,  5,  5,  5,  5,
+          0,  0,  0,  0,  0,  0,  0,  0,
+          0,  0,  0,  0,  0,  0,  0,  0,
+    },
+};
+
+static char const* const s_pieceWeightNames[NUM_CHESS_PIECE_TYPES] = { "bishop", "knight", "rook", "queen", "king", "pawn" };
+
+static constexpr ChessEvaluationWeights MakeDefaultChessEvaluationWeights()
+{
+    ChessEvaluationWeights weights;
+    for (int typeIndex = 0; typeIndex < NUM_CHESS_PIECE_TYPES; ++typeIndex)
+    {
+        weights.m_phaseWeights[typeIndex] = s_defaultPhaseWeights[typeIndex];
+        weights.m_midgameValues[typeIndex] = s_defaultMidgameValues[typeIndex];
+        weights.m_endgameValues[typeIndex] = s_defaultEndgameValues[typeIndex];
+        for (int bonusIndex = 0; bonusIndex < NUM_BOARD_SQUARES; ++bonusIndex)
+        {
+            weights.m_midgameBonuses[typeIndex][bonusIndex] = s_defaultMidgameBonuses[typeIndex][bonusIndex];
+            weights.m_endgameBonuses[typeIndex][bonusIndex] = s_defaultEndgameBonuses[typeIndex][bonusIndex];
+        }
+    }
+    return weights;
+}
+
+static constexpr ChessEvaluationTables MakeChessEvaluationTables(ChessEvaluationWeights const& weights)
+{
+    ChessEvaluationTables tables;
+    for (int typeIndex = 0; typeIndex < NUM_CHESS_PIECE_TYPES; ++typeIndex)
+    {
+        tables.m_phaseWeights[typeIndex] = weights.m_phaseWeights[typeIndex];
+        for (int square = 0; square < NUM_BOARD_SQUARES; ++square)
+        {
+            //A white piece on square s reads bonus index s ^ 56, a black piece reads index s
+            int whiteIndex = square ^ 56;
+            tables.m_midgameScores[KISHI_WHITE][typeIndex][square] = weights.m_midgameValues[typeIndex] + weights.m_midgameBonuses[typeIndex][whiteIndex];
+            tables.m_endgameScores[KISHI_WHITE][typeIndex][square] = weights.m_endgameValues[typeIndex] + weights.m_endgameBonuses[typeIndex][whiteIndex];
+            tables.m_midgameScores[KISHI_BLACK][typeIndex][square] = -(weights.m_midgameValues[typeIndex] + weights.m_midgameBonuses[typeIndex][square]);
+            tables.m_endgameScores[KISHI_BLACK][typeIndex][square] = -(weights.m_endgameValues[typeIndex] + weights.m_endgameBonuses[typeIndex][square]);
+        }
+    }
+    return tables;
+}
+
+//Both built at compile time, so positions set up during static initialization already see the built-in weights
+static ChessEvaluationWeights s_chessEvaluationWeights = MakeDefaultChessEvaluationWeights();
+ChessEvaluationTables g_chessEvaluationTables = MakeChessEvaluationTables(s_chessEvaluationWeights);
+
+//----------------------------------------------------------------------------------------------------------
+ChessEvaluationWeights ChessEvaluationWeights::GetDefaults()
+{
+    return MakeDefaultChessEvaluationWeights();
+}
+
+//Value of name="..." (spaces allowed around the =) inside one start tag
+static bool GetTagAttribute(std::string const& tag, char const* name, std::string& out_value)
+{
+    std::string key = std::string(" ") + name;
+    size_t keyPos = tag.find(key);
+    while (keyPos != std::string::npos)
+    {
+        size_t valuePos = tag.find_first_not_of(" \t\r\n", keyPos + key.size());
+        if (valuePos != std::string::npos && tag[valuePos] == '=')
+        {
+            size_t quotePos = tag.find_first_not_of(" \t\r\n", valuePos + 1);
+            size_t closingQuotePos = (quotePos != std::string::npos && tag[quotePos] == '"') ? tag.find('"', quotePos + 1) : std::string::npos;
+            if (closingQuotePos == std::string::npos)
+            {
+                return false;
+            }
+            out_value = tag.substr(quotePos + 1, closingQuotePos - quotePos - 1);
+            return true;
+        }
+        keyPos = tag.find(key, keyPos + 1);
+    }
+    return false;
+}
+
+static bool GetTagIntAttribute(std::string const& tag, char const* name, int& out_value)
+{
+    std::string text;
+    if (!GetTagAttribute(tag, name, text))
+    {
+        return false;
+    }
+    char* end = nullptr;
+    long value = strtol(text.c_str(), &end, 10);
+    if (end == text.c_str() || *end != '\0')
+    {
+        return false;
+    }
+    out_value = (int)value;
+    return true;
+}
+
+//Reads the 64 numbers between <elementName> and </elementName> inside body
+static bool ParseBonuses(std::string const& body, std::string const& elementName, int* out_bonuses)
+{
+    size_t openPos = body.find("<" + elementName + ">");
+    size_t closePos = body.find("</" + elementName + ">");
+    if (openPos == std::string::npos || closePos == std::string::npos || closePos < openPos)
+    {
+        return false;
+    }
+    std::istringstream numbers(body.substr(openPos + elementName.size() + 2, closePos - openPos - elementName.size() - 2));
+    for (int bonusIndex = 0; bonusIndex < NUM_BOARD_SQUARES; ++bonusIndex)
+    {
+        if (!(numbers >> out_bonuses[bonusIndex]))
+        {
+            return false;
+        }
+    }
+    std::string leftover;
+    return !(numbers >> leftover);
+}
+
+bool ChessEvaluationWeights::LoadFromFile(std::string const& path, std::string& out_error)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        out_error = "cannot open " + path;
+        return false;
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    std::string text = contents.str();
+    for (size_t commentPos = text.find("<!--"); commentPos != std::string::npos; commentPos = text.find("<!--", commentPos))
+    {
+        size_t commentEnd = text.find("-->", commentPos);
+        text.erase(commentPos, (commentEnd == std::string::npos) ? std::string::npos : commentEnd + 3 - commentPos);
+    }
+
+    ChessEvaluationWeights loaded = *this;
+    bool isPieceLoaded[NUM_CHESS_PIECE_TYPES] = {};
+    for (size_t tagPos = text.find("<PieceWeights"); tagPos != std::string::npos; tagPos = text.find("<PieceWeights", tagPos + 1))
+    {
+        size_t tagEnd = text.find('>', tagPos);
+        size_t elementEnd = text.find("</PieceWeights>", tagPos);
+        if (tagEnd == std::string::npos || elementEnd == std::string::npos)
+        {
+            out_error = path + " has an unterminated PieceWeights element";
+            return false;
+        }
+        std::string tag = text.substr(tagPos, tagEnd - tagPos);
+        std::string body = text.substr(tagEnd + 1, elementEnd - tagEnd - 1);
+
+        std::string name;
+        GetTagAttribute(tag, "name", name);
+        int typeIndex = 0;
+        while (typeIndex < NUM_CHESS_PIECE_TYPES && name != s_pieceWeightNames[typeIndex])
+        {
+            ++typeIndex;
+        }
+        if (typeIndex == NUM_CHESS_PIECE_TYPES)
+        {
+            out_error = path + " has weights for an unknown piece \"" + name + "\"";
+            return false;
+        }
+        if (!GetTagIntAttribute(tag, "phase", loaded.m_phaseWeights[typeIndex])
+            || !GetTagIntAttribute(tag, "midgameValue", loaded.m_midgameValues[typeIndex])
+            || !GetTagIntAttribute(tag, "endgameValue", loaded.m_endgameValues[typeIndex]))
+        {
+            out_error = path + ": " + name + " needs integer phase, midgameValue and endgameValue attributes";
+            return false;
+        }
+        if (!ParseBonuses(body, "MidgameBonuses", loaded.m_midgameBonuses[typeIndex])
+            || !ParseBonuses(body, "EndgameBonuses", loaded.m_endgameBonuses[typeIndex]))
+        {
+            out_error = path + ": " + name + " needs 64 MidgameBonuses and 64 EndgameBonuses";
+            return false;
+        }
+        isPieceLoaded[typeIndex] = true;
+    }
+    for (int typeIndex = 0; typeIndex < NUM_CHESS_PIECE_TYPES; ++typeIndex)
+    {
+        if (!isPieceLoaded[typeIndex])
+        {
+            out_error = path + " has no weights for " + s_pieceWeightNames[typeIndex];
+            return false;
+        }
+    }
+    *this = loaded;
+    return true;
+}
+
+static void WriteBonuses(std::ofstream& file, char const* elementName, int const* bonuses)
+{
+    file << "    <" << elementName << ">\n";
+    for (int y = 0; y < BOARD_SIZE; ++y)
+    {
+        file << "     ";
+        for (int x = 0; x < BOARD_SIZE; ++x)
+        {
+            char number[8];
+            snprintf(number, sizeof(number), " %4d", bonuses[y * BOARD_SIZE + x]);
+            file << number;
+        }
+        file << "\n";
+    }
+    file << "    </" << elementName << ">\n";
+}
+
+bool ChessEvaluationWeights::SaveToFile(std::string const& path) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        return false;
+    }
+    file << "<ChessEvaluation>\n";
+    file << "  <!-- Bonuses are seen from white, rank 8 on the first line and the a-file first; black reads them mirrored.\n";
+    file << "       phase is what the piece adds to the game phase, " << CHESS_MAX_GAME_PHASE << " or more scores as pure midgame -->\n";
+    for (int typeIndex = 0; typeIndex < NUM_CHESS_PIECE_TYPES; ++typeIndex)
+    {
+        file << "  <PieceWeights name=\"" << s_pieceWeightNames[typeIndex] << "\" phase=\"" << m_phaseWeights[typeIndex]
+            << "\" midgameValue=\"" << m_midgameValues[typeIndex] << "\" endgameValue=\"" << m_endgameValues[typeIndex] << "\">\n";
+        WriteBonuses(file, "MidgameBonuses", m_midgameBonuses[typeIndex]);
+        WriteBonuses(file, "EndgameBonuses", m_endgameBonuses[typeIndex]);
+        file << "  </PieceWeights>\n";
+    }
+    file << "</ChessEvaluation>\n";
+    return (bool)file;
+}
+
+//----------------------------------------------------------------------------------------------------------
+void SetChessEvaluationWeights(ChessEvaluationWeights const& weights)
+{
+    s_chessEvaluationWeights = weights;
+    g_chessEvaluationTables = MakeChessEvaluationTables(weights);
+}
+
+ChessEvaluationWeights const& GetChessEvaluationWeights()
+{
+    return s_chessEvaluationWeights;
+}
+
+int GetChessPieceSquareScore(int kishiID, ChessPieceType type, int square)
+{
+    int score = g_chessEvaluationTables.m_midgameScores[kishiID][(int)type][square];
+    return (kishiID == KISHI_WHITE) ? score : -score;
+}
+
+void ComputeChessEvaluationScores(ChessPosition const& position, int& out_midgameScore, int& out_endgameScore, int& out_gamePhase)
+{
+    out_midgameScore = 0;
+    out_endgameScore = 0;
+    out_gamePhase = 0;
+    for (int kishiIndex = 0; kishiIndex < NUM_KISHI; ++kishiIndex)
+    {
+        for (int typeIndex = 0; typeIndex < NUM_CHESS_PIECE_TYPES; ++typeIndex)
+        {
+            Bitboard pieces = position.m_pieces[kishiIndex][typeIndex];
+            while (pieces)
+            {
+                int square = PopLowestSquare(pieces);
+                out_midgameScore += g_chessEvaluationTables.m_midgameScores[kishiIndex][typeIndex][square];
+                out_endgameScore += g_chessEvaluationTables.m_endgameScores[kishiIndex][typeIndex][square];
+                out_gamePhase += g_chessEvaluationTables.m_phaseWeights[typeIndex];
+            }
+        }
+    }
+}
+
+int EvaluateChessPosition(ChessPosition const& position)
+{
+    int phase = (position.m_gamePhase < CHESS_MAX_GAME_PHASE) ? position.m_gamePhase : CHESS_MAX_GAME_PHASE;
+    int whiteScore = (position.m_midgameScore * phase + position.m_endgameScore * (CHESS_MAX_GAME_PHASE - phase)) / CHESS_MAX_GAME_PHASE;
+    return (position.m_sideToMove == KISHI_WHITE) ? whiteScore : -whiteScore;
+}
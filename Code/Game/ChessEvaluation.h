@@ -0,0 +1,52 @@
+﻿#pragma once
+#include "ChessPosition.h"
+
+#include <string>
+
+//Nominal centipawn values indexed by ChessPieceType, for move ordering; the king is never traded so it counts for nothing.
+//The evaluation itself uses the tunable values in ChessEvaluationWeights
+constexpr int CHESS_PIECE_VALUES[NUM_CHESS_PIECE_TYPES] = { 330, 320, 500, 900, 0, 100 };
+
+constexpr int CHESS_MAX_GAME_PHASE = 24; //phase of the starting material, a position at or above it is pure midgame
+
+//----------------------------------------------------------------------------------------------------------
+//Tapered piece-square weights: per piece type a midgame and an endgame value, square bonuses for both, and what the
+//piece adds to the game phase. Bonuses are seen from white and laid out as the board is drawn, rank 8 first; black
+//reads them mirrored onto its side. The game loads them from Data/Definitions/ChessEvaluation.xml
+struct ChessEvaluationWeights
+{
+    int m_phaseWeights[NUM_CHESS_PIECE_TYPES] = {};
+    int m_midgameValues[NUM_CHESS_PIECE_TYPES] = {};
+    int m_endgameValues[NUM_CHESS_PIECE_TYPES] = {};
+    int m_midgameBonuses[NUM_CHESS_PIECE_TYPES][NUM_BOARD_SQUARES] = {};
+    int m_endgameBonuses[NUM_CHESS_PIECE_TYPES][NUM_BOARD_SQUARES] = {};
+
+    static ChessEvaluationWeights GetDefaults(); //the built-in weights, what the game uses without a weights file
+
+    //ChessCore stays engine-free, so this reads only the small format SaveToFile writes rather than general XML.
+    //Leaves the weights untouched and fills out_error if the file is missing or incomplete
+    bool LoadFromFile(std::string const& path, std::string& out_error);
+    bool SaveToFile(std::string const& path) const;
+};
+
+//What ChessPosition::PutPiece and RemovePiece add to a position's running scores, built from the weights in use.
+//White pieces count positive and black pieces negative
+struct ChessEvaluationTables
+{
+    int m_midgameScores[NUM_KISHI][NUM_CHESS_PIECE_TYPES][NUM_BOARD_SQUARES] = {};
+    int m_endgameScores[NUM_KISHI][NUM_CHESS_PIECE_TYPES][NUM_BOARD_SQUARES] = {};
+    int m_phaseWeights[NUM_CHESS_PIECE_TYPES] = {};
+};
+
+extern ChessEvaluationTables g_chessEvaluationTables;
+
+//Positions keep the scores they were built with, so only swap weights while nothing searches and before setting up
+//the positions to evaluate; the game does it once at startup
+void SetChessEvaluationWeights(ChessEvaluationWeights const& weights);
+ChessEvaluationWeights const& GetChessEvaluationWeights();
+
+//Blends the position's running midgame and endgame scores by its phase: O(1), in centipawns from the side to move's point of view
+int EvaluateChessPosition(ChessPosition const& position);
+//Full recomputation from the board, white minus black; ChessPosition keeps the same three numbers incrementally
+void ComputeChessEvaluationScores(ChessPosition const& position, int& out_midgameScore, int& out_endgameScore, int& out_gamePhase);
+int GetChessPieceSquareScore(int kishiID, ChessPieceType type, int square); //midgame value plus bonus of one piece for its own side
@@ -1,4 +1,7 @@
 ﻿#include "ChessKishi.h"
+#include "ChessSearchWorker.h"
+
+#include <chrono>
 
 ChessKishi::ChessKishi(int playerID, std::string name)
     : m_playerId(playerID)
@@ -16,4 +19,24 @@ ChessKishi::ChessKishi(int playerID, std::string name)
 
 ChessKishi::~ChessKishi()
 {
+    DisableAI();
+}
+
+void ChessKishi::EnableAI(ChessSearchLimits const& limits, int hashMB, ChessNNUENetwork const* network)
+{
+    DisableAI();
+    m_searchWorker = new ChessSearchWorker(hashMB, network);
+    m_searchLimits = limits;
+    m_bookRandomState = (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count() ^ (uint64_t)m_playerId;
+}
+
+void ChessKishi::DisableAI()
+{
+    delete m_searchWorker; //stops the search and joins the thread
+    m_searchWorker = nullptr;
+    m_isThinking = false;
+    m_thinkingKey = 0;
+    m_hasPonderMove = false;
+    m_isPondering = false;
+    m_isPonderHit = false;
 }
@@ -3,11 +3,15 @@
 #include <vector>
 
 #include "Gamecommon.hpp"
+#include "ChessSearch.h"
+
+class ChessSearchWorker;
 
 class ChessKishi
 {
     friend class ChessBoard;
     friend class ChessPiece;
+    friend class ChessReferee;
 public:
     ChessKishi(int playerID, std::string name = "Hikari");
     ~ChessKishi();
@@ -15,9 +19,33 @@ public:
     int GetPlayerID() const {return m_playerId;}
     std::string GetName() const {return m_name;}
 
+    //AI control: the referee starts a search on the worker thread when it is this kishi's turn and plays the result
+    void EnableAI(ChessSearchLimits const& limits, int hashMB, ChessNNUENetwork const* network);
+    void DisableAI();
+    bool IsAI() const { return m_searchWorker != nullptr; }
+
 public:
     ChessPiece* m_lastMovedPiece = nullptr;
 
+    ChessSearchWorker* m_searchWorker = nullptr; //null for a human kishi
+    ChessSearchLimits m_searchLimits;
+    bool m_isThinking = false;
+    uint64_t m_thinkingKey = 0; //position the running search was started on
+    bool m_isUsingBook = true; //plays a g_theGame->m_openingBook move without searching while the position is in the book
+    uint64_t m_bookRandomState = 0; //splitmix64 state for choosing between book moves, seeded by EnableAI
+
+    //Pondering: while a human or remote opponent thinks, the worker searches the reply the last search expected
+    bool m_isPonderEnabled = true;
+    bool m_hasPonderMove = false;
+    ChessMove m_ponderMove;
+    uint64_t m_ponderFromKey = 0; //position m_ponderMove is a reply to, the one our move left
+    bool m_isPondering = false; //the running search is on the predicted position and waits for the opponent
+    bool m_isPonderHit = false; //the running search pondered the position that came up and is finishing under the limits
+    std::chrono::steady_clock::time_point m_ponderHitTime;
+    int m_numPonders = 0; //opponent moves that arrived while pondering, hit or miss
+    int m_numPonderHits = 0;
+    int64_t m_ponderSavedMilliseconds = 0; //search time the hits had done before it was our turn
+
 protected:
     int m_playerId;
     std::string m_name;
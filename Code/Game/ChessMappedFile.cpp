@@ -0,0 +1,94 @@
+﻿#include "ChessMappedFile.h"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+ChessMappedFile::~ChessMappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+bool ChessMappedFile::Open(std::string const& path)
+{
+    Close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* data = (mapping != nullptr) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (data == nullptr)
+    {
+        if (mapping != nullptr)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    m_fileHandle = file;
+    m_mappingHandle = mapping;
+    m_data = (unsigned char const*)data;
+    m_size = (uint64_t)size.QuadPart;
+    return true;
+}
+
+void ChessMappedFile::Close()
+{
+    if (m_data != nullptr)
+        UnmapViewOfFile(m_data);
+    if (m_mappingHandle != nullptr)
+        CloseHandle(m_mappingHandle);
+    if (m_fileHandle != nullptr)
+        CloseHandle(m_fileHandle);
+    m_data = nullptr;
+    m_size = 0;
+    m_fileHandle = nullptr;
+    m_mappingHandle = nullptr;
+}
+#else
+bool ChessMappedFile::Open(std::string const& path)
+{
+    Close();
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat fileStats;
+    if (fstat(file, &fileStats) != 0 || fileStats.st_size == 0)
+    {
+        close(file);
+        return false;
+    }
+    void* data = mmap(nullptr, (size_t)fileStats.st_size, PROT_READ, MAP_SHARED, file, 0);
+    close(file); //the mapping keeps its own reference to the file
+    if (data == MAP_FAILED)
+        return false;
+
+    madvise(data, (size_t)fileStats.st_size, MADV_RANDOM); //probes jump around, reading ahead would only waste memory
+    m_data = (unsigned char const*)data;
+    m_size = (uint64_t)fileStats.st_size;
+    return true;
+}
+
+void ChessMappedFile::Close()
+{
+    if (m_data != nullptr)
+        munmap((void*)m_data, (size_t)m_size);
+    m_data = nullptr;
+    m_size = 0;
+}
+#endif
@@ -0,0 +1,30 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+
+//----------------------------------------------------------------------------------------------------------
+//Read-only mapping of a whole file. Nothing is read at Open: the OS pages the file in as it is touched, so a
+//lookup costs at most the one page it reads and the file never has to fit in RAM
+class ChessMappedFile
+{
+public:
+    ChessMappedFile() = default;
+    ~ChessMappedFile();
+    ChessMappedFile(ChessMappedFile const&) = delete;
+    ChessMappedFile& operator=(ChessMappedFile const&) = delete;
+
+    bool Open(std::string const& path); //closes any file mapped before, false if the file cannot be mapped
+    void Close();
+
+    bool IsOpen() const { return m_data != nullptr; }
+    unsigned char const* GetData() const { return m_data; }
+    uint64_t GetSize() const { return m_size; }
+
+private:
+    unsigned char const* m_data = nullptr;
+    uint64_t m_size = 0;
+#ifdef _WIN32
+    void* m_fileHandle = nullptr;
+    void* m_mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,360 @@
+﻿#include "ChessMoveGen.h"
+
+#include <cstdlib>
+
+//----------------------------------------------------------------------------------------------------------
+void ChessMoveList::Add(int from, int to, ChessMoveResult result, ChessPieceType promoteTo)
+{
+    ChessMove& move = m_moves[m_numMoves++];
+    move.m_from = (unsigned char)from;
+    move.m_to = (unsigned char)to;
+    move.m_result = result;
+    move.m_promoteTo = promoteTo;
+}
+
+ChessMove const* ChessMoveList::Find(int from, int to, ChessPieceType promoteTo) const
+{
+    for (ChessMove const& move : *this)
+    {
+        if (move.m_from == from && move.m_to == to &&
+            (promoteTo == ChessPieceType::Count || move.m_promoteTo == ChessPieceType::Count || move.m_promoteTo == promoteTo))
+        {
+            return &move;
+        }
+    }
+    return nullptr;
+}
+
+//----------------------------------------------------------------------------------------------------------
+static Bitboard GetPieceAttacks(ChessPieceType type, int square, Bitboard occupied)
+{
+    switch (type)
+    {
+    case ChessPieceType::Bishop: return GetBishopAttacks(square, occupied);
+    case ChessPieceType::Knight: return GetKnightAttacks(square);
+    case ChessPieceType::Rook:   return GetRookAttacks(square, occupied);
+    case ChessPieceType::Queen:  return GetQueenAttacks(square, occupied);
+    case ChessPieceType::King:   return GetKingAttacks(square);
+    default:                     return 0;
+    }
+}
+
+static void AddPawnMove(ChessMoveList& out_moves, int from, int to, bool isCapture)
+{
+    if (GetSquareBit(to) & (RANK_1_BITS | RANK_8_BITS))
+    {
+        out_moves.Add(from, to, ChessMoveResult::VALID_MOVE_PROMOTION, ChessPieceType::Queen);
+        out_moves.Add(from, to, ChessMoveResult::VALID_MOVE_PROMOTION, ChessPieceType::Rook);
+        out_moves.Add(from, to, ChessMoveResult::VALID_MOVE_PROMOTION, ChessPieceType::Bishop);
+        out_moves.Add(from, to, ChessMoveResult::VALID_MOVE_PROMOTION, ChessPieceType::Knight);
+    }
+    else
+    {
+        out_moves.Add(from, to, isCapture ? ChessMoveResult::VALID_CAPTURE_NORMAL : ChessMoveResult::VALID_MOVE_NORMAL);
+    }
+}
+
+static bool IsEnPassantLegal(ChessPosition const& position, int from, int to, int kingSquare)
+{
+    //The only move that empties two squares of one rank at once, so test the resulting occupancy directly
+    int us = position.m_sideToMove;
+    int them = 1 - us;
+    int capturedSquare = GetSquareAt(GetSquareX(to), GetSquareY(from));
+    Bitboard occupied = (position.GetOccupied() ^ GetSquareBit(from) ^ GetSquareBit(capturedSquare)) | GetSquareBit(to);
+    Bitboard attackers = position.GetAttackersTo(kingSquare, occupied) & position.GetKishiPieces(them) & ~GetSquareBit(capturedSquare);
+    return attackers == 0;
+}
+
+static void GenerateCastles(ChessPosition const& position, ChessMoveList& out_moves)
+{
+    int us = position.m_sideToMove;
+    int them = 1 - us;
+    int homeY = (us == KISHI_WHITE) ? 0 : BOARD_SIZE - 1;
+    int kingSquare = GetSquareAt(4, homeY);
+    unsigned char kingside = (us == KISHI_WHITE) ? CASTLE_WHITE_KINGSIDE : CASTLE_BLACK_KINGSIDE;
+    unsigned char queenside = (us == KISHI_WHITE) ? CASTLE_WHITE_QUEENSIDE : CASTLE_BLACK_QUEENSIDE;
+    Bitboard rooks = position.GetPieces(us, ChessPieceType::Rook);
+
+    if (position.HasCastlingRight(kingside) && (rooks & GetSquareBit(GetSquareAt(7, homeY))) &&
+        (position.GetOccupied() & GetBetweenBits(kingSquare, GetSquareAt(7, homeY))) == 0 &&
+        !position.IsSquareAttacked(GetSquareAt(5, homeY), them) && !position.IsSquareAttacked(GetSquareAt(6, homeY), them))
+    {
+        out_moves.Add(kingSquare, GetSquareAt(6, homeY), ChessMoveResult::VALID_CASTLE_KINGSIDE);
+    }
+    if (position.HasCastlingRight(queenside) && (rooks & GetSquareBit(GetSquareAt(0, homeY))) &&
+        (position.GetOccupied() & GetBetweenBits(kingSquare, GetSquareAt(0, homeY))) == 0 &&
+        !position.IsSquareAttacked(GetSquareAt(3, homeY), them) && !position.IsSquareAttacked(GetSquareAt(2, homeY), them))
+    {
+        out_moves.Add(kingSquare, GetSquareAt(2, homeY), ChessMoveResult::VALID_CASTLE_QUEENSIDE);
+    }
+}
+
+void GenerateLegalMoves(ChessPosition const& position, ChessMoveList& out_moves)
+{
+    out_moves.Clear();
+
+    int const us = position.m_sideToMove;
+    int const them = 1 - us;
+    int const kingSquare = position.GetKingSquare(us);
+    if (kingSquare == NO_SQUARE)
+    {
+        return;
+    }
+
+    Bitboard const occupied = position.GetOccupied();
+    Bitboard const ours = position.GetKishiPieces(us);
+    Bitboard const theirs = position.GetKishiPieces(them);
+    Bitboard const checkers = position.GetAttackersTo(kingSquare, occupied) & theirs;
+
+    //King steps, tested with the king lifted off the board so it cannot hide behind itself on a slider ray
+    Bitboard const occupiedWithoutKing = occupied ^ GetSquareBit(kingSquare);
+    Bitboard kingTargets = GetKingAttacks(kingSquare) & ~ours;
+    while (kingTargets)
+    {
+        int to = PopLowestSquare(kingTargets);
+        if ((position.GetAttackersTo(to, occupiedWithoutKing) & theirs) == 0)
+        {
+            out_moves.Add(kingSquare, to, (theirs & GetSquareBit(to)) ? ChessMoveResult::VALID_CAPTURE_NORMAL : ChessMoveResult::VALID_MOVE_NORMAL);
+        }
+    }
+
+    if (CountBits(checkers) > 1)
+    {
+        return; //double check, only the king can move
+    }
+
+    //Single check: capture the checker or block its ray
+    Bitboard checkMask = ~0ull;
+    if (checkers)
+    {
+        int checkerSquare = GetLowestSquare(checkers);
+        checkMask = checkers | GetBetweenBits(kingSquare, checkerSquare);
+    }
+
+    //Pinned pieces may only move along the line through their king and the pinner
+    Bitboard pinned = 0;
+    Bitboard snipers = ((GetRookAttacks(kingSquare, theirs) & (position.GetPieces(them, ChessPieceType::Rook) | position.GetPieces(them, ChessPieceType::Queen)))
+                      | (GetBishopAttacks(kingSquare, theirs) & (position.GetPieces(them, ChessPieceType::Bishop) | position.GetPieces(them, ChessPieceType::Queen))));
+    while (snipers)
+    {
+        int sniperSquare = PopLowestSquare(snipers);
+        Bitboard blockers = GetBetweenBits(kingSquare, sniperSquare) & occupied;
+        if (CountBits(blockers) == 1 && (blockers & ours))
+        {
+            pinned |= blockers;
+        }
+    }
+
+    //Knights, bishops, rooks and queens
+    for (int typeIndex = 0; typeIndex < NUM_CHESS_PIECE_TYPES; ++typeIndex)
+    {
+        ChessPieceType type = (ChessPieceType)typeIndex;
+        if (type == ChessPieceType::King || type == ChessPieceType::Pawn)
+        {
+            continue;
+        }
+        Bitboard pieces = position.GetPieces(us, type);
+        while (pieces)
+        {
+            int from = PopLowestSquare(pieces);
+            Bitboard targets = GetPieceAttacks(type, from, occupied) & ~ours & checkMask;
+            if (pinned & GetSquareBit(from))
+            {
+                targets &= GetLineBits(kingSquare, from);
+            }
+            while (targets)
+            {
+                int to = PopLowestSquare(targets);
+                out_moves.Add(from, to, (theirs & GetSquareBit(to)) ? ChessMoveResult::VALID_CAPTURE_NORMAL : ChessMoveResult::VALID_MOVE_NORMAL);
+            }
+        }
+    }
+
+    //Pawns
+    int const forward = (us == KISHI_WHITE) ? BOARD_SIZE : -BOARD_SIZE;
+    Bitboard const doublePushRank = (us == KISHI_WHITE) ? (RANK_1_BITS << 16) : (RANK_1_BITS << 40); //where a pawn lands after its first step
+    Bitboard pawns = position.GetPieces(us, ChessPieceType::Pawn);
+    while (pawns)
+    {
+        int from = PopLowestSquare(pawns);
+        Bitboard pinMask = (pinned & GetSquareBit(from)) ? GetLineBits(kingSquare, from) : ~0ull;
+
+        int oneStep = from + forward;
+        if ((occupied & GetSquareBit(oneStep)) == 0)
+        {
+            if (GetSquareBit(oneStep) & checkMask & pinMask)
+            {
+                AddPawnMove(out_moves, from, oneStep, false);
+            }
+            int twoStep = oneStep + forward;
+            if ((GetSquareBit(oneStep) & doublePushRank) && (occupied & GetSquareBit(twoStep)) == 0 &&
+                (GetSquareBit(twoStep) & checkMask & pinMask))
+            {
+                out_moves.Add(from, twoStep, ChessMoveResult::VALID_MOVE_PAWN_2SQUARE);
+            }
+        }
+
+        Bitboard captures = GetPawnAttacks(us, from) & theirs & checkMask & pinMask;
+        while (captures)
+        {
+            AddPawnMove(out_moves, from, PopLowestSquare(captures), true);
+        }
+
+        if (position.m_enPassantSquare != NO_SQUARE && (GetPawnAttacks(us, from) & GetSquareBit(position.m_enPassantSquare)) &&
+            IsEnPassantLegal(position, from, position.m_enPassantSquare, kingSquare))
+        {
+            out_moves.Add(from, position.m_enPassantSquare, ChessMoveResult::VALID_CAPTURE_ENPASSANT);
+        }
+    }
+
+    if (!checkers)
+    {
+        GenerateCastles(position, out_moves);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------
+Bitboard GetLegalTargets(ChessPosition const& position, int from)
+{
+    if (position.IsEmpty(from) || position.GetKishiAt(from) != position.m_sideToMove)
+    {
+        return 0;
+    }
+    ChessMoveList moves;
+    GenerateLegalMoves(position, moves);
+    Bitboard targets = 0;
+    for (ChessMove const& move : moves)
+    {
+        if (move.m_from == from)
+        {
+            targets |= GetSquareBit(move.m_to);
+        }
+    }
+    return targets;
+}
+
+//----------------------------------------------------------------------------------------------------------
+//Pawn geometry per kishi, black moves down the board
+static int const PAWN_STEP[NUM_KISHI] = { -BOARD_SIZE, BOARD_SIZE };
+static int const PAWN_START_Y[NUM_KISHI] = { BOARD_SIZE - 2, 1 };
+static int const PAWN_EN_PASSANT_Y[NUM_KISHI] = { 3, BOARD_SIZE - 4 }; //rank a pawn must stand on to take en passant
+static Bitboard const PAWN_PROMOTION_RANK[NUM_KISHI] = { RANK_1_BITS, RANK_8_BITS };
+
+static ChessMoveResult ClassifyPawnMove(ChessPosition const& position, int us, int from, int to)
+{
+    Bitboard const toBit = GetSquareBit(to);
+    bool const reachesLastRank = (toBit & PAWN_PROMOTION_RANK[us]) != 0;
+    int const step = PAWN_STEP[us];
+
+    if (to == from + step)
+    {
+        if (!position.IsEmpty(to))
+            return ChessMoveResult::INVALID_MOVE_PAWN_BLOCKED;
+        return reachesLastRank ? ChessMoveResult::VALID_MOVE_PROMOTION : ChessMoveResult::VALID_MOVE_NORMAL;
+    }
+    if (to == from + 2 * step && GetSquareY(from) == PAWN_START_Y[us])
+    {
+        if (!position.IsEmpty(from + step))
+            return ChessMoveResult::INVALID_MOVE_PATH_BLOCKED;
+        if (!position.IsEmpty(to))
+            return ChessMoveResult::INVALID_MOVE_PAWN_BLOCKED;
+        return ChessMoveResult::VALID_MOVE_PAWN_2SQUARE;
+    }
+    if (GetPawnAttacks(us, from) & toBit)
+    {
+        if (position.GetKishiPieces(1 - us) & toBit)
+            return reachesLastRank ? ChessMoveResult::VALID_MOVE_PROMOTION : ChessMoveResult::VALID_CAPTURE_NORMAL;
+        if (to == position.m_enPassantSquare)
+            return ChessMoveResult::VALID_CAPTURE_ENPASSANT;
+
+        //An enemy pawn beside us that did not double-push on the last move can no longer be taken en passant
+        int besideSquare = GetSquareAt(GetSquareX(to), GetSquareY(from));
+        if (GetSquareY(from) == PAWN_EN_PASSANT_Y[us] && (position.GetPieces(1 - us, ChessPieceType::Pawn) & GetSquareBit(besideSquare)))
+            return ChessMoveResult::INVALID_ENPASSANT_STALE;
+    }
+    return ChessMoveResult::INVALID_MOVE_WRONG_MOVE_SHAPE;
+}
+
+static ChessMoveResult ClassifyCastle(ChessPosition const& position, int us, int from, int to)
+{
+    int const them = 1 - us;
+    bool const isKingside = GetSquareX(to) > GetSquareX(from);
+    unsigned char const bothRights = (us == KISHI_WHITE) ? (CASTLE_WHITE_KINGSIDE | CASTLE_WHITE_QUEENSIDE) : (CASTLE_BLACK_KINGSIDE | CASTLE_BLACK_QUEENSIDE);
+    unsigned char const right = bothRights & (isKingside ? (CASTLE_WHITE_KINGSIDE | CASTLE_BLACK_KINGSIDE) : (CASTLE_WHITE_QUEENSIDE | CASTLE_BLACK_QUEENSIDE));
+    int const rookSquare = GetSquareAt(isKingside ? BOARD_SIZE - 1 : 0, GetSquareY(from));
+
+    //Moving the king drops both rights, moving (or losing) one rook drops only its own
+    if (!position.HasCastlingRight(right))
+        return position.HasCastlingRight(bothRights) ? ChessMoveResult::INVALID_CASTLE_ROOK_HAS_MOVED : ChessMoveResult::INVALID_CASTLE_KING_HAS_MOVED;
+    if (position.GetOccupied() & GetBetweenBits(from, rookSquare))
+        return ChessMoveResult::INVALID_CASTLE_PATH_BLOCKED;
+    if (position.IsInCheck(us))
+        return ChessMoveResult::INVALID_CASTLE_OUT_OF_CHECK;
+    if (position.IsSquareAttacked((from + to) / 2, them) || position.IsSquareAttacked(to, them))
+        return ChessMoveResult::INVALID_CASTLE_THROUGH_CHECK;
+    return isKingside ? ChessMoveResult::VALID_CASTLE_KINGSIDE : ChessMoveResult::VALID_CASTLE_QUEENSIDE;
+}
+
+ChessMoveResult ClassifyChessMove(ChessPosition const& position, int from, int to, ChessPieceType promoteTo)
+{
+    if (from < 0 || from >= NUM_BOARD_SQUARES || to < 0 || to >= NUM_BOARD_SQUARES)
+        return ChessMoveResult::INVALID_MOVE_BAD_LOCATION;
+    if (from == to)
+        return ChessMoveResult::INVALID_MOVE_ZERO_DISTANCE;
+    if (position.IsEmpty(from))
+        return ChessMoveResult::INVALID_MOVE_NO_PIECE;
+
+    int const us = position.GetKishiAt(from);
+    int const them = 1 - us;
+    Bitboard const toBit = GetSquareBit(to);
+    Bitboard const occupied = position.GetOccupied();
+    Bitboard const theirs = position.GetKishiPieces(them);
+    if (us != position.m_sideToMove)
+        return ChessMoveResult::INVALID_MOVE_NOT_YOUR_PIECE;
+    if (position.GetKishiPieces(us) & toBit)
+        return ChessMoveResult::INVALID_MOVE_DESTINATION_BLOCKED;
+
+    ChessPieceType const type = position.GetPieceTypeAt(from);
+    int const homeY = (us == KISHI_WHITE) ? 0 : BOARD_SIZE - 1;
+    if (type == ChessPieceType::King && from == GetSquareAt(4, homeY) && GetSquareY(to) == homeY && abs(GetSquareX(to) - GetSquareX(from)) == 2)
+    {
+        return ClassifyCastle(position, us, from, to);
+    }
+
+    //Shape comes from the empty-board attack tables, blocking from the same tables with the real occupancy
+    ChessMoveResult result;
+    if (type == ChessPieceType::Pawn)
+    {
+        result = ClassifyPawnMove(position, us, from, to);
+        if (!IsValidChessMoveResult(result))
+            return result;
+        if (result == ChessMoveResult::VALID_MOVE_PROMOTION && promoteTo != ChessPieceType::Count && !IsPromotionChoice(promoteTo))
+            return ChessMoveResult::INVALID_MOVE_NO_PROMOTION;
+    }
+    else
+    {
+        if ((GetPieceAttacks(type, from, 0) & toBit) == 0)
+            return ChessMoveResult::INVALID_MOVE_WRONG_MOVE_SHAPE;
+        if ((GetPieceAttacks(type, from, occupied) & toBit) == 0)
+            return ChessMoveResult::INVALID_MOVE_PATH_BLOCKED;
+        result = (theirs & toBit) ? ChessMoveResult::VALID_CAPTURE_NORMAL : ChessMoveResult::VALID_MOVE_NORMAL;
+    }
+
+    //Check rules: look at the attackers with the post-move occupancy instead of making the move
+    if (type == ChessPieceType::King)
+    {
+        if (GetKingAttacks(to) & position.GetPieces(them, ChessPieceType::King))
+            return ChessMoveResult::INVALID_MOVE_KING_TOGETHER;
+        if (position.GetAttackersTo(to, occupied ^ GetSquareBit(from)) & theirs & ~toBit)
+            return ChessMoveResult::INVALID_MOVE_ENDS_IN_CHECK;
+        return result;
+    }
+    int const kingSquare = position.GetKingSquare(us);
+    if (kingSquare == NO_SQUARE)
+        return result;
+    if (result == ChessMoveResult::VALID_CAPTURE_ENPASSANT)
+        return IsEnPassantLegal(position, from, to, kingSquare) ? result : ChessMoveResult::INVALID_MOVE_ENDS_IN_CHECK;
+    if (position.GetAttackersTo(kingSquare, (occupied ^ GetSquareBit(from)) | toBit) & theirs & ~toBit)
+        return ChessMoveResult::INVALID_MOVE_ENDS_IN_CHECK;
+    return result;
+}
@@ -0,0 +1,28 @@
+﻿#pragma once
+#include "ChessPosition.h"
+
+constexpr int MAX_CHESS_MOVES = 256; //no legal position has more than 218
+
+struct ChessMoveList
+{
+    ChessMove m_moves[MAX_CHESS_MOVES];
+    int m_numMoves = 0;
+
+    void Clear() { m_numMoves = 0; }
+    void Add(int from, int to, ChessMoveResult result, ChessPieceType promoteTo = ChessPieceType::Count);
+    int Size() const { return m_numMoves; }
+    ChessMove const& operator[](int index) const { return m_moves[index]; }
+    ChessMove const* begin() const { return m_moves; }
+    ChessMove const* end() const { return m_moves + m_numMoves; }
+    ChessMove const* Find(int from, int to, ChessPieceType promoteTo = ChessPieceType::Count) const;
+};
+
+//Generates every legal move for the side to move exactly once, check and pin masks keep each move legal without making it
+void GenerateLegalMoves(ChessPosition const& position, ChessMoveList& out_moves);
+
+//Every square the piece on from can legally move to, 0 if it is not the side to move's piece
+Bitboard GetLegalTargets(ChessPosition const& position, int from);
+
+//Classifies from->to for the side to move into a VALID_* kind or the INVALID_* reason, without changing anything.
+//promoteTo = Count accepts any promotion choice (the piece is picked later), VALID_MOVE_PROMOTION covers capture-promotions too
+ChessMoveResult ClassifyChessMove(ChessPosition const& position, int from, int to, ChessPieceType promoteTo = ChessPieceType::Count);
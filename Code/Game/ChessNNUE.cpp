@@ -0,0 +1,274 @@
+﻿#include "ChessNNUE.h"
+#include "ChessEvaluation.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define CHESS_NNUE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define CHESS_NNUE_SSE2
+#endif
+
+static constexpr char CHESS_NNUE_MAGIC[4] = { 'C', 'S', 'N', 'N' };
+static constexpr uint32_t CHESS_NNUE_VERSION = 1;
+static constexpr int MAX_CHESS_NNUE_CHANGES = 2; //a move adds or removes at most two pieces per perspective
+
+char const* GetChessNNUESimdName()
+{
+#if defined(CHESS_NNUE_AVX2)
+    return "AVX2";
+#elif defined(CHESS_NNUE_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+//----------------------------------------------------------------------------------------------------------
+//out = in + the added rows - the removed rows, one pass over the hidden layer so each value is loaded and stored once
+static void ApplyFeatureRows(int16_t* out_values, int16_t const* values, int16_t const* const* addedRows, int numAdded,
+    int16_t const* const* removedRows, int numRemoved)
+{
+#if defined(CHESS_NNUE_AVX2)
+    for (int offset = 0; offset < CHESS_NNUE_HIDDEN_SIZE; offset += 16)
+    {
+        __m256i sum = _mm256_load_si256((__m256i const*)(values + offset));
+        for (int rowIndex = 0; rowIndex < numAdded; ++rowIndex)
+        {
+            sum = _mm256_add_epi16(sum, _mm256_load_si256((__m256i const*)(addedRows[rowIndex] + offset)));
+        }
+        for (int rowIndex = 0; rowIndex < numRemoved; ++rowIndex)
+        {
+            sum = _mm256_sub_epi16(sum, _mm256_load_si256((__m256i const*)(removedRows[rowIndex] + offset)));
+        }
+        _mm256_store_si256((__m256i*)(out_values + offset), sum);
+    }
+#elif defined(CHESS_NNUE_SSE2)
+    for (int offset = 0; offset < CHESS_NNUE_HIDDEN_SIZE; offset += 8)
+    {
+        __m128i sum = _mm_load_si128((__m128i const*)(values + offset));
+        for (int rowIndex = 0; rowIndex < numAdded; ++rowIndex)
+        {
+            sum = _mm_add_epi16(sum, _mm_load_si128((__m128i const*)(addedRows[rowIndex] + offset)));
+        }
+        for (int rowIndex = 0; rowIndex < numRemoved; ++rowIndex)
+        {
+            sum = _mm_sub_epi16(sum, _mm_load_si128((__m128i const*)(removedRows[rowIndex] + offset)));
+        }
+        _mm_store_si128((__m128i*)(out_values + offset), sum);
+    }
+#else
+    for (int neuron = 0; neuron < CHESS_NNUE_HIDDEN_SIZE; ++neuron)
+    {
+        int sum = values[neuron];
+        for (int rowIndex = 0; rowIndex < numAdded; ++rowIndex)
+        {
+            sum += addedRows[rowIndex][neuron];
+        }
+        for (int rowIndex = 0; rowIndex < numRemoved; ++rowIndex)
+        {
+            sum -= removedRows[rowIndex][neuron];
+        }
+        out_values[neuron] = (int16_t)sum;
+    }
+#endif
+}
+
+//Sum of clip(values, 0, 255) * weights
+static int32_t GetClippedDotProduct(int16_t const* values, int16_t const* weights)
+{
+#if defined(CHESS_NNUE_AVX2)
+    __m256i const zero = _mm256_setzero_si256();
+    __m256i const activationMax = _mm256_set1_epi16(CHESS_NNUE_ACTIVATION_MAX);
+    __m256i sum = _mm256_setzero_si256();
+    for (int offset = 0; offset < CHESS_NNUE_HIDDEN_SIZE; offset += 16)
+    {
+        __m256i clipped = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((__m256i const*)(values + offset)), zero), activationMax);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(clipped, _mm256_load_si256((__m256i const*)(weights + offset))));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(half);
+#elif defined(CHESS_NNUE_SSE2)
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const activationMax = _mm_set1_epi16(CHESS_NNUE_ACTIVATION_MAX);
+    __m128i sum = _mm_setzero_si128();
+    for (int offset = 0; offset < CHESS_NNUE_HIDDEN_SIZE; offset += 8)
+    {
+        __m128i clipped = _mm_min_epi16(_mm_max_epi16(_mm_load_si128((__m128i const*)(values + offset)), zero), activationMax);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(clipped, _mm_load_si128((__m128i const*)(weights + offset))));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    for (int neuron = 0; neuron < CHESS_NNUE_HIDDEN_SIZE; ++neuron)
+    {
+        int clipped = values[neuron] < 0 ? 0 : (values[neuron] > CHESS_NNUE_ACTIVATION_MAX ? CHESS_NNUE_ACTIVATION_MAX : values[neuron]);
+        sum += clipped * weights[neuron];
+    }
+    return sum;
+#endif
+}
+
+//----------------------------------------------------------------------------------------------------------
+bool ChessNNUENetwork::LoadFromFile(std::string const& path, std::string& out_error)
+{
+    //Raw little-endian arrays, read straight into place on the little-endian targets we ship
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        out_error = "cannot open " + path;
+        return false;
+    }
+    char magic[4] = {};
+    uint32_t header[3] = {};
+    file.read(magic, sizeof(magic));
+    file.read((char*)header, sizeof(header));
+    if (!file || memcmp(magic, CHESS_NNUE_MAGIC, sizeof(magic)) != 0 || header[0] != CHESS_NNUE_VERSION)
+    {
+        out_error = path + " is not a version 1 network file";
+        return false;
+    }
+    if (header[1] != CHESS_NNUE_NUM_FEATURES || header[2] != CHESS_NNUE_HIDDEN_SIZE)
+    {
+        out_error = path + " has " + std::to_string(header[1]) + "x" + std::to_string(header[2]) + " weights, this build expects "
+            + std::to_string(CHESS_NNUE_NUM_FEATURES) + "x" + std::to_string(CHESS_NNUE_HIDDEN_SIZE);
+        return false;
+    }
+
+    ChessNNUENetwork* loaded = new ChessNNUENetwork(); //too big for the stack, and this stays untouched if the file is short
+    file.read((char*)loaded->m_featureWeights, sizeof(loaded->m_featureWeights));
+    file.read((char*)loaded->m_featureBiases, sizeof(loaded->m_featureBiases));
+    file.read((char*)loaded->m_outputWeights, sizeof(loaded->m_outputWeights));
+    file.read((char*)&loaded->m_outputBias, sizeof(loaded->m_outputBias));
+    if (!file)
+    {
+        out_error = path + " is truncated";
+        delete loaded;
+        return false;
+    }
+    *this = *loaded;
+    delete loaded;
+    return true;
+}
+
+bool ChessNNUENetwork::SaveToFile(std::string const& path) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    uint32_t header[3] = { CHESS_NNUE_VERSION, (uint32_t)CHESS_NNUE_NUM_FEATURES, (uint32_t)CHESS_NNUE_HIDDEN_SIZE };
+    file.write(CHESS_NNUE_MAGIC, sizeof(CHESS_NNUE_MAGIC));
+    file.write((char const*)header, sizeof(header));
+    file.write((char const*)m_featureWeights, sizeof(m_featureWeights));
+    file.write((char const*)m_featureBiases, sizeof(m_featureBiases));
+    file.write((char const*)m_outputWeights, sizeof(m_outputWeights));
+    file.write((char const*)&m_outputBias, sizeof(m_outputBias));
+    return (bool)file;
+}
+
+void ChessNNUENetwork::InitializeFromPieceSquareTables()
+{
+    //Every neuron carries the material-and-square balance from its perspective around a midpoint of 127, scaled by
+    //featureScale. Rounding is dithered across the neurons so the layer as a whole keeps about 4 steps per centipawn.
+    //The output takes side to move minus the other side, which doubles the balance, and the scales undo the rest
+    int const outputWeight = 5;
+    double const outputPerCentipawn = (double)CHESS_NNUE_ACTIVATION_MAX * CHESS_NNUE_OUTPUT_QUANTIZATION / CHESS_NNUE_EVAL_SCALE;
+    double const featureScale = outputPerCentipawn / (2.0 * outputWeight * CHESS_NNUE_HIDDEN_SIZE);
+    for (int typeIndex = 0; typeIndex < NUM_CHESS_PIECE_TYPES; ++typeIndex)
+    {
+        ChessPieceType type = (ChessPieceType)typeIndex;
+        for (int relativeSquare = 0; relativeSquare < NUM_BOARD_SQUARES; ++relativeSquare)
+        {
+            //Relative squares put the perspective at the bottom, the way white sees the board
+            double ownScore = GetChessPieceSquareScore(KISHI_WHITE, type, relativeSquare) * featureScale;
+            double enemyScore = GetChessPieceSquareScore(KISHI_BLACK, type, relativeSquare) * featureScale;
+            int ownFeature = GetChessNNUEFeature(KISHI_WHITE, KISHI_WHITE, type, relativeSquare);
+            int enemyFeature = GetChessNNUEFeature(KISHI_WHITE, KISHI_BLACK, type, relativeSquare);
+            for (int neuron = 0; neuron < CHESS_NNUE_HIDDEN_SIZE; ++neuron)
+            {
+                double dither = (neuron + 0.5) / CHESS_NNUE_HIDDEN_SIZE;
+                m_featureWeights[ownFeature][neuron] = (int16_t)floor(ownScore + dither);
+                m_featureWeights[enemyFeature][neuron] = (int16_t)-floor(enemyScore + dither);
+            }
+        }
+    }
+    for (int neuron = 0; neuron < CHESS_NNUE_HIDDEN_SIZE; ++neuron)
+    {
+        m_featureBiases[neuron] = CHESS_NNUE_ACTIVATION_MAX / 2;
+        m_outputWeights[0][neuron] = (int16_t)outputWeight;
+        m_outputWeights[1][neuron] = (int16_t)-outputWeight;
+    }
+    m_outputBias = 0;
+}
+
+void ChessNNUENetwork::RefreshAccumulator(ChessPosition const& position, ChessNNUEAccumulator& out_accumulator) const
+{
+    for (int perspective = 0; perspective < NUM_KISHI; ++perspective)
+    {
+        int16_t* values = out_accumulator.m_values[perspective];
+        memcpy(values, m_featureBiases, sizeof(m_featureBiases));
+        for (int kishiIndex = 0; kishiIndex < NUM_KISHI; ++kishiIndex)
+        {
+            for (int typeIndex = 0; typeIndex < NUM_CHESS_PIECE_TYPES; ++typeIndex)
+            {
+                Bitboard pieces = position.m_pieces[kishiIndex][typeIndex];
+                while (pieces)
+                {
+                    int16_t const* row = m_featureWeights[GetChessNNUEFeature(perspective, kishiIndex, (ChessPieceType)typeIndex, PopLowestSquare(pieces))];
+                    ApplyFeatureRows(values, values, &row, 1, nullptr, 0);
+                }
+            }
+        }
+    }
+}
+
+void ChessNNUENetwork::UpdateAccumulator(ChessNNUEAccumulator const& before, ChessPosition const& position, ChessMove const& move,
+    ChessNNUEAccumulator& out_after) const
+{
+    //Mirrors ChessPosition::MakeMove: the mover leaves from, lands on to (promoted if need be), a capture leaves its
+    //square, castling also moves the rook. Never more than two pieces added and two removed
+    int const us = position.m_sideToMove;
+    int const from = move.m_from;
+    int const to = move.m_to;
+    ChessPieceType const movedType = position.GetPieceTypeAt(from);
+    ChessPieceType const landedType = (move.m_promoteTo != ChessPieceType::Count) ? move.m_promoteTo : movedType;
+    int const capturedSquare = (move.m_result == ChessMoveResult::VALID_CAPTURE_ENPASSANT) ? GetSquareAt(GetSquareX(to), GetSquareY(from)) : to;
+
+    for (int perspective = 0; perspective < NUM_KISHI; ++perspective)
+    {
+        int16_t const* addedRows[MAX_CHESS_NNUE_CHANGES] = {};
+        int16_t const* removedRows[MAX_CHESS_NNUE_CHANGES] = {};
+        int numAdded = 0;
+        int numRemoved = 0;
+        removedRows[numRemoved++] = m_featureWeights[GetChessNNUEFeature(perspective, us, movedType, from)];
+        addedRows[numAdded++] = m_featureWeights[GetChessNNUEFeature(perspective, us, landedType, to)];
+        if (position.m_board[capturedSquare] != NO_PIECE_CODE)
+        {
+            removedRows[numRemoved++] = m_featureWeights[GetChessNNUEFeature(perspective, 1 - us, position.GetPieceTypeAt(capturedSquare), capturedSquare)];
+        }
+        else if (move.m_result == ChessMoveResult::VALID_CASTLE_KINGSIDE || move.m_result == ChessMoveResult::VALID_CASTLE_QUEENSIDE)
+        {
+            int homeY = GetSquareY(from);
+            bool isKingside = move.m_result == ChessMoveResult::VALID_CASTLE_KINGSIDE;
+            removedRows[numRemoved++] = m_featureWeights[GetChessNNUEFeature(perspective, us, ChessPieceType::Rook, GetSquareAt(isKingside ? 7 : 0, homeY))];
+            addedRows[numAdded++] = m_featureWeights[GetChessNNUEFeature(perspective, us, ChessPieceType::Rook, GetSquareAt(isKingside ? 5 : 3, homeY))];
+        }
+        ApplyFeatureRows(out_after.m_values[perspective], before.m_values[perspective], addedRows, numAdded, removedRows, numRemoved);
+    }
+}
+
+int ChessNNUENetwork::Evaluate(ChessNNUEAccumulator const& accumulator, int sideToMove) const
+{
+    int64_t output = (int64_t)GetClippedDotProduct(accumulator.m_values[sideToMove], m_outputWeights[0])
+        + GetClippedDotProduct(accumulator.m_values[1 - sideToMove], m_outputWeights[1]) + m_outputBias;
+    return (int)(output * CHESS_NNUE_EVAL_SCALE / (CHESS_NNUE_ACTIVATION_MAX * CHESS_NNUE_OUTPUT_QUANTIZATION));
+}
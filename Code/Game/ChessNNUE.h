@@ -0,0 +1,55 @@
+﻿#pragma once
+#include "ChessPosition.h"
+
+#include <cstdint>
+#include <string>
+
+//Small NNUE-style network: 768 piece-square inputs seen from each side, one hidden layer per side, one output.
+//The first layer is kept in an accumulator that moves update by adding and subtracting a few weight rows instead of
+//recomputing it; the kernels use AVX2 or SSE2 integer SIMD when the compiler targets them and plain loops otherwise
+constexpr int CHESS_NNUE_NUM_FEATURES = NUM_KISHI * NUM_CHESS_PIECE_TYPES * NUM_BOARD_SQUARES;
+constexpr int CHESS_NNUE_HIDDEN_SIZE = 128;
+constexpr int CHESS_NNUE_ACTIVATION_MAX = 255; //hidden values are clipped to [0, 255] before the output layer
+constexpr int CHESS_NNUE_OUTPUT_QUANTIZATION = 64;
+constexpr int CHESS_NNUE_EVAL_SCALE = 400; //output * scale / (255 * 64) is centipawns
+
+//First layer values from each kishi's point of view, indexed [perspective][neuron]
+struct alignas(64) ChessNNUEAccumulator
+{
+    int16_t m_values[NUM_KISHI][CHESS_NNUE_HIDDEN_SIZE];
+};
+
+//Feature of a piece as seen by perspective: own or enemy, its type, its square flipped so the perspective plays up the board
+constexpr int GetChessNNUEFeature(int perspective, int pieceKishiID, ChessPieceType type, int square)
+{
+    int relativeSquare = (perspective == KISHI_WHITE) ? square : (square ^ 56);
+    int relation = (pieceKishiID == perspective) ? 0 : 1;
+    return (relation * NUM_CHESS_PIECE_TYPES + (int)type) * NUM_BOARD_SQUARES + relativeSquare;
+}
+
+char const* GetChessNNUESimdName(); //"AVX2", "SSE2" or "scalar", whichever this build compiled
+
+//----------------------------------------------------------------------------------------------------------
+//Weights file, little endian: "CSNN", uint32 version 1, uint32 768, uint32 128, then int16 feature weights [768][128],
+//int16 feature biases [128], int16 output weights [2][128] (side to move first), int32 output bias
+class ChessNNUENetwork
+{
+public:
+    bool LoadFromFile(std::string const& path, std::string& out_error); //leaves the network untouched on failure
+    bool SaveToFile(std::string const& path) const;
+
+    //Builds a network whose output matches the midgame piece-square score to within a few centipawns, a starting
+    //point until a trained network replaces it. A single linear layer cannot taper, so the endgame terms are left out
+    void InitializeFromPieceSquareTables();
+
+    void RefreshAccumulator(ChessPosition const& position, ChessNNUEAccumulator& out_accumulator) const;
+    //out_after = before with move applied; position is the position before the move, move one of its legal moves
+    void UpdateAccumulator(ChessNNUEAccumulator const& before, ChessPosition const& position, ChessMove const& move, ChessNNUEAccumulator& out_after) const;
+    int Evaluate(ChessNNUEAccumulator const& accumulator, int sideToMove) const; //centipawns from the side to move's point of view
+
+private:
+    alignas(64) int16_t m_featureWeights[CHESS_NNUE_NUM_FEATURES][CHESS_NNUE_HIDDEN_SIZE] = {};
+    alignas(64) int16_t m_featureBiases[CHESS_NNUE_HIDDEN_SIZE] = {};
+    alignas(64) int16_t m_outputWeights[NUM_KISHI][CHESS_NNUE_HIDDEN_SIZE] = {}; //[0] side to move, [1] the other side
+    int32_t m_outputBias = 0;
+};
@@ -8,7 +8,7 @@
 #include "Engine/Math/Mat44.hpp"
 #include "Engine/Math/Vec3.hpp"
 
-enum class ChessPieceType;
+enum class ChessPieceType : unsigned char;
 class VertexBuffer;
 class IndexBuffer;
 
@@ -25,8 +25,8 @@ public:
 
     void OnImpacted();
     void OnUnImpacted();
-    void OnGrabbed(); //only for piece
-    void OnUnGrabbed();
+    virtual void OnGrabbed(); //only for piece
+    virtual void OnUnGrabbed();
 
 public:
     Vec3 m_position;
@@ -38,8 +38,6 @@ public:
     Rgba8 m_originalTint;
     IntVec2 m_lastCoord = IntVec2::ZERO;
     IntVec2 m_currentCoord = IntVec2::ZERO;
-    float m_lerpT = 1.0f;
-    float m_lerpSpeed = 1.0f; //vel
 
     //Only used for piece
     bool m_isGrabbed = false;
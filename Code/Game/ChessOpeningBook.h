@@ -0,0 +1,83 @@
+﻿#pragma once
+#include "ChessMappedFile.h"
+#include "ChessPosition.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------
+//Opening book in the Polyglot .bin layout: 16-byte big-endian entries sorted by key, each
+//  uint64 key, uint16 move, uint16 weight, uint32 learn (unused)
+//The move packs to file in bits 0-2, to rank in 3-5, from file in 6-8, from rank in 9-11 and the promotion in 12-14
+//(1 knight, 2 bishop, 3 rook, 4 queen); castling is written as the king taking its own rook, e1h1 for e1g1.
+//Keys are Polyglot's own, so books made by other Polyglot tools probe here and ChessBookGen's books work elsewhere;
+//ChessBookGen --check-keys compares GetChessBookKey against the reference keys of the Polyglot format description
+constexpr int CHESS_BOOK_ENTRY_SIZE = 16;
+constexpr int MAX_CHESS_BOOK_MOVES = 16; //candidates a probe reports for one position
+char const* const CHESS_BOOK_EXTENSION = ".bin";
+
+struct ChessBookEntry
+{
+    uint64_t m_key = 0;
+    uint16_t m_move = 0;
+    uint16_t m_weight = 0;
+    uint32_t m_learn = 0;
+};
+
+struct ChessBookMove
+{
+    ChessMove m_move;
+    int m_weight = 0; //0 means known but never to be played
+};
+
+//A named line from the openings list, its moves checked against the rules from the starting position
+struct ChessOpeningLine
+{
+    std::string m_name;
+    std::vector<ChessMove> m_moves;
+};
+
+uint64_t GetChessBookKey(ChessPosition const& position); //Polyglot key, independent of ChessPosition::GetKey
+uint16_t EncodeChessBookMove(ChessMove const& move);
+//The legal move of position the book move stands for, false if there is none (a stale or foreign book)
+bool DecodeChessBookMove(ChessPosition const& position, uint16_t bookMove, ChessMove& out_move);
+void WriteChessBookEntry(ChessBookEntry const& entry, unsigned char* out_bytes); //CHESS_BOOK_ENTRY_SIZE bytes, big endian
+ChessBookEntry ReadChessBookEntry(unsigned char const* bytes);
+
+//One line per opening, "Ruy Lopez | e2e4 e7e5 g1f3 b8c6 f1b5", '#' starts a comment. Stops at the first bad line
+bool ReadChessOpeningLines(std::string const& path, std::vector<ChessOpeningLine>& out_lines, std::string& out_error);
+
+//----------------------------------------------------------------------------------------------------------
+//A book file mapped read-only. Books opened on the same file share one mapping, and the OS shares its pages with every
+//other process mapping the file, so running several games costs the book's memory once. Probe binary-searches the
+//mapping and writes into the caller's array: no heap allocation, one or two pages touched per lookup
+class ChessOpeningBook
+{
+public:
+    bool Open(std::string const& path, std::string& out_error); //closes the book opened before, keeps it closed on failure
+    void Close();
+    bool LoadOpeningNames(std::string const& path, std::string& out_error); //names the final position of every line
+
+    bool IsOpen() const { return m_file != nullptr; }
+    uint64_t GetNumEntries() const { return m_numEntries; }
+    int GetNumOpeningNames() const { return (int)m_openingNames.size(); }
+
+    //Legal book moves of position by decreasing weight, at most maxMoves of them; returns how many were written
+    int Probe(ChessPosition const& position, ChessBookMove* out_moves, int maxMoves) const;
+    //Weighted random choice among the playable book moves, randomValue being any 64-bit random number
+    bool PickMove(ChessPosition const& position, uint64_t randomValue, ChessMove& out_move) const;
+    //Name of the opening that reaches exactly this position, null if it has none
+    char const* GetOpeningName(ChessPosition const& position) const;
+
+private:
+    struct OpeningName
+    {
+        uint64_t m_key = 0;
+        std::string m_name;
+    };
+
+    std::shared_ptr<ChessMappedFile const> m_file;
+    uint64_t m_numEntries = 0;
+    std::vector<OpeningName> m_openingNames; //sorted by key
+};
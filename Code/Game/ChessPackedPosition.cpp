@@ -0,0 +1,184 @@
+﻿#include "ChessPackedPosition.h"
+#include "ChessZobrist.h"
+
+static_assert(CHESS_PACKED_POSITION_SIZE == 8 + 16 + 1 + 1 + 2 + 2 + 2, "packed layout must add up to its fixed size");
+
+constexpr int PACKED_NIBBLES_OFFSET = 8;
+constexpr int PACKED_MAX_PIECES = 32;
+constexpr int PACKED_STATE_OFFSET = 24;
+constexpr unsigned char PACKED_WHITE_TO_MOVE = 0x10;
+constexpr unsigned char PACKED_NO_EN_PASSANT = 0xFF;
+
+static char const s_hexDigits[] = "0123456789abcdef";
+
+//----------------------------------------------------------------------------------------------------------
+bool ChessPackedPosition::operator==(ChessPackedPosition const& other) const
+{
+    for (int byteIndex = 0; byteIndex < CHESS_PACKED_POSITION_SIZE; ++byteIndex)
+    {
+        if (m_bytes[byteIndex] != other.m_bytes[byteIndex])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------
+bool PackChessPosition(ChessPosition const& position, ChessPackedPosition& out_packed)
+{
+    Bitboard occupied = position.GetOccupied();
+    if (CountBits(occupied) > PACKED_MAX_PIECES)
+    {
+        return false;
+    }
+
+    ChessPackedPosition packed;
+    for (int byteIndex = 0; byteIndex < 8; ++byteIndex)
+    {
+        packed.m_bytes[byteIndex] = (unsigned char)(occupied >> (byteIndex * 8));
+    }
+    int pieceIndex = 0;
+    while (occupied)
+    {
+        int square = PopLowestSquare(occupied);
+        unsigned char code = position.GetPieceCodeAt(square);
+        packed.m_bytes[PACKED_NIBBLES_OFFSET + pieceIndex / 2] |= (unsigned char)(code << ((pieceIndex & 1) * 4));
+        ++pieceIndex;
+    }
+
+    unsigned char* state = packed.m_bytes + PACKED_STATE_OFFSET;
+    state[0] = (unsigned char)(position.m_castlingRights | (position.m_sideToMove == KISHI_WHITE ? PACKED_WHITE_TO_MOVE : 0));
+    state[1] = (position.m_enPassantSquare == NO_SQUARE) ? PACKED_NO_EN_PASSANT : (unsigned char)position.m_enPassantSquare;
+    state[2] = (unsigned char)(position.m_halfmoveClock & 0xFF);
+    state[3] = (unsigned char)((position.m_halfmoveClock >> 8) & 0xFF);
+    state[4] = (unsigned char)(position.m_fullmoveNumber & 0xFF);
+    state[5] = (unsigned char)((position.m_fullmoveNumber >> 8) & 0xFF);
+
+    out_packed = packed;
+    return true;
+}
+
+bool UnpackChessPosition(ChessPackedPosition const& packed, ChessPosition& out_position)
+{
+    Bitboard occupied = 0;
+    for (int byteIndex = 0; byteIndex < 8; ++byteIndex)
+    {
+        occupied |= (Bitboard)packed.m_bytes[byteIndex] << (byteIndex * 8);
+    }
+    if (CountBits(occupied) > PACKED_MAX_PIECES)
+    {
+        return false;
+    }
+
+    ChessPosition unpacked;
+    unpacked.Clear();
+    int pieceIndex = 0;
+    while (occupied)
+    {
+        int square = PopLowestSquare(occupied);
+        unsigned char code = (unsigned char)((packed.m_bytes[PACKED_NIBBLES_OFFSET + pieceIndex / 2] >> ((pieceIndex & 1) * 4)) & 0xF);
+        if ((int)GetPieceCodeType(code) >= NUM_CHESS_PIECE_TYPES)
+        {
+            return false;
+        }
+        unpacked.PutPiece(square, GetPieceCodeKishi(code), GetPieceCodeType(code));
+        ++pieceIndex;
+    }
+    if (CountBits(unpacked.GetPieces(KISHI_WHITE, ChessPieceType::King)) != 1 || CountBits(unpacked.GetPieces(KISHI_BLACK, ChessPieceType::King)) != 1)
+    {
+        return false;
+    }
+
+    unsigned char const* state = packed.m_bytes + PACKED_STATE_OFFSET;
+    if ((state[0] & ~(PACKED_WHITE_TO_MOVE | CASTLE_ALL)) != 0 || (state[1] != PACKED_NO_EN_PASSANT && state[1] >= NUM_BOARD_SQUARES))
+    {
+        return false;
+    }
+    unpacked.m_sideToMove = (state[0] & PACKED_WHITE_TO_MOVE) ? KISHI_WHITE : KISHI_BLACK;
+    unpacked.m_castlingRights = (unsigned char)(state[0] & CASTLE_ALL);
+    unpacked.m_enPassantSquare = (state[1] == PACKED_NO_EN_PASSANT) ? NO_SQUARE : (int)state[1];
+    unpacked.m_halfmoveClock = state[2] | (state[3] << 8);
+    unpacked.m_fullmoveNumber = state[4] | (state[5] << 8);
+
+    out_position = unpacked;
+    return true;
+}
+
+uint64_t GetChessValidationHash(ChessPosition const& position)
+{
+    uint64_t clockState = ((uint64_t)position.m_halfmoveClock << 32) | (uint64_t)(uint32_t)position.m_fullmoveNumber;
+    return position.GetKey() ^ GetNextZobristRandom(clockState);
+}
+
+//----------------------------------------------------------------------------------------------------------
+static int GetHexDigitValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+std::string GetPackedPositionHex(ChessPackedPosition const& packed)
+{
+    std::string text(CHESS_PACKED_POSITION_SIZE * 2, '0');
+    for (int byteIndex = 0; byteIndex < CHESS_PACKED_POSITION_SIZE; ++byteIndex)
+    {
+        text[byteIndex * 2] = s_hexDigits[packed.m_bytes[byteIndex] >> 4];
+        text[byteIndex * 2 + 1] = s_hexDigits[packed.m_bytes[byteIndex] & 0xF];
+    }
+    return text;
+}
+
+bool ParsePackedPositionHex(std::string const& text, ChessPackedPosition& out_packed)
+{
+    if ((int)text.size() != CHESS_PACKED_POSITION_SIZE * 2)
+    {
+        return false;
+    }
+    ChessPackedPosition packed;
+    for (int byteIndex = 0; byteIndex < CHESS_PACKED_POSITION_SIZE; ++byteIndex)
+    {
+        int high = GetHexDigitValue(text[byteIndex * 2]);
+        int low = GetHexDigitValue(text[byteIndex * 2 + 1]);
+        if (high < 0 || low < 0)
+        {
+            return false;
+        }
+        packed.m_bytes[byteIndex] = (unsigned char)((high << 4) | low);
+    }
+    out_packed = packed;
+    return true;
+}
+
+std::string GetHashHex(uint64_t hash)
+{
+    std::string text(16, '0');
+    for (int digitIndex = 15; digitIndex >= 0; --digitIndex)
+    {
+        text[digitIndex] = s_hexDigits[hash & 0xF];
+        hash >>= 4;
+    }
+    return text;
+}
+
+bool ParseHashHex(std::string const& text, uint64_t& out_hash)
+{
+    if (text.empty() || text.size() > 16)
+    {
+        return false;
+    }
+    uint64_t hash = 0;
+    for (char c : text)
+    {
+        int value = GetHexDigitValue(c);
+        if (value < 0)
+        {
+            return false;
+        }
+        hash = (hash << 4) | (uint64_t)value;
+    }
+    out_hash = hash;
+    return true;
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+#include "ChessPosition.h"
+
+#include <string>
+
+//Fixed-size binary form of a position for the wire: occupancy, one piece nibble per occupied square, then the state bytes
+constexpr int CHESS_PACKED_POSITION_SIZE = 32;
+
+struct ChessPackedPosition
+{
+    //[0, 8) occupancy, little endian
+    //[8, 24) piece codes of the occupied squares from a1 to h8, two per byte, low nibble first (at most 32 pieces)
+    //[24] side to move in bit 4, castling rights in bits 0-3
+    //[25] en passant square, 0xFF for none
+    //[26, 28) halfmove clock, [28, 30) fullmove number, both little endian
+    //[30, 32) reserved, always 0
+    unsigned char m_bytes[CHESS_PACKED_POSITION_SIZE] = {};
+
+    bool operator==(ChessPackedPosition const& other) const;
+    bool operator!=(ChessPackedPosition const& other) const { return !(*this == other); }
+};
+
+//False if the position has more than 32 pieces and cannot be packed
+bool PackChessPosition(ChessPosition const& position, ChessPackedPosition& out_packed);
+//Leaves out_position untouched and returns false if the bytes do not describe a position
+bool UnpackChessPosition(ChessPackedPosition const& packed, ChessPosition& out_position);
+
+//Zobrist key with the clocks folded in, two positions share it exactly when their packed forms match (barring collisions)
+uint64_t GetChessValidationHash(ChessPosition const& position);
+
+std::string GetPackedPositionHex(ChessPackedPosition const& packed); //64 hex digits
+bool ParsePackedPositionHex(std::string const& text, ChessPackedPosition& out_packed);
+std::string GetHashHex(uint64_t hash); //16 hex digits
+bool ParseHashHex(std::string const& text, uint64_t& out_hash);
@@ -26,11 +26,11 @@ public:
     void OnRaycastValidMove(IntVec2 from, IntVec2 to, ChessMoveResult result);
     void OnRaycastSemiMove(IntVec2 from, IntVec2 to, ChessMoveResult result);
     
-    std::vector<ChessPiece*> GetChessPiecesAroundAxially(IntVec2 pos);
-    
     void ResetMyCoords(IntVec2 last, IntVec2 current);
+    void SetCurrentCoord(IntVec2 coord);
     bool PromoteTo(ChessPieceType type);
-    void UpdateMyTint(float deltaSeconds);
+    void OnGrabbed() override;
+    void OnUnGrabbed() override;
 
     void SetMyColor(int ownerID);
     int GetMyOwnerID() const;
@@ -39,12 +39,13 @@ public:
     void InitializeDebugDraw();
     
 private:
+    void ApplyValidatedMove(IntVec2 from, IntVec2 to, ChessMoveResult result, ChessPieceType promoteType);
     ChessKishi* GetMyKishi() const;
     ChessKishi* GetAnotherKishi() const;
     Mat44 GetModelToWorldTransform() const override;
 
 public:
-    ChessPieceDefinition m_definition;
+    ChessPieceDefinition const* m_definition = nullptr; //shared entry in ChessPieceDefinition::s_chessPieceDefs
 
     //ChessPieceType m_type;
     int m_ownerKishiID;
@@ -59,7 +60,37 @@ public:
     //for pawn
     bool m_hasMoved2Squares = false;
 
-    float m_varyTime = 0.f;
+    //where ChessBoard::ResetPieces puts it back
+    IntVec2 m_startCoord;
+    ChessPieceType m_startType;
+
+    int m_poolIndex = -1; //slot in the board's ChessPiecePool, also indexes its ChessPieceAnimations
 
     std::vector<Vertex_PCU> m_debugVertices; 
 };
+
+//----------------------------------------------------------------------------------------------------------
+constexpr int MAX_CHESS_PIECES = NUM_KISHI * 2 * BOARD_SIZE + 1; //every piece of a match plus the referee's ghost piece
+
+//Fixed in-place storage for the pieces of one board: they are built once, sit next to each other for the update loop,
+//and capture, promotion and reset only move pointers around, so none of them touches the global heap
+class ChessPiecePool
+{
+public:
+    ChessPiecePool() = default;
+    ~ChessPiecePool();
+    ChessPiecePool(ChessPiecePool const&) = delete;
+    ChessPiecePool& operator=(ChessPiecePool const&) = delete;
+
+    ChessPiece* CreatePiece(int ownerID, ChessPieceType type, Vec3 position, EulerAngles orientation);
+    void DestroyAllPieces();
+    int GetNumPieces() const { return m_numPieces; }
+    ChessPiece* GetPiece(int index) { return GetSlot(index); }
+
+private:
+    ChessPiece* GetSlot(int index) { return reinterpret_cast<ChessPiece*>(m_storage + index * sizeof(ChessPiece)); }
+
+private:
+    alignas(ChessPiece) unsigned char m_storage[MAX_CHESS_PIECES * sizeof(ChessPiece)];
+    int m_numPieces = 0;
+};
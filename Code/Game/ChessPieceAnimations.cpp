@@ -0,0 +1,124 @@
+﻿#include "ChessPieceAnimations.h"
+
+#include <cmath>
+
+//----------------------------------------------------------------------------------------------------------
+void ChessPieceAnimations::Initialize(int numSlots)
+{
+    m_x.assign(numSlots, 0.f);
+    m_y.assign(numSlots, 0.f);
+    m_z.assign(numSlots, 0.f);
+    m_alpha.assign(numSlots, 255);
+    m_fromX.assign(numSlots, 0.f);
+    m_fromY.assign(numSlots, 0.f);
+    m_toX.assign(numSlots, 0.f);
+    m_toY.assign(numSlots, 0.f);
+    m_lerpT.assign(numSlots, 1.f);
+    m_lerpSpeed.assign(numSlots, 1.f);
+    m_pulseTime.assign(numSlots, 0.f);
+    m_flags.assign(numSlots, 0);
+    m_activeIndices.assign(numSlots, -1);
+    m_activeSlots.clear();
+    m_activeSlots.reserve(numSlots);
+    m_updatedSlots.clear();
+    m_updatedSlots.reserve(numSlots);
+}
+
+void ChessPieceAnimations::StartMove(int slot, float fromX, float fromY, float toX, float toY, bool isHopping, float speed)
+{
+    m_fromX[slot] = fromX;
+    m_fromY[slot] = fromY;
+    m_toX[slot] = toX;
+    m_toY[slot] = toY;
+    m_lerpT[slot] = 0.f;
+    m_lerpSpeed[slot] = speed;
+    unsigned char flags = (unsigned char)((m_flags[slot] & ~FLAG_HOPPING) | FLAG_MOVING);
+    SetFlags(slot, isHopping ? (unsigned char)(flags | FLAG_HOPPING) : flags);
+}
+
+void ChessPieceAnimations::RetargetMove(int slot, float toX, float toY)
+{
+    m_toX[slot] = toX;
+    m_toY[slot] = toY;
+}
+
+void ChessPieceAnimations::StopMove(int slot)
+{
+    m_lerpT[slot] = 1.f;
+    m_x[slot] = m_toX[slot];
+    m_y[slot] = m_toY[slot];
+    m_z[slot] = 0.f;
+    SetFlags(slot, (unsigned char)(m_flags[slot] & ~(FLAG_MOVING | FLAG_HOPPING)));
+}
+
+void ChessPieceAnimations::StartPulse(int slot)
+{
+    m_pulseTime[slot] = 0.f;
+    SetFlags(slot, (unsigned char)(m_flags[slot] | FLAG_PULSING));
+}
+
+void ChessPieceAnimations::StopPulse(int slot)
+{
+    m_alpha[slot] = 255;
+    SetFlags(slot, (unsigned char)(m_flags[slot] & ~FLAG_PULSING));
+}
+
+void ChessPieceAnimations::SetFlags(int slot, unsigned char flags)
+{
+    //Joining and leaving the active list is O(1): append, or swap the last active slot into the hole
+    bool wasActive = m_flags[slot] != 0;
+    m_flags[slot] = flags;
+    if (!wasActive && flags != 0)
+    {
+        m_activeIndices[slot] = (int)m_activeSlots.size();
+        m_activeSlots.push_back(slot);
+    }
+    else if (wasActive && flags == 0)
+    {
+        int index = m_activeIndices[slot];
+        int lastSlot = m_activeSlots.back();
+        m_activeSlots[index] = lastSlot;
+        m_activeIndices[lastSlot] = index;
+        m_activeSlots.pop_back();
+        m_activeIndices[slot] = -1;
+    }
+}
+
+void ChessPieceAnimations::Update(float deltaSeconds)
+{
+    m_updatedSlots.clear();
+    for (int activeIndex = (int)m_activeSlots.size() - 1; activeIndex >= 0; --activeIndex)
+    {
+        //Walking backwards keeps the swap-removal in SetFlags from skipping a slot
+        int slot = m_activeSlots[activeIndex];
+        m_updatedSlots.push_back(slot);
+        unsigned char flags = m_flags[slot];
+
+        if (flags & FLAG_MOVING)
+        {
+            float lerpT = m_lerpT[slot] + m_lerpSpeed[slot] * deltaSeconds;
+            if (lerpT >= 1.f)
+            {
+                StopMove(slot);
+            }
+            else
+            {
+                //SmoothStop3, the same ease the pieces always used
+                float inverse = 1.f - lerpT;
+                float t = 1.f - inverse * inverse * inverse;
+                m_lerpT[slot] = lerpT;
+                m_x[slot] = m_fromX[slot] + (m_toX[slot] - m_fromX[slot]) * t;
+                m_y[slot] = m_fromY[slot] + (m_toY[slot] - m_fromY[slot]) * t;
+                m_z[slot] = (flags & FLAG_HOPPING) ? 1.f - t : 0.f;
+            }
+        }
+
+        if (flags & FLAG_PULSING)
+        {
+            float pulseTime = m_pulseTime[slot] + deltaSeconds;
+            m_pulseTime[slot] = (pulseTime > 360.f) ? 0.f : pulseTime;
+            float pulse = 0.5f + 0.5f * sinf(m_pulseTime[slot] * 3.f);
+            m_alpha[slot] = (unsigned char)(150.f + 105.f * pulse);
+        }
+    }
+}
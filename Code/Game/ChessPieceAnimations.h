@@ -0,0 +1,56 @@
+﻿#pragma once
+#include <vector>
+
+//Structure-of-arrays animation state for the pieces of a board, indexed by the piece's pool slot.
+//Only slots on the active list (sliding to a square or pulsing while grabbed) are touched each frame,
+//pieces at rest cost nothing. Engine-free so the headless tools can benchmark it.
+class ChessPieceAnimations
+{
+public:
+    void Initialize(int numSlots); //the only allocation, every call after this reuses the arrays
+
+    void StartMove(int slot, float fromX, float fromY, float toX, float toY, bool isHopping, float speed = 1.f);
+    void RetargetMove(int slot, float toX, float toY); //a piece moved again before it landed
+    void StopMove(int slot);
+    void StartPulse(int slot);
+    void StopPulse(int slot);
+
+    bool IsMoving(int slot) const { return (m_flags[slot] & FLAG_MOVING) != 0; }
+    bool IsPulsing(int slot) const { return (m_flags[slot] & FLAG_PULSING) != 0; }
+
+    //Advances every active slot and drops the ones that finished, the slots it wrote are listed until the next call
+    void Update(float deltaSeconds);
+
+    int GetNumSlots() const { return (int)m_flags.size(); }
+    int GetNumActive() const { return (int)m_activeSlots.size(); }
+    int GetNumUpdated() const { return (int)m_updatedSlots.size(); }
+    int GetUpdatedSlot(int index) const { return m_updatedSlots[index]; }
+
+public:
+    //Outputs, current for every slot Update wrote
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+    std::vector<float> m_z;
+    std::vector<unsigned char> m_alpha;
+
+private:
+    static constexpr unsigned char FLAG_MOVING = 1;
+    static constexpr unsigned char FLAG_HOPPING = 2; //knights arc over the board
+    static constexpr unsigned char FLAG_PULSING = 4;
+
+    void SetFlags(int slot, unsigned char flags);
+
+private:
+    std::vector<float> m_fromX;
+    std::vector<float> m_fromY;
+    std::vector<float> m_toX;
+    std::vector<float> m_toY;
+    std::vector<float> m_lerpT;
+    std::vector<float> m_lerpSpeed;
+    std::vector<float> m_pulseTime;
+    std::vector<unsigned char> m_flags;
+
+    std::vector<int> m_activeSlots;
+    std::vector<int> m_activeIndices; //slot -> index in m_activeSlots, -1 while at rest
+    std::vector<int> m_updatedSlots;
+};
@@ -77,7 +77,7 @@ void ChessPieceDefinition::InitializeChessPieceDefinitions()
 
 void ChessPieceDefinition::ClearDefinitions()
 {
-    for (ChessPieceDefinition chessPieceDef : s_chessPieceDefs)
+    for (ChessPieceDefinition& chessPieceDef : s_chessPieceDefs)
     {
         for (int i = 0; i < 3; i++)
         {
@@ -114,32 +114,15 @@ ChessPieceDefinition const& ChessPieceDefinition::GetChessPieceDefinitionByName(
 
 ChessPieceDefinition const& ChessPieceDefinition::GetChessPieceDefinitionByChessPieceType(ChessPieceType type)
 {
-    std::string name;
-    if (type == ChessPieceType::Bishop)
-    {
-        name = "bishop";
-    }
-    else if (type == ChessPieceType::King)
-    {
-        name = "king";
-    }
-    else if (type == ChessPieceType::Queen)
-    {
-        name = "queen";
-    }
-    else if (type == ChessPieceType::Knight)
+    //m_type was resolved from the name at load, so promotion needs no string building or compares
+    for (ChessPieceDefinition const& chessPieceDef : s_chessPieceDefs)
     {
-        name = "knight";
-    }
-    else if (type == ChessPieceType::Rook)
-    {
-        name = "rook";
-    }
-    else if (type == ChessPieceType::Pawn)
-    {
-        name = "pawn";
+        if (chessPieceDef.m_type == type)
+        {
+            return chessPieceDef;
+        }
     }
-    return GetChessPieceDefinitionByName(name);
+    ERROR_AND_DIE("UNKNOWN ChessPieceType");
 }
 
 ChessPieceType ChessPieceDefinition::GetChessPieceTypeByName(std::string const& name) const
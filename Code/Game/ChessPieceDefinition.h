@@ -23,7 +23,7 @@ public:
     void InitializeGlyphs(ChessPieceType type);
     
 public:
-    static std::vector<ChessPieceDefinition> s_chessPieceDefs;
+    static std::vector<ChessPieceDefinition> s_chessPieceDefs; //pieces point into this, so it only grows during InitializeChessPieceDefinitions
     StaticMesh* m_sets[3][2];
 
 public:
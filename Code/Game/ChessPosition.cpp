@@ -0,0 +1,540 @@
+﻿#include "ChessPosition.h"
+#include "ChessEvaluation.h"
+#include "ChessZobrist.h"
+
+#include <string_view>
+
+//----------------------------------------------------------------------------------------------------------
+bool ChessMove::IsCapture() const
+{
+    return m_result == ChessMoveResult::VALID_CAPTURE_NORMAL || m_result == ChessMoveResult::VALID_CAPTURE_ENPASSANT;
+}
+
+bool ChessMove::operator==(ChessMove const& other) const
+{
+    return m_from == other.m_from && m_to == other.m_to && m_promoteTo == other.m_promoteTo;
+}
+
+std::string GetSquareName(int square)
+{
+    if (square < 0 || square >= NUM_BOARD_SQUARES)
+    {
+        return "-";
+    }
+    return std::string{ static_cast<char>('a' + GetSquareX(square)), static_cast<char>('1' + GetSquareY(square)) };
+}
+
+int ParseSquareName(std::string const& text)
+{
+    if (text.length() != 2)
+    {
+        return NO_SQUARE;
+    }
+    int x = text[0] - 'a';
+    int y = text[1] - '1';
+    if (x < 0 || x >= BOARD_SIZE || y < 0 || y >= BOARD_SIZE)
+    {
+        return NO_SQUARE;
+    }
+    return GetSquareAt(x, y);
+}
+
+std::string GetMoveNotation(ChessMove const& move)
+{
+    static char const promotionChars[NUM_CHESS_PIECE_TYPES] = { 'b', 'n', 'r', 'q', 'k', 'p' };
+    std::string notation = GetSquareName(move.m_from) + GetSquareName(move.m_to);
+    if (move.m_promoteTo != ChessPieceType::Count)
+    {
+        notation += promotionChars[(int)move.m_promoteTo];
+    }
+    return notation;
+}
+
+//----------------------------------------------------------------------------------------------------------
+static constexpr char s_fenPieceChars[NUM_KISHI][NUM_CHESS_PIECE_TYPES] = {
+    { 'b', 'n', 'r', 'q', 'k', 'p' }, //black, lowercase like the piece glyphs
+    { 'B', 'N', 'R', 'Q', 'K', 'P' }  //white
+};
+
+//Reverse of s_fenPieceChars indexed by character, NO_PIECE_CODE for anything that is not a piece letter
+struct ChessFENPieceCodes
+{
+    unsigned char m_codes[128] = {};
+};
+
+constexpr ChessFENPieceCodes MakeFENPieceCodes()
+{
+    ChessFENPieceCodes table;
+    for (int c = 0; c < 128; ++c)
+    {
+        table.m_codes[c] = NO_PIECE_CODE;
+    }
+    for (int kishiIndex = 0; kishiIndex < NUM_KISHI; ++kishiIndex)
+    {
+        for (int typeIndex = 0; typeIndex < NUM_CHESS_PIECE_TYPES; ++typeIndex)
+        {
+            table.m_codes[(int)s_fenPieceChars[kishiIndex][typeIndex]] = GetPieceCode(kishiIndex, (ChessPieceType)typeIndex);
+        }
+    }
+    return table;
+}
+
+static constexpr ChessFENPieceCodes s_fenPieceCodes = MakeFENPieceCodes();
+
+//FEN fields are split in place rather than through a stream, test suites and tuning sets load positions in bulk
+static bool IsFENSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static std::string_view GetNextFENField(std::string_view fen, size_t& cursor)
+{
+    while (cursor < fen.size() && IsFENSpace(fen[cursor]))
+    {
+        ++cursor;
+    }
+    size_t start = cursor;
+    while (cursor < fen.size() && !IsFENSpace(fen[cursor]))
+    {
+        ++cursor;
+    }
+    return fen.substr(start, cursor - start);
+}
+
+//Reads the leading digits like operator>> would, false if the field does not start with one
+static bool ParseFENNumber(std::string_view field, int& out_number)
+{
+    if (field.empty() || field[0] < '0' || field[0] > '9')
+    {
+        return false;
+    }
+    int number = 0;
+    for (size_t index = 0; index < field.size() && field[index] >= '0' && field[index] <= '9'; ++index)
+    {
+        number = number * 10 + (field[index] - '0');
+    }
+    out_number = number;
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------
+ChessPosition::ChessPosition()
+{
+    Clear();
+}
+
+void ChessPosition::Clear()
+{
+    for (int kishiIndex = 0; kishiIndex < NUM_KISHI; ++kishiIndex)
+    {
+        for (int typeIndex = 0; typeIndex < NUM_CHESS_PIECE_TYPES; ++typeIndex)
+        {
+            m_pieces[kishiIndex][typeIndex] = 0;
+        }
+        m_kishiPieces[kishiIndex] = 0;
+    }
+    m_occupied = 0;
+    m_pieceKey = 0;
+    m_midgameScore = 0;
+    m_endgameScore = 0;
+    m_gamePhase = 0;
+    for (int square = 0; square < NUM_BOARD_SQUARES; ++square)
+    {
+        m_board[square] = NO_PIECE_CODE;
+    }
+    m_sideToMove = KISHI_WHITE;
+    m_castlingRights = 0;
+    m_enPassantSquare = NO_SQUARE;
+    m_halfmoveClock = 0;
+    m_fullmoveNumber = 1;
+}
+
+void ChessPosition::SetToStartingPosition()
+{
+    static ChessPieceType const backRank[BOARD_SIZE] = {
+        ChessPieceType::Rook, ChessPieceType::Knight, ChessPieceType::Bishop, ChessPieceType::Queen,
+        ChessPieceType::King, ChessPieceType::Bishop, ChessPieceType::Knight, ChessPieceType::Rook };
+
+    Clear();
+    for (int x = 0; x < BOARD_SIZE; ++x)
+    {
+        PutPiece(GetSquareAt(x, 0), KISHI_WHITE, backRank[x]);
+        PutPiece(GetSquareAt(x, 1), KISHI_WHITE, ChessPieceType::Pawn);
+        PutPiece(GetSquareAt(x, 6), KISHI_BLACK, ChessPieceType::Pawn);
+        PutPiece(GetSquareAt(x, 7), KISHI_BLACK, backRank[x]);
+    }
+    m_castlingRights = CASTLE_ALL;
+}
+
+void ChessPosition::PutPiece(int square, int kishiID, ChessPieceType type)
+{
+    if (!IsEmpty(square))
+    {
+        RemovePiece(square);
+    }
+    Bitboard bit = GetSquareBit(square);
+    m_pieces[kishiID][(int)type] |= bit;
+    m_kishiPieces[kishiID] |= bit;
+    m_occupied |= bit;
+    m_board[square] = GetPieceCode(kishiID, type);
+    m_pieceKey ^= g_zobristKeys.m_pieces[kishiID][(int)type][square];
+    m_midgameScore += g_chessEvaluationTables.m_midgameScores[kishiID][(int)type][square];
+    m_endgameScore += g_chessEvaluationTables.m_endgameScores[kishiID][(int)type][square];
+    m_gamePhase += g_chessEvaluationTables.m_phaseWeights[(int)type];
+}
+
+void ChessPosition::RemovePiece(int square)
+{
+    unsigned char code = m_board[square];
+    if (code == NO_PIECE_CODE)
+    {
+        return;
+    }
+    int kishiID = GetPieceCodeKishi(code);
+    int typeIndex = (int)GetPieceCodeType(code);
+    Bitboard bit = GetSquareBit(square);
+    m_pieces[kishiID][typeIndex] &= ~bit;
+    m_kishiPieces[kishiID] &= ~bit;
+    m_occupied &= ~bit;
+    m_board[square] = NO_PIECE_CODE;
+    m_pieceKey ^= g_zobristKeys.m_pieces[kishiID][typeIndex][square];
+    m_midgameScore -= g_chessEvaluationTables.m_midgameScores[kishiID][typeIndex][square];
+    m_endgameScore -= g_chessEvaluationTables.m_endgameScores[kishiID][typeIndex][square];
+    m_gamePhase -= g_chessEvaluationTables.m_phaseWeights[typeIndex];
+}
+
+void ChessPosition::MovePiece(int from, int to)
+{
+    unsigned char code = m_board[from];
+    if (code == NO_PIECE_CODE)
+    {
+        return;
+    }
+    RemovePiece(from);
+    PutPiece(to, GetPieceCodeKishi(code), GetPieceCodeType(code));
+}
+
+uint64_t ChessPosition::GetKey() const
+{
+    return m_pieceKey ^ GetChessStateKey(*this);
+}
+
+void ChessPosition::ClearCastlingRightsOn(int square)
+{
+    //Anything leaving or landing on a king or rook home square ends the castles that need it
+    switch (square)
+    {
+    case GetSquareAt(4, 0): m_castlingRights &= ~(CASTLE_WHITE_KINGSIDE | CASTLE_WHITE_QUEENSIDE); break;
+    case GetSquareAt(7, 0): m_castlingRights &= ~CASTLE_WHITE_KINGSIDE; break;
+    case GetSquareAt(0, 0): m_castlingRights &= ~CASTLE_WHITE_QUEENSIDE; break;
+    case GetSquareAt(4, 7): m_castlingRights &= ~(CASTLE_BLACK_KINGSIDE | CASTLE_BLACK_QUEENSIDE); break;
+    case GetSquareAt(7, 7): m_castlingRights &= ~CASTLE_BLACK_KINGSIDE; break;
+    case GetSquareAt(0, 7): m_castlingRights &= ~CASTLE_BLACK_QUEENSIDE; break;
+    default: break;
+    }
+}
+
+void ChessPosition::MakeMove(ChessMove const& move, ChessUndoRecord& out_undo)
+{
+    int const us = m_sideToMove;
+    int const from = move.m_from;
+    int const to = move.m_to;
+    bool const isEnPassant = move.m_result == ChessMoveResult::VALID_CAPTURE_ENPASSANT;
+    int const capturedSquare = isEnPassant ? GetSquareAt(GetSquareX(to), GetSquareY(from)) : to;
+
+    out_undo.m_move = move;
+    out_undo.m_capturedCode = m_board[capturedSquare];
+    out_undo.m_castlingRights = m_castlingRights;
+    out_undo.m_enPassantSquare = (signed char)m_enPassantSquare;
+    out_undo.m_halfmoveClock = m_halfmoveClock;
+
+    bool const isPawnMove = GetPieceTypeAt(from) == ChessPieceType::Pawn;
+    bool const isCapture = out_undo.m_capturedCode != NO_PIECE_CODE;
+    if (isCapture)
+    {
+        RemovePiece(capturedSquare);
+    }
+
+    ClearCastlingRightsOn(from);
+    ClearCastlingRightsOn(to);
+    MovePiece(from, to);
+    if (move.m_promoteTo != ChessPieceType::Count)
+    {
+        PutPiece(to, us, move.m_promoteTo);
+    }
+
+    int const homeY = GetSquareY(from);
+    if (move.m_result == ChessMoveResult::VALID_CASTLE_KINGSIDE)
+    {
+        MovePiece(GetSquareAt(7, homeY), GetSquareAt(5, homeY));
+    }
+    else if (move.m_result == ChessMoveResult::VALID_CASTLE_QUEENSIDE)
+    {
+        MovePiece(GetSquareAt(0, homeY), GetSquareAt(3, homeY));
+    }
+
+    m_enPassantSquare = (move.m_result == ChessMoveResult::VALID_MOVE_PAWN_2SQUARE) ? (from + to) / 2 : NO_SQUARE;
+    m_halfmoveClock = (isPawnMove || isCapture) ? 0 : m_halfmoveClock + 1;
+    if (us == KISHI_BLACK)
+    {
+        ++m_fullmoveNumber;
+    }
+    m_sideToMove = 1 - us;
+}
+
+void ChessPosition::UnmakeMove(ChessUndoRecord const& undo)
+{
+    ChessMove const& move = undo.m_move;
+    int const us = 1 - m_sideToMove;
+    int const from = move.m_from;
+    int const to = move.m_to;
+
+    m_sideToMove = us;
+    if (us == KISHI_BLACK)
+    {
+        --m_fullmoveNumber;
+    }
+
+    int const homeY = GetSquareY(from);
+    if (move.m_result == ChessMoveResult::VALID_CASTLE_KINGSIDE)
+    {
+        MovePiece(GetSquareAt(5, homeY), GetSquareAt(7, homeY));
+    }
+    else if (move.m_result == ChessMoveResult::VALID_CASTLE_QUEENSIDE)
+    {
+        MovePiece(GetSquareAt(3, homeY), GetSquareAt(0, homeY));
+    }
+
+    MovePiece(to, from);
+    if (move.m_promoteTo != ChessPieceType::Count)
+    {
+        PutPiece(from, us, ChessPieceType::Pawn);
+    }
+    if (undo.m_capturedCode != NO_PIECE_CODE)
+    {
+        int capturedSquare = (move.m_result == ChessMoveResult::VALID_CAPTURE_ENPASSANT) ? GetSquareAt(GetSquareX(to), GetSquareY(from)) : to;
+        PutPiece(capturedSquare, GetPieceCodeKishi(undo.m_capturedCode), GetPieceCodeType(undo.m_capturedCode));
+    }
+
+    m_castlingRights = undo.m_castlingRights;
+    m_enPassantSquare = undo.m_enPassantSquare;
+    m_halfmoveClock = undo.m_halfmoveClock;
+}
+
+void ChessPosition::ApplyMove(ChessMove const& move)
+{
+    ChessUndoRecord undo;
+    MakeMove(move, undo);
+}
+
+bool ChessPosition::SetFromFEN(std::string const& fen)
+{
+    size_t cursor = 0;
+    std::string_view placement = GetNextFENField(fen, cursor);
+    std::string_view side = GetNextFENField(fen, cursor);
+    std::string_view castling = GetNextFENField(fen, cursor);
+    std::string_view enPassant = GetNextFENField(fen, cursor);
+    int halfmoveClock = 0;
+    int fullmoveNumber = 1;
+    if (placement.empty() || side.empty())
+    {
+        return false;
+    }
+    ParseFENNumber(GetNextFENField(fen, cursor), halfmoveClock);
+    if (!ParseFENNumber(GetNextFENField(fen, cursor), fullmoveNumber)) fullmoveNumber = 1;
+
+    ChessPosition parsed;
+    parsed.Clear();
+
+    //Ranks are listed from 8 down to 1, files a to h
+    int x = 0;
+    int y = BOARD_SIZE - 1;
+    for (char c : placement)
+    {
+        if (c == '/')
+        {
+            if (x != BOARD_SIZE || y == 0)
+            {
+                return false;
+            }
+            x = 0;
+            --y;
+            continue;
+        }
+        if (c >= '1' && c <= '8')
+        {
+            x += c - '0';
+            if (x > BOARD_SIZE)
+            {
+                return false;
+            }
+            continue;
+        }
+        unsigned char code = ((unsigned char)c < 128) ? s_fenPieceCodes.m_codes[(unsigned char)c] : NO_PIECE_CODE;
+        if (code == NO_PIECE_CODE || x >= BOARD_SIZE)
+        {
+            return false;
+        }
+        parsed.PutPiece(GetSquareAt(x, y), GetPieceCodeKishi(code), GetPieceCodeType(code));
+        ++x;
+    }
+    if (x != BOARD_SIZE || y != 0)
+    {
+        return false;
+    }
+    if (CountBits(parsed.GetPieces(KISHI_WHITE, ChessPieceType::King)) != 1 || CountBits(parsed.GetPieces(KISHI_BLACK, ChessPieceType::King)) != 1)
+    {
+        return false;
+    }
+
+    if (side == "w") parsed.m_sideToMove = KISHI_WHITE;
+    else if (side == "b") parsed.m_sideToMove = KISHI_BLACK;
+    else return false;
+
+    for (char c : castling)
+    {
+        switch (c)
+        {
+        case 'K': parsed.m_castlingRights |= CASTLE_WHITE_KINGSIDE; break;
+        case 'Q': parsed.m_castlingRights |= CASTLE_WHITE_QUEENSIDE; break;
+        case 'k': parsed.m_castlingRights |= CASTLE_BLACK_KINGSIDE; break;
+        case 'q': parsed.m_castlingRights |= CASTLE_BLACK_QUEENSIDE; break;
+        case '-': break;
+        default: return false;
+        }
+    }
+    //Drop rights whose king or rook is not home, so castling never moves a piece that is not there
+    unsigned char const rightsNeeding[6] = {
+        CASTLE_WHITE_KINGSIDE | CASTLE_WHITE_QUEENSIDE, CASTLE_WHITE_KINGSIDE, CASTLE_WHITE_QUEENSIDE,
+        CASTLE_BLACK_KINGSIDE | CASTLE_BLACK_QUEENSIDE, CASTLE_BLACK_KINGSIDE, CASTLE_BLACK_QUEENSIDE };
+    int const homeSquares[6] = { GetSquareAt(4, 0), GetSquareAt(7, 0), GetSquareAt(0, 0), GetSquareAt(4, 7), GetSquareAt(7, 7), GetSquareAt(0, 7) };
+    ChessPieceType const homeTypes[6] = { ChessPieceType::King, ChessPieceType::Rook, ChessPieceType::Rook, ChessPieceType::King, ChessPieceType::Rook, ChessPieceType::Rook };
+    for (int homeIndex = 0; homeIndex < 6; ++homeIndex)
+    {
+        int kishiID = (homeIndex < 3) ? KISHI_WHITE : KISHI_BLACK;
+        if (parsed.GetPieceCodeAt(homeSquares[homeIndex]) != GetPieceCode(kishiID, homeTypes[homeIndex]))
+        {
+            parsed.m_castlingRights &= ~rightsNeeding[homeIndex];
+        }
+    }
+
+    parsed.m_enPassantSquare = NO_SQUARE;
+    if (!enPassant.empty() && enPassant != "-")
+    {
+        parsed.m_enPassantSquare = ParseSquareName(std::string(enPassant));
+        if (parsed.m_enPassantSquare == NO_SQUARE)
+        {
+            return false;
+        }
+        //Only right after the opponent's double push: the square it skipped is on its third rank, both squares the
+        //pawn crossed are empty and the pawn stands right in front of the skipped square
+        int const them = 1 - parsed.m_sideToMove;
+        int const skippedY = (them == KISHI_WHITE) ? 2 : BOARD_SIZE - 3;
+        int const forwardY = (them == KISHI_WHITE) ? 1 : -1;
+        int const epX = GetSquareX(parsed.m_enPassantSquare);
+        if (GetSquareY(parsed.m_enPassantSquare) != skippedY || !parsed.IsEmpty(parsed.m_enPassantSquare)
+            || !parsed.IsEmpty(GetSquareAt(epX, skippedY - forwardY))
+            || parsed.GetPieceCodeAt(GetSquareAt(epX, skippedY + forwardY)) != GetPieceCode(them, ChessPieceType::Pawn))
+        {
+            return false;
+        }
+    }
+    //The side that just moved cannot have left its king in check, or the first move could capture it
+    if (parsed.IsInCheck(1 - parsed.m_sideToMove))
+    {
+        return false;
+    }
+    parsed.m_halfmoveClock = halfmoveClock;
+    parsed.m_fullmoveNumber = fullmoveNumber;
+
+    *this = parsed;
+    return true;
+}
+
+std::string ChessPosition::GetFEN() const
+{
+    std::string fen;
+    for (int y = BOARD_SIZE - 1; y >= 0; --y)
+    {
+        int numEmpty = 0;
+        for (int x = 0; x < BOARD_SIZE; ++x)
+        {
+            unsigned char code = m_board[GetSquareAt(x, y)];
+            if (code == NO_PIECE_CODE)
+            {
+                ++numEmpty;
+                continue;
+            }
+            if (numEmpty > 0)
+            {
+                fen += (char)('0' + numEmpty);
+                numEmpty = 0;
+            }
+            fen += s_fenPieceChars[GetPieceCodeKishi(code)][(int)GetPieceCodeType(code)];
+        }
+        if (numEmpty > 0)
+        {
+            fen += (char)('0' + numEmpty);
+        }
+        if (y > 0)
+        {
+            fen += '/';
+        }
+    }
+
+    fen += (m_sideToMove == KISHI_WHITE) ? " w " : " b ";
+    if (m_castlingRights == 0)
+    {
+        fen += '-';
+    }
+    else
+    {
+        if (HasCastlingRight(CASTLE_WHITE_KINGSIDE)) fen += 'K';
+        if (HasCastlingRight(CASTLE_WHITE_QUEENSIDE)) fen += 'Q';
+        if (HasCastlingRight(CASTLE_BLACK_KINGSIDE)) fen += 'k';
+        if (HasCastlingRight(CASTLE_BLACK_QUEENSIDE)) fen += 'q';
+    }
+    fen += ' ' + GetSquareName(m_enPassantSquare);
+    fen += ' ' + std::to_string(m_halfmoveClock) + ' ' + std::to_string(m_fullmoveNumber);
+    return fen;
+}
+
+int ChessPosition::GetKishiAt(int square) const
+{
+    return IsEmpty(square) ? -1 : GetPieceCodeKishi(m_board[square]);
+}
+
+ChessPieceType ChessPosition::GetPieceTypeAt(int square) const
+{
+    return IsEmpty(square) ? ChessPieceType::Count : GetPieceCodeType(m_board[square]);
+}
+
+int ChessPosition::GetKingSquare(int kishiID) const
+{
+    Bitboard king = GetPieces(kishiID, ChessPieceType::King);
+    return king ? GetLowestSquare(king) : NO_SQUARE;
+}
+
+Bitboard ChessPosition::GetAttackersTo(int square, Bitboard occupied) const
+{
+    Bitboard rooksAndQueens = GetPiecesOfType(ChessPieceType::Rook) | GetPiecesOfType(ChessPieceType::Queen);
+    Bitboard bishopsAndQueens = GetPiecesOfType(ChessPieceType::Bishop) | GetPiecesOfType(ChessPieceType::Queen);
+
+    return (GetPawnAttacks(KISHI_BLACK, square) & GetPieces(KISHI_WHITE, ChessPieceType::Pawn))
+         | (GetPawnAttacks(KISHI_WHITE, square) & GetPieces(KISHI_BLACK, ChessPieceType::Pawn))
+         | (GetKnightAttacks(square) & GetPiecesOfType(ChessPieceType::Knight))
+         | (GetKingAttacks(square) & GetPiecesOfType(ChessPieceType::King))
+         | (GetRookAttacks(square, occupied) & rooksAndQueens)
+         | (GetBishopAttacks(square, occupied) & bishopsAndQueens);
+}
+
+bool ChessPosition::IsSquareAttacked(int square, int byKishiID) const
+{
+    return (GetAttackersTo(square, m_occupied) & m_kishiPieces[byKishiID]) != 0;
+}
+
+bool ChessPosition::IsInCheck(int kishiID) const
+{
+    int kingSquare = GetKingSquare(kishiID);
+    return kingSquare != NO_SQUARE && IsSquareAttacked(kingSquare, 1 - kishiID);
+}
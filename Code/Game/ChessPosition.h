@@ -0,0 +1,132 @@
+﻿#pragma once
+#include "ChessBitboard.h"
+
+#include <string>
+
+constexpr unsigned char CASTLE_WHITE_KINGSIDE = 1;
+constexpr unsigned char CASTLE_WHITE_QUEENSIDE = 2;
+constexpr unsigned char CASTLE_BLACK_KINGSIDE = 4;
+constexpr unsigned char CASTLE_BLACK_QUEENSIDE = 8;
+constexpr unsigned char CASTLE_ALL = 15;
+
+constexpr unsigned char NO_PIECE_CODE = 0xFF;
+
+//Piece codes packed into one byte for the mailbox: kishi in bit 3, type in bits 0-2
+constexpr unsigned char GetPieceCode(int kishiID, ChessPieceType type) { return (unsigned char)((kishiID << 3) | (int)type); }
+constexpr int GetPieceCodeKishi(unsigned char code) { return code >> 3; }
+constexpr ChessPieceType GetPieceCodeType(unsigned char code) { return (ChessPieceType)(code & 7); }
+
+//m_result reuses the referee's VALID_* results to tell the move kind (normal, double push, castle, en passant, promotion)
+struct ChessMove
+{
+    unsigned char m_from = 0;
+    unsigned char m_to = 0;
+    ChessMoveResult m_result = ChessMoveResult::VALID_MOVE_NORMAL;
+    ChessPieceType m_promoteTo = ChessPieceType::Count;
+
+    bool IsCapture() const;
+    bool operator==(ChessMove const& other) const;
+};
+
+std::string GetSquareName(int square); //"e4"
+int ParseSquareName(std::string const& text); //NO_SQUARE if malformed
+std::string GetMoveNotation(ChessMove const& move); //coordinate notation, "e2e4" / "e7e8q"
+
+//Everything MakeMove overwrites that the move itself cannot reproduce, so UnmakeMove restores the position exactly
+struct ChessUndoRecord
+{
+    ChessMove m_move;
+    unsigned char m_capturedCode = NO_PIECE_CODE;
+    unsigned char m_castlingRights = 0;
+    signed char m_enPassantSquare = NO_SQUARE;
+    int m_halfmoveClock = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------
+//Fixed-capacity LIFO of undo records; once full the oldest record is dropped, pushing never allocates
+template <typename RecordType, int CAPACITY>
+class ChessUndoStack
+{
+public:
+    RecordType& Push()
+    {
+        if (m_size == CAPACITY)
+        {
+            m_start = (m_start + 1) % CAPACITY;
+            --m_size;
+        }
+        RecordType& record = m_records[(m_start + m_size) % CAPACITY];
+        ++m_size;
+        return record;
+    }
+    void Pop() { if (m_size > 0) --m_size; }
+    RecordType& Top() { return m_records[(m_start + m_size - 1) % CAPACITY]; }
+    RecordType const& Top() const { return m_records[(m_start + m_size - 1) % CAPACITY]; }
+    RecordType const& operator[](int index) const { return m_records[(m_start + index) % CAPACITY]; }
+    void Clear() { m_start = 0; m_size = 0; }
+    bool IsEmpty() const { return m_size == 0; }
+    int Size() const { return m_size; }
+
+private:
+    RecordType m_records[CAPACITY];
+    int m_start = 0;
+    int m_size = 0;
+};
+
+constexpr int MAX_CHESS_GAME_PLIES = 1024;
+
+char const* const CHESS_STARTING_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+//----------------------------------------------------------------------------------------------------------
+//Engine-free rules state of a game: one bitboard per (kishi, piece type) plus a byte mailbox for square queries
+class ChessPosition
+{
+public:
+    ChessPosition();
+
+    void Clear();
+    void SetToStartingPosition();
+    bool SetFromFEN(std::string const& fen); //leaves the position untouched and returns false if the text is malformed
+    std::string GetFEN() const;
+
+    void PutPiece(int square, int kishiID, ChessPieceType type);
+    void RemovePiece(int square);
+    void MovePiece(int from, int to);
+    void ClearCastlingRightsOn(int square);
+    void MakeMove(ChessMove const& move, ChessUndoRecord& out_undo); //move must come from GenerateLegalMoves for this position
+    void UnmakeMove(ChessUndoRecord const& undo); //undo must be the record of the last move made
+    void ApplyMove(ChessMove const& move); //MakeMove without keeping the undo record
+
+    bool IsEmpty(int square) const { return m_board[square] == NO_PIECE_CODE; }
+    unsigned char GetPieceCodeAt(int square) const { return m_board[square]; }
+    int GetKishiAt(int square) const;
+    ChessPieceType GetPieceTypeAt(int square) const;
+    Bitboard GetPieces(int kishiID, ChessPieceType type) const { return m_pieces[kishiID][(int)type]; }
+    Bitboard GetPiecesOfType(ChessPieceType type) const { return m_pieces[0][(int)type] | m_pieces[1][(int)type]; }
+    Bitboard GetKishiPieces(int kishiID) const { return m_kishiPieces[kishiID]; }
+    Bitboard GetOccupied() const { return m_occupied; }
+    int GetKingSquare(int kishiID) const;
+
+    Bitboard GetAttackersTo(int square, Bitboard occupied) const;
+    bool IsSquareAttacked(int square, int byKishiID) const;
+    bool IsInCheck(int kishiID) const;
+
+    bool HasCastlingRight(unsigned char right) const { return (m_castlingRights & right) != 0; }
+    uint64_t GetKey() const; //Zobrist key, equal to ComputeChessPositionKey but O(1)
+
+public:
+    Bitboard m_pieces[NUM_KISHI][NUM_CHESS_PIECE_TYPES];
+    Bitboard m_kishiPieces[NUM_KISHI];
+    Bitboard m_occupied = 0;
+    unsigned char m_board[NUM_BOARD_SQUARES];
+    int m_sideToMove = KISHI_WHITE;
+    unsigned char m_castlingRights = CASTLE_ALL;
+    int m_enPassantSquare = NO_SQUARE; //square a pawn may capture onto, NO_SQUARE if the last move was not a double push
+    int m_halfmoveClock = 0; //moves since the last capture or pawn move
+    int m_fullmoveNumber = 1;
+    uint64_t m_pieceKey = 0; //xor of the Zobrist keys of every piece on the board, kept current by PutPiece/RemovePiece
+    //Running tapered evaluation terms, white minus black, kept current by PutPiece/RemovePiece (see ChessEvaluation.h)
+    int m_midgameScore = 0;
+    int m_endgameScore = 0;
+    int m_gamePhase = 0;
+};
@@ -1,5 +1,14 @@
 ﻿#include "ChessReferee.h"
-
+#include "ChessAnalysis.h"
+#include "ChessEvaluation.h"
+#include "ChessMoveGen.h"
+#include "ChessOpeningBook.h"
+#include "ChessPackedPosition.h"
+#include "ChessSearchWorker.h"
+#include "ChessTablebaseWorker.h"
+#include "ChessZobrist.h"
+
+#include <algorithm>
 #include <complex>
 
 #include "Game.hpp"
@@ -7,6 +16,7 @@
 #include "Player.hpp"
 #include "Engine/Core/EventSystem.hpp"
 #include "Engine/Core/Clock.hpp"
+#include "Engine/Core/VertexUtils.hpp"
 #include "Engine/Math/AABB3.hpp"
 #include "Engine/Math/FloatRange.hpp"
 
@@ -33,13 +43,15 @@ ChessReferee::ChessReferee(ChessKishi* chessKishi[2])
     /*PrintCurrentPlayerRound();
     PrintBoardStateToDevConsole();*/
 
-    m_ghostPiece = new ChessPiece(0, ChessPieceType::Pawn, Vec3(), EulerAngles());
+    m_ghostPiece = m_chessBoard->m_piecePool.CreatePiece(0, ChessPieceType::Pawn, Vec3(), EulerAngles()); //freed with the board
 }
 
 ChessReferee::~ChessReferee()
 {
+    StopAnalysis();
     delete m_chessBoard;
     m_chessBoard = nullptr;
+    m_ghostPiece = nullptr;
 }
 
 void ChessReferee::InitializeTheBoard()
@@ -126,8 +138,12 @@ void ChessReferee::Update(float deltaSeconds)
 {
     m_chessBoard->Update(deltaSeconds);
     UpdateLights(deltaSeconds);
+    UpdateAIKishi();
+    UpdateAnalysis();
+    UpdateTablebase();
+    UpdateBook();
 
-    if (m_myKishi)
+    if (m_myKishi && !m_chessKishi[m_currentMoveKishiIndex]->IsAI())
 	{
 		if (!g_theGame->m_isRemote || (m_currentState == MatchState::PLAYING &&
 			m_currentMoveKishiIndex == m_myKishi->GetPlayerID()))
@@ -216,9 +232,9 @@ void ChessReferee::Reset()
 		m_currentState = MatchState::CONNECTING;
 		g_theDevConsole->AddLine(Rgba8::PEACH, "The match state is: Connecting. Try to connect to a server/client to play.");
 	}
-    delete m_chessBoard;
-    m_chessBoard = nullptr;
-    m_chessBoard = new ChessBoard(this);
+    m_chessBoard->ResetPieces(); //same pieces back on their start squares, nothing is reallocated
+    g_theGame->m_hasWon = false;
+    g_theGame->m_isDraw = false;
 
 	m_nextMoveKishiIndex = 0;  //1先移动
 	m_currentMoveKishiIndex = 1;
@@ -230,6 +246,7 @@ void ChessReferee::Reset()
 	m_connectedKishi = 0;
 	m_currentSetFromCoord = IntVec2::NEGATIVEONE;
 	m_currentSetToCoord = IntVec2::NEGATIVEONE;
+	m_openingName.clear();
 }
 
 void ChessReferee::RegisterForEvents()
@@ -259,6 +276,14 @@ void ChessReferee::RegisterForEvents()
     g_theEventSystem->SubscribeEventCallBackFunction("changestate", OnMatchStateChange);
     g_theEventSystem->SubscribeEventCallBackFunction("connectsucceed", OnConnectSucceed);
     g_theEventSystem->SubscribeEventCallBackFunction("joingame", OnJoinGame);
+    g_theEventSystem->SubscribeEventCallBackFunction("chessbench", OnChessBenchmark);
+    g_theEventSystem->SubscribeEventCallBackFunction("chesstakeback", OnChessTakeback);
+    g_theEventSystem->SubscribeEventCallBackFunction("chessfen", OnChessFEN);
+    g_theEventSystem->SubscribeEventCallBackFunction("chessai", OnChessAI);
+    g_theEventSystem->SubscribeEventCallBackFunction("chessanalyze", OnChessAnalyze);
+    g_theEventSystem->SubscribeEventCallBackFunction("chesseval", OnChessEval);
+    g_theEventSystem->SubscribeEventCallBackFunction("chesstablebase", OnChessTablebase);
+    g_theEventSystem->SubscribeEventCallBackFunction("chessbook", OnChessBook);
 }
 
 void ChessReferee::PrintBoardStateToDevConsole()
@@ -281,14 +306,14 @@ void ChessReferee::PrintBoardStateToDevConsole()
             ChessPiece* piece = m_chessBoard->GetPiece(coord);
             if (piece != nullptr)
             {
-                char symbol = piece->m_definition.m_glyph[piece->m_ownerKishiID];
+                char symbol = piece->m_definition->m_glyph[piece->m_ownerKishiID];
                 line += symbol;
             }
             // auto iter = m_chessBoard->m_chessPieces.find(coord);
             // if (iter != m_chessBoard->m_chessPieces.end() && iter->second != nullptr)
             // {
             //     const ChessPiece* piece = iter->second;
-            //     char symbol = piece->m_definition.m_glyph[piece->m_ownerKishiID];
+            //     char symbol = piece->m_definition->m_glyph[piece->m_ownerKishiID];
             //     line += symbol;
             // }
             else
@@ -317,7 +342,7 @@ std::string ChessReferee::GetBoardStateAsString()
             ChessPiece* piece = m_chessBoard->GetPiece(coord);
             if (piece != nullptr)
             {
-                char symbol = piece->m_definition.m_glyph[piece->m_ownerKishiID];
+                char symbol = piece->m_definition->m_glyph[piece->m_ownerKishiID];
                 boardString += symbol;
             }
             else
@@ -351,8 +376,461 @@ void ChessReferee::PrintCurrentPlayerRound()
 void ChessReferee::SwapAndPrintBoardStatesAndRound() const
 {
     std::swap(g_theGame->m_chessReferee->m_nextMoveKishiIndex, g_theGame->m_chessReferee->m_currentMoveKishiIndex);
+    g_theGame->m_chessReferee->m_chessBoard->EndTurn(g_theGame->m_chessReferee->m_currentMoveKishiIndex);
     g_theGame->m_chessReferee->PrintCurrentPlayerRound();
     g_theGame->m_chessReferee->PrintBoardStateToDevConsole();
+    g_theGame->m_chessReferee->CheckForMateOrStalemate();
+}
+
+bool ChessReferee::BeginMoveRecord(IntVec2 from, IntVec2 to)
+{
+    if (!m_chessBoard->IsOnBoard(from) || !m_chessBoard->IsOnBoard(to))
+        return false;
+
+    ChessMoveList legalMoves;
+    GenerateLegalMoves(m_chessBoard->GetPosition(), legalMoves);
+    ChessMove const* move = legalMoves.Find(m_chessBoard->GetSquareIndex(from), m_chessBoard->GetSquareIndex(to));
+    if (move == nullptr)
+        return false;
+
+    m_chessBoard->BeginMoveRecord(*move);
+    return true;
+}
+
+void ChessReferee::EndMoveRecord(int kishiIndexBeforeMove)
+{
+    //ChessPiece::OnMove only hands the turn over when the move really happened
+    if (m_currentMoveKishiIndex != kishiIndexBeforeMove)
+    {
+        m_chessBoard->CommitMoveRecord();
+    }
+}
+
+void ChessReferee::CheckForMateOrStalemate()
+{
+    if (g_theGame->m_hasWon)
+        return;
+
+    ChessPosition const& position = m_chessBoard->GetPosition();
+    ChessMoveList legalMoves;
+    GenerateLegalMoves(position, legalMoves);
+    bool isInCheck = position.IsInCheck(m_currentMoveKishiIndex);
+
+    if (legalMoves.Size() > 0)
+    {
+        if (isInCheck)
+        {
+            g_theDevConsole->AddLine(Rgba8::PEACH, "Player #" + std::to_string(m_currentMoveKishiIndex) + " ("
+                + m_chessKishi[m_currentMoveKishiIndex]->m_colorName + ") is in check!");
+        }
+        //Mate on the move that reaches them takes precedence, so the draw rules are only checked here
+        if (m_chessBoard->GetRepetitionCount() >= 3)
+        {
+            DeclareDraw("Threefold repetition! The same position has occurred three times, the match is a draw.");
+        }
+        else if (m_chessBoard->IsFiftyMoveRuleReached())
+        {
+            DeclareDraw("Fifty-move rule! No capture or pawn move in the last 50 moves, the match is a draw.");
+        }
+        return;
+    }
+
+    if (isInCheck)
+    {
+        g_theGame->m_hasWon = true;
+        g_theDevConsole->AddLine(Rgba8::GREY, "#########################################");
+        g_theDevConsole->AddLine(Rgba8::YELLOW, "Checkmate! Player #" + std::to_string(m_nextMoveKishiIndex) + " ("
+            + m_chessKishi[m_nextMoveKishiIndex]->m_colorName + ") has won the match!");
+        g_theDevConsole->AddLine(Rgba8::GREY, "#########################################");
+    }
+    else
+    {
+        DeclareDraw("Stalemate! Player #" + std::to_string(m_currentMoveKishiIndex) + " ("
+            + m_chessKishi[m_currentMoveKishiIndex]->m_colorName + ") has no legal move, the match is a draw.");
+    }
+}
+
+bool ChessReferee::LoadFEN(std::string const& fen)
+{
+    if (!m_chessBoard->LoadFEN(fen))
+        return false;
+
+    if (m_chessRaycastResult.m_impactedObject != nullptr)
+    {
+        ResetChessMoveRayCast();
+    }
+    m_hasGrabbedPiece = false;
+    m_hasFoundLegalMovePos = false;
+    ClearGrabbedLegalTargets();
+
+    m_currentMoveKishiIndex = m_chessBoard->GetPosition().m_sideToMove;
+    m_nextMoveKishiIndex = 1 - m_currentMoveKishiIndex;
+    m_currentSetFromCoord = IntVec2::NEGATIVEONE;
+    m_currentSetToCoord = IntVec2::NEGATIVEONE;
+    g_theGame->m_hasWon = false;
+    g_theGame->m_isDraw = false;
+    m_openingName.clear(); //not reached through the opening named before
+    CheckForMateOrStalemate(); //a loaded position may already be over
+    return true;
+}
+
+void ChessReferee::SendValidationHash() const
+{
+    //16 hex digits instead of the whole board, the peer asks for the packed board only if its own hash differs
+    g_theNetworkSystem->SendStringToRemote("RemoteCmd cmd=chessvalidate hash="
+        + GetHashHex(GetChessValidationHash(m_chessBoard->GetPosition())) + " remote=true");
+}
+
+void ChessReferee::UpdateAIKishi()
+{
+    //Only ever polls the worker threads, a search in progress never holds up the frame
+    uint64_t key = m_chessBoard->GetPositionKey();
+    bool canMove = m_currentState == MatchState::PLAYING && !g_theGame->m_hasWon;
+    for (int kishiIndex = 0; kishiIndex < NUM_KISHI; ++kishiIndex)
+    {
+        ChessKishi* kishi = m_chessKishi[kishiIndex];
+        if (!kishi->IsAI())
+            continue;
+
+        bool isMySide = !g_theGame->m_isRemote || kishi == m_myKishi;
+        bool isMyTurn = canMove && kishiIndex == m_currentMoveKishiIndex && isMySide;
+        if (kishi->m_isPondering && isMyTurn)
+        {
+            UpdatePonderOutcome(kishiIndex, key);
+        }
+        bool isStillPondering = kishi->m_isPondering && canMove && key == kishi->m_ponderFromKey;
+        if (kishi->m_isThinking && !isStillPondering && (!isMyTurn || kishi->m_thinkingKey != key))
+        {
+            //Taken back, reloaded or reset under it, the answer is for a position that is gone
+            kishi->m_searchWorker->Stop();
+            kishi->m_isThinking = false;
+            kishi->m_isPondering = false;
+            kishi->m_isPonderHit = false;
+        }
+        if (!isMyTurn)
+        {
+            //The opponent's time: an AI across the board thinks on this machine too, so only a human or remote one is pondered on
+            bool isOpponentHuman = !m_chessKishi[1 - kishiIndex]->IsAI();
+            if (canMove && isMySide && isOpponentHuman && kishi->m_isPonderEnabled && !kishi->m_isThinking && kishi->m_hasPonderMove
+                && key == kishi->m_ponderFromKey)
+            {
+                StartPondering(kishiIndex);
+            }
+            continue;
+        }
+
+        if (!kishi->m_isThinking)
+        {
+            //A book move is a lookup in the mapped book, played at once without starting the search
+            ChessMove bookMove;
+            ChessOpeningBook const* book = g_theGame->m_openingBook;
+            if (kishi->m_isUsingBook && book != nullptr && book->PickMove(m_chessBoard->GetPosition(), GetNextZobristRandom(kishi->m_bookRandomState), bookMove))
+            {
+                g_theDevConsole->AddLine(Rgba8::LAVENDER, "Player #" + std::to_string(kishiIndex) + " (" + kishi->m_colorName + ") AI plays "
+                    + GetMoveNotation(bookMove) + " from the opening book");
+                PlayAIMove(bookMove);
+                return;
+            }
+
+            std::vector<uint64_t> gameKeys;
+            m_chessBoard->GetRepeatableKeys(gameKeys);
+            kishi->m_searchWorker->Start(m_chessBoard->GetPosition(), gameKeys, kishi->m_searchLimits);
+            kishi->m_isThinking = true;
+            kishi->m_thinkingKey = key;
+            continue;
+        }
+
+        ChessSearchResult result;
+        uint64_t resultKey = 0;
+        if (!kishi->m_searchWorker->TryTakeResult(result, resultKey) || resultKey != key)
+            continue;
+
+        kishi->m_isThinking = false;
+        if (!result.m_hasMove)
+            continue;
+
+        std::string ponderText;
+        if (kishi->m_isPonderHit)
+        {
+            //The search ran from the ponder start, only the part after the opponent's move was spent on our turn. What a
+            //normal search could have used is capped by movetime, the rest of a long ponder is not counted as saved
+            int turnMilliseconds = (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - kishi->m_ponderHitTime).count();
+            int searchMilliseconds = result.m_milliseconds;
+            if (kishi->m_searchLimits.m_maxMilliseconds > 0)
+            {
+                searchMilliseconds = std::min(searchMilliseconds, kishi->m_searchLimits.m_maxMilliseconds);
+            }
+            int savedMilliseconds = std::max(searchMilliseconds - turnMilliseconds, 0);
+            kishi->m_ponderSavedMilliseconds += savedMilliseconds;
+            kishi->m_isPonderHit = false;
+            ponderText = Stringf(" (ponder hit: %d ms on our turn, %d ms saved)", turnMilliseconds, savedMilliseconds);
+        }
+        g_theDevConsole->AddLine(Rgba8::LAVENDER, "Player #" + std::to_string(kishiIndex) + " (" + kishi->m_colorName + ") AI plays "
+            + GetMoveNotation(result.m_bestMove) + ", depth " + std::to_string(result.m_depth) + ", score " + std::to_string(result.m_score)
+            + ", " + std::to_string(result.m_nodes) + " nodes in " + std::to_string(result.m_milliseconds) + " ms" + ponderText);
+        PlayAIMove(result.m_bestMove);
+
+        //The second move of the principal variation is the reply this search expects, pondered from next frame on
+        kishi->m_hasPonderMove = result.m_principalVariation.size() >= 2;
+        if (kishi->m_hasPonderMove)
+        {
+            kishi->m_ponderMove = result.m_principalVariation[1];
+            kishi->m_ponderFromKey = m_chessBoard->GetPositionKey();
+        }
+        return; //the turn has passed, the other kishi starts thinking next frame
+    }
+}
+
+void ChessReferee::StartPondering(int kishiIndex)
+{
+    ChessKishi* kishi = m_chessKishi[kishiIndex];
+    kishi->m_hasPonderMove = false; //one try per move
+    ChessPosition position = m_chessBoard->GetPosition();
+    ChessMoveList legalMoves;
+    GenerateLegalMoves(position, legalMoves);
+    ChessMove const* ponderMove = legalMoves.Find(kishi->m_ponderMove.m_from, kishi->m_ponderMove.m_to, kishi->m_ponderMove.m_promoteTo);
+    if (ponderMove == nullptr)
+        return;
+
+    std::vector<uint64_t> gameKeys;
+    m_chessBoard->GetRepeatableKeys(gameKeys);
+    if (ponderMove->IsCapture() || position.GetPieceTypeAt(ponderMove->m_from) == ChessPieceType::Pawn)
+    {
+        gameKeys.clear(); //nothing before an irreversible move can come back
+    }
+    position.ApplyMove(*ponderMove);
+    kishi->m_searchWorker->Start(position, gameKeys, kishi->m_searchLimits, true);
+    kishi->m_isThinking = true;
+    kishi->m_isPondering = true;
+    kishi->m_thinkingKey = position.GetKey();
+}
+
+void ChessReferee::UpdatePonderOutcome(int kishiIndex, uint64_t key)
+{
+    ChessKishi* kishi = m_chessKishi[kishiIndex];
+    kishi->m_isPondering = false;
+    ++kishi->m_numPonders;
+    bool isHit = key == kishi->m_thinkingKey;
+    if (isHit)
+    {
+        //The warm search carries on and is played as soon as the limits are met, counting the time it already had
+        ++kishi->m_numPonderHits;
+        kishi->m_isPonderHit = true;
+        kishi->m_ponderHitTime = std::chrono::steady_clock::now();
+        kishi->m_searchWorker->PonderHit();
+    }
+    else
+    {
+        kishi->m_searchWorker->Stop(); //the search below starts over on the real position
+        kishi->m_isThinking = false;
+    }
+    g_theDevConsole->AddLine(Rgba8::LAVENDER, Stringf("Player #%d (%s) ponder %s, expected %s: %d/%d hits (%d%%), %.1f s of search saved",
+        kishiIndex, kishi->m_colorName.c_str(), isHit ? "hit" : "miss", GetMoveNotation(kishi->m_ponderMove).c_str(), kishi->m_numPonderHits,
+        kishi->m_numPonders, kishi->m_numPonderHits * 100 / kishi->m_numPonders, (float)kishi->m_ponderSavedMilliseconds / 1000.f));
+}
+
+void ChessReferee::PlayAIMove(ChessMove const& move)
+{
+    //Same path as a typed or remote move, so validation, history, networking and mate checks all apply
+    static char const* const s_promoteNames[NUM_CHESS_PIECE_TYPES] = { "bishop", "knight", "rook", "queen", "", "" };
+    EventArgs moveArgs;
+    moveArgs.SetValue("from", GetSquareName(move.m_from));
+    moveArgs.SetValue("to", GetSquareName(move.m_to));
+    if (IsPromotionChoice(move.m_promoteTo))
+    {
+        moveArgs.SetValue("promoteTo", s_promoteNames[(int)move.m_promoteTo]);
+    }
+    g_theEventSystem->FireEvent("chessmove", moveArgs);
+}
+
+void ChessReferee::UpdateAnalysis()
+{
+    if (m_analysis == nullptr)
+        return;
+    if (m_status != ChessStatus::SPECTATOR)
+    {
+        StopAnalysis(); //joined the match as a player
+        return;
+    }
+
+    //Every incoming remote chessmove (or reset, or takeback) changes the key, the threads drop the old position at once
+    uint64_t key = m_chessBoard->GetPositionKey();
+    if (key == m_analysisKey)
+        return;
+
+    m_analysisKey = key;
+    ChessMoveList legalMoves;
+    GenerateLegalMoves(m_chessBoard->GetPosition(), legalMoves);
+    if (legalMoves.Size() == 0)
+    {
+        m_analysis->Stop(); //mate or stalemate, nothing left to analyse
+        return;
+    }
+    std::vector<uint64_t> gameKeys;
+    m_chessBoard->GetRepeatableKeys(gameKeys);
+    m_analysis->Start(m_chessBoard->GetPosition(), gameKeys);
+}
+
+void ChessReferee::StopAnalysis()
+{
+    delete m_analysis; //stops and joins the threads
+    m_analysis = nullptr;
+    m_analysisKey = 0;
+}
+
+std::string ChessReferee::GetAnalysisHUDText() const
+{
+    if (m_analysis == nullptr)
+        return "";
+
+    ChessAnalysisInfo info = m_analysis->GetInfo();
+    std::string text = "Analysis (" + std::to_string(m_analysis->GetNumThreads()) + " threads) ";
+    if (!info.m_hasLine || info.m_positionKey != m_chessBoard->GetPositionKey())
+        return text + "thinking...";
+
+    //Shown from white's side like a regular eval bar, mates as M<moves>
+    int whiteScore = (info.m_sideToMove == KISHI_WHITE) ? info.m_score : -info.m_score;
+    std::string scoreText;
+    if (IsChessMateScore(whiteScore))
+    {
+        int matePlies = CHESS_MATE_SCORE - abs(whiteScore);
+        scoreText = std::string(whiteScore > 0 ? "M" : "-M") + std::to_string((matePlies + 1) / 2);
+    }
+    else
+    {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%+.2f", (float)whiteScore / 100.f);
+        scoreText = buffer;
+    }
+    int kiloNodesPerSecond = (info.m_milliseconds > 0) ? (int)(info.m_nodes / info.m_milliseconds) : 0;
+    text += "depth " + std::to_string(info.m_depth) + " eval " + scoreText + " | " + std::to_string(kiloNodesPerSecond) + " kN/s |";
+    for (int moveIndex = 0; moveIndex < (int)info.m_principalVariation.size() && moveIndex < 12; ++moveIndex)
+    {
+        text += " " + GetMoveNotation(info.m_principalVariation[moveIndex]);
+    }
+    return text;
+}
+
+void ChessReferee::UpdateTablebase()
+{
+    ChessTablebaseWorker* worker = g_theGame->m_tablebaseWorker;
+    if (worker == nullptr)
+        return;
+
+    ChessPosition const& position = m_chessBoard->GetPosition();
+    uint64_t key = position.GetKey();
+    if (key != m_tablebaseKey)
+    {
+        m_tablebaseKey = key;
+        m_hasTablebaseVerdict = false;
+        if (CountBits(position.GetOccupied()) <= g_theGame->m_tablebase->GetMaxPieces())
+        {
+            worker->Request(position); //answered a frame or so later, even when the page has to come from disk
+        }
+    }
+
+    ChessTablebaseResult result;
+    bool isFound = false;
+    uint64_t resultKey = 0;
+    if (!worker->TryTakeResult(result, isFound, resultKey) || resultKey != m_tablebaseKey || !isFound)
+        return;
+
+    m_tablebaseVerdict = result;
+    m_hasTablebaseVerdict = true;
+    AdjudicateFromTablebase();
+}
+
+void ChessReferee::AdjudicateFromTablebase()
+{
+    if (!m_isTablebaseAdjudicating || g_theGame->m_isRemote || g_theGame->m_hasWon || !m_hasTablebaseVerdict)
+        return;
+
+    if (m_tablebaseVerdict.m_wdl == ChessTablebaseWDL::Draw)
+    {
+        DeclareDraw("Tablebase adjudication! The endgame tables show a draw with best play, the match is a draw.");
+        return;
+    }
+    if (m_tablebaseVerdict.m_wdl == ChessTablebaseWDL::CursedWin || m_tablebaseVerdict.m_wdl == ChessTablebaseWDL::BlessedLoss)
+    {
+        DeclareDraw("Tablebase adjudication! The win takes longer than the fifty-move rule allows, the match is a draw.");
+        return;
+    }
+    //The tables count the fifty moves from a fresh start, so only call a win the stronger side converts before the
+    //count already running out
+    ChessPosition const& position = m_chessBoard->GetPosition();
+    if (position.m_halfmoveClock + m_tablebaseVerdict.m_dtz > 100)
+        return;
+
+    int winnerIndex = (m_tablebaseVerdict.m_wdl == ChessTablebaseWDL::Win) ? position.m_sideToMove : 1 - position.m_sideToMove;
+    g_theGame->m_hasWon = true;
+    g_theDevConsole->AddLine(Rgba8::GREY, "#########################################");
+    g_theDevConsole->AddLine(Rgba8::YELLOW, "Tablebase adjudication! Player #" + std::to_string(winnerIndex) + " ("
+        + m_chessKishi[winnerIndex]->m_colorName + ") has a forced win and is awarded the match!");
+    g_theDevConsole->AddLine(Rgba8::GREY, "#########################################");
+}
+
+std::string ChessReferee::GetTablebaseHUDText() const
+{
+    if (m_status != ChessStatus::SPECTATOR || !m_hasTablebaseVerdict)
+        return "";
+
+    if (m_tablebaseVerdict.m_wdl == ChessTablebaseWDL::Draw)
+        return "Tablebase: draw";
+
+    int sideToMove = m_chessBoard->GetPosition().m_sideToMove;
+    int winnerIndex = (m_tablebaseVerdict.m_wdl > ChessTablebaseWDL::Draw) ? sideToMove : 1 - sideToMove;
+    if (m_tablebaseVerdict.m_wdl == ChessTablebaseWDL::CursedWin || m_tablebaseVerdict.m_wdl == ChessTablebaseWDL::BlessedLoss)
+        return "Tablebase: draw by the fifty-move rule, " + m_chessKishi[winnerIndex]->m_colorName + " wins without it";
+
+    std::string text = "Tablebase: " + m_chessKishi[winnerIndex]->m_colorName + " wins, DTZ " + std::to_string(m_tablebaseVerdict.m_dtz);
+    if (m_chessBoard->GetPosition().m_halfmoveClock + m_tablebaseVerdict.m_dtz > 100)
+    {
+        text += " (past the fifty-move rule)";
+    }
+    return text;
+}
+
+void ChessReferee::UpdateBook()
+{
+    ChessOpeningBook const* book = g_theGame->m_openingBook;
+    ChessPosition const& position = m_chessBoard->GetPosition();
+    if (book == nullptr || position.GetKey() == m_bookKey)
+        return;
+
+    //Only a binary search of the mapped book, cheap enough to run on the frame whenever the position changes
+    m_bookKey = position.GetKey();
+    char const* openingName = book->GetOpeningName(position);
+    if (openingName != nullptr)
+    {
+        m_openingName = openingName;
+    }
+
+    ChessBookMove moves[MAX_CHESS_BOOK_MOVES];
+    int numMoves = book->Probe(position, moves, MAX_CHESS_BOOK_MOVES);
+    int totalWeight = 0;
+    for (int moveIndex = 0; moveIndex < numMoves; ++moveIndex)
+    {
+        totalWeight += moves[moveIndex].m_weight;
+    }
+
+    m_bookHUDText = m_openingName.empty() ? "" : "Opening: " + m_openingName;
+    if (totalWeight > 0)
+    {
+        m_bookHUDText += m_bookHUDText.empty() ? "Book:" : " | Book:";
+        for (int moveIndex = 0; moveIndex < numMoves && moveIndex < 4 && moves[moveIndex].m_weight > 0; ++moveIndex)
+        {
+            m_bookHUDText += Stringf(" %s %d%%", GetMoveNotation(moves[moveIndex].m_move).c_str(), moves[moveIndex].m_weight * 100 / totalWeight);
+        }
+    }
+}
+
+void ChessReferee::DeclareDraw(std::string const& reason)
+{
+    g_theGame->m_hasWon = true;
+    g_theGame->m_isDraw = true;
+    g_theDevConsole->AddLine(Rgba8::GREY, "#########################################");
+    g_theDevConsole->AddLine(Rgba8::YELLOW, reason);
+    g_theDevConsole->AddLine(Rgba8::GREY, "#########################################");
 }
 
 void ChessReferee::Render() const
@@ -377,6 +855,7 @@ void ChessReferee::Render() const
 
     if(m_chessBoard)
         m_chessBoard->Render();
+    RenderGrabbedLegalTargets();
     RenderGhostPiece();
 }
 
@@ -388,6 +867,18 @@ void ChessReferee::RenderGhostPiece() const
     }
 }
 
+void ChessReferee::RenderGrabbedLegalTargets() const
+{
+    if (!m_hasGrabbedPiece || m_grabbedTargetVerts.empty())
+        return;
+
+    g_theRenderer->BindShader(nullptr);
+    g_theRenderer->BindTexture(nullptr);
+    g_theRenderer->SetModelConstants();
+    g_theRenderer->SetBlendMode(BlendMode::ALPHA);
+    g_theRenderer->DrawVertexArray(m_grabbedTargetVerts);
+}
+
 bool ChessReferee::OnChessMove(EventArgs& args)
 {
     if (g_theGame->m_hasWon)
@@ -508,7 +999,7 @@ bool ChessReferee::OnChessMove(EventArgs& args)
     ChessPiece* fromPiece = g_theGame->m_chessReferee->m_chessBoard->GetPiece(fromCoord);
     if (fromPiece->m_ownerKishiID != g_theGame->m_chessReferee->m_currentMoveKishiIndex)
     {
-        g_theDevConsole->AddLine(Rgba8::RED, "The " + fromPiece->m_definition.m_name +
+        g_theDevConsole->AddLine(Rgba8::RED, "The " + fromPiece->m_definition->m_name +
             " at " + from + " belongs to player #" + std::to_string(g_theGame->m_chessReferee->m_nextMoveKishiIndex)
             + " ("+nextColor+"); it is currently player #"+
             std::to_string(g_theGame->m_chessReferee->m_currentMoveKishiIndex)+ " (" + currentColor+")'s turn.");
@@ -521,7 +1012,7 @@ bool ChessReferee::OnChessMove(EventArgs& args)
     if (toPiece &&fromPiece->m_ownerKishiID == toPiece->m_ownerKishiID)
     {
         g_theDevConsole->AddLine(Rgba8::RED, "Cannot move to" + to +
-            ", since it is occupied by your own "+toPiece->m_definition.m_name);
+            ", since it is occupied by your own "+toPiece->m_definition->m_name);
         ChessMoveResult result = ChessMoveResult::INVALID_MOVE_DESTINATION_BLOCKED;
         g_theDevConsole->AddLine(Rgba8::RED, GetMoveResultString(result));
         return true;
@@ -548,13 +1039,23 @@ bool ChessReferee::OnChessMove(EventArgs& args)
     if (tResult == false)
     {
         //capture! //二编: move!!
+        int kishiIndexBeforeMove = g_theGame->m_chessReferee->m_currentMoveKishiIndex;
+        bool isRecording = g_theGame->m_chessReferee->BeginMoveRecord(fromCoord, toCoord);
         fromPiece->OnMove(fromCoord, toCoord, promoteType);
+        if (isRecording)
+        {
+            g_theGame->m_chessReferee->EndMoveRecord(kishiIndexBeforeMove);
+        }
 
         if (!args.GetValue("remote", false))
         {
 			std::string anotherCmd = args.AppendToString();
 			anotherCmd = "RemoteCmd cmd=chessmove " + anotherCmd + " remote=true";
 			g_theNetworkSystem->SendStringToRemote(anotherCmd);
+            if (g_theGame->m_isRemote)
+            {
+                g_theGame->m_chessReferee->SendValidationHash(); //cheap enough to check the peer after every move
+            }
         }
 
         return true;
@@ -563,15 +1064,16 @@ bool ChessReferee::OnChessMove(EventArgs& args)
     {
         g_theDevConsole->AddLine(Rgba8::MISTBLUE,
         "Moved Player #" + std::to_string(g_theGame->m_chessReferee->m_currentMoveKishiIndex) + " ("
-            +currentColor+")'s " + fromPiece->m_definition.m_name + " from " + from + " to " + to);
+            +currentColor+")'s " + fromPiece->m_definition->m_name + " from " + from + " to " + to);
         if (toPiece)
         {
             g_theDevConsole->AddLine(Rgba8::PEACH,
             "Player #" + std::to_string(g_theGame->m_chessReferee->m_currentMoveKishiIndex) + " ("
                 + currentColor +") captured Player #" + std::to_string(g_theGame->m_chessReferee->m_nextMoveKishiIndex)
-                + " ("+ nextColor +")'s " + toPiece->m_definition.m_name + " at " + to);
+                + " ("+ nextColor +")'s " + toPiece->m_definition->m_name + " at " + to);
         }
         g_theGame->m_chessReferee->m_chessBoard->CaptureAnotherPiece(fromCoord, toCoord);
+        g_theGame->m_chessReferee->m_chessBoard->ClearMoveHistory(); //a teleport has no legal move to undo
         
         fromPiece->OnSemiLegalMove(fromCoord, toCoord, promoteType);
     
@@ -585,12 +1087,18 @@ bool ChessReferee::OnChessMove(EventArgs& args)
         }
     
         std::swap(g_theGame->m_chessReferee->m_nextMoveKishiIndex, g_theGame->m_chessReferee->m_currentMoveKishiIndex);
+        g_theGame->m_chessReferee->m_chessBoard->EndTurn(g_theGame->m_chessReferee->m_currentMoveKishiIndex);
         g_theGame->m_chessReferee->PrintCurrentPlayerRound();
         g_theGame->m_chessReferee->PrintBoardStateToDevConsole();
+        g_theGame->m_chessReferee->CheckForMateOrStalemate();
 
 		std::string anotherCmd = args.AppendToString();
 		anotherCmd = "RemoteCmd cmd=chessmove " + anotherCmd + " remote=true";
 		g_theNetworkSystem->SendStringToRemote(anotherCmd);
+        if (g_theGame->m_isRemote && !args.GetValue("remote", false))
+        {
+            g_theGame->m_chessReferee->SendValidationHash();
+        }
 
         return true;
     }
@@ -939,58 +1447,76 @@ bool ChessReferee::OnChessValidate(EventArgs& args)
 		g_theDevConsole->AddLine(Rgba8::YELLOW, "WARNING: Spectators cannot check if it's validate.");
 		return false;
 	}
-    if (args.GetValue("remote", false)) //远端发来了东西 打印到devConsole
+    ChessReferee* referee = g_theGame->m_chessReferee;
+    if (!args.GetValue("remote", false))
+    {
+        referee->SendValidationHash();
+        return true;
+    }
+
+    //远端发来了东西: a hash first, the packed board only when the hashes disagree
+    ChessPosition const& myPosition = referee->m_chessBoard->GetPosition();
+    bool mismatch = false;
+    if (args.Has("resend"))
     {
-        std::string longInfo = args.AppendToString();
-        Strings infos = SplitStringOnDelimiter(longInfo, ' ');
-        for (std::string line : infos)
+        ChessPackedPosition packed;
+        if (PackChessPosition(myPosition, packed))
         {
-            Strings subLines = SplitStringOnDelimiter(line, '\n');
-            for (std::string subLine : subLines)
-            {
-                g_theDevConsole->AddLine(Rgba8::MINTGREEN, subLine);
-            }
+            g_theNetworkSystem->SendStringToRemote("RemoteCmd cmd=chessvalidate packed=" + GetPackedPositionHex(packed) + " remote=true");
         }
-
-        std::string remoteState = args.GetValue("state", "");
-        int remoteMoveIndex = args.GetValue("currentmovingplayer", -1);
-        std::string myState = g_theGame->m_chessReferee->GetBoardStateAsString();
-        int myMoveIndex = g_theGame->m_chessReferee->m_currentMoveKishiIndex;
-        
-        bool mismatch = false;
-        if (remoteState != myState)
+        return true;
+    }
+    else if (args.Has("packed"))
+    {
+        ChessPackedPosition remotePacked;
+        ChessPosition remotePosition;
+        if (!ParsePackedPositionHex(args.GetValue("packed", ""), remotePacked) || !UnpackChessPosition(remotePacked, remotePosition))
         {
             mismatch = true;
-            g_theDevConsole->AddLine(Rgba8::RED, "Validation FAILED: board mismatch");
+            g_theDevConsole->AddLine(Rgba8::RED, "Validation FAILED: the remote board could not be decoded");
         }
-        if (remoteMoveIndex != myMoveIndex)
+        else if (remotePosition.GetFEN() != myPosition.GetFEN())
         {
             mismatch = true;
-            g_theDevConsole->AddLine(Rgba8::RED, "Validation FAILED: current moving player mismatch");
+            g_theDevConsole->AddLine(Rgba8::RED, "Validation FAILED: board mismatch");
+            g_theDevConsole->AddLine(Rgba8::MINTGREEN, "Remote: " + remotePosition.GetFEN());
+            g_theDevConsole->AddLine(Rgba8::MINTGREEN, "Local:  " + myPosition.GetFEN());
+            for (int square = 0; square < NUM_BOARD_SQUARES; ++square)
+            {
+                if (remotePosition.GetPieceCodeAt(square) != myPosition.GetPieceCodeAt(square))
+                {
+                    g_theDevConsole->AddLine(Rgba8::RED, "  Squares differ at " + GetSquareName(square));
+                }
+            }
         }
-        if (mismatch)
+    }
+    else
+    {
+        uint64_t remoteHash = 0;
+        if (!ParseHashHex(args.GetValue("hash", ""), remoteHash))
         {
-            g_theDevConsole->AddLine(Rgba8::RED, "Validation failed, disconnecting...");
-
-            EventArgs disconnectArgs;
-            disconnectArgs.SetValue("reason", "VALIDATION FAILED");
-            g_theEventSystem->FireEvent("chessdisconnect", disconnectArgs);
+            g_theDevConsole->AddLine(Rgba8::RED, "chessvalidate received no hash.");
+            return false;
         }
-        else
+        if (remoteHash != GetChessValidationHash(myPosition))
         {
-            g_theDevConsole->AddLine(Rgba8::GREEN, "Validation PASSED.");
+            g_theDevConsole->AddLine(Rgba8::YELLOW, "Validation hash mismatch, asking for the packed board...");
+            g_theNetworkSystem->SendStringToRemote("RemoteCmd cmd=chessvalidate resend=true remote=true");
+            return true;
         }
     }
+
+    if (mismatch)
+    {
+        g_theDevConsole->AddLine(Rgba8::RED, "Validation failed, disconnecting...");
+
+        EventArgs disconnectArgs;
+        disconnectArgs.SetValue("reason", "VALIDATION FAILED");
+        g_theEventSystem->FireEvent("chessdisconnect", disconnectArgs);
+    }
     else
     {
-        EventArgs remoteArgs;
-        remoteArgs.SetValue("state", g_theGame->m_chessReferee->GetBoardStateAsString());
-        remoteArgs.SetValue("currentmovingplayer", std::to_string(g_theGame->m_chessReferee->m_currentMoveKishiIndex));
-        remoteArgs.SetValue("remote", "true");
-        //g_theEventSystem->FireEvent("chessvalidate", remoteArgs); 
-        std::string newCmd = args.AppendToString();
-        newCmd = "RemoteCmd cmd=chessvalidate " + newCmd + " remote=true";
-        g_theNetworkSystem->SendStringToRemote(newCmd);
+        g_theDevConsole->AddLine(Rgba8::GREEN, "Validation PASSED.");
     }
     return true;
 }
@@ -1153,6 +1679,273 @@ bool ChessReferee::OnReset(EventArgs& args)
     }
 }
 
+bool ChessReferee::OnChessBenchmark(EventArgs& args)
+{
+    int numIterations = args.GetValue("iterations", 100000);
+    if (numIterations <= 0)
+    {
+        g_theDevConsole->AddLine(Rgba8::RED, "chessbench needs iterations > 0, e.g. chessbench iterations=100000");
+        return false;
+    }
+    g_theGame->m_chessReferee->m_chessBoard->RunSquareLookupBenchmark(numIterations);
+    return true;
+}
+
+bool ChessReferee::OnChessTakeback(EventArgs& args)
+{
+    UNUSED(args);
+    if (g_theGame->m_isRemote)
+    {
+        g_theDevConsole->AddLine(Rgba8::RED, "chesstakeback is only available in a local match.");
+        return false;
+    }
+
+    ChessReferee* referee = g_theGame->m_chessReferee;
+    if (!referee->m_chessBoard->TakeBackMove())
+    {
+        g_theDevConsole->AddLine(Rgba8::RED, "There is no move to take back.");
+        return false;
+    }
+
+    std::swap(referee->m_nextMoveKishiIndex, referee->m_currentMoveKishiIndex);
+    referee->m_chessBoard->SetSideToMove(referee->m_currentMoveKishiIndex);
+    g_theGame->m_hasWon = false;
+    g_theGame->m_isDraw = false;
+    g_theDevConsole->AddLine(Rgba8::LAVENDER, "Took back the last move, " + std::to_string(referee->m_chessBoard->GetNumRecordedMoves())
+        + " move(s) left to take back.");
+    referee->PrintCurrentPlayerRound();
+    referee->PrintBoardStateToDevConsole();
+    return true;
+}
+
+bool ChessReferee::OnChessFEN(EventArgs& args)
+{
+    ChessReferee* referee = g_theGame->m_chessReferee;
+    if (!args.Has("fen"))
+    {
+        g_theDevConsole->AddLine(Rgba8::CYAN, referee->GetFEN());
+        return true;
+    }
+    if (g_theGame->m_isRemote)
+    {
+        g_theDevConsole->AddLine(Rgba8::RED, "chessfen can only load a position in a local match.");
+        return false;
+    }
+
+    //Console arguments split on spaces, so the FEN fields may also be joined with underscores
+    std::string fen = args.GetValue("fen", "");
+    std::replace(fen.begin(), fen.end(), '_', ' ');
+    if (fen == "startpos")
+    {
+        fen = CHESS_STARTING_FEN;
+    }
+    if (!referee->LoadFEN(fen))
+    {
+        g_theDevConsole->AddLine(Rgba8::RED, "Invalid FEN, e.g. chessfen fen=rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR_b_KQkq_e3_0_1");
+        return false;
+    }
+    g_theDevConsole->AddLine(Rgba8::LAVENDER, "Loaded " + referee->GetFEN());
+    referee->PrintCurrentPlayerRound();
+    referee->PrintBoardStateToDevConsole();
+    return true;
+}
+
+//"eval=pst" (the default) or "eval=nnue". The shipped network is only a bootstrap fitted to the midgame tables, so the
+//tapered piece-square evaluation stays the default until a trained network replaces it
+static bool GetEvalNetwork(EventArgs& args, ChessNNUENetwork const*& out_network)
+{
+    std::string eval = args.GetValue("eval", "pst");
+    out_network = nullptr;
+    if (eval == "pst")
+        return true;
+
+    if (eval != "nnue")
+    {
+        g_theDevConsole->AddLine(Rgba8::RED, "eval is pst or nnue, not " + eval + ".");
+        return false;
+    }
+    if (g_theGame->m_evalNetwork == nullptr)
+    {
+        g_theDevConsole->AddLine(Rgba8::RED, "eval=nnue needs Data/Networks/ChessEval.nnue, which did not load.");
+        return false;
+    }
+    out_network = g_theGame->m_evalNetwork;
+    return true;
+}
+
+bool ChessReferee::OnChessAI(EventArgs& args)
+{
+    ChessReferee* referee = g_theGame->m_chessReferee;
+    std::string side = args.GetValue("side", "");
+    if (g_theGame->m_isRemote)
+    {
+        //Only our own side can be handed to the AI in a remote match
+        if (referee->m_status != ChessStatus::KISHI || referee->m_myKishi == nullptr)
+        {
+            g_theDevConsole->AddLine(Rgba8::RED, "chessai needs a side to play, join or begin a match first.");
+            return false;
+        }
+        if (side != "off")
+        {
+            side = (referee->m_myKishi->GetPlayerID() == KISHI_WHITE) ? "white" : "black";
+        }
+    }
+
+    bool enableKishi[NUM_KISHI] = {};
+    if (side == "white" || side == "both")
+    {
+        enableKishi[KISHI_WHITE] = true;
+    }
+    if (side == "black" || side == "both")
+    {
+        enableKishi[KISHI_BLACK] = true;
+    }
+    if (side != "off" && !enableKishi[KISHI_WHITE] && !enableKishi[KISHI_BLACK])
+    {
+        g_theDevConsole->AddLine(Rgba8::RED, "Usage: chessai side=white|black|both|off [movetime=1000] [nodes=0] [depth=0] [hash=16] [eval=pst|nnue] [book=true] [ponder=true]");
+        g_theDevConsole->AddLine(Rgba8::AQUA, "  movetime is in milliseconds per move, 0 leaves that budget unlimited");
+        g_theDevConsole->AddLine(Rgba8::AQUA, "  eval=nnue plays on the loaded network instead of the tapered piece-square evaluation");
+        g_theDevConsole->AddLine(Rgba8::AQUA, "  book=false searches every move instead of playing opening book moves");
+        g_theDevConsole->AddLine(Rgba8::AQUA, "  ponder=false stops searching the expected reply while a human or remote opponent thinks");
+        return false;
+    }
+
+    ChessSearchLimits limits;
+    limits.m_maxMilliseconds = args.GetValue("movetime", 1000);
+    limits.m_maxNodes = args.GetValue("nodes", 0);
+    limits.m_maxDepth = args.GetValue("depth", 0);
+    int hashMB = args.GetValue("hash", 16);
+    ChessNNUENetwork const* network = nullptr;
+    if (!GetEvalNetwork(args, network))
+        return false;
+    bool isUsingBook = args.GetValue("book", true);
+    bool isPonderEnabled = args.GetValue("ponder", true);
+    if (limits.m_maxMilliseconds <= 0 && limits.m_maxNodes <= 0 && limits.m_maxDepth <= 0)
+    {
+        g_theDevConsole->AddLine(Rgba8::RED, "chessai needs at least one of movetime, nodes or depth above 0.");
+        return false;
+    }
+
+    for (int kishiIndex = 0; kishiIndex < NUM_KISHI; ++kishiIndex)
+    {
+        ChessKishi* kishi = referee->m_chessKishi[kishiIndex];
+        if (enableKishi[kishiIndex])
+        {
+            kishi->EnableAI(limits, hashMB, network);
+            kishi->m_isUsingBook = isUsingBook;
+            kishi->m_isPonderEnabled = isPonderEnabled;
+            g_theDevConsole->AddLine(Rgba8::LAVENDER, "Player #" + std::to_string(kishiIndex) + " (" + kishi->m_colorName + ") is now played by the AI.");
+        }
+        else if (kishi->IsAI() && (side == "off" || !g_theGame->m_isRemote))
+        {
+            kishi->DisableAI();
+            g_theDevConsole->AddLine(Rgba8::LAVENDER, "Player #" + std::to_string(kishiIndex) + " (" + kishi->m_colorName + ") is back in human hands.");
+        }
+    }
+    return true;
+}
+
+bool ChessReferee::OnChessAnalyze(EventArgs& args)
+{
+    ChessReferee* referee = g_theGame->m_chessReferee;
+    if (args.GetValue("off", false))
+    {
+        referee->StopAnalysis();
+        g_theDevConsole->AddLine(Rgba8::LAVENDER, "Analysis stopped.");
+        return true;
+    }
+    if (referee->m_status != ChessStatus::SPECTATOR)
+    {
+        g_theDevConsole->AddLine(Rgba8::RED, "chessanalyze is for spectators, players cannot analyse their own match.");
+        return false;
+    }
+
+    //Leave one hardware thread to the frame loop by default
+    int defaultThreads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+    int numThreads = args.GetValue("threads", defaultThreads);
+    int hashMB = args.GetValue("hash", 64);
+    if (numThreads < 1 || numThreads > 64 || hashMB < 1)
+    {
+        g_theDevConsole->AddLine(Rgba8::RED, "Usage: chessanalyze [threads=1-64] [hash=64] [eval=pst|nnue] | chessanalyze off=true");
+        return false;
+    }
+    ChessNNUENetwork const* network = nullptr;
+    if (!GetEvalNetwork(args, network))
+        return false;
+
+    referee->StopAnalysis();
+    referee->m_analysis = new ChessAnalysis(numThreads, hashMB, network);
+    referee->UpdateAnalysis();
+    g_theDevConsole->AddLine(Rgba8::LAVENDER, "Analysing on " + std::to_string(numThreads) + " threads with a " + std::to_string(hashMB)
+        + " MB table, the line on the HUD follows every move.");
+    return true;
+}
+
+bool ChessReferee::OnChessEval(EventArgs& args)
+{
+    UNUSED(args);
+    //The static evaluation of the board as it stands, from white's point of view, as a quick hint of who is better
+    ChessPosition const& position = g_theGame->m_chessReferee->m_chessBoard->GetPosition();
+    int score = EvaluateChessPosition(position);
+    int whiteScore = (position.m_sideToMove == KISHI_WHITE) ? score : -score;
+    int phase = (position.m_gamePhase < CHESS_MAX_GAME_PHASE) ? position.m_gamePhase : CHESS_MAX_GAME_PHASE;
+    g_theDevConsole->AddLine(Rgba8::CYAN, Stringf("Eval %+.2f for white (midgame %+d, endgame %+d, phase %d/%d)",
+        (float)whiteScore / 100.f, position.m_midgameScore, position.m_endgameScore, phase, CHESS_MAX_GAME_PHASE));
+    return true;
+}
+
+bool ChessReferee::OnChessTablebase(EventArgs& args)
+{
+    ChessReferee* referee = g_theGame->m_chessReferee;
+    if (g_theGame->m_tablebase == nullptr)
+    {
+        g_theDevConsole->AddLine(Rgba8::RED, "No endgame tables, copy Syzygy .rtbw/.rtbz files into Run/Data/Tablebases or write them with ChessTablebaseGen.");
+        return false;
+    }
+    if (args.Has("adjudicate"))
+    {
+        referee->m_isTablebaseAdjudicating = args.GetValue("adjudicate", true);
+        referee->AdjudicateFromTablebase(); //the current position may already be decided
+    }
+
+    std::string verdict = "not covered";
+    if (referee->m_hasTablebaseVerdict)
+    {
+        static char const* const s_wdlNames[] = { "loss", "blessed loss", "draw", "cursed win", "win" };
+        verdict = std::string(s_wdlNames[(int)referee->m_tablebaseVerdict.m_wdl + 2]) + " for the side to move, DTZ "
+            + std::to_string(referee->m_tablebaseVerdict.m_dtz);
+    }
+    g_theDevConsole->AddLine(Rgba8::LAVENDER, std::to_string(g_theGame->m_tablebase->GetNumTables()) + " tables ("
+        + std::to_string(g_theGame->m_tablebase->GetNumDTZTables()) + " with DTZ) up to "
+        + std::to_string(g_theGame->m_tablebase->GetMaxPieces()) + " pieces, adjudication " + (referee->m_isTablebaseAdjudicating ? "on" : "off")
+        + (g_theGame->m_isRemote ? " (local matches only)" : "") + ". Current position: " + verdict + ".");
+    return true;
+}
+
+bool ChessReferee::OnChessBook(EventArgs& args)
+{
+    UNUSED(args);
+    ChessOpeningBook const* book = g_theGame->m_openingBook;
+    if (book == nullptr)
+    {
+        g_theDevConsole->AddLine(Rgba8::RED, "No opening book, build Run/Data/Books/ChessBook.bin from ChessOpenings.txt with ChessBookGen.");
+        return false;
+    }
+
+    ChessPosition const& position = g_theGame->m_chessReferee->m_chessBoard->GetPosition();
+    char const* openingName = book->GetOpeningName(position);
+    ChessBookMove moves[MAX_CHESS_BOOK_MOVES];
+    int numMoves = book->Probe(position, moves, MAX_CHESS_BOOK_MOVES);
+    g_theDevConsole->AddLine(Rgba8::LAVENDER, std::to_string(book->GetNumEntries()) + " book entries, " + std::to_string(book->GetNumOpeningNames())
+        + " opening names. Current position: " + ((openingName != nullptr) ? openingName : "unnamed") + ", "
+        + ((numMoves > 0) ? std::to_string(numMoves) + " book moves" : "out of the book") + ".");
+    for (int moveIndex = 0; moveIndex < numMoves; ++moveIndex)
+    {
+        g_theDevConsole->AddLine(Rgba8::CYAN, Stringf("  %-6s weight %d", GetMoveNotation(moves[moveIndex].m_move).c_str(), moves[moveIndex].m_weight));
+    }
+    return true;
+}
+
 ChessRaycastResult ChessReferee::UpdateChessRaycast()
 {
     if (m_hasGrabbedPiece)
@@ -1277,23 +2070,19 @@ void ChessReferee::UpdateGrabAndUngrab()
         
         IntVec2 to = GetCurrentRaycastCoordExceptGrabbedPiece();
         SetGhostPieceState(to);
+        UpdateGrabbedLegalTargets();
 
         //legal
         if (!g_theApp->IsKeyDown(KEYCODE_LEFTCONTROL))
         {
-            ChessMoveResult legalMove;
-            legalMove = OnRaycastMoveTest(m_chessRaycastResult.m_impactedObject->m_currentCoord, to);
-            if (IsValid(legalMove))
-            {
-                m_hasFoundLegalMovePos = true;
-            }
-            else
-            {
-                m_hasFoundLegalMovePos = false;
-            }
+            //Hovering is a bit test, the full piece rules only run once the move is actually made
+            m_hasFoundLegalMovePos = m_chessBoard->IsOnBoard(to) &&
+                (m_grabbedLegalTargets & GetSquareBit(m_chessBoard->GetSquareIndex(to))) != 0;
 
             if (g_theApp->WasKeyJustPressed(KEYCODE_LEFT_MOUSE))
             {
+                ChessMoveResult legalMove;
+                legalMove = OnRaycastMoveTest(m_chessRaycastResult.m_impactedObject->m_currentCoord, to);
                 if (IsValid(legalMove))
                 {
                     OnRaycastValidMove(legalMove, m_chessRaycastResult.m_impactedObject->m_currentCoord, to);
@@ -1346,6 +2135,41 @@ void ChessReferee::ResetChessMoveRayCast()
     m_chessRaycastResult.m_impactedObject = nullptr;
 
     m_chessRaycastResult.m_raycast.m_didImpact = false;
+    ClearGrabbedLegalTargets();
+}
+
+void ChessReferee::UpdateGrabbedLegalTargets()
+{
+    if (m_chessRaycastResult.m_impactedObject == nullptr)
+        return;
+
+    int fromSquare = m_chessBoard->GetSquareIndex(m_chessRaycastResult.m_impactedObject->m_currentCoord);
+    uint64_t positionKey = m_chessBoard->GetPositionKey();
+    if (fromSquare == m_grabbedFromSquare && positionKey == m_grabbedTargetsKey)
+        return;
+
+    m_grabbedFromSquare = fromSquare;
+    m_grabbedTargetsKey = positionKey;
+    m_grabbedLegalTargets = g_theGame->m_hasWon ? 0 : GetLegalTargets(m_chessBoard->GetPosition(), fromSquare);
+
+    //Quiet moves and captures get different tints, all of them drawn in one batch
+    m_grabbedTargetVerts.clear();
+    Bitboard targets = m_grabbedLegalTargets;
+    while (targets)
+    {
+        int square = PopLowestSquare(targets);
+        Vec3 mins((float)GetSquareX(square) + 0.08f, (float)GetSquareY(square) + 0.08f, 0.001f);
+        Vec3 maxs((float)GetSquareX(square) + 0.92f, (float)GetSquareY(square) + 0.92f, 0.02f);
+        Rgba8 color = m_chessBoard->GetPosition().IsEmpty(square) ? Rgba8(80, 255, 140, 90) : Rgba8(255, 90, 90, 110);
+        AddVertsForAABB3D(m_grabbedTargetVerts, AABB3(mins, maxs), color, AABB2::ZERO_TO_ONE);
+    }
+}
+
+void ChessReferee::ClearGrabbedLegalTargets()
+{
+    m_grabbedLegalTargets = 0;
+    m_grabbedFromSquare = NO_SQUARE;
+    m_grabbedTargetVerts.clear();
 }
 
 IntVec2 ChessReferee::GetCurrentRaycastCoordExceptGrabbedPiece() const
@@ -1462,7 +2286,7 @@ ChessMoveResult ChessReferee::OnRaycastMoveTest(IntVec2 from, IntVec2 to)
      ChessPiece* fromPiece = g_theGame->m_chessReferee->m_chessBoard->GetPiece(fromCoord);
     // if (fromPiece->m_ownerKishiID != g_theGame->m_chessReferee->m_currentMoveKishiIndex)
     // {
-    //     g_theDevConsole->AddLine(Rgba8::RED, "The " + fromPiece->m_definition.m_name +
+    //     g_theDevConsole->AddLine(Rgba8::RED, "The " + fromPiece->m_definition->m_name +
     //         " at " + from + " belongs to player #" + std::to_string(g_theGame->m_chessReferee->m_nextMoveKishiIndex)
     //         + " ("+nextColor+"); it is currently player #"+
     //         std::to_string(g_theGame->m_chessReferee->m_currentMoveKishiIndex)+ " (" + currentColor+")'s turn.");
@@ -1475,7 +2299,7 @@ ChessMoveResult ChessReferee::OnRaycastMoveTest(IntVec2 from, IntVec2 to)
     // if (toPiece &&fromPiece->m_ownerKishiID == toPiece->m_ownerKishiID)
     // {
     //     g_theDevConsole->AddLine(Rgba8::RED, "Cannot move to" + to +
-    //         ", since it is occupied by your own "+toPiece->m_definition.m_name);
+    //         ", since it is occupied by your own "+toPiece->m_definition->m_name);
     //     ChessMoveResult result = ChessMoveResult::INVALID_MOVE_DESTINATION_BLOCKED;
     //     g_theDevConsole->AddLine(Rgba8::RED, GetMoveResultString(result));
     //     return true;
@@ -1503,7 +2327,7 @@ ChessMoveResult ChessReferee::OnRaycastMoveTest(IntVec2 from, IntVec2 to)
     // {
     //     //capture! //二编: move!!
          
-         return fromPiece->OnRaycastMoveTest(fromCoord, toCoord);
+    return fromPiece->OnRaycastMoveTest(fromCoord, toCoord);
 }
 
 ChessMoveResult ChessReferee::OnRaycastSemiMoveTest(IntVec2 from, IntVec2 to)
@@ -1532,6 +2356,7 @@ ChessMoveResult ChessReferee::OnRaycastSemiMoveTest(IntVec2 from, IntVec2 to)
 
 void ChessReferee::OnRaycastValidMove(ChessMoveResult result, IntVec2 from, IntVec2 to)
 {
+    //Not recorded here: the piece fires "chessmove" and OnChessMove records the move, for the mouse like for the console
     ChessPiece* fromPiece = g_theGame->m_chessReferee->m_chessBoard->GetPiece(from);
     fromPiece->OnRaycastValidMove(from, to, result);
     return;
@@ -1540,6 +2365,7 @@ void ChessReferee::OnRaycastValidMove(ChessMoveResult result, IntVec2 from, IntV
 void ChessReferee::OnRaycastSemiMove(ChessMoveResult result, IntVec2 from, IntVec2 to)
 {
     ChessPiece* fromPiece = g_theGame->m_chessReferee->m_chessBoard->GetPiece(from);
+    m_chessBoard->ClearMoveHistory();
     fromPiece->OnRaycastSemiMove(from, to, result);
     return;
 }
@@ -1,5 +1,8 @@
 ﻿#pragma once
 #include "ChessBoard.h"
+#include "ChessTablebase.h"
+
+class ChessAnalysis;
 
 enum class MatchState
 {
@@ -42,17 +45,39 @@ public:
     void RegisterForEvents();
     void PrintBoardStateToDevConsole();
     std::string GetBoardStateAsString();
+    bool LoadFEN(std::string const& fen);
+    std::string GetFEN() const { return m_chessBoard->GetFEN(); }
     void PrintCurrentPlayerRound();
     void SwapAndPrintBoardStatesAndRound() const;
+    void CheckForMateOrStalemate();
+    void DeclareDraw(std::string const& reason);
+    void SendValidationHash() const;
+    void UpdateAIKishi();
+    void StartPondering(int kishiIndex);
+    void UpdatePonderOutcome(int kishiIndex, uint64_t key); //the opponent has moved while kishiIndex was pondering
+    void PlayAIMove(ChessMove const& move);
+    void UpdateAnalysis();
+    void StopAnalysis();
+    std::string GetAnalysisHUDText() const; //empty unless analysing
+    void UpdateTablebase();
+    void AdjudicateFromTablebase();
+    std::string GetTablebaseHUDText() const; //empty unless a spectator and the tables cover the position
+    void UpdateBook();
+    std::string GetBookHUDText() const { return m_bookHUDText; } //empty out of the book with no opening named
+    bool BeginMoveRecord(IntVec2 from, IntVec2 to);
+    void EndMoveRecord(int kishiIndexBeforeMove);
 
     void Render() const;
     void RenderGhostPiece() const;
+    void RenderGrabbedLegalTargets() const;
 
     ChessRaycastResult UpdateChessRaycast();
     
     void UpdateGrabAndUngrab();
     void SetGhostPieceState(IntVec2 pos);
     void ResetChessMoveRayCast();
+    void UpdateGrabbedLegalTargets();
+    void ClearGrabbedLegalTargets();
     IntVec2 GetCurrentRaycastCoordExceptGrabbedPiece() const;
     ChessMoveResult OnRaycastMoveTest(IntVec2 from, IntVec2 to);
     ChessMoveResult OnRaycastSemiMoveTest(IntVec2 from, IntVec2 to);
@@ -80,6 +105,14 @@ public:
     static bool OnConnectSucceed(EventArgs& args);
     static bool OnJoinGame(EventArgs& args);
     static bool OnReset(EventArgs& args);
+    static bool OnChessBenchmark(EventArgs& args);
+    static bool OnChessTakeback(EventArgs& args);
+    static bool OnChessFEN(EventArgs& args);
+    static bool OnChessAI(EventArgs& args);
+    static bool OnChessAnalyze(EventArgs& args);
+    static bool OnChessEval(EventArgs& args);
+    static bool OnChessTablebase(EventArgs& args);
+    static bool OnChessBook(EventArgs& args);
 
 public:
     ChessBoard* m_chessBoard;
@@ -104,6 +137,27 @@ public:
     bool m_hasFoundLegalMovePos = false;
     ChessPiece* m_ghostPiece = nullptr;
 
+    //Legal destinations of the grabbed piece, rebuilt on grab and whenever the position key changes
+    Bitboard m_grabbedLegalTargets = 0;
+    int m_grabbedFromSquare = NO_SQUARE;
+    uint64_t m_grabbedTargetsKey = 0;
+    std::vector<Vertex_PCU> m_grabbedTargetVerts;
+
+    //Spectator analysis, null unless turned on with chessanalyze
+    ChessAnalysis* m_analysis = nullptr;
+    uint64_t m_analysisKey = 0;
+
+    //Endgame table verdict on the current position, probed through g_theGame->m_tablebaseWorker
+    uint64_t m_tablebaseKey = 0;
+    bool m_hasTablebaseVerdict = false;
+    ChessTablebaseResult m_tablebaseVerdict;
+    bool m_isTablebaseAdjudicating = true; //local matches only, remote peers could disagree on which tables they have
+
+    //Opening book candidates and opening name of the current position, from g_theGame->m_openingBook
+    uint64_t m_bookKey = 0;
+    std::string m_openingName; //the last opening the game passed through, kept once the game leaves the book
+    std::string m_bookHUDText;
+
     float m_updateRateTimer = 0.f;
     float c_updateRate = 0.005f;
 
@@ -0,0 +1,531 @@
+﻿#include "ChessSearch.h"
+#include "ChessEvaluation.h"
+
+#include <algorithm>
+#include <cstring>
+
+//----------------------------------------------------------------------------------------------------------
+//Mate scores are stored relative to the node so a mate found through a transposition keeps its true distance
+static int GetScoreForTable(int score, int ply)
+{
+    if (score > CHESS_MATE_BOUND)
+        return score + ply;
+    if (score < -CHESS_MATE_BOUND)
+        return score - ply;
+    return score;
+}
+
+static int GetScoreFromTable(int score, int ply)
+{
+    if (score > CHESS_MATE_BOUND)
+        return score - ply;
+    if (score < -CHESS_MATE_BOUND)
+        return score + ply;
+    return score;
+}
+
+static bool IsCaptureOnBoard(ChessPosition const& position, ChessMove const& move)
+{
+    return position.m_board[move.m_to] != NO_PIECE_CODE || move.m_result == ChessMoveResult::VALID_CAPTURE_ENPASSANT;
+}
+
+//Lazy SMP depth skipping: helper n skips depths in runs of s_skipSizes[n], offset by s_skipPhases[n], so at any moment
+//about half of the helpers are one depth ahead of the main thread
+static constexpr int NUM_CHESS_SKIP_PATTERNS = 20;
+static constexpr int s_skipSizes[NUM_CHESS_SKIP_PATTERNS] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+static constexpr int s_skipPhases[NUM_CHESS_SKIP_PATTERNS] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+static bool IsHelperSkippingDepth(int helperIndex, int depth)
+{
+    if (helperIndex <= 0)
+        return false;
+
+    int pattern = (helperIndex - 1) % NUM_CHESS_SKIP_PATTERNS;
+    return ((depth + s_skipPhases[pattern]) / s_skipSizes[pattern]) % 2 != 0;
+}
+
+//----------------------------------------------------------------------------------------------------------
+void ChessTranspositionTable::Resize(int sizeMB)
+{
+    uint64_t numSlots = 1;
+    uint64_t maxSlots = ((uint64_t)std::max(sizeMB, 1) << 20) / sizeof(Slot);
+    while (numSlots * 2 <= maxSlots)
+    {
+        numSlots *= 2;
+    }
+    m_slots.reset(new Slot[(size_t)numSlots]);
+    m_numSlots = numSlots;
+    m_indexMask = numSlots - 1;
+}
+
+void ChessTranspositionTable::Clear()
+{
+    for (uint64_t slotIndex = 0; slotIndex < m_numSlots; ++slotIndex)
+    {
+        m_slots[slotIndex].m_data.store(0, std::memory_order_relaxed);
+        m_slots[slotIndex].m_keyXorData.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool ChessTranspositionTable::Probe(uint64_t key, ChessTranspositionEntry& out_entry) const
+{
+    if (m_numSlots == 0)
+        return false;
+
+    Slot const& slot = m_slots[key & m_indexMask];
+    uint64_t data = slot.m_data.load(std::memory_order_relaxed);
+    if ((slot.m_keyXorData.load(std::memory_order_relaxed) ^ data) != key)
+        return false;
+
+    memcpy(static_cast<void*>(&out_entry), &data, sizeof(data));
+    return out_entry.m_bound != ChessBound::NONE;
+}
+
+void ChessTranspositionTable::Store(uint64_t key, ChessMove const& move, int score, int depth, ChessBound bound)
+{
+    if (m_numSlots == 0)
+        return;
+
+    ChessTranspositionEntry stored;
+    if (Probe(key, stored) && depth < stored.m_depth && bound != ChessBound::EXACT)
+        return;
+
+    ChessTranspositionEntry entry;
+    entry.m_move = move;
+    entry.m_score = (short)score;
+    entry.m_depth = (signed char)std::min(depth, 127);
+    entry.m_bound = bound;
+    uint64_t data = 0;
+    memcpy(&data, &entry, sizeof(data));
+
+    Slot& slot = m_slots[key & m_indexMask];
+    slot.m_data.store(data, std::memory_order_relaxed);
+    slot.m_keyXorData.store(key ^ data, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------------------------------------
+ChessSearcher::ChessSearcher()
+{
+    memset(m_historyScores, 0, sizeof(m_historyScores));
+    memset(m_principalVariationLength, 0, sizeof(m_principalVariationLength));
+}
+
+ChessSearchResult ChessSearcher::Search(ChessPosition const& position, std::vector<uint64_t> const& gameKeys, ChessSearchLimits const& limits,
+    ChessTranspositionTable& table, std::atomic<bool> const* stopFlag, std::atomic<bool> const* ponderFlag)
+{
+    m_position = position;
+    m_table = &table;
+    m_stopFlag = stopFlag;
+    m_ponderFlag = ponderFlag;
+    m_limits = limits;
+    m_startTime = std::chrono::steady_clock::now();
+    m_nodes = 0;
+    m_publishedNodes.store(0, std::memory_order_relaxed);
+    m_isStopped = false;
+    m_hasCompletedDepth = false;
+    m_completedDepth = 0;
+
+    m_keyHistory.clear();
+    m_keyHistory.reserve(gameKeys.size() + MAX_CHESS_SEARCH_PLY + 1);
+    m_keyHistory.insert(m_keyHistory.end(), gameKeys.begin(), gameKeys.end());
+    if (m_keyHistory.empty() || m_keyHistory.back() != m_position.GetKey())
+    {
+        m_keyHistory.push_back(m_position.GetKey());
+    }
+
+    for (ChessMove (&killers)[2] : m_killerMoves)
+    {
+        killers[0] = ChessMove();
+        killers[1] = ChessMove();
+    }
+    //Keep half of the last search's history, most of it still applies one move later
+    int* historyScores = &m_historyScores[0][0][0];
+    for (int scoreIndex = 0; scoreIndex < NUM_KISHI * NUM_BOARD_SQUARES * NUM_BOARD_SQUARES; ++scoreIndex)
+    {
+        historyScores[scoreIndex] /= 2;
+    }
+
+    ChessSearchResult result;
+    ChessMoveList rootMoves;
+    GenerateLegalMoves(m_position, rootMoves);
+    if (m_network)
+    {
+        m_network->RefreshAccumulator(m_position, m_accumulators[0]);
+    }
+    if (rootMoves.Size() == 0)
+    {
+        result.m_score = m_position.IsInCheck(m_position.m_sideToMove) ? -CHESS_MATE_SCORE : 0;
+        return result;
+    }
+
+    int maxDepth = (limits.m_maxDepth > 0) ? std::min(limits.m_maxDepth, MAX_CHESS_SEARCH_PLY - 1) : MAX_CHESS_SEARCH_PLY - 1;
+    for (int depth = 1; depth < MAX_CHESS_SEARCH_PLY; ++depth)
+    {
+        if (depth > maxDepth && !IsPondering())
+            break;
+        if (IsHelperSkippingDepth(m_helperIndex, depth) && depth < maxDepth && m_hasCompletedDepth)
+            continue;
+
+        int score = SearchNode(depth, 0, -CHESS_INFINITE_SCORE, CHESS_INFINITE_SCORE, false);
+        if (m_isStopped)
+            break; //an unfinished depth may not have looked at the best move yet
+
+        m_hasCompletedDepth = true;
+        m_completedDepth = depth;
+        result.m_bestMove = m_principalVariation[0][0];
+        result.m_hasMove = true;
+        result.m_score = score;
+        result.m_depth = depth;
+        result.m_principalVariation.assign(m_principalVariation[0], m_principalVariation[0] + m_principalVariationLength[0]);
+        result.m_nodes = m_nodes;
+        result.m_milliseconds = GetElapsedMilliseconds();
+        if (m_onIterationDone)
+        {
+            m_onIterationDone(result);
+        }
+
+        //A forced move needs no thought, a found mate cannot get shorter, and the next depth takes several times longer than this one
+        if (rootMoves.Size() == 1 || (IsChessMateScore(score) && CHESS_MATE_SCORE - abs(score) <= depth))
+            break;
+        if (limits.m_maxMilliseconds > 0 && result.m_milliseconds * 2 > limits.m_maxMilliseconds && !IsPondering())
+            break;
+        if (ShouldStop())
+            break;
+    }
+    result.m_nodes = m_nodes;
+    result.m_milliseconds = GetElapsedMilliseconds();
+    m_publishedNodes.store(m_nodes, std::memory_order_relaxed);
+    return result;
+}
+
+int ChessSearcher::SearchNode(int depth, int ply, int alpha, int beta, bool canNullMove)
+{
+    m_principalVariationLength[ply] = ply;
+    if (ply > 0 && (m_position.m_halfmoveClock >= 100 || IsRepetition()))
+        return 0;
+    if (ply >= MAX_CHESS_SEARCH_PLY - 1)
+        return Evaluate(ply);
+
+    int const us = m_position.m_sideToMove;
+    bool const isInCheck = m_position.IsInCheck(us);
+    if (isInCheck)
+    {
+        ++depth;
+    }
+    if (depth <= 0)
+        return SearchQuiescence(ply, alpha, beta);
+
+    ++m_nodes;
+    if (ShouldStop())
+        return 0;
+
+    bool const isPrincipalNode = beta - alpha > 1;
+    uint64_t const key = m_keyHistory.back();
+    ChessTranspositionEntry entry;
+    ChessMove const* tableMove = nullptr;
+    if (m_table->Probe(key, entry))
+    {
+        tableMove = &entry.m_move;
+        if (!isPrincipalNode && entry.m_depth >= depth)
+        {
+            int tableScore = GetScoreFromTable(entry.m_score, ply);
+            if (entry.m_bound == ChessBound::EXACT
+                || (entry.m_bound == ChessBound::LOWER && tableScore >= beta)
+                || (entry.m_bound == ChessBound::UPPER && tableScore <= alpha))
+            {
+                return tableScore;
+            }
+        }
+    }
+
+    //Null move: if passing still fails high the real moves will too. Not with only pawns left, where passing may be the best move
+    Bitboard ourPieces = m_position.GetKishiPieces(us) & ~m_position.GetPieces(us, ChessPieceType::Pawn) & ~m_position.GetPieces(us, ChessPieceType::King);
+    if (canNullMove && !isPrincipalNode && !isInCheck && depth >= 3 && ourPieces != 0 && Evaluate(ply) >= beta)
+    {
+        int enPassantSquare = m_position.m_enPassantSquare;
+        m_position.m_enPassantSquare = NO_SQUARE;
+        m_position.m_sideToMove = 1 - us;
+        m_keyHistory.push_back(m_position.GetKey());
+        if (m_network)
+        {
+            m_accumulators[ply + 1] = m_accumulators[ply];
+        }
+        int nullScore = -SearchNode(depth - 3, ply + 1, -beta, -beta + 1, false);
+        m_keyHistory.pop_back();
+        m_position.m_sideToMove = us;
+        m_position.m_enPassantSquare = enPassantSquare;
+        if (m_isStopped)
+            return 0;
+        if (nullScore >= beta)
+            return IsChessMateScore(nullScore) ? beta : nullScore;
+    }
+
+    ChessMoveList moves;
+    GenerateLegalMoves(m_position, moves);
+    if (moves.Size() == 0)
+        return isInCheck ? -CHESS_MATE_SCORE + ply : 0;
+
+    int moveScores[MAX_CHESS_MOVES];
+    ScoreMoves(moves, ply, tableMove, moveScores);
+    ChessMove orderedMoves[MAX_CHESS_MOVES];
+    std::copy(moves.begin(), moves.end(), orderedMoves);
+
+    int const originalAlpha = alpha;
+    int bestScore = -CHESS_INFINITE_SCORE;
+    ChessMove bestMove = orderedMoves[0];
+    for (int moveIndex = 0; moveIndex < moves.Size(); ++moveIndex)
+    {
+        //Selection sort one move at a time, a cutoff usually comes before the list is sorted
+        int bestIndex = moveIndex;
+        for (int otherIndex = moveIndex + 1; otherIndex < moves.Size(); ++otherIndex)
+        {
+            if (moveScores[otherIndex] > moveScores[bestIndex])
+            {
+                bestIndex = otherIndex;
+            }
+        }
+        std::swap(orderedMoves[moveIndex], orderedMoves[bestIndex]);
+        std::swap(moveScores[moveIndex], moveScores[bestIndex]);
+        ChessMove const& move = orderedMoves[moveIndex];
+        bool const isQuiet = !IsCaptureOnBoard(m_position, move) && move.m_promoteTo == ChessPieceType::Count;
+
+        ChessUndoRecord undo;
+        MakeSearchMove(ply, move, undo);
+        m_keyHistory.push_back(m_position.GetKey());
+        int score;
+        if (moveIndex == 0)
+        {
+            score = -SearchNode(depth - 1, ply + 1, -beta, -alpha, true);
+        }
+        else
+        {
+            //Every later move is expected to be worse, prove it with a null window and re-search only if it is not
+            score = -SearchNode(depth - 1, ply + 1, -alpha - 1, -alpha, true);
+            if (score > alpha && score < beta && !m_isStopped)
+            {
+                score = -SearchNode(depth - 1, ply + 1, -beta, -alpha, true);
+            }
+        }
+        m_keyHistory.pop_back();
+        m_position.UnmakeMove(undo);
+        if (m_isStopped)
+            return 0;
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestMove = move;
+            if (score > alpha)
+            {
+                alpha = score;
+                UpdatePrincipalVariation(ply, move);
+                if (alpha >= beta)
+                {
+                    if (isQuiet)
+                    {
+                        RecordQuietCutoff(ply, depth, move);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    ChessBound bound = (bestScore >= beta) ? ChessBound::LOWER : ((bestScore > originalAlpha) ? ChessBound::EXACT : ChessBound::UPPER);
+    m_table->Store(key, bestMove, GetScoreForTable(bestScore, ply), depth, bound);
+    return bestScore;
+}
+
+int ChessSearcher::SearchQuiescence(int ply, int alpha, int beta)
+{
+    ++m_nodes;
+    if (ShouldStop())
+        return 0;
+    if (ply >= MAX_CHESS_SEARCH_PLY - 1)
+        return Evaluate(ply);
+
+    //Only captures and queen promotions from here on, unless in check where every evasion counts
+    bool const isInCheck = m_position.IsInCheck(m_position.m_sideToMove);
+    int bestScore = -CHESS_INFINITE_SCORE;
+    if (!isInCheck)
+    {
+        bestScore = Evaluate(ply);
+        if (bestScore >= beta)
+            return bestScore;
+        alpha = std::max(alpha, bestScore);
+    }
+
+    ChessMoveList moves;
+    GenerateLegalMoves(m_position, moves);
+    if (moves.Size() == 0)
+        return isInCheck ? -CHESS_MATE_SCORE + ply : 0;
+
+    int moveScores[MAX_CHESS_MOVES];
+    ScoreMoves(moves, ply, nullptr, moveScores);
+    ChessMove orderedMoves[MAX_CHESS_MOVES];
+    std::copy(moves.begin(), moves.end(), orderedMoves);
+    for (int moveIndex = 0; moveIndex < moves.Size(); ++moveIndex)
+    {
+        int bestIndex = moveIndex;
+        for (int otherIndex = moveIndex + 1; otherIndex < moves.Size(); ++otherIndex)
+        {
+            if (moveScores[otherIndex] > moveScores[bestIndex])
+            {
+                bestIndex = otherIndex;
+            }
+        }
+        std::swap(orderedMoves[moveIndex], orderedMoves[bestIndex]);
+        std::swap(moveScores[moveIndex], moveScores[bestIndex]);
+        ChessMove const& move = orderedMoves[moveIndex];
+        if (!isInCheck && !IsCaptureOnBoard(m_position, move) && move.m_promoteTo != ChessPieceType::Queen)
+            continue;
+
+        ChessUndoRecord undo;
+        MakeSearchMove(ply, move, undo);
+        int score = -SearchQuiescence(ply + 1, -beta, -alpha);
+        m_position.UnmakeMove(undo);
+        if (m_isStopped)
+            return 0;
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            if (score > alpha)
+            {
+                alpha = score;
+                if (alpha >= beta)
+                    break;
+            }
+        }
+    }
+    return bestScore;
+}
+
+void ChessSearcher::ScoreMoves(ChessMoveList const& moves, int ply, ChessMove const* tableMove, int* out_scores) const
+{
+    //Table move, then captures most valuable victim / least valuable attacker first, then killers, then history
+    int const us = m_position.m_sideToMove;
+    for (int moveIndex = 0; moveIndex < moves.Size(); ++moveIndex)
+    {
+        ChessMove const& move = moves[moveIndex];
+        int score;
+        if (tableMove && move == *tableMove)
+        {
+            score = 1000000;
+        }
+        else if (IsCaptureOnBoard(m_position, move) || move.m_promoteTo == ChessPieceType::Queen)
+        {
+            int victimValue = (m_position.m_board[move.m_to] != NO_PIECE_CODE) ? CHESS_PIECE_VALUES[(int)m_position.GetPieceTypeAt(move.m_to)] : 0;
+            if (move.m_result == ChessMoveResult::VALID_CAPTURE_ENPASSANT)
+            {
+                victimValue = CHESS_PIECE_VALUES[(int)ChessPieceType::Pawn];
+            }
+            if (move.m_promoteTo == ChessPieceType::Queen)
+            {
+                victimValue += CHESS_PIECE_VALUES[(int)ChessPieceType::Queen];
+            }
+            score = 200000 + victimValue * 10 - CHESS_PIECE_VALUES[(int)m_position.GetPieceTypeAt(move.m_from)];
+        }
+        else if (move == m_killerMoves[ply][0])
+        {
+            score = 100000;
+        }
+        else if (move == m_killerMoves[ply][1])
+        {
+            score = 99000;
+        }
+        else
+        {
+            score = m_historyScores[us][move.m_from][move.m_to];
+        }
+        out_scores[moveIndex] = score;
+    }
+}
+
+bool ChessSearcher::IsRepetition() const
+{
+    //Once in the search is enough to call it a draw, the side that could avoid it will have found a better line.
+    //Only positions since the last capture or pawn move can recur, with the same side to move
+    int lastIndex = (int)m_keyHistory.size() - 1;
+    int oldestIndex = std::max(0, lastIndex - m_position.m_halfmoveClock);
+    uint64_t key = m_keyHistory[lastIndex];
+    for (int index = lastIndex - 4; index >= oldestIndex; index -= 2)
+    {
+        if (m_keyHistory[index] == key)
+            return true;
+    }
+    return false;
+}
+
+bool ChessSearcher::ShouldStop()
+{
+    if (m_isStopped)
+        return true;
+    if ((m_nodes & 1023) == 0)
+    {
+        m_publishedNodes.store(m_nodes, std::memory_order_relaxed);
+    }
+    if (!m_hasCompletedDepth)
+        return false;
+
+    if (m_stopFlag && m_stopFlag->load(std::memory_order_relaxed))
+    {
+        m_isStopped = true;
+    }
+    else if (IsPondering())
+    {
+        return false; //the limits only apply from the ponder hit on
+    }
+    else if ((m_limits.m_maxNodes > 0 && m_nodes >= m_limits.m_maxNodes) || (m_limits.m_maxDepth > 0 && m_completedDepth >= m_limits.m_maxDepth))
+    {
+        m_isStopped = true;
+    }
+    else if (m_limits.m_maxMilliseconds > 0 && (m_nodes & 1023) == 0 && GetElapsedMilliseconds() >= m_limits.m_maxMilliseconds)
+    {
+        m_isStopped = true;
+    }
+    return m_isStopped;
+}
+
+int ChessSearcher::GetElapsedMilliseconds() const
+{
+    return (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+}
+
+void ChessSearcher::UpdatePrincipalVariation(int ply, ChessMove const& move)
+{
+    m_principalVariation[ply][ply] = move;
+    int childLength = m_principalVariationLength[ply + 1];
+    for (int nextPly = ply + 1; nextPly < childLength; ++nextPly)
+    {
+        m_principalVariation[ply][nextPly] = m_principalVariation[ply + 1][nextPly];
+    }
+    m_principalVariationLength[ply] = std::max(childLength, ply + 1);
+}
+
+int ChessSearcher::Evaluate(int ply) const
+{
+    if (m_network)
+        return m_network->Evaluate(m_accumulators[ply], m_position.m_sideToMove);
+    return EvaluateChessPosition(m_position);
+}
+
+void ChessSearcher::MakeSearchMove(int ply, ChessMove const& move, ChessUndoRecord& out_undo)
+{
+    if (m_network)
+    {
+        m_network->UpdateAccumulator(m_accumulators[ply], m_position, move, m_accumulators[ply + 1]); //before the move changes the board
+    }
+    m_position.MakeMove(move, out_undo);
+}
+
+void ChessSearcher::RecordQuietCutoff(int ply, int depth, ChessMove const& move)
+{
+    if (!(move == m_killerMoves[ply][0]))
+    {
+        m_killerMoves[ply][1] = m_killerMoves[ply][0];
+        m_killerMoves[ply][0] = move;
+    }
+    int& history = m_historyScores[m_position.m_sideToMove][move.m_from][move.m_to];
+    history = std::min(history + depth * depth, 50000); //stays below the killers
+}
@@ -0,0 +1,144 @@
+﻿#pragma once
+#include "ChessMoveGen.h"
+#include "ChessNNUE.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+constexpr int CHESS_MATE_SCORE = 32000; //mate in n plies scores CHESS_MATE_SCORE - n
+constexpr int CHESS_INFINITE_SCORE = 32001;
+constexpr int CHESS_MATE_BOUND = CHESS_MATE_SCORE - 1000; //anything beyond is a forced mate
+constexpr int MAX_CHESS_SEARCH_PLY = 64;
+
+constexpr bool IsChessMateScore(int score) { return score > CHESS_MATE_BOUND || score < -CHESS_MATE_BOUND; }
+
+enum class ChessBound : unsigned char
+{
+    NONE,
+    EXACT,
+    LOWER, //failed high, the true score is at least this
+    UPPER  //failed low, the true score is at most this
+};
+
+//Packs into the 64-bit data word of a table slot
+struct ChessTranspositionEntry
+{
+    ChessMove m_move;
+    short m_score = 0;
+    signed char m_depth = -1;
+    ChessBound m_bound = ChessBound::NONE;
+};
+static_assert(sizeof(ChessTranspositionEntry) == sizeof(uint64_t), "a table entry must fit one atomic word");
+
+//----------------------------------------------------------------------------------------------------------
+//Fixed-size hash of searched positions, shared without locks by every thread of a search. A slot is two atomic words,
+//the entry and the entry xor its key; a slot torn by two threads writing at once fails the key check and reads as a miss.
+//Another position always takes the slot, the same position keeps its deeper result unless the new one is exact
+class ChessTranspositionTable
+{
+public:
+    void Resize(int sizeMB); //rounded down to a power of two slots, clears the table
+    void Clear();
+
+    bool Probe(uint64_t key, ChessTranspositionEntry& out_entry) const;
+    void Store(uint64_t key, ChessMove const& move, int score, int depth, ChessBound bound);
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> m_keyXorData{ 0 };
+        std::atomic<uint64_t> m_data{ 0 };
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    uint64_t m_numSlots = 0;
+    uint64_t m_indexMask = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------
+//0 means no limit; with no limit at all the search runs to MAX_CHESS_SEARCH_PLY or until stopped
+struct ChessSearchLimits
+{
+    int m_maxDepth = 0;
+    int64_t m_maxNodes = 0;
+    int m_maxMilliseconds = 0;
+};
+
+struct ChessSearchResult
+{
+    ChessMove m_bestMove;
+    bool m_hasMove = false; //false only when the root has no legal move
+    int m_score = 0; //centipawns from the side to move's point of view
+    int m_depth = 0; //last fully searched depth
+    int64_t m_nodes = 0;
+    int m_milliseconds = 0;
+    std::vector<ChessMove> m_principalVariation;
+};
+
+//----------------------------------------------------------------------------------------------------------
+//Iterative deepening alpha-beta (principal variation search) over a ChessPosition copy, with transposition table,
+//null-move pruning, check extensions, quiescence on captures and TT / MVV-LVA / killer / history move ordering.
+//One searcher is single-threaded and engine-free; ChessSearchWorker runs one on a background thread for the game,
+//ChessAnalysis runs several on one shared table (Lazy SMP)
+class ChessSearcher
+{
+public:
+    ChessSearcher();
+
+    //0 for the main thread. Lazy SMP helpers skip some depths by index so the threads spread over different depths
+    //and fill the shared table with work the others have not done yet
+    void SetHelperIndex(int helperIndex) { m_helperIndex = helperIndex; }
+    //Evaluate with network instead of EvaluateChessPosition, null to switch back. The network must outlive the searches
+    void SetNetwork(ChessNNUENetwork const* network) { m_network = network; }
+    int64_t GetPublishedNodes() const { return m_publishedNodes.load(std::memory_order_relaxed); } //safe from any thread
+
+    //gameKeys: keys of the positions already played since the last capture or pawn move, oldest first, so the search
+    //sees repetitions against the game. stopFlag, if given, aborts the search as soon as another thread sets it.
+    //ponderFlag, if given, holds every limit off while it is set: the search ponders until another thread clears it
+    //(a ponder hit), then stops by the limits as if it had been started at the same time as the pondering
+    ChessSearchResult Search(ChessPosition const& position, std::vector<uint64_t> const& gameKeys, ChessSearchLimits const& limits,
+        ChessTranspositionTable& table, std::atomic<bool> const* stopFlag = nullptr, std::atomic<bool> const* ponderFlag = nullptr);
+
+    //Called after every completed depth with the result so far
+    std::function<void(ChessSearchResult const&)> m_onIterationDone;
+
+private:
+    int SearchNode(int depth, int ply, int alpha, int beta, bool canNullMove);
+    int SearchQuiescence(int ply, int alpha, int beta);
+    void ScoreMoves(ChessMoveList const& moves, int ply, ChessMove const* tableMove, int* out_scores) const;
+    bool IsRepetition() const;
+    bool ShouldStop();
+    bool IsPondering() const { return m_ponderFlag && m_ponderFlag->load(std::memory_order_relaxed); }
+    int GetElapsedMilliseconds() const;
+    void UpdatePrincipalVariation(int ply, ChessMove const& move);
+    void RecordQuietCutoff(int ply, int depth, ChessMove const& move);
+    int Evaluate(int ply) const;
+    void MakeSearchMove(int ply, ChessMove const& move, ChessUndoRecord& out_undo);
+
+private:
+    ChessPosition m_position;
+    ChessTranspositionTable* m_table = nullptr;
+    std::atomic<bool> const* m_stopFlag = nullptr;
+    std::atomic<bool> const* m_ponderFlag = nullptr;
+    int m_helperIndex = 0;
+    std::atomic<int64_t> m_publishedNodes{ 0 }; //m_nodes, refreshed every 1024 nodes for other threads to sum
+    ChessSearchLimits m_limits;
+    std::chrono::steady_clock::time_point m_startTime;
+    int64_t m_nodes = 0;
+    bool m_isStopped = false;
+    bool m_hasCompletedDepth = false; //limits are ignored until depth 1 is done, so there is always a move to play
+    int m_completedDepth = 0; //can pass the depth limit while pondering
+
+    std::vector<uint64_t> m_keyHistory; //game keys up to the root, then one key per searched ply
+    ChessMove m_killerMoves[MAX_CHESS_SEARCH_PLY][2];
+    int m_historyScores[NUM_KISHI][NUM_BOARD_SQUARES][NUM_BOARD_SQUARES];
+    ChessMove m_principalVariation[MAX_CHESS_SEARCH_PLY][MAX_CHESS_SEARCH_PLY];
+    int m_principalVariationLength[MAX_CHESS_SEARCH_PLY];
+
+    //One accumulator per ply: making a move derives the next one from this ply's, unmaking is just going back a ply
+    ChessNNUENetwork const* m_network = nullptr;
+    ChessNNUEAccumulator m_accumulators[MAX_CHESS_SEARCH_PLY + 1];
+};
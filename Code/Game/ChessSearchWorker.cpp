@@ -0,0 +1,100 @@
+﻿#include "ChessSearchWorker.h"
+
+ChessSearchWorker::ChessSearchWorker(int hashMB, ChessNNUENetwork const* network)
+{
+    m_table.Resize(hashMB);
+    m_searcher.SetNetwork(network);
+    m_thread = std::thread(&ChessSearchWorker::ThreadMain, this);
+}
+
+ChessSearchWorker::~ChessSearchWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isQuitting = true;
+        m_stopFlag = true;
+    }
+    m_wakeCondition.notify_one();
+    m_thread.join();
+}
+
+void ChessSearchWorker::Start(ChessPosition const& position, std::vector<uint64_t> const& gameKeys, ChessSearchLimits const& limits, bool isPondering)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requestPosition = position;
+        m_requestKeys = gameKeys;
+        m_requestLimits = limits;
+        m_isRequestPondering = isPondering;
+        m_hasRequest = true;
+        m_hasResult = false;
+        m_stopFlag = true; //abandon whatever is running, the thread picks the new request up next
+    }
+    m_wakeCondition.notify_one();
+}
+
+void ChessSearchWorker::PonderHit()
+{
+    //Under the lock so a pondering request the thread has not picked up yet is turned into a normal one as well
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isRequestPondering = false;
+    m_ponderFlag = false;
+}
+
+void ChessSearchWorker::Stop()
+{
+    m_stopFlag = true;
+}
+
+bool ChessSearchWorker::IsSearching() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hasRequest || m_isSearching;
+}
+
+bool ChessSearchWorker::TryTakeResult(ChessSearchResult& out_result, uint64_t& out_positionKey)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_hasResult)
+        return false;
+
+    out_result = m_result;
+    out_positionKey = m_resultKey;
+    m_hasResult = false;
+    return true;
+}
+
+void ChessSearchWorker::ThreadMain()
+{
+    ChessPosition position;
+    std::vector<uint64_t> gameKeys;
+    ChessSearchLimits limits;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeCondition.wait(lock, [this]() { return m_hasRequest || m_isQuitting; });
+            if (m_isQuitting)
+                return;
+
+            position = m_requestPosition;
+            gameKeys.swap(m_requestKeys);
+            limits = m_requestLimits;
+            m_hasRequest = false;
+            m_isSearching = true;
+            m_stopFlag = false;
+            m_ponderFlag = m_isRequestPondering;
+        }
+
+        ChessSearchResult result = m_searcher.Search(position, gameKeys, limits, m_table, &m_stopFlag, &m_ponderFlag);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isSearching = false;
+        if (!m_hasRequest) //a newer request makes this result stale
+        {
+            m_result = result;
+            m_resultKey = position.GetKey();
+            m_hasResult = true;
+        }
+    }
+}
@@ -0,0 +1,48 @@
+﻿#pragma once
+#include "ChessSearch.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+//Runs a ChessSearcher on its own thread so the caller never waits on a search. Start hands a position over and
+//returns at once, the result is picked up later with TryTakeResult. Starting again or stopping aborts the running
+//search within a few thousand nodes, and the thread sleeps while there is nothing to search
+class ChessSearchWorker
+{
+public:
+    explicit ChessSearchWorker(int hashMB = 16, ChessNNUENetwork const* network = nullptr); //network as for ChessSearcher::SetNetwork
+    ~ChessSearchWorker(); //stops the search and joins the thread
+
+    //A pondering search ignores the limits until PonderHit, so it can run on a predicted position for as long as the
+    //opponent thinks and then finish as a normal search that has had all that time
+    void Start(ChessPosition const& position, std::vector<uint64_t> const& gameKeys, ChessSearchLimits const& limits, bool isPondering = false);
+    void PonderHit(); //the predicted position came up: the pondering search goes on, now under its limits
+    void Stop(); //the stopped search still delivers the best move of its last finished depth
+    bool IsSearching() const;
+    //False until the latest search has finished; out_positionKey is the key of the position it searched
+    bool TryTakeResult(ChessSearchResult& out_result, uint64_t& out_positionKey);
+
+private:
+    void ThreadMain();
+
+private:
+    ChessSearcher m_searcher; //only touched by the worker thread
+    ChessTranspositionTable m_table; //kept between searches, the next move reuses most of it
+    std::thread m_thread;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeCondition;
+    std::atomic<bool> m_stopFlag{ false };
+    std::atomic<bool> m_ponderFlag{ false };
+    bool m_isQuitting = false;
+    bool m_hasRequest = false;
+    bool m_isSearching = false;
+    bool m_hasResult = false;
+    ChessPosition m_requestPosition;
+    std::vector<uint64_t> m_requestKeys;
+    ChessSearchLimits m_requestLimits;
+    bool m_isRequestPondering = false;
+    ChessSearchResult m_result;
+    uint64_t m_resultKey = 0;
+};
@@ -0,0 +1,982 @@
+﻿#include "ChessTablebase.h"
+#include "ChessMoveGen.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+static char const s_materialLetters[NUM_CHESS_PIECE_TYPES] = { 'B', 'N', 'R', 'Q', 'K', 'P' };
+static ChessPieceType const s_materialOrder[NUM_CHESS_PIECE_TYPES] = {
+    ChessPieceType::King, ChessPieceType::Queen, ChessPieceType::Rook, ChessPieceType::Bishop, ChessPieceType::Knight, ChessPieceType::Pawn };
+static unsigned char const s_syzygyPieceTypes[NUM_CHESS_PIECE_TYPES] = { 3, 2, 4, 5, 6, 1 }; //Syzygy numbers PNBRQK 1-6
+
+//----------------------------------------------------------------------------------------------------------
+//Square tables of the Syzygy index, built by the compiler. A square's diagonal offset is its rank minus its file:
+//negative below the a1-h8 diagonal, zero on it
+constexpr int GetDiagonalOffset(int square) { return GetSquareY(square) - GetSquareX(square); }
+
+struct SyzygyIndexTables
+{
+    int m_mapPawns[NUM_BOARD_SQUARES] = {};   //a2-h7 to 47..0, edge files and low ranks highest: the leading pawn has the highest
+    int m_mapB1H1H7[NUM_BOARD_SQUARES] = {};  //squares below the diagonal to 0..27
+    int m_mapA1D1D4[NUM_BOARD_SQUARES] = {};  //the a1-d1-d4 triangle to 0..9, diagonal squares last
+    int m_mapKK[10][NUM_BOARD_SQUARES] = {};  //both kings to 0..461, the first one in the triangle
+    int m_binomial[6][NUM_BOARD_SQUARES] = {}; //[k][n], ways to choose k of n
+    int m_leadPawnIndex[6][NUM_BOARD_SQUARES] = {}; //[leading pawns][square of the leading one]
+    int m_leadPawnsSize[6][4] = {};           //[leading pawns][file a-d]
+    int m_numKingPairs = 0;
+};
+
+constexpr SyzygyIndexTables MakeSyzygyIndexTables()
+{
+    SyzygyIndexTables tables;
+    int code = 0;
+    for (int square = 0; square < NUM_BOARD_SQUARES; ++square)
+    {
+        if (GetDiagonalOffset(square) < 0)
+        {
+            tables.m_mapB1H1H7[square] = code++;
+        }
+    }
+
+    code = 0;
+    int diagonal[4] = {};
+    int numDiagonal = 0;
+    for (int square = 0; square <= GetSquareAt(3, 3); ++square)
+    {
+        if (GetDiagonalOffset(square) < 0 && GetSquareX(square) <= 3)
+        {
+            tables.m_mapA1D1D4[square] = code++;
+        }
+        else if (GetDiagonalOffset(square) == 0 && GetSquareX(square) <= 3)
+        {
+            diagonal[numDiagonal++] = square;
+        }
+    }
+    for (int diagonalIndex = 0; diagonalIndex < numDiagonal; ++diagonalIndex)
+    {
+        tables.m_mapA1D1D4[diagonal[diagonalIndex]] = code++;
+    }
+
+    //Kings apart; with the first one on the diagonal the second is not above it. Pairs both on the diagonal come last
+    int bothOnDiagonal[4 * NUM_BOARD_SQUARES][2] = {};
+    int numBothOnDiagonal = 0;
+    code = 0;
+    for (int triangleIndex = 0; triangleIndex < 10; ++triangleIndex)
+    {
+        for (int first = 0; first <= GetSquareAt(3, 3); ++first)
+        {
+            if (tables.m_mapA1D1D4[first] != triangleIndex || (triangleIndex == 0 && first != GetSquareAt(1, 0)))
+                continue;
+
+            for (int second = 0; second < NUM_BOARD_SQUARES; ++second)
+            {
+                if (((GetKingAttacks(first) | GetSquareBit(first)) & GetSquareBit(second)) != 0)
+                    continue;
+                if (GetDiagonalOffset(first) == 0 && GetDiagonalOffset(second) > 0)
+                    continue;
+
+                if (GetDiagonalOffset(first) == 0 && GetDiagonalOffset(second) == 0)
+                {
+                    bothOnDiagonal[numBothOnDiagonal][0] = triangleIndex;
+                    bothOnDiagonal[numBothOnDiagonal++][1] = second;
+                }
+                else
+                {
+                    tables.m_mapKK[triangleIndex][second] = code++;
+                }
+            }
+        }
+    }
+    for (int pairIndex = 0; pairIndex < numBothOnDiagonal; ++pairIndex)
+    {
+        tables.m_mapKK[bothOnDiagonal[pairIndex][0]][bothOnDiagonal[pairIndex][1]] = code++;
+    }
+    tables.m_numKingPairs = code;
+
+    tables.m_binomial[0][0] = 1;
+    for (int n = 1; n < NUM_BOARD_SQUARES; ++n)
+    {
+        for (int k = 0; k < 6 && k <= n; ++k)
+        {
+            tables.m_binomial[k][n] = (k > 0 ? tables.m_binomial[k - 1][n - 1] : 0) + (k < n ? tables.m_binomial[k][n - 1] : 0);
+        }
+    }
+
+    //A leading pawn on a square leaves MapPawns of it squares to the others: 47 on a2, two fewer per rank or file inward
+    int availableSquares = 47;
+    for (int numLeadPawns = 1; numLeadPawns <= 5; ++numLeadPawns)
+    {
+        for (int file = 0; file < 4; ++file)
+        {
+            int index = 0;
+            for (int y = 1; y <= 6; ++y)
+            {
+                int square = GetSquareAt(file, y);
+                if (numLeadPawns == 1)
+                {
+                    tables.m_mapPawns[square] = availableSquares--;
+                    tables.m_mapPawns[square ^ 7] = availableSquares--;
+                }
+                tables.m_leadPawnIndex[numLeadPawns][square] = index;
+                index += tables.m_binomial[numLeadPawns - 1][tables.m_mapPawns[square]];
+            }
+            tables.m_leadPawnsSize[numLeadPawns][file] = index;
+        }
+    }
+    return tables;
+}
+
+static constexpr SyzygyIndexTables s_indexTables = MakeSyzygyIndexTables();
+static_assert(s_indexTables.m_numKingPairs == 462, "two kings have 462 placements up to symmetry");
+static_assert(s_indexTables.m_mapA1D1D4[GetSquareAt(1, 0)] == 0 && s_indexTables.m_mapA1D1D4[GetSquareAt(3, 3)] == 9, "b1 first, d4 last");
+static_assert(s_indexTables.m_mapPawns[GetSquareAt(0, 1)] == 47 && s_indexTables.m_mapPawns[GetSquareAt(4, 6)] == 0, "a2 leads, e7 trails");
+
+//Leading group of three different pieces: first below the diagonal, or on it with the second below, and so on
+constexpr uint64_t SYZYGY_UNIQUE_LEAD_SIZE = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + 4 * 7 * 6;
+static_assert(SYZYGY_UNIQUE_LEAD_SIZE == 31332, "three unique pieces have 31332 placements up to symmetry");
+
+//----------------------------------------------------------------------------------------------------------
+static uint16_t ReadLittleEndian16(unsigned char const* data) { return (uint16_t)(data[0] | (data[1] << 8)); }
+static uint32_t ReadLittleEndian32(unsigned char const* data) { return (uint32_t)ReadLittleEndian16(data) | ((uint32_t)ReadLittleEndian16(data + 2) << 16); }
+static uint32_t ReadBigEndian32(unsigned char const* data) { return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3]; }
+static uint64_t ReadBigEndian64(unsigned char const* data) { return ((uint64_t)ReadBigEndian32(data) << 32) | ReadBigEndian32(data + 4); }
+
+static int GetLeftSymbol(unsigned char const* tree, int symbol) { return ((tree[3 * symbol + 1] & 0xF) << 8) | tree[3 * symbol]; }
+static int GetRightSymbol(unsigned char const* tree, int symbol) { return (tree[3 * symbol + 2] << 4) | (tree[3 * symbol + 1] >> 4); }
+
+static ChessTablebaseWDL Negate(ChessTablebaseWDL wdl) { return (ChessTablebaseWDL)(-(int)wdl); }
+static int GetSign(int value) { return (value > 0) - (value < 0); }
+
+//The DTZ of the move before a zeroing move that reaches wdl, which the DTZ tables do not store
+static int GetDTZBeforeZeroing(ChessTablebaseWDL wdl)
+{
+    switch (wdl)
+    {
+    case ChessTablebaseWDL::Win:         return 1;
+    case ChessTablebaseWDL::CursedWin:   return 101;
+    case ChessTablebaseWDL::BlessedLoss: return -101;
+    case ChessTablebaseWDL::Loss:        return -1;
+    default:                             return 0;
+    }
+}
+
+static bool IsCaptureMove(ChessPosition const& position, ChessMove const& move)
+{
+    return move.IsCapture() || !position.IsEmpty(move.m_to); //capture-promotions are promotions to ChessMove
+}
+
+//----------------------------------------------------------------------------------------------------------
+static std::string GetSideLetters(ChessPosition const& position, int kishiID)
+{
+    std::string letters;
+    for (ChessPieceType type : s_materialOrder)
+    {
+        letters.append(CountBits(position.GetPieces(kishiID, type)), s_materialLetters[(int)type]);
+    }
+    return letters;
+}
+
+std::string GetChessMaterialName(ChessPosition const& position)
+{
+    return GetSideLetters(position, KISHI_WHITE) + "v" + GetSideLetters(position, KISHI_BLACK);
+}
+
+//Count of each piece type in one side's letters, false unless they are in KQRBNP order with exactly one king
+static bool CountSideLetters(std::string const& letters, int out_counts[NUM_CHESS_PIECE_TYPES])
+{
+    std::string sorted;
+    for (ChessPieceType type : s_materialOrder)
+    {
+        out_counts[(int)type] = (int)std::count(letters.begin(), letters.end(), s_materialLetters[(int)type]);
+        sorted.append(out_counts[(int)type], s_materialLetters[(int)type]);
+    }
+    return sorted == letters && out_counts[(int)ChessPieceType::King] == 1;
+}
+
+bool GetChessTablebaseMaterial(std::string const& name, ChessTablebaseMaterial& out_material)
+{
+    size_t separatorPos = name.find('v');
+    int counts[2][NUM_CHESS_PIECE_TYPES] = {};
+    if (separatorPos == std::string::npos || !CountSideLetters(name.substr(0, separatorPos), counts[0])
+        || !CountSideLetters(name.substr(separatorPos + 1), counts[1]) || (int)name.size() - 1 > MAX_CHESS_TABLEBASE_PIECES)
+        return false;
+
+    ChessTablebaseMaterial material;
+    material.m_name = name;
+    material.m_numPieces = (int)name.size() - 1;
+    material.m_isSymmetric = memcmp(counts[0], counts[1], sizeof(counts[0])) == 0;
+    for (int side = 0; side < 2; ++side)
+    {
+        for (int typeIndex = 0; typeIndex < NUM_CHESS_PIECE_TYPES; ++typeIndex)
+        {
+            material.m_hasUniquePieces |= (typeIndex != (int)ChessPieceType::King && counts[side][typeIndex] == 1);
+        }
+    }
+    int whitePawns = counts[0][(int)ChessPieceType::Pawn];
+    int blackPawns = counts[1][(int)ChessPieceType::Pawn];
+    material.m_hasPawns = whitePawns + blackPawns > 0;
+    material.m_isLeadPawnWhite = blackPawns == 0 || (whitePawns > 0 && blackPawns >= whitePawns);
+    material.m_pawnCounts[0] = material.m_isLeadPawnWhite ? whitePawns : blackPawns;
+    material.m_pawnCounts[1] = material.m_isLeadPawnWhite ? blackPawns : whitePawns;
+    out_material = material;
+    return true;
+}
+
+uint64_t ChessTablebaseEncoding::GetSize() const
+{
+    int numGroups = 0;
+    while (numGroups < MAX_CHESS_TABLEBASE_PIECES && m_groupLengths[numGroups] != 0)
+    {
+        ++numGroups;
+    }
+    return m_groupFactors[numGroups];
+}
+
+void SetChessTablebaseGroups(ChessTablebaseMaterial const& material, int const order[2], int file, ChessTablebaseEncoding& inout_encoding)
+{
+    //Pieces of the same kind are one group, except the leading group: the leading pawns, three unique pieces or the kings
+    int* groupLengths = inout_encoding.m_groupLengths;
+    int numGroups = 0;
+    int leadLength = material.m_hasPawns ? 0 : material.m_hasUniquePieces ? 3 : 2;
+    groupLengths[0] = 1;
+    for (int pieceIndex = 1; pieceIndex < inout_encoding.m_numPieces; ++pieceIndex)
+    {
+        if (--leadLength > 0 || inout_encoding.m_pieces[pieceIndex] == inout_encoding.m_pieces[pieceIndex - 1])
+        {
+            ++groupLengths[numGroups];
+        }
+        else
+        {
+            groupLengths[++numGroups] = 1;
+        }
+    }
+    groupLengths[++numGroups] = 0;
+
+    //The index is g1 * N(g2) * N(g3) + g2 * N(g3) + g3 over the groups in the file's order, N(g) their placements
+    bool hasOtherPawns = material.m_hasPawns && material.m_pawnCounts[1] > 0;
+    int nextGroup = hasOtherPawns ? 2 : 1;
+    int freeSquares = NUM_BOARD_SQUARES - groupLengths[0] - (hasOtherPawns ? groupLengths[1] : 0);
+    uint64_t factor = 1;
+    for (int rank = 0; nextGroup < numGroups || rank == order[0] || rank == order[1]; ++rank)
+    {
+        if (rank == order[0])
+        {
+            inout_encoding.m_groupFactors[0] = factor;
+            factor *= material.m_hasPawns ? (uint64_t)s_indexTables.m_leadPawnsSize[groupLengths[0]][file]
+                : material.m_hasUniquePieces ? SYZYGY_UNIQUE_LEAD_SIZE : (uint64_t)s_indexTables.m_numKingPairs;
+        }
+        else if (rank == order[1])
+        {
+            inout_encoding.m_groupFactors[1] = factor;
+            factor *= s_indexTables.m_binomial[groupLengths[1]][48 - groupLengths[0]];
+        }
+        else
+        {
+            inout_encoding.m_groupFactors[nextGroup] = factor;
+            factor *= s_indexTables.m_binomial[groupLengths[nextGroup]][freeSquares];
+            freeSquares -= groupLengths[nextGroup++];
+        }
+    }
+    inout_encoding.m_groupFactors[numGroups] = factor;
+}
+
+uint64_t GetChessTablebaseIndex(ChessTablebaseMaterial const& material, ChessTablebaseEncoding const* fileEncodings, ChessPosition const& position,
+    bool isFlipped, int& out_file)
+{
+    SyzygyIndexTables const& tables = s_indexTables;
+    auto isPawnBefore = [&tables](int square, int otherSquare) { return tables.m_mapPawns[square] < tables.m_mapPawns[otherSquare]; };
+    int const flipColor = isFlipped ? 8 : 0;
+    int const flipSquares = isFlipped ? 56 : 0;
+    int squares[MAX_CHESS_TABLEBASE_PIECES] = {};
+    unsigned char pieces[MAX_CHESS_TABLEBASE_PIECES] = {};
+    int numSquares = 0;
+    int numLeadPawns = 0;
+    int file = 0;
+
+    //Pawn tables are split by the file of the leading pawn, the one nearest the edge and then the lowest
+    Bitboard leadPawns = 0;
+    if (material.m_hasPawns)
+    {
+        bool isLeadBlack = ((fileEncodings[0].m_pieces[0] ^ flipColor) & 8) != 0;
+        leadPawns = position.GetPieces(isLeadBlack ? KISHI_BLACK : KISHI_WHITE, ChessPieceType::Pawn);
+        for (Bitboard bits = leadPawns; bits != 0;)
+        {
+            squares[numSquares++] = PopLowestSquare(bits) ^ flipSquares;
+        }
+        numLeadPawns = numSquares;
+        std::swap(squares[0], *std::max_element(squares, squares + numLeadPawns, isPawnBefore));
+        file = std::min(GetSquareX(squares[0]), BOARD_SIZE - 1 - GetSquareX(squares[0]));
+    }
+
+    ChessTablebaseEncoding const& encoding = fileEncodings[file];
+    for (Bitboard bits = position.GetOccupied() & ~leadPawns; bits != 0;)
+    {
+        int square = PopLowestSquare(bits);
+        unsigned char code = position.GetPieceCodeAt(square);
+        squares[numSquares] = square ^ flipSquares;
+        pieces[numSquares++] = (unsigned char)((s_syzygyPieceTypes[(int)GetPieceCodeType(code)] | (GetPieceCodeKishi(code) == KISHI_BLACK ? 8 : 0)) ^ flipColor);
+    }
+    //Into the sub-table's piece order
+    for (int pieceIndex = numLeadPawns; pieceIndex < numSquares - 1; ++pieceIndex)
+    {
+        for (int otherIndex = pieceIndex + 1; otherIndex < numSquares; ++otherIndex)
+        {
+            if (encoding.m_pieces[pieceIndex] == pieces[otherIndex])
+            {
+                std::swap(pieces[pieceIndex], pieces[otherIndex]);
+                std::swap(squares[pieceIndex], squares[otherIndex]);
+                break;
+            }
+        }
+    }
+
+    //Mirror the leading piece onto files a-d
+    if (GetSquareX(squares[0]) >= BOARD_SIZE / 2)
+    {
+        for (int squareIndex = 0; squareIndex < numSquares; ++squareIndex)
+        {
+            squares[squareIndex] ^= 7;
+        }
+    }
+
+    uint64_t index = 0;
+    if (material.m_hasPawns)
+    {
+        index = tables.m_leadPawnIndex[numLeadPawns][squares[0]];
+        std::stable_sort(squares + 1, squares + numLeadPawns, isPawnBefore);
+        for (int pawnIndex = 1; pawnIndex < numLeadPawns; ++pawnIndex)
+        {
+            index += tables.m_binomial[pawnIndex][tables.m_mapPawns[squares[pawnIndex]]];
+        }
+    }
+    else
+    {
+        //Without pawns the board also mirrors top to bottom and along the diagonal: the leading piece goes into the
+        //a1-d1-d4 triangle, the first leading piece off the diagonal below it
+        if (GetSquareY(squares[0]) >= BOARD_SIZE / 2)
+        {
+            for (int squareIndex = 0; squareIndex < numSquares; ++squareIndex)
+            {
+                squares[squareIndex] ^= 56;
+            }
+        }
+        for (int squareIndex = 0; squareIndex < encoding.m_groupLengths[0]; ++squareIndex)
+        {
+            if (GetDiagonalOffset(squares[squareIndex]) == 0)
+                continue;
+
+            if (GetDiagonalOffset(squares[squareIndex]) > 0)
+            {
+                for (int otherIndex = squareIndex; otherIndex < numSquares; ++otherIndex)
+                {
+                    squares[otherIndex] = ((squares[otherIndex] >> 3) | (squares[otherIndex] << 3)) & 63;
+                }
+            }
+            break;
+        }
+
+        if (material.m_hasUniquePieces)
+        {
+            int const first = squares[0];
+            int const second = squares[1];
+            int const third = squares[2];
+            int const adjust1 = (second > first) ? 1 : 0;
+            int const adjust2 = ((third > first) ? 1 : 0) + ((third > second) ? 1 : 0);
+            if (GetDiagonalOffset(first) != 0)
+            {
+                index = ((uint64_t)tables.m_mapA1D1D4[first] * 63 + (second - adjust1)) * 62 + (third - adjust2);
+            }
+            else if (GetDiagonalOffset(second) != 0)
+            {
+                index = ((uint64_t)6 * 63 + GetSquareY(first) * 28 + tables.m_mapB1H1H7[second]) * 62 + (third - adjust2);
+            }
+            else if (GetDiagonalOffset(third) != 0)
+            {
+                index = 6 * 63 * 62 + 4 * 28 * 62 + GetSquareY(first) * 7 * 28 + (GetSquareY(second) - adjust1) * 28 + tables.m_mapB1H1H7[third];
+            }
+            else
+            {
+                index = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + GetSquareY(first) * 7 * 6 + (GetSquareY(second) - adjust1) * 6
+                    + (GetSquareY(third) - adjust2);
+            }
+        }
+        else
+        {
+            index = tables.m_mapKK[tables.m_mapA1D1D4[squares[0]]][squares[1]];
+        }
+    }
+    index *= encoding.m_groupFactors[0];
+
+    //The other groups, each as a combination of its squares, skipping the squares taken by the groups before it
+    int* groupSquares = squares + encoding.m_groupLengths[0];
+    bool isOtherPawnGroup = material.m_hasPawns && material.m_pawnCounts[1] > 0;
+    for (int group = 1; encoding.m_groupLengths[group] != 0; ++group)
+    {
+        int const groupLength = encoding.m_groupLengths[group];
+        std::stable_sort(groupSquares, groupSquares + groupLength);
+        uint64_t groupIndex = 0;
+        for (int squareIndex = 0; squareIndex < groupLength; ++squareIndex)
+        {
+            int const square = groupSquares[squareIndex];
+            int const numTakenBelow = (int)std::count_if(squares, groupSquares, [square](int takenSquare) { return square > takenSquare; });
+            groupIndex += tables.m_binomial[squareIndex + 1][square - numTakenBelow - (isOtherPawnGroup ? 8 : 0)];
+        }
+        isOtherPawnGroup = false;
+        index += groupIndex * encoding.m_groupFactors[group];
+        groupSquares += groupLength;
+    }
+    out_file = file;
+    return index;
+}
+
+//----------------------------------------------------------------------------------------------------------
+int ChessTablebase::Open(std::string const& directory, std::string& out_error)
+{
+    Close();
+    std::error_code errorCode;
+    if (!std::filesystem::exists(directory, errorCode))
+        return 0; //no tables installed is not an error
+
+    std::filesystem::directory_iterator directoryIterator(directory, errorCode);
+    if (errorCode)
+    {
+        out_error = "cannot read " + directory;
+        return 0;
+    }
+
+    for (std::filesystem::directory_entry const& entry : directoryIterator)
+    {
+        std::filesystem::path const& path = entry.path();
+        if (path.extension() != SYZYGY_WDL_EXTENSION)
+            continue;
+
+        std::string materialName = path.stem().string();
+        std::unique_ptr<Table> table = std::make_unique<Table>();
+        if (!GetChessTablebaseMaterial(materialName, table->m_material))
+        {
+            out_error = path.string() + " is not named after its material, e.g. KQvKR" + SYZYGY_WDL_EXTENSION;
+            continue;
+        }
+        if (!ReadTable(path.string(), false, *table, out_error))
+            continue;
+
+        //A win or loss needs the DTZ table as well, but the WDL table alone still serves draws and the search
+        std::filesystem::path dtzPath = path;
+        dtzPath.replace_extension(SYZYGY_DTZ_EXTENSION);
+        if (std::filesystem::exists(dtzPath, errorCode) && ReadTable(dtzPath.string(), true, *table, out_error))
+        {
+            table->m_hasDTZ = true;
+            ++m_numDTZTables;
+        }
+
+        std::string swappedName = materialName.substr(materialName.find('v') + 1) + "v" + materialName.substr(0, materialName.find('v'));
+        m_tablesByMaterial[materialName] = { table.get(), false };
+        if (swappedName != materialName)
+        {
+            m_tablesByMaterial[swappedName] = { table.get(), true };
+        }
+        m_maxPieces = std::max(m_maxPieces, table->m_material.m_numPieces);
+        m_tables.push_back(std::move(table));
+    }
+    return (int)m_tables.size();
+}
+
+void ChessTablebase::Close()
+{
+    m_tablesByMaterial.clear();
+    m_tables.clear();
+    m_numDTZTables = 0;
+    m_maxPieces = 0;
+}
+
+bool ChessTablebase::HasTable(std::string const& materialName) const
+{
+    return m_tablesByMaterial.count(materialName) != 0;
+}
+
+//Sets up every sub-table of one file: piece orders and groups, then the Huffman headers, DTZ maps, sparse indices,
+//block lengths and blocks, each section for all sub-tables in turn
+bool ChessTablebase::ReadTable(std::string const& path, bool isDTZ, Table& inout_table, std::string& out_error)
+{
+    ChessMappedFile& file = isDTZ ? inout_table.m_dtzFile : inout_table.m_wdlFile;
+    if (!file.Open(path))
+    {
+        out_error = "cannot map " + path;
+        return false;
+    }
+
+    ChessTablebaseMaterial const& material = inout_table.m_material;
+    unsigned char const* data = file.GetData();
+    uint64_t const size = file.GetSize();
+    unsigned char const* magic = isDTZ ? SYZYGY_DTZ_MAGIC : SYZYGY_WDL_MAGIC;
+    unsigned char const expectedHeader = (material.m_isSymmetric ? 0 : SYZYGY_FILE_SPLIT) | (material.m_hasPawns ? SYZYGY_FILE_HAS_PAWNS : 0);
+    if (size < 5 || memcmp(data, magic, 4) != 0 || data[4] != expectedHeader)
+    {
+        out_error = path + " is not a Syzygy table for " + material.m_name;
+        file.Close();
+        return false;
+    }
+
+    int const numFiles = material.m_hasPawns ? 4 : 1;
+    int const numSides = (!isDTZ && !material.m_isSymmetric) ? 2 : 1;
+    bool const hasOtherPawns = material.m_hasPawns && material.m_pawnCounts[1] > 0;
+    auto getEncoding = [&inout_table, isDTZ](int side, int file) -> ChessTablebaseEncoding& {
+        return isDTZ ? inout_table.m_dtzEncodings[file] : inout_table.m_wdlEncodings[side][file]; };
+    auto getPairs = [&inout_table, isDTZ](int side, int file) -> Pairs& {
+        return isDTZ ? inout_table.m_dtz[file] : inout_table.m_wdl[side][file]; };
+
+    uint64_t offset = 5;
+    bool isTruncated = false;
+    for (int fileIndex = 0; fileIndex < numFiles && !isTruncated; ++fileIndex)
+    {
+        isTruncated = offset + 1 + (hasOtherPawns ? 1 : 0) + material.m_numPieces > size;
+        if (isTruncated)
+            break;
+
+        //Low nibbles describe the first side to move, high nibbles the second
+        int orders[2][2] = { { data[offset] & 0xF, hasOtherPawns ? data[offset + 1] & 0xF : 0xF },
+                             { data[offset] >> 4, hasOtherPawns ? data[offset + 1] >> 4 : 0xF } };
+        offset += hasOtherPawns ? 2 : 1;
+        for (int side = 0; side < numSides; ++side)
+        {
+            ChessTablebaseEncoding& encoding = getEncoding(side, fileIndex);
+            encoding.m_numPieces = material.m_numPieces;
+            for (int pieceIndex = 0; pieceIndex < material.m_numPieces; ++pieceIndex)
+            {
+                encoding.m_pieces[pieceIndex] = (unsigned char)((side == 0) ? (data[offset + pieceIndex] & 0xF) : (data[offset + pieceIndex] >> 4));
+            }
+            SetChessTablebaseGroups(material, orders[side], fileIndex, encoding);
+        }
+        offset += material.m_numPieces;
+    }
+    offset += offset & 1;
+
+    for (int fileIndex = 0; fileIndex < numFiles && !isTruncated; ++fileIndex)
+    {
+        for (int side = 0; side < numSides && !isTruncated; ++side)
+        {
+            isTruncated = !ReadPairs(file, getEncoding(side, fileIndex).GetSize(), offset, getPairs(side, fileIndex));
+        }
+    }
+
+    if (isDTZ && !isTruncated)
+    {
+        //Per file, four value lists (win, loss, cursed win, blessed loss) that the stored symbols index
+        uint64_t const mapOffset = offset;
+        inout_table.m_dtzMap = data + mapOffset;
+        for (int fileIndex = 0; fileIndex < numFiles && !isTruncated; ++fileIndex)
+        {
+            Pairs& pairs = getPairs(0, fileIndex);
+            if ((pairs.m_flags & SYZYGY_FLAG_MAPPED) == 0)
+                continue;
+
+            bool const isWide = (pairs.m_flags & SYZYGY_FLAG_WIDE) != 0;
+            offset += isWide ? (offset & 1) : 0;
+            for (int slot = 0; slot < 4 && !isTruncated; ++slot)
+            {
+                isTruncated = offset + (isWide ? 2 : 1) > size;
+                if (isTruncated)
+                    break;
+                pairs.m_mapIndices[slot] = (uint16_t)(isWide ? (offset - mapOffset) / 2 + 1 : offset - mapOffset + 1);
+                offset += isWide ? 2 * (uint64_t)ReadLittleEndian16(data + offset) + 2 : (uint64_t)data[offset] + 1;
+            }
+        }
+        offset += offset & 1;
+    }
+
+    for (int fileIndex = 0; fileIndex < numFiles; ++fileIndex)
+    {
+        for (int side = 0; side < numSides; ++side)
+        {
+            Pairs& pairs = getPairs(side, fileIndex);
+            pairs.m_sparseIndex = data + offset;
+            offset += pairs.m_numSparseEntries * 6;
+        }
+    }
+    for (int fileIndex = 0; fileIndex < numFiles; ++fileIndex)
+    {
+        for (int side = 0; side < numSides; ++side)
+        {
+            Pairs& pairs = getPairs(side, fileIndex);
+            pairs.m_blockLengths = data + offset;
+            offset += (uint64_t)pairs.m_numBlockLengths * 2;
+        }
+    }
+    for (int fileIndex = 0; fileIndex < numFiles; ++fileIndex)
+    {
+        for (int side = 0; side < numSides; ++side)
+        {
+            Pairs& pairs = getPairs(side, fileIndex);
+            offset = (offset + 63) & ~(uint64_t)63;
+            pairs.m_data = data + offset;
+            offset += pairs.m_numBlocks * pairs.m_blockSize;
+        }
+    }
+
+    if (isTruncated || offset > size)
+    {
+        out_error = path + " is truncated";
+        file.Close();
+        return false;
+    }
+    return true;
+}
+
+//Size of the values symbol expands to, minus one; pairs expand to both halves
+static int SetSymbolSize(unsigned char const* tree, int symbol, std::vector<bool>& inout_isVisited, std::vector<unsigned char>& inout_sizes)
+{
+    inout_isVisited[symbol] = true; //the tree is acyclic, a symbol is never its own descendant
+    int right = GetRightSymbol(tree, symbol);
+    if (right == 0xFFF)
+        return 0;
+
+    int left = GetLeftSymbol(tree, symbol);
+    if (left >= (int)inout_sizes.size() || right >= (int)inout_sizes.size())
+        return 0;
+    if (!inout_isVisited[left])
+    {
+        inout_sizes[left] = (unsigned char)SetSymbolSize(tree, left, inout_isVisited, inout_sizes);
+    }
+    if (!inout_isVisited[right])
+    {
+        inout_sizes[right] = (unsigned char)SetSymbolSize(tree, right, inout_isVisited, inout_sizes);
+    }
+    return inout_sizes[left] + inout_sizes[right] + 1;
+}
+
+bool ChessTablebase::ReadPairs(ChessMappedFile const& file, uint64_t numValues, uint64_t& inout_offset, Pairs& out_pairs)
+{
+    unsigned char const* data = file.GetData() + inout_offset;
+    uint64_t bytesLeft = (inout_offset < file.GetSize()) ? file.GetSize() - inout_offset : 0;
+    if (bytesLeft < 2)
+        return false;
+
+    out_pairs.m_flags = data[0];
+    if (out_pairs.m_flags & SYZYGY_FLAG_SINGLE_VALUE)
+    {
+        out_pairs.m_minSymbolLength = data[1];
+        inout_offset += 2;
+        return true;
+    }
+
+    if (bytesLeft < 10 || data[1] > 30 || data[2] > 30)
+        return false;
+    out_pairs.m_blockSize = (uint64_t)1 << data[1];
+    out_pairs.m_span = (uint64_t)1 << data[2];
+    out_pairs.m_numSparseEntries = (numValues + out_pairs.m_span - 1) / out_pairs.m_span;
+    out_pairs.m_numBlocks = ReadLittleEndian32(data + 4);
+    out_pairs.m_numBlockLengths = out_pairs.m_numBlocks + data[3]; //padded so no sparse entry points past the end
+    int maxSymbolLength = data[8];
+    out_pairs.m_minSymbolLength = data[9];
+    //A code must fit the 32 bits refilled at a time
+    if (out_pairs.m_minSymbolLength < 1 || maxSymbolLength < out_pairs.m_minSymbolLength || maxSymbolLength > 32)
+        return false;
+
+    //Canonical Huffman: the lowest symbol of each code length, from which the lowest code of each length follows
+    int numLengths = maxSymbolLength - out_pairs.m_minSymbolLength + 1;
+    uint64_t position = 10;
+    if (bytesLeft < position + 2 * numLengths + 2)
+        return false;
+    out_pairs.m_lowestSymbols = data + position;
+    out_pairs.m_bases.assign(numLengths, 0);
+    for (int length = numLengths - 2; length >= 0; --length)
+    {
+        out_pairs.m_bases[length] = (out_pairs.m_bases[length + 1] + ReadLittleEndian16(data + position + 2 * length)
+            - ReadLittleEndian16(data + position + 2 * (length + 1))) / 2;
+    }
+    for (int length = 0; length < numLengths; ++length)
+    {
+        out_pairs.m_bases[length] <<= 64 - length - out_pairs.m_minSymbolLength;
+    }
+    position += 2 * numLengths;
+
+    int numSymbols = ReadLittleEndian16(data + position);
+    position += 2;
+    if (bytesLeft < position + 3 * numSymbols + (numSymbols & 1))
+        return false;
+    out_pairs.m_symbolTree = data + position;
+    out_pairs.m_symbolSizes.assign(numSymbols, 0);
+    std::vector<bool> isVisited(numSymbols, false);
+    for (int symbol = 0; symbol < numSymbols; ++symbol)
+    {
+        if (!isVisited[symbol])
+        {
+            out_pairs.m_symbolSizes[symbol] = (unsigned char)SetSymbolSize(out_pairs.m_symbolTree, symbol, isVisited, out_pairs.m_symbolSizes);
+        }
+    }
+    inout_offset += position + 3 * numSymbols + (numSymbols & 1);
+    return true;
+}
+
+//The sparse index names a block and an offset near the value; the block lengths walk from there to its block, which
+//is decoded symbol by symbol until the one covering the value, and that symbol's pair tree down to the value itself
+int ChessTablebase::DecodeValue(Pairs const& pairs, uint64_t index)
+{
+    if (pairs.m_flags & SYZYGY_FLAG_SINGLE_VALUE)
+        return pairs.m_minSymbolLength;
+
+    unsigned char const* sparseEntry = pairs.m_sparseIndex + 6 * (index / pairs.m_span);
+    uint32_t block = ReadLittleEndian32(sparseEntry);
+    int64_t offset = (int64_t)ReadLittleEndian16(sparseEntry + 4) + (int64_t)(index % pairs.m_span) - (int64_t)(pairs.m_span / 2);
+    while (offset < 0)
+    {
+        offset += ReadLittleEndian16(pairs.m_blockLengths + 2 * (--block)) + 1;
+    }
+    while (offset > ReadLittleEndian16(pairs.m_blockLengths + 2 * block))
+    {
+        offset -= ReadLittleEndian16(pairs.m_blockLengths + 2 * (block++)) + 1;
+    }
+
+    unsigned char const* blockData = pairs.m_data + block * pairs.m_blockSize;
+    uint64_t bits = ReadBigEndian64(blockData);
+    blockData += 8;
+    int numBits = 64;
+    int symbol = 0;
+    for (;;)
+    {
+        int length = 0; //above the minimum
+        while (bits < pairs.m_bases[length])
+        {
+            ++length;
+        }
+        symbol = (int)((bits - pairs.m_bases[length]) >> (64 - length - pairs.m_minSymbolLength))
+            + ReadLittleEndian16(pairs.m_lowestSymbols + 2 * length);
+        if (offset < pairs.m_symbolSizes[symbol] + 1)
+            break;
+
+        offset -= pairs.m_symbolSizes[symbol] + 1;
+        length += pairs.m_minSymbolLength;
+        bits <<= length;
+        numBits -= length;
+        if (numBits <= 32)
+        {
+            numBits += 32;
+            bits |= (uint64_t)ReadBigEndian32(blockData) << (64 - numBits);
+            blockData += 4;
+        }
+    }
+
+    while (pairs.m_symbolSizes[symbol] != 0)
+    {
+        int left = GetLeftSymbol(pairs.m_symbolTree, symbol);
+        if (offset < pairs.m_symbolSizes[left] + 1)
+        {
+            symbol = left;
+        }
+        else
+        {
+            offset -= pairs.m_symbolSizes[left] + 1;
+            symbol = GetRightSymbol(pairs.m_symbolTree, symbol);
+        }
+    }
+    return GetLeftSymbol(pairs.m_symbolTree, symbol);
+}
+
+//----------------------------------------------------------------------------------------------------------
+ChessTablebase::Table const* ChessTablebase::FindTable(ChessPosition const& position, bool& out_isFlipped) const
+{
+    auto found = m_tablesByMaterial.find(GetChessMaterialName(position));
+    if (found == m_tablesByMaterial.end())
+        return nullptr;
+
+    out_isFlipped = found->second.second;
+    return found->second.first;
+}
+
+//WDL value, or the DTZ in plies of a position whose result is wdl. Only what the file holds: no en passant, and
+//the DTZ of positions whose best move zeroes is not to be trusted
+int ChessTablebase::ProbeTable(ChessPosition const& position, bool isDTZ, ChessTablebaseWDL wdl, ProbeState& out_state) const
+{
+    if (CountBits(position.GetOccupied()) == 2)
+        return (int)ChessTablebaseWDL::Draw;
+
+    bool isBlackStronger = false;
+    Table const* table = FindTable(position, isBlackStronger);
+    if (table == nullptr || (isDTZ && !table->m_hasDTZ))
+    {
+        out_state = ProbeState::Fail;
+        return 0;
+    }
+
+    //Files store the side named first as white; a symmetric table stores white to move only, so black to move is
+    //probed with the colours swapped as well
+    ChessTablebaseMaterial const& material = table->m_material;
+    bool const isBlackToMove = (position.m_sideToMove == KISHI_BLACK);
+    bool const isFlipped = isBlackStronger || (material.m_isSymmetric && isBlackToMove);
+    int const sideToMove = (isFlipped != isBlackToMove) ? 1 : 0;
+    int file = 0;
+    if (!isDTZ)
+    {
+        uint64_t index = GetChessTablebaseIndex(material, table->m_wdlEncodings[sideToMove], position, isFlipped, file);
+        return DecodeValue(table->m_wdl[sideToMove][file], index) - 2;
+    }
+
+    uint64_t index = GetChessTablebaseIndex(material, table->m_dtzEncodings, position, isFlipped, file);
+    Pairs const& pairs = table->m_dtz[file];
+    if ((pairs.m_flags & SYZYGY_FLAG_STM) != sideToMove && !(material.m_isSymmetric && !material.m_hasPawns))
+    {
+        out_state = ProbeState::ChangeSideToMove;
+        return 0;
+    }
+
+    int value = DecodeValue(pairs, index);
+    if (pairs.m_flags & SYZYGY_FLAG_MAPPED)
+    {
+        static int const s_mapSlots[5] = { 1, 3, 0, 2, 0 }; //by wdl + 2
+        int mapIndex = pairs.m_mapIndices[s_mapSlots[(int)wdl + 2]] + value;
+        value = (pairs.m_flags & SYZYGY_FLAG_WIDE) ? ReadLittleEndian16(table->m_dtzMap + 2 * mapIndex) : table->m_dtzMap[mapIndex];
+    }
+
+    //Values in moves count the ply to the zeroing move once; cursed and blessed ones are always in moves
+    bool isInPlies = (wdl == ChessTablebaseWDL::Win && (pairs.m_flags & SYZYGY_FLAG_WIN_PLIES) != 0)
+        || (wdl == ChessTablebaseWDL::Loss && (pairs.m_flags & SYZYGY_FLAG_LOSS_PLIES) != 0);
+    return (isInPlies ? value : value * 2) + 1;
+}
+
+//Captures (and with isZeroingChecked pawn moves too) are searched before the table is trusted: the files hold no en
+//passant, and store a don't-care value where a capture is the best move. out_state is ZeroingBestMove when the
+//result comes from such a move
+ChessTablebaseWDL ChessTablebase::SearchCaptures(ChessPosition& position, bool isZeroingChecked, ProbeState& out_state) const
+{
+    ChessMoveList moves;
+    GenerateLegalMoves(position, moves);
+    ChessTablebaseWDL bestWDL = ChessTablebaseWDL::Loss;
+    int numSearched = 0;
+    for (ChessMove const& move : moves)
+    {
+        if (!IsCaptureMove(position, move) && !(isZeroingChecked && position.GetPieceTypeAt(move.m_from) == ChessPieceType::Pawn))
+            continue;
+
+        ++numSearched;
+        ChessUndoRecord undo;
+        position.MakeMove(move, undo);
+        ChessTablebaseWDL wdl = Negate(SearchCaptures(position, false, out_state));
+        position.UnmakeMove(undo);
+        if (out_state == ProbeState::Fail)
+            return ChessTablebaseWDL::Draw;
+
+        if (wdl > bestWDL)
+        {
+            bestWDL = wdl;
+            if (wdl == ChessTablebaseWDL::Win)
+            {
+                out_state = ProbeState::ZeroingBestMove;
+                return wdl;
+            }
+        }
+    }
+
+    //With every move searched the table is not needed, and may be wrong if one of them was en passant
+    bool const isEveryMoveSearched = numSearched > 0 && numSearched == moves.Size();
+    ChessTablebaseWDL wdl = bestWDL;
+    if (!isEveryMoveSearched)
+    {
+        wdl = (ChessTablebaseWDL)ProbeTable(position, false, ChessTablebaseWDL::Draw, out_state);
+        if (out_state == ProbeState::Fail)
+            return ChessTablebaseWDL::Draw;
+    }
+
+    if (bestWDL >= wdl)
+    {
+        out_state = (bestWDL > ChessTablebaseWDL::Draw || isEveryMoveSearched) ? ProbeState::ZeroingBestMove : ProbeState::OK;
+        return bestWDL;
+    }
+    out_state = ProbeState::OK;
+    return wdl;
+}
+
+//Signed DTZ in plies, +100 for cursed wins and blessed losses
+int ChessTablebase::ProbeDTZ(ChessPosition& position, ProbeState& out_state) const
+{
+    out_state = ProbeState::OK;
+    ChessTablebaseWDL wdl = SearchCaptures(position, true, out_state);
+    if (out_state == ProbeState::Fail || wdl == ChessTablebaseWDL::Draw)
+        return 0;
+    if (out_state == ProbeState::ZeroingBestMove)
+        return GetDTZBeforeZeroing(wdl);
+
+    int dtz = ProbeTable(position, true, wdl, out_state);
+    if (out_state == ProbeState::Fail)
+        return 0;
+    if (out_state != ProbeState::ChangeSideToMove)
+    {
+        bool isFiftyMoveDraw = (wdl == ChessTablebaseWDL::CursedWin || wdl == ChessTablebaseWDL::BlessedLoss);
+        return (dtz + (isFiftyMoveDraw ? 100 : 0)) * GetSign((int)wdl);
+    }
+
+    //The table holds the other side to move: one ply of search for the best DTZ among the moves keeping the result
+    int minDTZ = INT_MAX;
+    ChessMoveList moves;
+    GenerateLegalMoves(position, moves);
+    for (ChessMove const& move : moves)
+    {
+        bool isZeroing = IsCaptureMove(position, move) || position.GetPieceTypeAt(move.m_from) == ChessPieceType::Pawn;
+        ChessUndoRecord undo;
+        position.MakeMove(move, undo);
+        //A zeroing move counts as the DTZ of the position before it, searched only for the sign of its result
+        int moveDTZ = isZeroing ? -GetDTZBeforeZeroing(SearchCaptures(position, false, out_state)) : -ProbeDTZ(position, out_state);
+        if (moveDTZ == 1 && position.IsInCheck(position.m_sideToMove))
+        {
+            ChessMoveList replies;
+            GenerateLegalMoves(position, replies);
+            minDTZ = (replies.Size() == 0) ? 1 : minDTZ; //mate
+        }
+        moveDTZ += isZeroing ? 0 : GetSign(moveDTZ);
+        if (moveDTZ < minDTZ && GetSign(moveDTZ) == GetSign((int)wdl))
+        {
+            minDTZ = moveDTZ;
+        }
+        position.UnmakeMove(undo);
+        if (out_state == ProbeState::Fail)
+            return 0;
+    }
+    return (minDTZ == INT_MAX) ? -1 : minDTZ; //no legal moves: mated
+}
+
+bool ChessTablebase::ProbeWDL(ChessPosition const& position, ChessTablebaseWDL& out_wdl) const
+{
+    if (position.m_castlingRights != 0)
+        return false;
+
+    int numPieces = CountBits(position.GetOccupied());
+    if (numPieces == 2)
+    {
+        out_wdl = ChessTablebaseWDL::Draw;
+        return true;
+    }
+    if (numPieces > m_maxPieces)
+        return false;
+
+    ChessPosition searchPosition = position;
+    ProbeState state = ProbeState::OK;
+    ChessTablebaseWDL wdl = SearchCaptures(searchPosition, false, state);
+    if (state == ProbeState::Fail)
+        return false;
+
+    out_wdl = wdl;
+    return true;
+}
+
+bool ChessTablebase::Probe(ChessPosition const& position, ChessTablebaseResult& out_result) const
+{
+    ChessTablebaseWDL wdl = ChessTablebaseWDL::Draw;
+    if (!ProbeWDL(position, wdl))
+        return false;
+
+    out_result = ChessTablebaseResult();
+    out_result.m_wdl = wdl;
+    if (wdl == ChessTablebaseWDL::Draw)
+        return true;
+
+    ChessPosition searchPosition = position;
+    ProbeState state = ProbeState::OK;
+    int dtz = ProbeDTZ(searchPosition, state);
+    if (state == ProbeState::Fail)
+        return false;
+
+    out_result.m_dtz = std::abs(dtz);
+    return true;
+}
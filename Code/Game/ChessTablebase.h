@@ -0,0 +1,167 @@
+﻿#pragma once
+#include "ChessMappedFile.h"
+#include "ChessPosition.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------
+//Syzygy endgame tablebases, the format of the published 3-7 piece sets. Each material signature has a KQvKR.rtbw
+//file with the win/draw/loss of every position and a KQvKR.rtbz file with its distance to zeroing (plies to the next
+//capture, pawn move or mate with best play); the side named first is white in the file, positions with the colours
+//the other way round are probed mirrored. Values are Huffman coded in small blocks, so a probe decodes one block of
+//a mapped file and nothing is read into RAM. The indexing and decoding follow the reference prober's, see
+//https://github.com/syzygy1/tb for the format.
+//Results obey the fifty-move rule: a cursed win can only be won without it, a blessed loss is the other side of one.
+//Castling is never possible in a table, so positions with castling rights are not covered; en passant captures are
+//searched before the tables are trusted, as the files do not store them
+constexpr int MAX_CHESS_TABLEBASE_PIECES = 7;
+constexpr unsigned char SYZYGY_WDL_MAGIC[4] = { 0x71, 0xE8, 0x23, 0x5D };
+constexpr unsigned char SYZYGY_DTZ_MAGIC[4] = { 0xD7, 0x66, 0x0C, 0xA5 };
+char const* const SYZYGY_WDL_EXTENSION = ".rtbw";
+char const* const SYZYGY_DTZ_EXTENSION = ".rtbz";
+
+//Header byte of a file, then the flags byte of each of its sub-tables
+constexpr unsigned char SYZYGY_FILE_SPLIT = 1;      //white and black to move are stored apart (the sides differ)
+constexpr unsigned char SYZYGY_FILE_HAS_PAWNS = 2;  //one sub-table per file of the leading pawn, a to d
+constexpr unsigned char SYZYGY_FLAG_STM = 1;        //DTZ: the side to move stored, 0 white
+constexpr unsigned char SYZYGY_FLAG_MAPPED = 2;     //DTZ: values go through a per-result map
+constexpr unsigned char SYZYGY_FLAG_WIN_PLIES = 4;  //DTZ: wins are stored in plies, not moves
+constexpr unsigned char SYZYGY_FLAG_LOSS_PLIES = 8; //DTZ: losses are stored in plies, not moves
+constexpr unsigned char SYZYGY_FLAG_WIDE = 16;      //DTZ: the map holds 16-bit values
+constexpr unsigned char SYZYGY_FLAG_SINGLE_VALUE = 128; //every position has the same value, no blocks follow
+
+//For the side to move, in Syzygy's order so negating it swaps the sides
+enum class ChessTablebaseWDL : signed char
+{
+    Loss = -2,
+    BlessedLoss = -1, //lost, but drawn by the fifty-move rule
+    Draw = 0,
+    CursedWin = 1,    //won, but drawn by the fifty-move rule
+    Win = 2
+};
+
+struct ChessTablebaseResult
+{
+    ChessTablebaseWDL m_wdl = ChessTablebaseWDL::Draw;
+    //Plies to the next capture, pawn move or mate with best play, 0 for a draw and above 100 for a cursed win or
+    //blessed loss. Tables that store moves instead of plies can make it one ply too high, never too low
+    int m_dtz = 0;
+};
+
+//Material of one table, from its name: "KQvKR" has K and Q for the side named first (white in the file)
+struct ChessTablebaseMaterial
+{
+    std::string m_name;
+    int m_numPieces = 0;
+    bool m_isSymmetric = false; //both sides have the same pieces, only white to move is stored
+    bool m_hasPawns = false;
+    bool m_hasUniquePieces = false; //some side has exactly one piece of a type other than king
+    bool m_isLeadPawnWhite = false; //the side with the fewer pawns (but some) leads, white on a tie
+    int m_pawnCounts[2] = {};       //leading side, other side
+};
+
+//How one sub-table numbers its positions, as its file header lists it: the pieces in index order, grouped
+//Piece codes are 1-6 for PNBRQK, +8 for the side named second
+struct ChessTablebaseEncoding
+{
+    int m_numPieces = 0;
+    unsigned char m_pieces[MAX_CHESS_TABLEBASE_PIECES] = {};
+    int m_groupLengths[MAX_CHESS_TABLEBASE_PIECES + 1] = {}; //zero-terminated
+    uint64_t m_groupFactors[MAX_CHESS_TABLEBASE_PIECES + 1] = {}; //the one after the last group is the sub-table size
+
+    uint64_t GetSize() const;
+};
+
+//False if name is not one king per side plus known letters, at most MAX_CHESS_TABLEBASE_PIECES in all
+bool GetChessTablebaseMaterial(std::string const& name, ChessTablebaseMaterial& out_material);
+//Groups m_pieces, which must already be set. order[0] is the rank of the leading group in the index, order[1] that
+//of the other side's pawns (0xF when there are none); file is the leading pawn's, 0 without pawns
+void SetChessTablebaseGroups(ChessTablebaseMaterial const& material, int const order[2], int file, ChessTablebaseEncoding& inout_encoding);
+//Index of position in the sub-table for its side to move. fileEncodings has one encoding per leading pawn file (one
+//without pawns); isFlipped is true when black is the table's first side. out_file is the sub-table used
+uint64_t GetChessTablebaseIndex(ChessTablebaseMaterial const& material, ChessTablebaseEncoding const* fileEncodings, ChessPosition const& position,
+    bool isFlipped, int& out_file);
+//"KQvKR" for the pieces on the board, white first
+std::string GetChessMaterialName(ChessPosition const& position);
+
+//----------------------------------------------------------------------------------------------------------
+//Every .rtbw table found in one directory with its .rtbz, memory-mapped. Probe only reads the mappings, so any number
+//of threads may probe at once; opening and closing must happen while nobody probes
+class ChessTablebase
+{
+public:
+    //Replaces the tables opened before and returns how many WDL tables were mapped. A missing directory is no error;
+    //files that cannot be used are skipped and the last problem is left in out_error
+    int Open(std::string const& directory, std::string& out_error);
+    void Close();
+
+    int GetNumTables() const { return (int)m_tables.size(); }
+    int GetNumDTZTables() const { return m_numDTZTables; }
+    int GetMaxPieces() const { return m_maxPieces; }
+    bool HasTable(std::string const& materialName) const;
+
+    //False if the position is not covered: too many pieces, castling rights, or a table it or one of its captures
+    //needs is missing; a win or loss needs the DTZ tables too. A bare-kings position is always a draw
+    bool Probe(ChessPosition const& position, ChessTablebaseResult& out_result) const;
+    bool ProbeWDL(ChessPosition const& position, ChessTablebaseWDL& out_wdl) const; //WDL tables only
+
+private:
+    //Decoding state of one sub-table, pointing into the mapped file
+    struct Pairs
+    {
+        unsigned char m_flags = 0;
+        int m_minSymbolLength = 0; //the value itself for SYZYGY_FLAG_SINGLE_VALUE
+        uint64_t m_blockSize = 0;
+        uint64_t m_span = 0; //values between two sparse index entries
+        uint64_t m_numSparseEntries = 0;
+        uint32_t m_numBlocks = 0;
+        uint32_t m_numBlockLengths = 0; //padded past m_numBlocks so no sparse entry points out of range
+        unsigned char const* m_lowestSymbols = nullptr;
+        unsigned char const* m_symbolTree = nullptr; //3 bytes per symbol: left and right 12-bit children
+        unsigned char const* m_sparseIndex = nullptr;
+        unsigned char const* m_blockLengths = nullptr;
+        unsigned char const* m_data = nullptr;
+        std::vector<uint64_t> m_bases; //lowest code of each length, left-aligned in 64 bits
+        std::vector<unsigned char> m_symbolSizes; //values a symbol expands to, minus one
+        uint16_t m_mapIndices[4] = {}; //DTZ map offset of Win, Loss, CursedWin, BlessedLoss
+    };
+
+    struct Table
+    {
+        ChessTablebaseMaterial m_material;
+        ChessMappedFile m_wdlFile;
+        ChessMappedFile m_dtzFile;
+        ChessTablebaseEncoding m_wdlEncodings[2][4]; //[side to move, white first][leading pawn file]
+        ChessTablebaseEncoding m_dtzEncodings[4];    //one side to move only, see SYZYGY_FLAG_STM
+        Pairs m_wdl[2][4];
+        Pairs m_dtz[4];
+        unsigned char const* m_dtzMap = nullptr;
+        bool m_hasDTZ = false;
+    };
+
+    enum class ProbeState
+    {
+        Fail,
+        OK,
+        ChangeSideToMove, //the DTZ table stores the other side to move
+        ZeroingBestMove   //the best move is a capture or pawn move, the DTZ table may not hold this position
+    };
+
+    static bool ReadTable(std::string const& path, bool isDTZ, Table& inout_table, std::string& out_error);
+    static bool ReadPairs(ChessMappedFile const& file, uint64_t numValues, uint64_t& inout_offset, Pairs& out_pairs);
+    static int DecodeValue(Pairs const& pairs, uint64_t index);
+
+    Table const* FindTable(ChessPosition const& position, bool& out_isFlipped) const;
+    int ProbeTable(ChessPosition const& position, bool isDTZ, ChessTablebaseWDL wdl, ProbeState& out_state) const;
+    ChessTablebaseWDL SearchCaptures(ChessPosition& position, bool isZeroingChecked, ProbeState& out_state) const;
+    int ProbeDTZ(ChessPosition& position, ProbeState& out_state) const;
+
+private:
+    std::vector<std::unique_ptr<Table>> m_tables;
+    std::map<std::string, std::pair<Table const*, bool>> m_tablesByMaterial; //white-first name to table and whether it is flipped
+    int m_numDTZTables = 0;
+    int m_maxPieces = 0;
+};
@@ -0,0 +1,70 @@
+﻿#include "ChessTablebaseWorker.h"
+
+ChessTablebaseWorker::ChessTablebaseWorker(ChessTablebase const* tablebase)
+    : m_tablebase(tablebase)
+{
+    m_thread = std::thread(&ChessTablebaseWorker::ThreadMain, this);
+}
+
+ChessTablebaseWorker::~ChessTablebaseWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isQuitting = true;
+    }
+    m_wakeCondition.notify_one();
+    m_thread.join();
+}
+
+void ChessTablebaseWorker::Request(ChessPosition const& position)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requestPosition = position;
+        m_hasRequest = true;
+        m_hasResult = false;
+    }
+    m_wakeCondition.notify_one();
+}
+
+bool ChessTablebaseWorker::TryTakeResult(ChessTablebaseResult& out_result, bool& out_isFound, uint64_t& out_positionKey)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_hasResult)
+        return false;
+
+    out_result = m_result;
+    out_isFound = m_isResultFound;
+    out_positionKey = m_resultKey;
+    m_hasResult = false;
+    return true;
+}
+
+void ChessTablebaseWorker::ThreadMain()
+{
+    ChessPosition position;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeCondition.wait(lock, [this]() { return m_hasRequest || m_isQuitting; });
+            if (m_isQuitting)
+                return;
+
+            position = m_requestPosition;
+            m_hasRequest = false;
+        }
+
+        ChessTablebaseResult result;
+        bool isFound = m_tablebase->Probe(position, result);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_hasRequest) //a newer position is already waiting, this answer is stale
+        {
+            m_result = result;
+            m_isResultFound = isFound;
+            m_resultKey = position.GetKey();
+            m_hasResult = true;
+        }
+    }
+}
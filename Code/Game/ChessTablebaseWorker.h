@@ -0,0 +1,37 @@
+﻿#pragma once
+#include "ChessTablebase.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+//Probes a ChessTablebase on its own thread, so a probe that has to page its table in from disk never stalls the
+//frame. Request hands a position over and returns at once, TryTakeResult picks the answer up on a later frame; a new
+//request replaces one that has not been started yet
+class ChessTablebaseWorker
+{
+public:
+    explicit ChessTablebaseWorker(ChessTablebase const* tablebase); //tablebase must outlive the worker
+    ~ChessTablebaseWorker(); //joins the thread
+
+    void Request(ChessPosition const& position);
+    //False until the latest request has been probed; out_isFound is false if the tables do not cover the position
+    bool TryTakeResult(ChessTablebaseResult& out_result, bool& out_isFound, uint64_t& out_positionKey);
+
+private:
+    void ThreadMain();
+
+private:
+    ChessTablebase const* m_tablebase = nullptr;
+    std::thread m_thread;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCondition;
+    bool m_isQuitting = false;
+    bool m_hasRequest = false;
+    bool m_hasResult = false;
+    ChessPosition m_requestPosition;
+    ChessTablebaseResult m_result;
+    bool m_isResultFound = false;
+    uint64_t m_resultKey = 0;
+};
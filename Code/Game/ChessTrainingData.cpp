@@ -0,0 +1,116 @@
+﻿#include "ChessTrainingData.h"
+
+constexpr int RECORD_SCORE_OFFSET = CHESS_PACKED_POSITION_SIZE;
+constexpr int RECORD_RESULT_OFFSET = CHESS_PACKED_POSITION_SIZE + 2;
+
+static_assert(CHESS_TRAINING_RECORD_SIZE == CHESS_PACKED_POSITION_SIZE + 2 + 1 + 1, "record layout must add up to its fixed size");
+
+//----------------------------------------------------------------------------------------------------------
+void WriteChessTrainingRecord(ChessTrainingRecord const& record, unsigned char* out_bytes)
+{
+    for (int byteIndex = 0; byteIndex < CHESS_PACKED_POSITION_SIZE; ++byteIndex)
+    {
+        out_bytes[byteIndex] = record.m_position.m_bytes[byteIndex];
+    }
+    unsigned short score = (unsigned short)record.m_score;
+    out_bytes[RECORD_SCORE_OFFSET] = (unsigned char)(score & 0xFF);
+    out_bytes[RECORD_SCORE_OFFSET + 1] = (unsigned char)(score >> 8);
+    out_bytes[RECORD_RESULT_OFFSET] = record.m_result;
+    out_bytes[RECORD_RESULT_OFFSET + 1] = 0;
+}
+
+ChessTrainingRecord ReadChessTrainingRecord(unsigned char const* bytes)
+{
+    ChessTrainingRecord record;
+    for (int byteIndex = 0; byteIndex < CHESS_PACKED_POSITION_SIZE; ++byteIndex)
+    {
+        record.m_position.m_bytes[byteIndex] = bytes[byteIndex];
+    }
+    record.m_score = (short)(unsigned short)(bytes[RECORD_SCORE_OFFSET] | (bytes[RECORD_SCORE_OFFSET + 1] << 8));
+    record.m_result = bytes[RECORD_RESULT_OFFSET];
+    return record;
+}
+
+float GetChessResultScore(unsigned char result)
+{
+    return (result == CHESS_RESULT_WHITE_WIN) ? 1.0f : (result == CHESS_RESULT_BLACK_WIN) ? 0.0f : 0.5f;
+}
+
+//----------------------------------------------------------------------------------------------------------
+bool ChessTrainingDataWriter::Open(std::string const& path, bool isAppending, std::string& out_error)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file.is_open())
+    {
+        m_file.close();
+    }
+    m_file.clear();
+    m_file.open(path, std::ios::binary | (isAppending ? std::ios::app : std::ios::trunc));
+    if (!m_file)
+    {
+        out_error = "cannot open " + path + " for writing";
+        return false;
+    }
+    m_numWritten = 0;
+    return true;
+}
+
+void ChessTrainingDataWriter::Close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file.close();
+}
+
+bool ChessTrainingDataWriter::Append(std::vector<ChessTrainingRecord> const& records)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file)
+        return false;
+
+    m_bytes.resize(records.size() * CHESS_TRAINING_RECORD_SIZE);
+    for (size_t recordIndex = 0; recordIndex < records.size(); ++recordIndex)
+    {
+        WriteChessTrainingRecord(records[recordIndex], &m_bytes[recordIndex * CHESS_TRAINING_RECORD_SIZE]);
+    }
+    if (!m_file.write((char const*)m_bytes.data(), (std::streamsize)m_bytes.size()))
+        return false;
+
+    m_numWritten += records.size();
+    return true;
+}
+
+uint64_t ChessTrainingDataWriter::GetNumWritten() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_numWritten;
+}
+
+//----------------------------------------------------------------------------------------------------------
+bool ChessTrainingDataFile::Open(std::string const& path, std::string& out_error)
+{
+    Close();
+    if (!m_file.Open(path))
+    {
+        out_error = "cannot map " + path;
+        return false;
+    }
+    if (m_file.GetSize() % CHESS_TRAINING_RECORD_SIZE != 0)
+    {
+        out_error = path + " is not a whole number of " + std::to_string(CHESS_TRAINING_RECORD_SIZE) + "-byte training records";
+        m_file.Close();
+        return false;
+    }
+    m_numRecords = m_file.GetSize() / CHESS_TRAINING_RECORD_SIZE;
+    return true;
+}
+
+void ChessTrainingDataFile::Close()
+{
+    m_file.Close();
+    m_numRecords = 0;
+}
+
+ChessTrainingRecord ChessTrainingDataFile::GetRecord(uint64_t index) const
+{
+    return ReadChessTrainingRecord(m_file.GetData() + index * CHESS_TRAINING_RECORD_SIZE);
+}
@@ -0,0 +1,70 @@
+﻿#pragma once
+#include "ChessMappedFile.h"
+#include "ChessPackedPosition.h"
+
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------------------------------------------
+//Labelled positions for tuning the evaluation, as fixed-size little-endian records with no header, so a file is read by
+//mapping it and indexing, files concatenate into a bigger one, and a writer only ever appends
+//  [0, 32) the position, ChessPackedPosition
+//  [32, 34) search score in centipawns from the side to move's point of view, int16
+//  [34] game result from white's point of view, CHESS_RESULT_*
+//  [35] reserved, always 0
+constexpr int CHESS_TRAINING_RECORD_SIZE = 36;
+char const* const CHESS_TRAINING_EXTENSION = ".bin";
+
+constexpr unsigned char CHESS_RESULT_BLACK_WIN = 0;
+constexpr unsigned char CHESS_RESULT_DRAW = 1;
+constexpr unsigned char CHESS_RESULT_WHITE_WIN = 2;
+
+struct ChessTrainingRecord
+{
+    ChessPackedPosition m_position;
+    short m_score = 0;
+    unsigned char m_result = CHESS_RESULT_DRAW;
+};
+
+void WriteChessTrainingRecord(ChessTrainingRecord const& record, unsigned char* out_bytes); //CHESS_TRAINING_RECORD_SIZE bytes
+ChessTrainingRecord ReadChessTrainingRecord(unsigned char const* bytes);
+//The result as the fraction of a point white scored: 0, 0.5 or 1
+float GetChessResultScore(unsigned char result);
+
+//----------------------------------------------------------------------------------------------------------
+//Appends records to a training file. Append takes a whole game's records under one lock, so any number of threads
+//can share a writer and each game lands in the file in one piece
+class ChessTrainingDataWriter
+{
+public:
+    bool Open(std::string const& path, bool isAppending, std::string& out_error); //isAppending false truncates the file
+    void Close();
+
+    bool Append(std::vector<ChessTrainingRecord> const& records); //false once a write has failed
+    uint64_t GetNumWritten() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::ofstream m_file;
+    std::vector<unsigned char> m_bytes; //encoding buffer, reused under the lock
+    uint64_t m_numWritten = 0;
+};
+
+//----------------------------------------------------------------------------------------------------------
+//A training file mapped read-only: records are decoded where they lie, nothing is loaded up front
+class ChessTrainingDataFile
+{
+public:
+    bool Open(std::string const& path, std::string& out_error);
+    void Close();
+
+    bool IsOpen() const { return m_file.IsOpen(); }
+    uint64_t GetNumRecords() const { return m_numRecords; }
+    ChessTrainingRecord GetRecord(uint64_t index) const;
+
+private:
+    ChessMappedFile m_file;
+    uint64_t m_numRecords = 0;
+};
@@ -0,0 +1,28 @@
+﻿#include "ChessZobrist.h"
+
+uint64_t GetChessStateKey(ChessPosition const& position)
+{
+    uint64_t key = g_zobristKeys.m_castling[position.m_castlingRights];
+    if (position.m_enPassantSquare != NO_SQUARE &&
+        (GetPawnAttacks(1 - position.m_sideToMove, position.m_enPassantSquare) & position.GetPieces(position.m_sideToMove, ChessPieceType::Pawn)))
+    {
+        key ^= g_zobristKeys.m_enPassantFile[GetSquareX(position.m_enPassantSquare)];
+    }
+    if (position.m_sideToMove == KISHI_WHITE)
+    {
+        key ^= g_zobristKeys.m_whiteToMove;
+    }
+    return key;
+}
+
+uint64_t ComputeChessPositionKey(ChessPosition const& position)
+{
+    uint64_t key = GetChessStateKey(position);
+    Bitboard occupied = position.GetOccupied();
+    while (occupied)
+    {
+        int square = PopLowestSquare(occupied);
+        key ^= g_zobristKeys.m_pieces[position.GetKishiAt(square)][(int)position.GetPieceTypeAt(square)][square];
+    }
+    return key;
+}
@@ -0,0 +1,66 @@
+﻿#pragma once
+#include "ChessPosition.h"
+
+//Random keys for Zobrist position hashing, generated at compile time from a fixed seed so every build and peer agrees
+struct ChessZobristKeys
+{
+    uint64_t m_pieces[NUM_KISHI][NUM_CHESS_PIECE_TYPES][NUM_BOARD_SQUARES] = {};
+    uint64_t m_castling[CASTLE_ALL + 1] = {};
+    uint64_t m_enPassantFile[BOARD_SIZE] = {};
+    uint64_t m_whiteToMove = 0;
+};
+
+constexpr uint64_t GetNextZobristRandom(uint64_t& state)
+{
+    //splitmix64
+    state += 0x9E3779B97F4A7C15ull;
+    uint64_t mixed = state;
+    mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ull;
+    mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBull;
+    return mixed ^ (mixed >> 31);
+}
+
+constexpr ChessZobristKeys MakeChessZobristKeys()
+{
+    ChessZobristKeys keys;
+    uint64_t state = 0x43686573735A6F62ull;
+    for (int kishiIndex = 0; kishiIndex < NUM_KISHI; ++kishiIndex)
+    {
+        for (int typeIndex = 0; typeIndex < NUM_CHESS_PIECE_TYPES; ++typeIndex)
+        {
+            for (int square = 0; square < NUM_BOARD_SQUARES; ++square)
+            {
+                keys.m_pieces[kishiIndex][typeIndex][square] = GetNextZobristRandom(state);
+            }
+        }
+    }
+    //Castling keys are xor-combinations of four base keys so that rights can be dropped one at a time
+    uint64_t rightKeys[4] = {};
+    for (int rightIndex = 0; rightIndex < 4; ++rightIndex)
+    {
+        rightKeys[rightIndex] = GetNextZobristRandom(state);
+    }
+    for (int rights = 0; rights <= CASTLE_ALL; ++rights)
+    {
+        for (int rightIndex = 0; rightIndex < 4; ++rightIndex)
+        {
+            if (rights & (1 << rightIndex))
+            {
+                keys.m_castling[rights] ^= rightKeys[rightIndex];
+            }
+        }
+    }
+    for (int file = 0; file < BOARD_SIZE; ++file)
+    {
+        keys.m_enPassantFile[file] = GetNextZobristRandom(state);
+    }
+    keys.m_whiteToMove = GetNextZobristRandom(state);
+    return keys;
+}
+
+inline constexpr ChessZobristKeys g_zobristKeys = MakeChessZobristKeys();
+
+//Side to move, castling and en passant part of the key; the en passant file only counts when a pawn can actually take there
+uint64_t GetChessStateKey(ChessPosition const& position);
+//Full recomputation from the board, ChessPosition::GetKey is the incremental equivalent
+uint64_t ComputeChessPositionKey(ChessPosition const& position);
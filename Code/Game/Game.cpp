@@ -1,9 +1,12 @@
 ﻿#include "Game.hpp"
 
+#include "ChessEvaluation.h"
 #include "ChessObject.h"
+#include "ChessOpeningBook.h"
 #include "ChessPiece.h"
 #include "ChessPieceDefinition.h"
 #include "ChessReferee.h"
+#include "ChessTablebaseWorker.h"
 #include "Engine/Math/RandomNumberGenerator.hpp"
 #include "Engine/Math/AABB2.hpp"    
 #include "Engine/Math/AABB3.hpp"
@@ -46,6 +49,16 @@ Game::Game()
 
 Game::~Game()
 {
+	//First, while everything its analysis threads read is still alive; F8 or quitting can come mid-match
+	if (m_chessReferee)
+	{
+		for (ChessKishi* chessKishi : m_chessKishi)
+		{
+			chessKishi->m_lastMovedPiece = nullptr;
+		}
+		delete m_chessReferee; //stops and joins the analysis threads
+		m_chessReferee = nullptr;
+	}
 	ChessPieceDefinition::ClearDefinitions();
 
 	if (m_attractWidget)
@@ -58,6 +71,19 @@ Game::~Game()
 		delete w;
 		w = nullptr;
 	}
+	for (ChessKishi*& chessKishi : m_chessKishi)
+	{
+		delete chessKishi; //joins an AI kishi's search thread
+		chessKishi = nullptr;
+	}
+	delete m_evalNetwork; //after the kishi, their searches read it
+	m_evalNetwork = nullptr;
+	delete m_tablebaseWorker; //joins its thread before the tables it reads are unmapped
+	m_tablebaseWorker = nullptr;
+	delete m_tablebase;
+	m_tablebase = nullptr;
+	delete m_openingBook;
+	m_openingBook = nullptr;
  }
 
 void Game::Startup()
@@ -65,6 +91,67 @@ void Game::Startup()
 	PrintGameControlToDevConsole();
 	ChessPieceDefinition::InitializeChessPieceDefinitions();
 
+	//Before any board exists, positions only pick the weights up as pieces are placed
+	ChessEvaluationWeights evaluationWeights = ChessEvaluationWeights::GetDefaults();
+	std::string weightsError;
+	if (evaluationWeights.LoadFromFile("Data/Definitions/ChessEvaluation.xml", weightsError))
+	{
+		SetChessEvaluationWeights(evaluationWeights);
+	}
+	else
+	{
+		g_theDevConsole->AddLine(Rgba8::YELLOW, "WARNING: No evaluation weights (" + weightsError + "), using the built-in ones.");
+	}
+
+	std::string networkError;
+	m_evalNetwork = new ChessNNUENetwork();
+	if (!m_evalNetwork->LoadFromFile("Data/Networks/ChessEval.nnue", networkError))
+	{
+		g_theDevConsole->AddLine(Rgba8::YELLOW, "WARNING: No evaluation network (" + networkError + "), eval=nnue is unavailable.");
+		delete m_evalNetwork;
+		m_evalNetwork = nullptr;
+	}
+
+	//Only mapped here, a table is paged in by the probes that touch it
+	std::string tablebaseError;
+	m_tablebase = new ChessTablebase();
+	if (m_tablebase->Open("Data/Tablebases", tablebaseError) > 0)
+	{
+		g_theDevConsole->AddLine(Rgba8::LAVENDER, "Endgame tables: " + std::to_string(m_tablebase->GetNumTables()) + " Syzygy tables mapped ("
+			+ std::to_string(m_tablebase->GetNumDTZTables()) + " with DTZ), up to "
+			+ std::to_string(m_tablebase->GetMaxPieces()) + " pieces.");
+		m_tablebaseWorker = new ChessTablebaseWorker(m_tablebase);
+	}
+	else
+	{
+		delete m_tablebase;
+		m_tablebase = nullptr;
+	}
+	if (!tablebaseError.empty())
+	{
+		g_theDevConsole->AddLine(Rgba8::YELLOW, "WARNING: " + tablebaseError);
+	}
+
+	//Mapped like the tables, and shared with any other game running on this machine
+	std::string bookError;
+	std::string namesError;
+	m_openingBook = new ChessOpeningBook();
+	bool isBookOpen = m_openingBook->Open("Data/Books/ChessBook.bin", bookError);
+	bool areNamesLoaded = m_openingBook->LoadOpeningNames("Data/Books/ChessOpenings.txt", namesError);
+	if (!isBookOpen)
+	{
+		g_theDevConsole->AddLine(Rgba8::YELLOW, "WARNING: No opening book (" + bookError + "), the AI searches from the first move.");
+	}
+	if (!areNamesLoaded)
+	{
+		g_theDevConsole->AddLine(Rgba8::YELLOW, "WARNING: No opening names (" + namesError + ").");
+	}
+	if (!isBookOpen && !areNamesLoaded)
+	{
+		delete m_openingBook;
+		m_openingBook = nullptr;
+	}
+
 	ChessKishi* kishi1 = new ChessKishi(0);
 	ChessKishi* kishi2 = new ChessKishi(1);
 	m_chessKishi[0] = kishi1;
@@ -240,6 +327,7 @@ void Game::ExitState(GameState state)
 void Game::EnterAttractState()
 {
 	m_hasWon = false;
+	m_isDraw = false;
 	m_isRemote = false;
 	InitializeWidgetsForAttract();
 	if (m_attractWidget)
@@ -725,7 +813,7 @@ void Game::PlayingModeRender() const
 	{
 		std::vector<Vertex_PCU> verts;
 		AddVertsForAABB2D(verts, m_screenCamera.GetOrthographicBounds(), Rgba8(120,120,120,120));
-		AddVertsForTextTriangles2D(verts, "Win!", Vec2(720.f, 385.f),
+		AddVertsForTextTriangles2D(verts, m_isDraw ? "Draw!" : "Win!", Vec2(720.f, 385.f),
 				40.f, Rgba8::YELLOW);
 		g_theRenderer->BeginCamera(m_screenCamera);
 		//g_theRenderer->BindTexture(nullptr);
@@ -752,6 +840,21 @@ void Game::PlayingModeRender() const
 			AddVertsForTextTriangles2D(verts, "CameraMode (F4) Auto | GameState: First Player's Turn", Vec2(3.f, 771.f),
 				12.f, Rgba8::MINTGREEN);
 		}
+		std::string analysisText = m_chessReferee->GetAnalysisHUDText();
+		if (!analysisText.empty())
+		{
+			AddVertsForTextTriangles2D(verts, analysisText, Vec2(3.f, 757.f), 12.f, Rgba8::LAVENDER);
+		}
+		std::string tablebaseText = m_chessReferee->GetTablebaseHUDText();
+		if (!tablebaseText.empty())
+		{
+			AddVertsForTextTriangles2D(verts, tablebaseText, Vec2(3.f, 743.f), 12.f, Rgba8::LAVENDER);
+		}
+		std::string bookText = m_chessReferee->GetBookHUDText();
+		if (!bookText.empty())
+		{
+			AddVertsForTextTriangles2D(verts, bookText, Vec2(3.f, 729.f), 12.f, Rgba8::LAVENDER);
+		}
 		g_theRenderer->BeginCamera(m_screenCamera);
 		//g_theRenderer->BindTexture(nullptr);
 		g_theRenderer->BindShader(nullptr);
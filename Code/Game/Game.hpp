@@ -13,6 +13,9 @@
 
 class ChessReferee;
 class ChessObject;
+class ChessOpeningBook;
+class ChessTablebase;
+class ChessTablebaseWorker;
 class Player;
 class Clock;
 
@@ -56,8 +59,12 @@ public:
 	Player* m_player; //For camera
 	RaycastResult3D m_cameraRay;
 	
-	ChessReferee* m_chessReferee;
+	ChessReferee* m_chessReferee = nullptr; //only while playing, ~Game deletes it first if it is still there
 	ChessKishi* m_chessKishi[NUM_KISHI];
+	ChessNNUENetwork* m_evalNetwork = nullptr; //null if Data/Networks/ChessEval.nnue failed to load; searches only use it when asked with eval=nnue
+	ChessTablebase* m_tablebase = nullptr; //Syzygy endgame tables mapped from Data/Tablebases, null if there are none
+	ChessTablebaseWorker* m_tablebaseWorker = nullptr; //probes m_tablebase off the frame thread for whichever referee is running
+	ChessOpeningBook* m_openingBook = nullptr; //Data/Books/ChessBook.bin and the opening names, null if neither loaded
 
 	//state
 	GameState m_currentState = GameState::COUNT;
@@ -65,6 +72,7 @@ public:
 	Texture* m_attractCover = nullptr;
 
 	bool m_hasWon = false;
+	bool m_isDraw = false; //stalemate, m_hasWon is set too so everything that stops on game over still does
 
 	//debug rendering
 	float m_debugTime = 0.f;